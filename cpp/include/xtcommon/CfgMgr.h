@@ -69,12 +69,12 @@ public:
 	/**
 	* @brief copy constructor
 	*/
-	CfgMgr(const CfgMgr& from) {} // = delete;
+	CfgMgr(const CfgMgr&) {} // = delete;
 
 	/**
 	* @brief copy assignment
 	*/
-	CfgMgr& operator=(const CfgMgr& from) { return *this; } // = delete;
+	CfgMgr& operator=(const CfgMgr&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
@@ -70,12 +70,12 @@ namespace XT
 		/**
 		* @brief default copy constructor
 		*/
-		GlobalMgr(const GlobalMgr& from) {} // = delete;
+		GlobalMgr(const GlobalMgr&) {} // = delete;
 
 		/**
 		* @brief default copy assignment
 		*/
-		GlobalMgr& operator=(const GlobalMgr& from) { return *this; } // = delete;
+		GlobalMgr& operator=(const GlobalMgr&) { return *this; } // = delete;
 
 		/**
 		* @brief destructor
@@ -61,12 +61,12 @@ public:
 	/**
 	* @brief default copy constructor
 	*/
-	InstrSettingsMgr(const InstrSettingsMgr& from) {} // = delete;
+	InstrSettingsMgr(const InstrSettingsMgr&) {} // = delete;
 
 	/**
 	* @brief default copy assignment
 	*/
-	InstrSettingsMgr& operator=(const InstrSettingsMgr& from) { return *this; } // = delete;
+	InstrSettingsMgr& operator=(const InstrSettingsMgr&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
@@ -25,6 +25,7 @@
 #include "XTConfig.h"
 
 #include "LogUtil.h"
+#include "XTMsgWire.h"
 
 
 #include "nng.h" 
@@ -86,9 +87,74 @@ namespace XT {
 
 	public:
 
+		/**
+		* @brief send a wire encoded XTMsg
+		*
+		* @param sock
+		* @param b as finished wire builder
+		* @param flags as nng flags, e.g. NNG_FLAG_NONBLOCK
+		*
+		* @return 0 or nng error code
+		*/
+		static int sendXTMsgWire(nng_socket sock, const XTMsgWireBuilder& b, int flags = 0)
+		{
+			return nng_send(sock, const_cast<char*>(b.data()), b.size(), flags);
+		}
  
 	};// NNGMgr
 
+	/**
+	* received nng message holding a wire encoded XTMsg, the view reads the nng_msg body in place
+	*/
+	class NNGWireMsg
+	{
+	public:
+		NNGWireMsg() : m_msg(nullptr) {}
+
+		~NNGWireMsg() { release(); }
+
+		NNGWireMsg(const NNGWireMsg&) = delete;
+		NNGWireMsg& operator=(const NNGWireMsg&) = delete;
+
+		/**
+		* @brief receive next message from socket
+		*
+		* @param sock
+		* @param flags as nng flags, e.g. NNG_FLAG_NONBLOCK
+		*
+		* @return 0 or nng error code
+		*/
+		int recv(nng_socket sock, int flags = 0)
+		{
+			release();
+			int rv = nng_recvmsg(sock, &m_msg, flags);
+			if (rv == 0)
+			{
+				m_view.reset(nng_msg_body(m_msg), nng_msg_len(m_msg));
+			}
+			return rv;
+		}
+
+		/** if the received message is a wire message, otherwise it is a plain json/pb string */
+		bool isWireMsg() const { return m_msg != nullptr && m_view.valid(); }
+
+		const XTMsgWireView& view() const { return m_view; }
+
+		void release()
+		{
+			if (m_msg != nullptr)
+			{
+				nng_msg_free(m_msg);
+				m_msg = nullptr;
+			}
+			m_view = XTMsgWireView();
+		}
+
+	protected:
+		nng_msg* m_msg;
+		XTMsgWireView m_view;
+	};
+
 
 
 }//namespace XT
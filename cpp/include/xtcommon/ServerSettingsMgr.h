@@ -61,12 +61,12 @@ public:
 	/**
 	* @brief default copy constructor
 	*/
-	ServerSettingsMgr(const ServerSettingsMgr& from) {} // = delete;
+	ServerSettingsMgr(const ServerSettingsMgr&) {} // = delete;
 
 	/**
 	* @brief default copy assignment
 	*/
-	ServerSettingsMgr& operator=(const ServerSettingsMgr& from) { return *this; } // = delete;
+	ServerSettingsMgr& operator=(const ServerSettingsMgr&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
@@ -74,12 +74,12 @@ public:
 	/**
 	* @brief default copy constructor
 	*/
-	SettingsMgr(const SettingsMgr& from) {} // = delete;
+	SettingsMgr(const SettingsMgr&) {} // = delete;
 
 	/**
 	* @brief default copy assignment
 	*/
-	SettingsMgr& operator=(const SettingsMgr& from) { return *this; } // = delete;
+	SettingsMgr& operator=(const SettingsMgr&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
@@ -0,0 +1,564 @@
+#pragma once
+#ifndef XT_THREAD_PLACEMENT_MGR_H
+#define XT_THREAD_PLACEMENT_MGR_H
+
+/**
+* \file ThreadPlacementMgr.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a manager class for placing threads on cpus by role.
+*
+* \description
+*	Roles (main, mdgw, trdgw, strat, log, journal, ...) are mapped to cpu lists with an
+*	optional scheduling policy and priority, from a spec string or an ini section:
+*
+*	[ThreadPlacement]
+*	mdgw = 2:fifo:80
+*	trdgw = 3:fifo:80
+*	strat = 4-7
+*	log = 0
+*	journal = 1:batch
+*
+*	A thread calls applyToCurrentThread(role, name) when it starts (or is started by
+*	startThread/threadInit), which sets the thread name, affinity and policy and records
+*	it for report(): allowed cpus, last cpu and context switch counts from /proc.
+*	Threads of roles that are not configured are only named and recorded.
+*/
+
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <bitset>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include <boost/algorithm/string.hpp>
+
+#include "XTConfig.h"
+#include "log4z.h"
+#include "ThreadUtil.h"
+#include "XTThread.h"
+#include "XTCPUTopology.h"
+#include "XTSimpleIni.h"
+
+namespace XT
+{
+
+	/**
+	* cpus and scheduling of a thread role
+	*/
+	struct ThreadRoleCfg
+	{
+		std::string role;
+		std::vector<int> cpus; ///< empty for no affinity
+		int policy; ///< ThreadPlacementMgr::SchedPolicy
+		int priority; ///< for fifo and rr, 1-99
+	};
+
+	/**
+	* placement of a started thread
+	*/
+	struct ThreadPlacementInfo
+	{
+		std::string role;
+		std::string name;
+		int64_t tid;
+		std::string requestedCpus;
+		std::string allowedCpus; ///< Cpus_allowed_list from /proc
+		int lastCpu; ///< cpu the thread last ran on, -1 if unknown
+		int policy;
+		int priority;
+		int64_t voluntarySwitches;
+		int64_t involuntarySwitches;
+		bool alive;
+		std::string error; ///< affinity or policy error when applied
+	};
+
+class ThreadPlacementMgr
+{
+public:
+	enum SchedPolicy
+	{
+		SchedOther = 0,
+		SchedFifo = 1,
+		SchedRR = 2,
+		SchedBatch = 3,
+		SchedIdle = 5
+	};
+
+	/**
+	* @brief constructor, reads the cpu topology
+	*/
+	ThreadPlacementMgr() : m_topology(CPUTopology::Load()) {}
+
+	ThreadPlacementMgr(const ThreadPlacementMgr&) = delete;
+	ThreadPlacementMgr& operator=(const ThreadPlacementMgr&) = delete;
+
+	/**
+	* @brief get singleton instance
+	*
+	* @return singleton instance
+	*/
+	static ThreadPlacementMgr* getInstance()
+	{
+		static ThreadPlacementMgr instance;
+		return &instance;
+	}
+
+public:
+	/**
+	* @name configuration
+	*/
+	///@{
+
+	const CPUTopology& topology() const { return m_topology; }
+
+	/**
+	* @brief set cpus and scheduling of a role
+	*
+	* @param role
+	* @param cpus as cpu list, empty for no affinity
+	* @param policy as SchedPolicy
+	* @param priority for fifo and rr
+	*/
+	void setRole(const std::string& role, const std::vector<int>& cpus, int policy = SchedOther, int priority = 0)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		ThreadRoleCfg& cfg = m_roles[role];
+		cfg.role = role;
+		cfg.cpus = cpus;
+		cfg.policy = policy;
+		cfg.priority = priority;
+	}
+
+	/**
+	* @brief parse a role value such as "2-3:fifo:80"
+	*
+	* @return false if the value is invalid
+	*/
+	bool setRoleStr(const std::string& role, const std::string& value)
+	{
+		std::vector<std::string> parts;
+		boost::split(parts, value, boost::is_any_of(":"));
+		for (auto& p : parts) { boost::trim(p); }
+		std::vector<int> cpus = CPUTopology::ParseCpuList(parts.size() > 0 ? parts[0] : "");
+		int policy = SchedOther;
+		if (parts.size() > 1 && !parsePolicy(parts[1], policy))
+		{
+			LOGW("ThreadPlacementMgr::setRoleStr,bad policy,role:" + role + ",value:" + value);
+			return false;
+		}
+		int priority = 0;
+		if (parts.size() > 2)
+		{
+			try { priority = std::stoi(parts[2]); }
+			catch (...)
+			{
+				LOGW("ThreadPlacementMgr::setRoleStr,bad priority,role:" + role + ",value:" + value);
+				return false;
+			}
+		}
+		setRole(role, cpus, policy, priority);
+		return true;
+	}
+
+	/**
+	* @brief configure roles from "role=cpus[:policy[:priority]];role=..."
+	*
+	* @return false if any entry is invalid, valid entries are still applied
+	*/
+	bool configure(const std::string& spec)
+	{
+		bool ok = true;
+		std::vector<std::string> entries;
+		boost::split(entries, spec, boost::is_any_of(";"));
+		for (auto& e : entries)
+		{
+			boost::trim(e);
+			if (e.empty()) { continue; }
+			size_t eq = e.find('=');
+			if (eq == std::string::npos)
+			{
+				LOGW("ThreadPlacementMgr::configure,bad entry:" + e);
+				ok = false;
+				continue;
+			}
+			ok = setRoleStr(boost::trim_copy(e.substr(0, eq)), e.substr(eq + 1)) && ok;
+		}
+		return ok;
+	}
+
+	/**
+	* @brief configure roles from the names of an ini section
+	*
+	* @param ini
+	* @param section
+	*/
+	void loadFromIni(XTSimpleIniPtr& ini, const std::string& section = "ThreadPlacement")
+	{
+		if (ini == nullptr) { return; }
+		for (const std::string& role : ini->getNamesForSection(section))
+		{
+			setRoleStr(role, ini->getString(section, role, ""));
+		}
+	}
+
+	bool hasRole(const std::string& role)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_roles.count(role) > 0;
+	}
+
+	/**
+	* @brief check the configuration against the topology
+	*
+	* Reports offline cpus, cpus shared by roles, real-time roles sharing a physical core
+	* with another role (SMT sibling) and roles spanning NUMA nodes.
+	*
+	* @return warnings, empty when the placement is clean
+	*/
+	std::vector<std::string> validate()
+	{
+		std::vector<std::string> warnings;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::map<int, std::vector<std::string> > cpuRoles;
+		for (auto& kv : m_roles)
+		{
+			std::set<int> nodes;
+			for (int cpu : kv.second.cpus)
+			{
+				if (m_topology.Find(cpu) == nullptr)
+				{
+					warnings.push_back("role:" + kv.first + ",cpu not online:" + std::to_string(cpu));
+					continue;
+				}
+				cpuRoles[cpu].push_back(kv.first);
+				nodes.insert(m_topology.NodeOf(cpu));
+			}
+			if (nodes.size() > 1)
+			{
+				warnings.push_back("role:" + kv.first + ",spans numa nodes");
+			}
+		}
+		for (auto& kv : cpuRoles)
+		{
+			if (kv.second.size() > 1)
+			{
+				warnings.push_back("cpu:" + std::to_string(kv.first) + ",shared by roles:" + boost::join(kv.second, "|"));
+			}
+		}
+		for (auto& kv : m_roles)
+		{
+			if (kv.second.policy != SchedFifo && kv.second.policy != SchedRR) { continue; }
+			for (int cpu : kv.second.cpus)
+			{
+				for (int sib : m_topology.SiblingsOf(cpu))
+				{
+					if (sib == cpu || !cpuRoles.count(sib)) { continue; }
+					for (const std::string& other : cpuRoles[sib])
+					{
+						if (other != kv.first)
+						{
+							warnings.push_back("role:" + kv.first + ",cpu:" + std::to_string(cpu) + ",smt sibling " + std::to_string(sib) + " used by role:" + other);
+						}
+					}
+				}
+			}
+		}
+		return warnings;
+	}
+	///@}
+
+public:
+	/**
+	* @name placement
+	*/
+	///@{
+
+	/**
+	* @brief name the current thread, apply the role affinity and policy and record it
+	*
+	* @param role
+	* @param name as thread name, the role when empty
+	*
+	* @return false if the role is configured and applying it failed
+	*/
+	bool applyToCurrentThread(const std::string& role, const std::string& name = "")
+	{
+		ThreadPlacementInfo info;
+		info.role = role;
+		info.name = name.empty() ? role : name;
+		info.tid = currentTid();
+		info.lastCpu = -1;
+		info.policy = SchedOther;
+		info.priority = 0;
+		info.voluntarySwitches = 0;
+		info.involuntarySwitches = 0;
+		info.alive = true;
+
+		ThreadUtil::setCurrThreadName(info.name);
+
+		bool configured = false;
+		ThreadRoleCfg cfg;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_roles.find(role);
+			if (it != m_roles.end())
+			{
+				cfg = it->second;
+				configured = true;
+			}
+		}
+		bool ok = true;
+		if (configured)
+		{
+			info.requestedCpus = CPUTopology::FormatCpuList(cfg.cpus);
+			info.policy = cfg.policy;
+			info.priority = cfg.priority;
+			if (!cfg.cpus.empty() && !setAffinity(cfg.cpus, info.error)) { ok = false; }
+			if (cfg.policy != SchedOther && !setPolicy(cfg.policy, cfg.priority, info.error)) { ok = false; }
+			if (!ok)
+			{
+				LOGW("ThreadPlacementMgr::applyToCurrentThread,role:" + role + ",name:" + info.name + ",error:" + info.error);
+			}
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threads.push_back(info);
+		return ok;
+	}
+
+	/**
+	* @brief thread start hook for pools and background threads
+	*
+	* @return function calling applyToCurrentThread(role, name)
+	*/
+	std::function<void()> threadInit(const std::string& role, const std::string& name = "")
+	{
+		return [this, role, name]() { applyToCurrentThread(role, name); };
+	}
+
+	/**
+	* @brief start a thread placed by role
+	*/
+	template<typename Fn>
+	std::thread startThread(const std::string& role, const std::string& name, Fn fn)
+	{
+		return std::thread([this, role, name, fn]() mutable {
+			applyToCurrentThread(role, name);
+			fn();
+		});
+	}
+	///@}
+
+public:
+	/**
+	* @name report
+	*/
+	///@{
+
+	/**
+	* @brief actual placement and context switches of the recorded threads
+	*/
+	std::vector<ThreadPlacementInfo> report()
+	{
+		std::vector<ThreadPlacementInfo> v;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			v = m_threads;
+		}
+		for (ThreadPlacementInfo& info : v)
+		{
+			readProcStatus(info);
+		}
+		return v;
+	}
+
+	/**
+	* @brief report as text, one line per thread
+	*/
+	std::string reportStr()
+	{
+		std::stringstream ss;
+		for (const ThreadPlacementInfo& info : report())
+		{
+			ss << "role:" << info.role << ",name:" << info.name << ",tid:" << info.tid
+				<< ",requested:" << info.requestedCpus << ",allowed:" << info.allowedCpus << ",lastcpu:" << info.lastCpu
+				<< ",policy:" << policyName(info.policy) << ",priority:" << info.priority
+				<< ",voluntary:" << info.voluntarySwitches << ",involuntary:" << info.involuntarySwitches
+				<< (info.alive ? "" : ",exited") << (info.error.empty() ? "" : ",error:" + info.error) << "\n";
+		}
+		return ss.str();
+	}
+
+	/**
+	* @brief log topology, configuration warnings and placement
+	*/
+	void logReport()
+	{
+		LOGI("ThreadPlacementMgr,topology:\n" + m_topology.ToString());
+		for (const std::string& w : validate())
+		{
+			LOGW("ThreadPlacementMgr," + w);
+		}
+		LOGI("ThreadPlacementMgr,threads:\n" + reportStr());
+	}
+
+	static std::string policyName(int policy)
+	{
+		switch (policy)
+		{
+		case SchedFifo: return "fifo";
+		case SchedRR: return "rr";
+		case SchedBatch: return "batch";
+		case SchedIdle: return "idle";
+		default: return "other";
+		}
+	}
+	///@}
+
+protected:
+	static bool parsePolicy(const std::string& s, int& policy)
+	{
+		std::string p = boost::to_lower_copy(s);
+		if (p.empty() || p == "other" || p == "normal") { policy = SchedOther; return true; }
+		if (p == "fifo") { policy = SchedFifo; return true; }
+		if (p == "rr") { policy = SchedRR; return true; }
+		if (p == "batch") { policy = SchedBatch; return true; }
+		if (p == "idle") { policy = SchedIdle; return true; }
+		return false;
+	}
+
+	static int64_t currentTid()
+	{
+#if defined(__linux__)
+		return (int64_t)syscall(SYS_gettid);
+#else
+		return (int64_t)XTThread::CurrentThreadId();
+#endif
+	}
+
+	static bool setAffinity(const std::vector<int>& cpus, std::string& error)
+	{
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int cpu : cpus)
+		{
+			if (cpu >= 0 && cpu < CPU_SETSIZE) { CPU_SET(cpu, &set); }
+		}
+		int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (rc != 0)
+		{
+			error += "affinity errno " + std::to_string(rc) + ";";
+			return false;
+		}
+		return true;
+#else
+		std::bitset<64> mask;
+		for (int cpu : cpus)
+		{
+			if (cpu >= 0 && cpu < 64) { mask.set(cpu); }
+		}
+		XTThread::SetAffinity(mask);
+		return true;
+#endif
+	}
+
+	static bool setPolicy(int policy, int priority, std::string& error)
+	{
+#if defined(__linux__)
+		int p = SCHED_OTHER;
+		switch (policy)
+		{
+		case SchedFifo: p = SCHED_FIFO; break;
+		case SchedRR: p = SCHED_RR; break;
+		case SchedBatch: p = SCHED_BATCH; break;
+		case SchedIdle: p = SCHED_IDLE; break;
+		default: break;
+		}
+		sched_param param;
+		param.sched_priority = (p == SCHED_FIFO || p == SCHED_RR) ? priority : 0;
+		int rc = pthread_setschedparam(pthread_self(), p, &param);
+		if (rc != 0)
+		{
+			error += "policy errno " + std::to_string(rc) + ";";
+			return false;
+		}
+		return true;
+#else
+		XTThread::SetPriority((policy == SchedFifo || policy == SchedRR) ? XTThread::Priority::HIGHEST
+			: (policy == SchedIdle ? XTThread::Priority::IDLE : XTThread::Priority::LOW));
+		return true;
+#endif
+	}
+
+	static void readProcStatus(ThreadPlacementInfo& info)
+	{
+#if defined(__linux__)
+		std::string dir = "/proc/self/task/" + std::to_string(info.tid);
+		std::ifstream status((dir + "/status").c_str());
+		if (!status)
+		{
+			info.alive = false;
+			return;
+		}
+		std::string line;
+		while (std::getline(status, line))
+		{
+			size_t colon = line.find(':');
+			if (colon == std::string::npos) { continue; }
+			std::string key = line.substr(0, colon);
+			std::string value = boost::trim_copy(line.substr(colon + 1));
+			try
+			{
+				if (key == "Cpus_allowed_list") { info.allowedCpus = value; }
+				else if (key == "voluntary_ctxt_switches") { info.voluntarySwitches = std::stoll(value); }
+				else if (key == "nonvoluntary_ctxt_switches") { info.involuntarySwitches = std::stoll(value); }
+			}
+			catch (...)
+			{
+			}
+		}
+		// field 39 of stat is the last cpu, counted after the ')' closing the command name
+		std::ifstream stat((dir + "/stat").c_str());
+		std::string s((std::istreambuf_iterator<char>(stat)), std::istreambuf_iterator<char>());
+		size_t rp = s.rfind(')');
+		if (rp != std::string::npos)
+		{
+			std::stringstream ss(s.substr(rp + 2));
+			std::string field;
+			for (int i = 3; i <= 39 && (ss >> field); ++i)
+			{
+				if (i == 39)
+				{
+					try { info.lastCpu = std::stoi(field); }
+					catch (...) {}
+				}
+			}
+		}
+#endif
+	}
+
+protected:
+	CPUTopology m_topology;
+	std::mutex m_mutex;
+	std::map<std::string, ThreadRoleCfg> m_roles; ///< role to cpus and scheduling
+	std::vector<ThreadPlacementInfo> m_threads; ///< threads placed so far
+}; //class ThreadPlacementMgr
+
+}//namespace XT
+
+#endif
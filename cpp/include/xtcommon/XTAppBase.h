@@ -42,6 +42,7 @@
 #include "XTTimer.h"
 #include "XTApiMgr.h"
 #include "XTMgr.h"
+#include "ThreadPlacementMgr.h"
 
 namespace XT
 {
@@ -108,6 +109,22 @@ public:
 	*/
 	static void catchInterruptSignals();
 
+	/**
+	* @brief load thread roles from the [ThreadPlacement] section of the cfg ini and place the calling thread as role "main"
+	*
+	* Call after CfgMgr is initialized and before other threads start.
+	*/
+	static void initThreadPlacement()
+	{
+		ThreadPlacementMgr* mgr = ThreadPlacementMgr::getInstance();
+		mgr->loadFromIni(CfgMgr::getInstance()->cfgIniData());
+		for (const std::string& w : mgr->validate())
+		{
+			LOGW("XTAppBase::initThreadPlacement," + w);
+		}
+		mgr->applyToCurrentThread("main");
+	}
+
 protected:
 	/**
 	* @brief handle interrupt singals such as CTRL-C
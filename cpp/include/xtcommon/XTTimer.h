@@ -45,6 +45,7 @@
 #include "log4z.h"
 #include "Util.h"
 #include "TimeUtil.h"
+#include "XTTimerWheel.h"
 
 namespace XT
 {
@@ -251,12 +252,12 @@ public:
 	/**
 	* @brief copy constructor
 	*/
-	XTTimerMgr(const XTTimerMgr& from) {} //= delete;
+	XTTimerMgr(const XTTimerMgr&) {} //= delete;
 
 	/**
 	* @brief copy assignment
 	*/
-	XTTimerMgr& operator=(const XTTimerMgr& from) { return *this; } //= delete;
+	XTTimerMgr& operator=(const XTTimerMgr&) { return *this; } //= delete;
 
 	/**
 	* @brief destructor
@@ -287,6 +288,21 @@ public:
 	*/
 	static XTTimer* getMktTimer();
 
+	/**
+	* @brief get timing wheel for one-shot and periodic timers (wall clock by default)
+	*
+	* The wall clock thread is started on first use. After setClockType(WallClock) call start() again.
+	*
+	* @return timing wheel instance
+	*/
+	static XTTimerWheel* getTimerWheel()
+	{
+		static XTTimerWheel s_timerWheel;
+		static bool s_started = (s_timerWheel.start(), true);
+		(void)s_started;
+		return &s_timerWheel;
+	}
+
 
 };//class XT_COMMON_API XTTimerMgr
 
@@ -0,0 +1,516 @@
+#pragma once
+#ifndef XT_TIMER_WHEEL_H
+#define XT_TIMER_WHEEL_H
+
+/**
+* \file XTTimerWheel.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a hierarchical timing wheel for one-shot and periodic timers.
+*
+* \description
+*	XTTimer broadcasts one tick per interval. XTTimerWheel keeps individual timers
+*	(order timeouts, 10ms quote refreshes, ...) in 4 levels of 256 slots with O(1)
+*	schedule and cancel. Timers are nanosecond timestamps, the wheel advances in ticks
+*	(default 1ms) driven by the wall clock (own thread) or by the simulated clock
+*	(setNowTs from replay). Callbacks run on the advancing thread, outside the lock.
+*/
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+
+#include "XTConfig.h"
+
+namespace XT
+{
+
+class XTTimerWheel
+{
+public:
+	typedef std::function<void(uint64_t timerid, int64_t nowns)> Callback;
+
+	enum ClockType
+	{
+		WallClock = 0, ///< system clock, advanced by start() thread
+		SimClock = 1 ///< advanced by setNowTs/advanceTo
+	};
+
+	static const int kLevels = 4;
+	static const int kSlotBits = 8;
+	static const int kSlots = 1 << kSlotBits;
+
+	/**
+	* @brief constructor
+	*
+	* @param tickns as tick length in nanoseconds, timers never fire early and at most one tick late
+	* @param clocktype
+	*/
+	explicit XTTimerWheel(int64_t tickns = 1000000, int clocktype = WallClock)
+		: m_tickNs(tickns > 0 ? tickns : 1), m_clockType(clocktype), m_nowNs(0), m_tick(0), m_count(0), m_freeHead(kNil),
+		m_running(false), m_thread(nullptr), m_firedCount(0)
+	{
+		for (int l = 0; l < kLevels; ++l)
+		{
+			m_levelCount[l] = 0;
+			for (int s = 0; s < kSlots; ++s) { m_heads[l][s] = kNil; }
+		}
+		if (clocktype == WallClock)
+		{
+			resetNow(wallNowNs());
+		}
+	}
+
+	XTTimerWheel(const XTTimerWheel&) = delete;
+	XTTimerWheel& operator=(const XTTimerWheel&) = delete;
+
+	virtual ~XTTimerWheel()
+	{
+		stop();
+	}
+
+public:
+	/**
+	* @name clock
+	*/
+	///@{
+
+	int getClockType() const { return m_clockType.load(std::memory_order_acquire); }
+
+	/**
+	* @brief switch clock and re-base the wheel on the new current time,
+	* pending timers (scheduleAt ones included) keep their remaining delay
+	*
+	* @param clocktype
+	* @param nowns as current time for SimClock, ignored for WallClock
+	*/
+	void setClockType(int clocktype, int64_t nowns = 0)
+	{
+		stop();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		int64_t old = m_nowNs.load(std::memory_order_relaxed);
+		m_clockType.store(clocktype, std::memory_order_release);
+		int64_t now = (clocktype == WallClock) ? wallNowNs() : nowns;
+		resetNowLocked(now);
+		if (m_count == 0) { return; }
+		for (int l = 0; l < kLevels; ++l)
+		{
+			m_levelCount[l] = 0;
+			for (int s = 0; s < kSlots; ++s) { m_heads[l][s] = kNil; }
+		}
+		int64_t shift = now - old;
+		for (uint32_t idx = 0; idx < (uint32_t)m_nodes.size(); ++idx)
+		{
+			if (!m_nodes[idx].active) { continue; }
+			m_nodes[idx].expiryNs += shift;
+			insertLocked(idx);
+		}
+	}
+
+	/**
+	* @brief current time of the wheel in nanoseconds
+	*/
+	int64_t getNowNs() const { return m_nowNs.load(std::memory_order_acquire); }
+
+	int64_t getTickNs() const { return m_tickNs; }
+
+	/**
+	* @brief simulated clock in microseconds (TimeUtil/XTTimer timestamp unit), ignored for WallClock
+	*
+	* @param ts
+	*/
+	void setNowTs(int64_t ts)
+	{
+		if (getClockType() != SimClock) { return; }
+		advanceTo(ts * 1000);
+	}
+
+	/**
+	* @brief start the wall clock thread
+	*/
+	void start()
+	{
+		if (getClockType() != WallClock || m_running.exchange(true)) { return; }
+		m_thread = new std::thread([this]() {
+			while (m_running.load(std::memory_order_acquire))
+			{
+				advanceTo(wallNowNs());
+				std::this_thread::sleep_for(std::chrono::nanoseconds(m_tickNs));
+			}
+		});
+	}
+
+	/**
+	* @brief stop the wall clock thread
+	*/
+	void stop()
+	{
+		if (!m_running.exchange(false)) { return; }
+		if (m_thread != nullptr)
+		{
+			m_thread->join();
+			delete m_thread;
+			m_thread = nullptr;
+		}
+	}
+	///@}
+
+public:
+	/**
+	* @name timers
+	*/
+	///@{
+
+	/**
+	* @brief one-shot timer at an absolute time
+	*
+	* @param atns as nanosecond timestamp
+	* @param cb
+	*
+	* @return timer id for cancel, never 0
+	*/
+	uint64_t scheduleAt(int64_t atns, const Callback& cb)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return addLocked(atns, 0, cb);
+	}
+
+	/**
+	* @brief one-shot timer after a delay
+	*
+	* @param delayns
+	* @param cb
+	*
+	* @return timer id
+	*/
+	uint64_t schedule(int64_t delayns, const Callback& cb)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		refreshIdleNowLocked();
+		return addLocked(m_nowNs.load(std::memory_order_relaxed) + delayns, 0, cb);
+	}
+
+	/**
+	* @brief periodic timer, runs until cancelled
+	*
+	* @param periodns
+	* @param cb
+	* @param firstdelayns as delay of the first run, periodns when negative
+	*
+	* @return timer id, 0 if periodns is not positive
+	*/
+	uint64_t schedulePeriodic(int64_t periodns, const Callback& cb, int64_t firstdelayns = -1)
+	{
+		if (periodns <= 0) { return 0; }
+		std::lock_guard<std::mutex> lock(m_mutex);
+		int64_t first = (firstdelayns < 0) ? periodns : firstdelayns;
+		refreshIdleNowLocked();
+		return addLocked(m_nowNs.load(std::memory_order_relaxed) + first, periodns, cb);
+	}
+
+	/**
+	* @brief cancel a timer, a callback already collected for running is not stopped
+	*
+	* @param timerid
+	*
+	* @return false if the timer already fired (one-shot) or is unknown
+	*/
+	bool cancel(uint64_t timerid)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		uint32_t idx = (uint32_t)(timerid & 0xffffffffu) - 1;
+		uint32_t gen = (uint32_t)(timerid >> 32);
+		if (idx >= m_nodes.size() || m_nodes[idx].gen != gen || !m_nodes[idx].active) { return false; }
+		unlinkLocked(idx);
+		releaseLocked(idx);
+		return true;
+	}
+
+	/**
+	* @brief number of pending timers
+	*/
+	size_t size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_count;
+	}
+
+	/**
+	* @brief number of callbacks run
+	*/
+	uint64_t getFiredCount() const { return m_firedCount.load(std::memory_order_relaxed); }
+
+	/**
+	* @brief move the clock forward and run expired timers, never moves backward
+	*
+	* @param nowns
+	*
+	* @return number of callbacks run
+	*/
+	size_t advanceTo(int64_t nowns)
+	{
+		std::vector<Fired> fired;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (nowns <= m_nowNs.load(std::memory_order_relaxed)) { return 0; }
+			m_nowNs.store(nowns, std::memory_order_release);
+			uint64_t target = (uint64_t)(nowns / m_tickNs);
+			while (m_tick < target)
+			{
+				if (m_count == 0)
+				{
+					m_tick = target;
+					break;
+				}
+				if (m_levelCount[0] == 0)
+				{
+					// nothing in the lower levels, jump to the next cascade of the lowest used level
+					int level = 1;
+					while (level < kLevels - 1 && m_levelCount[level] == 0) { ++level; }
+					uint64_t boundary = (m_tick | (((uint64_t)1 << (kSlotBits * level)) - 1)) + 1;
+					if (boundary > target)
+					{
+						m_tick = target;
+						break;
+					}
+					m_tick = boundary - 1;
+				}
+				++m_tick;
+				if ((m_tick & (kSlots - 1)) == 0)
+				{
+					cascadeLocked();
+				}
+				collectLocked(0, (int)(m_tick & (kSlots - 1)), fired);
+			}
+		}
+		for (Fired& f : fired)
+		{
+			f.cb(f.id, nowns);
+		}
+		m_firedCount.fetch_add(fired.size(), std::memory_order_relaxed);
+		return fired.size();
+	}
+	///@}
+
+protected:
+	static const uint32_t kNil = 0xffffffffu;
+
+	struct Node
+	{
+		int64_t expiryNs;
+		int64_t periodNs;
+		uint32_t gen;
+		uint32_t prev;
+		uint32_t next;
+		int8_t level;
+		int16_t slot;
+		bool active;
+		Callback cb;
+	};
+
+	struct Fired
+	{
+		uint64_t id;
+		Callback cb;
+	};
+
+	static int64_t wallNowNs()
+	{
+		return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	void resetNow(int64_t nowns)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		resetNowLocked(nowns);
+	}
+
+	void resetNowLocked(int64_t nowns)
+	{
+		m_nowNs.store(nowns, std::memory_order_release);
+		m_tick = (uint64_t)(nowns / m_tickNs);
+	}
+
+	/**
+	* @brief catch an empty wall clock wheel up with the system clock, so a delay is not taken from a stale now
+	*/
+	void refreshIdleNowLocked()
+	{
+		if (m_clockType.load(std::memory_order_relaxed) != WallClock || m_count != 0) { return; }
+		int64_t wall = wallNowNs();
+		if (wall > m_nowNs.load(std::memory_order_relaxed))
+		{
+			resetNowLocked(wall);
+		}
+	}
+
+	uint64_t addLocked(int64_t atns, int64_t periodns, const Callback& cb)
+	{
+		uint32_t idx;
+		if (m_freeHead != kNil)
+		{
+			idx = m_freeHead;
+			m_freeHead = m_nodes[idx].next;
+		}
+		else
+		{
+			idx = (uint32_t)m_nodes.size();
+			m_nodes.push_back(Node());
+			m_nodes[idx].gen = 0;
+		}
+		Node& n = m_nodes[idx];
+		n.gen = (n.gen + 1) == 0 ? 1 : n.gen + 1;
+		n.expiryNs = atns;
+		n.periodNs = periodns;
+		n.active = true;
+		n.cb = cb;
+		++m_count;
+		insertLocked(idx);
+		return ((uint64_t)n.gen << 32) | (uint64_t)(idx + 1);
+	}
+
+	void releaseLocked(uint32_t idx)
+	{
+		Node& n = m_nodes[idx];
+		n.active = false;
+		n.cb = Callback();
+		n.next = m_freeHead;
+		m_freeHead = idx;
+		--m_count;
+	}
+
+	/** expiry tick, rounded up so a timer never fires early */
+	uint64_t expiryTick(int64_t ns) const
+	{
+		if (ns <= 0) { return 0; }
+		return (uint64_t)((ns + m_tickNs - 1) / m_tickNs);
+	}
+
+	/**
+	* @brief link a timer into its slot
+	*
+	* @param idx
+	* @param cascading as true when the slot of m_tick is collected right after
+	*/
+	void insertLocked(uint32_t idx, bool cascading = false)
+	{
+		Node& n = m_nodes[idx];
+		uint64_t e = expiryTick(n.expiryNs);
+		if (e <= m_tick && !(cascading && e == m_tick))
+		{
+			e = m_tick + 1; // due, the slot of m_tick is already processed
+		}
+		uint64_t delta = e - m_tick;
+		int level = 0;
+		while (level < kLevels - 1 && delta >= ((uint64_t)1 << (kSlotBits * (level + 1))))
+		{
+			++level;
+		}
+		uint64_t span = (uint64_t)1 << (kSlotBits * (level + 1));
+		if (delta >= span)
+		{
+			e = m_tick + span - 1; // beyond the top level, re-cascaded until due
+		}
+		int slot = (int)((e >> (kSlotBits * level)) & (kSlots - 1));
+		n.level = (int8_t)level;
+		n.slot = (int16_t)slot;
+		n.prev = kNil;
+		n.next = m_heads[level][slot];
+		if (n.next != kNil) { m_nodes[n.next].prev = idx; }
+		m_heads[level][slot] = idx;
+		++m_levelCount[level];
+	}
+
+	void unlinkLocked(uint32_t idx)
+	{
+		Node& n = m_nodes[idx];
+		if (n.prev != kNil) { m_nodes[n.prev].next = n.next; }
+		else { m_heads[n.level][n.slot] = n.next; }
+		if (n.next != kNil) { m_nodes[n.next].prev = n.prev; }
+		--m_levelCount[n.level];
+	}
+
+	/** re-insert the level slots reached by m_tick, lower levels first */
+	void cascadeLocked()
+	{
+		for (int level = 1; level < kLevels; ++level)
+		{
+			int slot = (int)((m_tick >> (kSlotBits * level)) & (kSlots - 1));
+			uint32_t idx = m_heads[level][slot];
+			m_heads[level][slot] = kNil;
+			while (idx != kNil)
+			{
+				uint32_t next = m_nodes[idx].next;
+				--m_levelCount[level];
+				insertLocked(idx, true);
+				idx = next;
+			}
+			if (slot != 0) { break; }
+		}
+	}
+
+	void collectLocked(int level, int slot, std::vector<Fired>& fired)
+	{
+		uint32_t idx = m_heads[level][slot];
+		m_heads[level][slot] = kNil;
+		while (idx != kNil)
+		{
+			Node& n = m_nodes[idx];
+			uint32_t next = n.next;
+			--m_levelCount[level];
+			Fired f;
+			f.id = ((uint64_t)n.gen << 32) | (uint64_t)(idx + 1);
+			if (expiryTick(n.expiryNs) > m_tick)
+			{
+				insertLocked(idx); // clamped far timer, not due yet
+			}
+			else if (n.periodNs > 0)
+			{
+				f.cb = n.cb;
+				fired.push_back(f);
+				// next period after now, skipped periods are not replayed
+				int64_t now = m_nowNs.load(std::memory_order_relaxed);
+				int64_t nextns = n.expiryNs + n.periodNs;
+				if (nextns <= now)
+				{
+					nextns += ((now - nextns) / n.periodNs + 1) * n.periodNs;
+				}
+				n.expiryNs = nextns;
+				insertLocked(idx);
+			}
+			else
+			{
+				f.cb = n.cb;
+				fired.push_back(f);
+				releaseLocked(idx);
+			}
+			idx = next;
+		}
+	}
+
+protected:
+	const int64_t m_tickNs;
+	std::atomic<int> m_clockType; ///< written under m_mutex by setClockType, read without it by setNowTs/start
+	std::atomic<int64_t> m_nowNs;
+	uint64_t m_tick; ///< current tick, all ticks up to it are processed
+	size_t m_count; ///< pending timers
+	uint32_t m_freeHead;
+	std::vector<Node> m_nodes; ///< timer pool, the id is index+1 and generation
+	uint32_t m_heads[kLevels][kSlots];
+	size_t m_levelCount[kLevels];
+	mutable std::mutex m_mutex;
+
+	std::atomic<bool> m_running;
+	std::thread* m_thread;
+	std::atomic<uint64_t> m_firedCount;
+}; //class XTTimerWheel
+
+}//namespace
+
+#endif
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
+#include <functional>
 
 #include <boost/unordered_map.hpp>
 #include <boost/unordered_set.hpp>
@@ -49,6 +50,7 @@
 #include "XTData.pb.h"
 
 #include "TagDataWrapper.h"
+#include "XTMsgWire.h"
 
 #include "Util.h"
 #include "XTTimer.h"
@@ -60,6 +62,51 @@
 
 namespace XT {
 
+/**
+* received zmq message holding a wire encoded XTMsg, the view reads the zmq buffer in place
+*/
+class ZMQWireMsg
+{
+public:
+	ZMQWireMsg() { zmq_msg_init(&m_msg); }
+
+	~ZMQWireMsg() { zmq_msg_close(&m_msg); }
+
+	ZMQWireMsg(const ZMQWireMsg&) = delete;
+	ZMQWireMsg& operator=(const ZMQWireMsg&) = delete;
+
+	/**
+	* @brief receive next message from socket
+	*
+	* @param socket
+	* @param flags as zmq flags, e.g. ZMQ_DONTWAIT
+	*
+	* @return bytes received, -1 on error or when nothing is available with ZMQ_DONTWAIT
+	*/
+	int recv(void* socket, int flags = 0)
+	{
+		int n = zmq_msg_recv(&m_msg, socket, flags);
+		if (n >= 0)
+		{
+			m_view.reset(zmq_msg_data(&m_msg), zmq_msg_size(&m_msg));
+		}
+		return n;
+	}
+
+	/** if the received message is a wire message, otherwise it is a plain json/pb string */
+	bool isWireMsg() const { return m_view.valid(); }
+
+	const XTMsgWireView& view() const { return m_view; }
+
+	const char* data() { return static_cast<const char*>(zmq_msg_data(&m_msg)); }
+
+	size_t size() { return zmq_msg_size(&m_msg); }
+
+protected:
+	zmq_msg_t m_msg;
+	XTMsgWireView m_view;
+};
+
 class XT_COMMON_API ZMQMgr
 {
 
@@ -77,12 +124,12 @@ public:
 	/**
 	* @brief default copy constructor
 	*/
-	ZMQMgr(const ZMQMgr& from) {}// = delete;
+	ZMQMgr(const ZMQMgr&) {}// = delete;
 
 	/**
 	* @brief default copy assignment
 	*/
-	ZMQMgr& operator=(const ZMQMgr& from) { return *this; } //= delete;
+	ZMQMgr& operator=(const ZMQMgr&) { return *this; } //= delete;
 
 	/**
 	* @brief destructor
@@ -232,6 +279,63 @@ public:
 	*/
 	void unbindSubscribeAddress(const std::string& s);
 
+	/**
+	* @brief publish a wire encoded XTMsg, the builder buffer goes to zmq without an intermediate string
+	*
+	* @param b as finished wire builder
+	*
+	* @return bytes sent, -1 on error
+	*/
+	int publishXTMsgWire(const XTMsgWireBuilder& b)
+	{
+		return zmq_send(m_publish_socket, b.data(), b.size(), ZMQ_DONTWAIT);
+	}
+
+	/**
+	* @brief publish a wire encoded XTMsg inproc
+	*
+	* @param b as finished wire builder
+	*
+	* @return bytes sent, -1 on error
+	*/
+	int publishInprocXTMsgWire(const XTMsgWireBuilder& b)
+	{
+		return zmq_send(m_inproc_publish_socket, b.data(), b.size(), ZMQ_DONTWAIT);
+	}
+
+	/**
+	* @brief receive pending messages of a socket without blocking
+	*
+	*	Wire encoded XTMsg go to onWire as a view over the zmq buffer, valid during the call only;
+	*	json/pb strings go to onOther.
+	*
+	* @param socket as receiving socket, e.g. getSubscribeSocket()
+	* @param onWire as handler of wire messages
+	* @param onOther as handler of other messages, may be empty
+	* @param maxmsgs as maximum number of messages received per call
+	*
+	* @return number of messages received
+	*/
+	int pollXTMsgWire(void* socket, const std::function<void(const XTMsgWireView&)>& onWire,
+		const std::function<void(const char*, size_t)>& onOther = nullptr, int maxmsgs = 64)
+	{
+		ZMQWireMsg msg;
+		int n = 0;
+		while (n < maxmsgs && msg.recv(socket, ZMQ_DONTWAIT) >= 0)
+		{
+			++n;
+			if (msg.isWireMsg())
+			{
+				onWire(msg.view());
+			}
+			else if (onOther)
+			{
+				onOther(msg.data(), msg.size());
+			}
+		}
+		return n;
+	}
+
 
 protected:
 	bool m_isInitialized; ///< is initialized or not
@@ -257,6 +361,7 @@ protected:
 
 };//
 
+
  
 
 }//namespace
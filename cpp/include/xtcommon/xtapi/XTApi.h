@@ -40,6 +40,7 @@
 #include "DataUtil.h"
 
 #include "XTMsg.h"
+#include "XTMsgWire.h"
 
 #include "InstrSpec.h"
 #include "Instr.h"
@@ -278,6 +279,21 @@ public:
 	*/
 	virtual int handleXTMsg(XTMsgPtr& msg);
 
+	/**
+	* @brief handle wire encoded XTMsg
+	*
+	*	Overrides should read the fields through the view (findTag/findKey/getInt...) without decoding;
+	*	the default decodes into an XTMsg only so handlers written for handleXTMsg keep working.
+	*
+	* @param v as view over the received buffer, valid during the call only
+	*/
+	virtual int handleXTMsgWire(const XTMsgWireView& v)
+	{
+		if (!v.valid()) { return -1; }
+		XTMsgPtr msg = v.toXTMsg();
+		return handleXTMsg(msg);
+	}
+
 	/**
 	* @brief subsribe market data for instruments
 	* @param instrs vector of instruments
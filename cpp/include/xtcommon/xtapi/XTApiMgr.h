@@ -198,6 +198,24 @@ public:
 	*/
 	void addApiByName(const std::string& name);
 
+	/**
+	* @brief deliver a wire encoded XTMsg to every api on the calling thread, e.g. from ZMQMgr::pollXTMsgWire
+	*
+	* @param v as view over the received buffer
+	*
+	* @return number of apis which handled it (handleXTMsgWire >= 0)
+	*/
+	int dispatchXTMsgWire(const XTMsgWireView& v)
+	{
+		if (!v.valid()) { return 0; }
+		int n = 0;
+		for (auto it = m_xtapiMap.begin(); it != m_xtapiMap.end(); ++it)
+		{
+			if (it->second && it->second->handleXTMsgWire(v) >= 0) { ++n; }
+		}
+		return n;
+	}
+
 protected:
 	//std::string m_baseDir;
 
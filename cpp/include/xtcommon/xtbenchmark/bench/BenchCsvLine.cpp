@@ -0,0 +1,173 @@
+/**
+* \file BenchCsvLine.cpp
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Benchmark parsing a MktQuoteData csv line, CsvUtil against string split.
+*
+* \description
+*	Each operation parses one tick line of kItems columns. "strings" splits into a string per
+*	field and converts with std::sto*, "CsvUtil" splits in place and converts with CsvUtil.
+*	"MktQuoteData" is MarketSim::processMktQuoteDataCsvView without the dispatch: check the
+*	cached descriptors against the csv items, split, then set the fields of a new MktQuoteData.
+*	Items per second of the report is lines/sec.
+*/
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "XTBenchmark.h"
+#include "XTBenchmarkRegister.h"
+
+#include "CsvUtil.h"
+#include "XTData.pb.h"
+#include "typedef_XTData.pb.h"
+
+using namespace XT;
+
+namespace
+{
+	const int64_t kLineOperations = 2000000;
+	const size_t kLines = 1 << 16;
+
+	const std::vector<std::string> kItems = { "instrid", "exchid", "tradingday", "exchts", "lastpx", "bidpx0", "bidsz0",
+		"askpx0", "asksz0", "totvolume", "totamount", "totoi" };
+
+	/**
+	* Same tick lines for every attempt and class
+	*/
+	const std::vector<std::string>& benchLines()
+	{
+		static std::vector<std::string> s_lines;
+		if (!s_lines.empty()) { return s_lines; }
+		for (size_t i = 0; i < kLines; ++i)
+		{
+			std::ostringstream o;
+			o << "rb2101,SHFE,20201015," << (93000000 + i) << "," << 3700 + i % 50 << ".0," << 3699 + i % 50 << ".5," << (i % 500)
+				<< "," << 3701 + i % 50 << ".0," << (i % 300) << "," << 123456 + i << "," << 4567890123.5 + i << "," << (2345678 + i);
+			s_lines.push_back(o.str());
+		}
+		return s_lines;
+	}
+
+	std::vector<std::string> splitStrings(const std::string& str, char d)
+	{
+		std::vector<std::string> tokens;
+		size_t b = 0;
+		size_t e;
+		while ((e = str.find(d, b)) != std::string::npos)
+		{
+			tokens.push_back(str.substr(b, e - b));
+			b = e + 1;
+		}
+		tokens.push_back(str.substr(b));
+		return tokens;
+	}
+}
+
+class CsvLineBenchmark : public Benchmark
+{
+public:
+	using Benchmark::Benchmark;
+
+protected:
+	void Initialize(Context&) override
+	{
+		benchLines();
+		m_i = 0;
+		m_sum = 0;
+	}
+
+	void Cleanup(Context& context) override
+	{
+		context.metrics().AddItems(m_i);
+	}
+
+	const std::string& nextLine() { return benchLines()[(size_t)(m_i++ & (kLines - 1))]; }
+
+protected:
+	int64_t m_i;
+	double m_sum;
+};
+
+class CsvStringsBenchmark : public CsvLineBenchmark
+{
+public:
+	using CsvLineBenchmark::CsvLineBenchmark;
+
+protected:
+	void Run(Context&) override
+	{
+		std::vector<std::string> t = splitStrings(nextLine(), ',');
+		m_sum += std::stoi(t[2]) + std::stoll(t[3]) + std::stod(t[4]) + std::stod(t[5]) + std::stoi(t[6]) + std::stod(t[7])
+			+ std::stoi(t[8]) + std::stoll(t[9]) + std::stod(t[10]) + std::stoll(t[11]);
+	}
+};
+
+class CsvUtilBenchmark : public CsvLineBenchmark
+{
+public:
+	using CsvLineBenchmark::CsvLineBenchmark;
+
+protected:
+	void Run(Context&) override
+	{
+		const std::string& line = nextLine();
+		CsvUtil::split(line.data(), line.size(), ',', m_fields);
+		m_sum += CsvUtil::toInt(m_fields[2]) + CsvUtil::toInt64(m_fields[3]) + CsvUtil::toDouble(m_fields[4]) + CsvUtil::toDouble(m_fields[5])
+			+ CsvUtil::toInt(m_fields[6]) + CsvUtil::toDouble(m_fields[7]) + CsvUtil::toInt(m_fields[8]) + CsvUtil::toInt64(m_fields[9])
+			+ CsvUtil::toDouble(m_fields[10]) + CsvUtil::toInt64(m_fields[11]);
+	}
+
+private:
+	CsvFields m_fields;
+};
+
+class CsvMktQuoteDataBenchmark : public CsvLineBenchmark
+{
+public:
+	using CsvLineBenchmark::CsvLineBenchmark;
+
+protected:
+	void Initialize(Context& context) override
+	{
+		CsvLineBenchmark::Initialize(context);
+		m_items = kItems;
+		m_descItems.clear();
+	}
+
+	void Run(Context&) override
+	{
+		if (m_descItems != m_items)
+		{
+			const google::protobuf::Descriptor* desc = MktQuoteData::descriptor();
+			m_descs.clear();
+			for (const std::string& item : m_items) { m_descs.push_back(desc->FindFieldByName(item)); }
+			m_descItems = m_items;
+		}
+		const std::string& line = nextLine();
+		size_t nbfields = CsvUtil::split(line.data(), line.size(), ',', m_fields);
+		MktQuoteData* d = new MktQuoteData();
+		for (size_t i = 0; i < nbfields && i < m_descs.size(); ++i)
+		{
+			if (m_descs[i] == nullptr || m_fields[i].empty()) { continue; }
+			CsvUtil::setPBField(d, m_descs[i], m_fields[i]);
+		}
+		MktQuoteDataPtr mktdata(d);
+		m_sum += d->lastpx();
+	}
+
+private:
+	std::vector<std::string> m_items;
+	std::vector<std::string> m_descItems;
+	std::vector<const google::protobuf::FieldDescriptor*> m_descs;
+	CsvFields m_fields;
+};
+
+BENCHMARK_CLASS(CsvStringsBenchmark, "CsvLine.strings", Settings().Operations(kLineOperations).Attempts(5))
+BENCHMARK_CLASS(CsvUtilBenchmark, "CsvLine.CsvUtil", Settings().Operations(kLineOperations).Attempts(5))
+BENCHMARK_CLASS(CsvMktQuoteDataBenchmark, "CsvLine.MktQuoteData", Settings().Operations(kLineOperations).Attempts(5))
+
+BENCHMARK_MAIN()
@@ -0,0 +1,141 @@
+/**
+* \file BenchEventDispatch.cpp
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Benchmark EventDispatchTable against boost::signals2 per emitted event.
+*
+* \description
+*	"signals2" and "table" emit to kSubscribers slots. "publishAll" is the cost of
+*	MktDataEventPubMgr::publishMktEventAll for a process subscribed only through the table
+*	(setSignalDispatch(false)): the subscriber count is read from the table snapshot, then the
+*	table is emitted.
+*/
+
+#include <cstdint>
+#include <memory>
+
+#include <boost/signals2.hpp>
+
+#include "XTBenchmark.h"
+#include "XTBenchmarkRegister.h"
+
+#include "EventDispatchTable.h"
+
+using namespace XT;
+
+namespace
+{
+	const int kSubscribers = 4;
+	const int64_t kEmitOperations = 10000000;
+}
+
+class Signals2EmitBenchmark : public Benchmark
+{
+public:
+	using Benchmark::Benchmark;
+
+protected:
+	void Initialize(Context&) override
+	{
+		m_signal.reset(new boost::signals2::signal<void(int)>());
+		m_sum = 0;
+		for (int k = 0; k < kSubscribers; ++k)
+		{
+			m_signal->connect([this](int iid) { m_sum += iid; });
+		}
+		m_i = 0;
+	}
+
+	void Run(Context&) override
+	{
+		(*m_signal)(m_i++ & 1023);
+	}
+
+	void Cleanup(Context& context) override
+	{
+		context.metrics().AddItems(m_i);
+		m_signal.reset();
+	}
+
+private:
+	std::unique_ptr<boost::signals2::signal<void(int)> > m_signal;
+	int64_t m_sum;
+	int m_i;
+};
+
+class TableEmitBenchmark : public Benchmark
+{
+public:
+	using Benchmark::Benchmark;
+
+protected:
+	void Initialize(Context&) override
+	{
+		m_table.clear();
+		m_sum = 0;
+		for (int k = 0; k < kSubscribers; ++k)
+		{
+			m_table.subscribe([this](int iid) { m_sum += iid; });
+		}
+		m_i = 0;
+	}
+
+	void Run(Context&) override
+	{
+		m_table.emit(m_i++ & 1023);
+	}
+
+	void Cleanup(Context& context) override
+	{
+		context.metrics().AddItems(m_i);
+	}
+
+private:
+	EventDispatchTable<> m_table;
+	int64_t m_sum;
+	int m_i;
+};
+
+class PublishAllBenchmark : public Benchmark
+{
+public:
+	using Benchmark::Benchmark;
+
+protected:
+	void Initialize(Context&) override
+	{
+		m_table.clear();
+		m_sum = 0;
+		for (int k = 0; k < kSubscribers; ++k)
+		{
+			m_table.subscribe([this](int iid) { m_sum += iid; });
+		}
+		m_i = 0;
+	}
+
+	void Run(Context&) override
+	{
+		int iid = m_i++ & 1023;
+		if (!m_table.empty())
+		{
+			m_table.emit(iid);
+		}
+	}
+
+	void Cleanup(Context& context) override
+	{
+		context.metrics().AddItems(m_i);
+	}
+
+private:
+	EventDispatchTable<> m_table;
+	int64_t m_sum;
+	int m_i;
+};
+
+BENCHMARK_CLASS(Signals2EmitBenchmark, "EventDispatch.signals2", Settings().Operations(kEmitOperations).Attempts(5))
+BENCHMARK_CLASS(TableEmitBenchmark, "EventDispatch.table", Settings().Operations(kEmitOperations).Attempts(5))
+BENCHMARK_CLASS(PublishAllBenchmark, "EventDispatch.publishAll", Settings().Operations(kEmitOperations).Attempts(5))
+
+BENCHMARK_MAIN()
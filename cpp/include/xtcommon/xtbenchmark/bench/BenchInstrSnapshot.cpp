@@ -0,0 +1,173 @@
+/**
+* \file BenchInstrSnapshot.cpp
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Benchmark the warm restart of InstrMgr from an InstrSnapshot against the cold load.
+*
+* \description
+*	kInstrs futures are written once to a sqlite main db in the temp directory. "coldLoad"
+*	clears InstrMgr and creates every instrument from its row. "warmRestart" clears InstrMgr
+*	and runs InstrSnapshot::loadOrBuild: the row checksum of the db (mainDbVersion), mapping
+*	and validating the snapshot, parsing the specs, adding the instruments, verifying and
+*	publishing the registry, i.e. everything from process start to instruments ready. The
+*	step times of the last warm restart are printed. Items per second of the report is
+*	instruments/sec.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include <SQLiteCpp/Transaction.h>
+
+#include "XTBenchmark.h"
+#include "XTBenchmarkRegister.h"
+
+#include "InstrMgr.h"
+#include "InstrSnapshot.h"
+
+using namespace XT;
+
+namespace
+{
+	const int kInstrs = 60000;
+	const int64_t kRestartOperations = 10;
+	const int kTradingDay = 20240102;
+	const char* kSelectSql = "SELECT exchid, instrid, product, expire, tick, multiplier FROM instr ORDER BY instrid";
+
+	std::string tempPath(const std::string& name)
+	{
+		return (boost::filesystem::temp_directory_path() / name).string();
+	}
+
+	/**
+	* Main db with one row per instrument, written once
+	*/
+	const std::string& mainDb()
+	{
+		static std::string path;
+		if (!path.empty()) { return path; }
+		path = tempPath("BenchInstrSnapshot.db");
+		boost::system::error_code ec;
+		boost::filesystem::remove(path, ec);
+		SQLite::Database db(path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+		db.exec("CREATE TABLE instr(exchid TEXT, instrid TEXT PRIMARY KEY, product TEXT, expire INTEGER, tick REAL, multiplier REAL)");
+		SQLite::Transaction tr(db);
+		SQLite::Statement ins(db, "INSERT INTO instr VALUES(?, ?, ?, ?, ?, ?)");
+		char instrid[16];
+		char product[8];
+		for (int i = 0; i < kInstrs; ++i)
+		{
+			std::snprintf(instrid, sizeof(instrid), "p%03d%02d%02d", i % 600, 24 + i / 7200, 1 + (i / 600) % 12);
+			std::snprintf(product, sizeof(product), "p%03d", i % 600);
+			ins.bind(1, "SHFE");
+			ins.bind(2, instrid);
+			ins.bind(3, product);
+			ins.bind(4, 20240115 + (i / 600) * 100);
+			ins.bind(5, 1.0);
+			ins.bind(6, 10.0);
+			ins.exec();
+			ins.reset();
+		}
+		tr.commit();
+		return path;
+	}
+
+	void coldLoad(InstrMgr* mgr)
+	{
+		SQLite::Database db(mainDb(), SQLite::OPEN_READONLY);
+		SQLite::Statement q(db, kSelectSql);
+		while (q.executeStep())
+		{
+			InstrSpecPtr spec = mgr->createInstrSpecFromParams(q.getColumn(0).getText(), q.getColumn(1).getText(), "FUT",
+				q.getColumn(2).getText(), q.getColumn(3).getInt(), 0, 0.0, q.getColumn(4).getDouble(), q.getColumn(5).getDouble());
+			InstrPtr instr = mgr->createInstr(spec);
+			if (instr != nullptr) { mgr->addInstr(instr); }
+		}
+	}
+}
+
+class ColdLoadBenchmark : public Benchmark
+{
+public:
+	using Benchmark::Benchmark;
+
+protected:
+	void Initialize(Context&) override
+	{
+		mainDb();
+		m_n = 0;
+	}
+
+	void Run(Context&) override
+	{
+		InstrMgr* mgr = InstrMgr::getInstance();
+		mgr->clearAll();
+		coldLoad(mgr);
+		mgr->publishInstrRegistry();
+		++m_n;
+	}
+
+	void Cleanup(Context& context) override
+	{
+		context.metrics().AddItems(m_n * kInstrs);
+	}
+
+private:
+	int64_t m_n;
+};
+
+class WarmRestartBenchmark : public Benchmark
+{
+public:
+	using Benchmark::Benchmark;
+
+protected:
+	void Initialize(Context&) override
+	{
+		m_snapshot = tempPath("BenchInstrSnapshot.snp");
+		boost::system::error_code ec;
+		boost::filesystem::remove(m_snapshot, ec);
+		// the first call does the cold load and writes the snapshot
+		InstrMgr::getInstance()->clearAll();
+		restart();
+		m_n = 0;
+		m_warm = 0;
+	}
+
+	void Run(Context&) override
+	{
+		InstrMgr::getInstance()->clearAll();
+		m_warm += restart() ? 1 : 0;
+		++m_n;
+	}
+
+	void Cleanup(Context& context) override
+	{
+		context.metrics().AddItems(m_n * kInstrs);
+		std::printf("warm %lld/%lld, last restart %.1f ms: %s\n", (long long)m_warm, (long long)m_n, m_stats.totalMs, m_stats.str().c_str());
+	}
+
+	bool restart()
+	{
+		InstrMgr* mgr = InstrMgr::getInstance();
+		return InstrSnapshot::loadOrBuild(m_snapshot, []() { return InstrSnapshot::mainDbVersion(kSelectSql, mainDb()); }, kTradingDay,
+			[mgr]() { coldLoad(mgr); }, mgr, &m_stats);
+	}
+
+private:
+	std::string m_snapshot;
+	InstrSnapshotStats m_stats;
+	int64_t m_n;
+	int64_t m_warm;
+};
+
+BENCHMARK_CLASS(ColdLoadBenchmark, "InstrSnapshot.coldLoad", Settings().Operations(kRestartOperations).Attempts(3))
+BENCHMARK_CLASS(WarmRestartBenchmark, "InstrSnapshot.warmRestart", Settings().Operations(kRestartOperations).Attempts(3))
+
+BENCHMARK_MAIN()
@@ -0,0 +1,204 @@
+/**
+* \file BenchLineFilesPipeline.cpp
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Benchmark PipelinedLineFilesGroup against LineFilesGroup in merged lines per second.
+*
+* \description
+*	kFiles csv files of kLinesPerFile timestamped lines are written once to the temp directory.
+*	Each operation takes the next merged line, the group is rebuilt when every line is merged.
+*	"LineFilesGroup" and "pipelined.LineFiles" read the same LineFiles sources, "pipelined.files"
+*	reads the files itself. "readers1" is a single reader thread for all sources.
+*	Items per second of the report is lines/sec.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "XTBenchmark.h"
+#include "XTBenchmarkRegister.h"
+
+#include "LineFiles.h"
+#include "LineFilesGroup.h"
+#include "LineFilesPipeline.h"
+
+using namespace XT;
+
+namespace
+{
+	const int kFiles = 256;
+	const int kLinesPerFile = 20000;
+	const int64_t kLineOperations = (int64_t)kFiles * kLinesPerFile;
+
+	/**
+	* Same files for every attempt and class, a header line then "ts,px,text"
+	*/
+	const std::vector<std::string>& benchFiles()
+	{
+		static std::vector<std::string> s_files;
+		if (!s_files.empty()) { return s_files; }
+		boost::filesystem::path dir = boost::filesystem::temp_directory_path() / "xt_bench_linefiles";
+		boost::filesystem::create_directories(dir);
+		std::mt19937 rng(3);
+		for (int f = 0; f < kFiles; ++f)
+		{
+			std::string path = (dir / ("f" + std::to_string(f) + ".csv")).string();
+			FILE* fp = std::fopen(path.c_str(), "wb");
+			if (!fp) { continue; }
+			std::fprintf(fp, "ts,px,text\n");
+			int64_t ts = 0;
+			for (int i = 0; i < kLinesPerFile; ++i)
+			{
+				ts += 1 + rng() % 100;
+				std::fprintf(fp, "%lld,%.2f,abcdefghijklmnopqrstuvwxyz\n", (long long)ts, 4000.0 + (double)(rng() % 2000) * 0.5);
+			}
+			std::fclose(fp);
+			s_files.push_back(path);
+		}
+		return s_files;
+	}
+
+	LineFilesPtr newLineFiles(const std::string& path)
+	{
+		LineFilesPtr lf = std::make_shared<LineFiles>();
+		lf->addFile(path);
+		return lf;
+	}
+}
+
+class LineFilesGroupBenchmark : public Benchmark
+{
+public:
+	using Benchmark::Benchmark;
+
+protected:
+	void Initialize(Context&) override
+	{
+		benchFiles();
+		m_n = 0;
+		m_bytes = 0;
+		open();
+	}
+
+	void Run(Context&) override
+	{
+		if (!m_group->hasNext())
+		{
+			open();
+			m_group->hasNext();
+		}
+		m_bytes += m_group->getLine().size();
+		++m_n;
+	}
+
+	void Cleanup(Context& context) override
+	{
+		context.metrics().AddItems(m_n);
+		m_group.reset();
+	}
+
+	void open()
+	{
+		m_group.reset(new LineFilesGroup());
+		const std::vector<std::string>& files = benchFiles();
+		for (size_t i = 0; i < files.size(); ++i)
+		{
+			m_group->addLineFiles("f" + std::to_string(i), newLineFiles(files[i]));
+		}
+	}
+
+private:
+	std::unique_ptr<LineFilesGroup> m_group;
+	int64_t m_n;
+	size_t m_bytes;
+};
+
+/**
+* @param lineFiles as LineFiles sources, else plain files read by the group
+* @param readers as reader threads, 0 for one per core
+*/
+template<bool lineFiles, size_t readers>
+class PipelinedBenchmark : public Benchmark
+{
+public:
+	using Benchmark::Benchmark;
+
+protected:
+	void Initialize(Context&) override
+	{
+		benchFiles();
+		m_n = 0;
+		m_bytes = 0;
+		open();
+	}
+
+	void Run(Context&) override
+	{
+		if (!m_group->hasNext())
+		{
+			open();
+			m_group->hasNext();
+		}
+		const char* p;
+		size_t n;
+		m_group->getLineView(p, n);
+		m_bytes += n;
+		++m_n;
+	}
+
+	void Cleanup(Context& context) override
+	{
+		context.metrics().AddItems(m_n);
+		m_group.reset();
+	}
+
+	void open()
+	{
+		m_group.reset(); //stop the readers of the last pass first
+		m_group.reset(new PipelinedLineFilesGroup(256 << 20, 256 << 10, readers));
+		const std::vector<std::string>& files = benchFiles();
+		for (size_t i = 0; i < files.size(); ++i)
+		{
+			std::string name = "f" + std::to_string(i);
+			if (lineFiles) { m_group->addLineFiles(name, newLineFiles(files[i])); }
+			else { m_group->addFiles(name, { files[i] }, PipelinedLineFilesGroup::LineTsParser(), 1); }
+		}
+	}
+
+private:
+	std::unique_ptr<PipelinedLineFilesGroup> m_group;
+	int64_t m_n;
+	size_t m_bytes;
+};
+
+class PipelinedLineFilesBenchmark : public PipelinedBenchmark<true, 0>
+{
+public:
+	using PipelinedBenchmark::PipelinedBenchmark;
+};
+
+class PipelinedFilesBenchmark : public PipelinedBenchmark<false, 0>
+{
+public:
+	using PipelinedBenchmark::PipelinedBenchmark;
+};
+
+class PipelinedFilesOneReaderBenchmark : public PipelinedBenchmark<false, 1>
+{
+public:
+	using PipelinedBenchmark::PipelinedBenchmark;
+};
+
+BENCHMARK_CLASS(LineFilesGroupBenchmark, "LineFiles.LineFilesGroup", Settings().Operations(kLineOperations).Attempts(5))
+BENCHMARK_CLASS(PipelinedLineFilesBenchmark, "LineFiles.pipelined.LineFiles", Settings().Operations(kLineOperations).Attempts(5))
+BENCHMARK_CLASS(PipelinedFilesBenchmark, "LineFiles.pipelined.files", Settings().Operations(kLineOperations).Attempts(5))
+BENCHMARK_CLASS(PipelinedFilesOneReaderBenchmark, "LineFiles.pipelined.files.readers1", Settings().Operations(kLineOperations).Attempts(5))
+
+BENCHMARK_MAIN()
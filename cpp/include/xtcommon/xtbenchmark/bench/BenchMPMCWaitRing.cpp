@@ -0,0 +1,129 @@
+/**
+* \file BenchMPMCWaitRing.cpp
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Benchmark the Sim gateway task queue, MPMCWaitRing against ConcurrentQueue.
+*
+* \description
+*	Run pushes one task shaped like SimMdTask, a consumer thread drains the queue as
+*	processTask does. Cleanup waits for the consumer to take every task, so the time per
+*	operation is the producer cost with the queue kept busy. "batch" drains with DequeueBatch.
+*/
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/any.hpp>
+
+#include "XTBenchmark.h"
+#include "XTBenchmarkRegister.h"
+
+#include "Containers.h"
+#include "XTMPMCWaitRing.h"
+
+using namespace XT;
+
+namespace
+{
+	const int64_t kTaskOperations = 5000000;
+	const int kStopTag = -1;
+
+	struct BenchTask
+	{
+		int task_tag;
+		boost::any task_data;
+	};
+}
+
+template<typename Queue>
+class TaskQueueBenchmark : public Benchmark
+{
+public:
+	using Benchmark::Benchmark;
+
+protected:
+	void Initialize(Context&) override
+	{
+		m_queue.reset(new Queue());
+		m_taken.store(0);
+		m_i = 0;
+		m_consumer = std::thread([this]() { consume(); });
+	}
+
+	void Run(Context&) override
+	{
+		BenchTask task;
+		task.task_tag = (int)(m_i++ & 1023);
+		m_queue->emplace(std::move(task));
+	}
+
+	void Cleanup(Context& context) override
+	{
+		BenchTask stop;
+		stop.task_tag = kStopTag;
+		m_queue->emplace(std::move(stop));
+		m_consumer.join();
+		context.metrics().AddItems(m_taken.load());
+		m_queue.reset();
+	}
+
+	virtual void consume()
+	{
+		for (;;)
+		{
+			BenchTask task = m_queue->wait_and_pop_move();
+			if (task.task_tag == kStopTag) { return; }
+			m_taken.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+protected:
+	std::unique_ptr<Queue> m_queue;
+	std::thread m_consumer;
+	std::atomic<int64_t> m_taken;
+	int64_t m_i;
+};
+
+class ConcurrentQueueBenchmark : public TaskQueueBenchmark<ConcurrentQueue<BenchTask> >
+{
+public:
+	using TaskQueueBenchmark::TaskQueueBenchmark;
+};
+
+class WaitRingBenchmark : public TaskQueueBenchmark<MPMCWaitRing<BenchTask> >
+{
+public:
+	using TaskQueueBenchmark::TaskQueueBenchmark;
+};
+
+class WaitRingBatchBenchmark : public TaskQueueBenchmark<MPMCWaitRing<BenchTask> >
+{
+public:
+	using TaskQueueBenchmark::TaskQueueBenchmark;
+
+protected:
+	void consume() override
+	{
+		std::vector<BenchTask> tasks;
+		for (;;)
+		{
+			tasks.clear();
+			m_queue->DequeueBatch(tasks, 256);
+			for (const BenchTask& task : tasks)
+			{
+				if (task.task_tag == kStopTag) { return; }
+				m_taken.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	}
+};
+
+BENCHMARK_CLASS(ConcurrentQueueBenchmark, "SimTaskQueue.ConcurrentQueue", Settings().Operations(kTaskOperations).Attempts(5))
+BENCHMARK_CLASS(WaitRingBenchmark, "SimTaskQueue.MPMCWaitRing", Settings().Operations(kTaskOperations).Attempts(5))
+BENCHMARK_CLASS(WaitRingBatchBenchmark, "SimTaskQueue.MPMCWaitRing.batch", Settings().Operations(kTaskOperations).Attempts(5))
+
+BENCHMARK_MAIN()
@@ -0,0 +1,125 @@
+/**
+* \file BenchRollingRing.cpp
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Benchmark RollingRing against Rolling in ticks per second.
+*
+* \description
+*	Each operation adds one tick and reads the window sum, min and max as a bar maker does.
+*	"Time" feeds a 60 second window with ticks every 0.5 ms on average, "Tick" a 120 tick window.
+*	Items per second of the report is ticks/sec.
+*/
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "XTBenchmark.h"
+#include "XTBenchmarkRegister.h"
+
+#include "Rolling.h"
+#include "RollingRing.h"
+
+using namespace XT;
+
+namespace
+{
+	const int64_t kTickOperations = 5000000;
+	const int32_t kTimeSpan = 60;
+	const int32_t kTickSpan = 120;
+
+	/**
+	* Same pseudo random ticks for every attempt and class
+	*/
+	struct TickFeed
+	{
+		std::vector<int64_t> dts;
+		std::vector<double> xs;
+
+		void build(size_t n)
+		{
+			std::mt19937 rng(5);
+			dts.resize(n);
+			xs.resize(n);
+			int64_t dt = 1600000000000000LL;
+			for (size_t i = 0; i < n; ++i)
+			{
+				dt += rng() % 1000;
+				dts[i] = dt;
+				xs[i] = 4000.0 + (double)(int)(rng() % 201 - 100) * 0.5;
+			}
+		}
+	};
+
+	const size_t kFeedSize = 1 << 20;
+}
+
+template<typename R, RollingType::enumtype rtype, int32_t span>
+class RollingAddBenchmark : public Benchmark
+{
+public:
+	using Benchmark::Benchmark;
+
+protected:
+	void Initialize(Context&) override
+	{
+		if (m_feed.dts.empty()) { m_feed.build(kFeedSize); }
+		m_rolling.reset(new R(span, rtype, DateTimeType::UTS));
+		m_i = 0;
+		m_sink = 0;
+	}
+
+	void Run(Context&) override
+	{
+		size_t k = (size_t)(m_i++ & (kFeedSize - 1));
+		//keep the time strictly increasing when the feed wraps
+		int64_t dt = m_feed.dts[k] + (m_i / (int64_t)kFeedSize) * (m_feed.dts.back() - m_feed.dts.front() + 1000);
+		m_rolling->add(dt, m_feed.xs[k]);
+		m_sink += m_rolling->getSum() + m_rolling->getMinRolling() + m_rolling->getMaxRolling();
+	}
+
+	void Cleanup(Context& context) override
+	{
+		context.metrics().AddItems(m_i);
+		m_rolling.reset();
+	}
+
+private:
+	TickFeed m_feed;
+	std::unique_ptr<R> m_rolling;
+	int64_t m_i;
+	double m_sink;
+};
+
+class RollingTimeBenchmark : public RollingAddBenchmark<Rolling, RollingType::Time, kTimeSpan>
+{
+public:
+	using RollingAddBenchmark::RollingAddBenchmark;
+};
+
+class RollingRingTimeBenchmark : public RollingAddBenchmark<RollingRing, RollingType::Time, kTimeSpan>
+{
+public:
+	using RollingAddBenchmark::RollingAddBenchmark;
+};
+
+class RollingTickBenchmark : public RollingAddBenchmark<Rolling, RollingType::Tick, kTickSpan>
+{
+public:
+	using RollingAddBenchmark::RollingAddBenchmark;
+};
+
+class RollingRingTickBenchmark : public RollingAddBenchmark<RollingRing, RollingType::Tick, kTickSpan>
+{
+public:
+	using RollingAddBenchmark::RollingAddBenchmark;
+};
+
+BENCHMARK_CLASS(RollingTimeBenchmark, "Rolling.Time", Settings().Operations(kTickOperations).Attempts(5))
+BENCHMARK_CLASS(RollingRingTimeBenchmark, "RollingRing.Time", Settings().Operations(kTickOperations).Attempts(5))
+BENCHMARK_CLASS(RollingTickBenchmark, "Rolling.Tick", Settings().Operations(kTickOperations).Attempts(5))
+BENCHMARK_CLASS(RollingRingTickBenchmark, "RollingRing.Tick", Settings().Operations(kTickOperations).Attempts(5))
+
+BENCHMARK_MAIN()
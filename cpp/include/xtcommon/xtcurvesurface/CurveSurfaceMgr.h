@@ -69,12 +69,12 @@ public:
 	/**
 	* @brief default copy constructor
 	*/
-	CurveSurfaceMgr(const CurveSurfaceMgr& from) {} //= delete;
+	CurveSurfaceMgr(const CurveSurfaceMgr&) {} //= delete;
 
 	/**
 	* @brief default copy assignment
 	*/
-	CurveSurfaceMgr& operator=(const CurveSurfaceMgr& from) { return *this; } //= delete;
+	CurveSurfaceMgr& operator=(const CurveSurfaceMgr&) { return *this; } //= delete;
 	
 	/**
 	* @brief destructor
@@ -131,7 +131,7 @@ public:
 
 		T popped_value = std::move(m_queue.front());			// get the front value
 		m_queue.pop();								// pop out the value
-		return std::move(popped_value);							//return the value
+		return popped_value;							//return the value
 	}
 
 };
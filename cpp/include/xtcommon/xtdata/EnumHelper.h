@@ -32,8 +32,8 @@ class XT_COMMON_API BuySellTypeHelper {
 
 public:
 	BuySellTypeHelper() {}
-	BuySellTypeHelper(const BuySellTypeHelper& from) {}// = delete;
-	const BuySellTypeHelper& operator=(const BuySellTypeHelper& from) { return *this; }// = delete;
+	BuySellTypeHelper(const BuySellTypeHelper&) {}// = delete;
+	const BuySellTypeHelper& operator=(const BuySellTypeHelper&) { return *this; }// = delete;
 	virtual ~BuySellTypeHelper() {}
 
 public:
@@ -0,0 +1,641 @@
+#pragma once
+#ifndef XT_LINE_FILES_PIPELINE_H
+#define XT_LINE_FILES_PIPELINE_H
+
+/**
+* \file LineFilesPipeline.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a pipelined files group class .
+*
+* \description
+*	Designed for merging many timestamped line files (e.g. per instrument csv) by time.
+*	Every source is a stage that reads ahead and extracts the line timestamps into chunks of
+*	lines, handed to the merging thread through a SPSC queue. The merge is a heap over the
+*	sources. The bytes read ahead are bounded by a memory budget shared by the sources.
+*	hasNext/getLine/getLineTs/getName work as in LineFilesGroup.
+*
+*	Stages are read by a fixed number of reader threads, not one thread per source: a reader
+*	goes round its stages and reads one chunk at a time for every stage under its quota.
+*	By default there are as many readers as cores, at most one per source.
+*
+*	A source is either a LineFiles (its own timestamp parsing) or a list of plain files with
+*	a timestamp parser, read with large buffered reads.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include "XTConfig.h"
+#include "XTSPSCRingQueue.h"
+#include "LineFiles.h"
+
+namespace XT
+{
+
+class PipelinedLineFilesGroup
+{
+public:
+	/**
+	* @brief timestamp of a line, lines are given without the end of line
+	*/
+	typedef std::function<int64_t(const char* line, size_t len)> LineTsParser;
+
+	/**
+	* @brief constructor
+	*
+	* @param membudget as bytes of lines read ahead over all sources
+	* @param chunkbytes as bytes of lines per chunk handed to the merge
+	* @param readers as reader threads, 0 for one per core
+	*/
+	explicit PipelinedLineFilesGroup(size_t membudget = 256 << 20, size_t chunkbytes = 256 << 10, size_t readers = 0)
+		: m_memBudget(membudget), m_chunkBytes(std::max<size_t>(chunkbytes, 4096)), m_readerCount(readers), m_stopping(false),
+		m_isInitialized(false), m_needAdvance(true), m_hasNext(false), m_curr(-1), m_lineTs(0), m_lineCount(0)
+	{
+	}
+
+	PipelinedLineFilesGroup(const PipelinedLineFilesGroup&) = delete;
+	PipelinedLineFilesGroup& operator=(const PipelinedLineFilesGroup&) = delete;
+
+	virtual ~PipelinedLineFilesGroup() { stop(); }
+
+public:
+	/**
+	* @brief add a LineFiles source, read ahead with its own hasNext/getLine/getLineTs
+	*/
+	void addLineFiles(const std::string& name, const LineFilesPtr& linefiles)
+	{
+		Stage* s = newStage(name);
+		s->lineFiles = linefiles;
+	}
+
+	/**
+	* @brief add plain files read one after the other as one source
+	*
+	* @param name as source name
+	* @param files as file paths
+	* @param parser as line timestamp parser, default parseLeadingInt
+	* @param skiplines as header lines to skip in each file
+	*/
+	void addFiles(const std::string& name, const std::vector<std::string>& files, const LineTsParser& parser = LineTsParser(), int skiplines = 0)
+	{
+		Stage* s = newStage(name);
+		s->files = files;
+		s->parser = parser ? parser : LineTsParser(&PipelinedLineFilesGroup::parseLeadingInt);
+		s->skipLines = skiplines;
+	}
+
+	/**
+	* @brief set the reader threads before init, 0 for one per core
+	*/
+	void setReaderCount(size_t readers) { m_readerCount = readers; }
+
+	/** reader threads started by init */
+	size_t getReaderCount() const { return m_readers.size(); }
+
+	/**
+	* @brief start the read ahead stages
+	*/
+	void init()
+	{
+		if (m_isInitialized) { return; }
+		m_isInitialized = true;
+		size_t n = std::max<size_t>(m_stages.size(), 1);
+		size_t quota = std::max(m_memBudget / n, m_chunkBytes);
+		size_t nreaders = m_readerCount > 0 ? m_readerCount : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		nreaders = std::min(nreaders, m_stages.size());
+		for (size_t i = 0; i < nreaders; ++i) { m_readers.emplace_back(new Reader()); }
+		for (size_t i = 0; i < m_stages.size(); ++i)
+		{
+			Stage* s = m_stages[i].get();
+			s->quota = quota;
+			s->reader = m_readers[i % nreaders].get();
+			s->reader->stages.push_back(s);
+		}
+		for (auto& r : m_readers)
+		{
+			Reader* rp = r.get();
+			r->thread = std::thread([this, rp]() { runReader(rp); });
+		}
+		for (size_t i = 0; i < m_stages.size(); ++i)
+		{
+			if (fetch(m_stages[i].get())) { m_heap.push(HeapItem(currTs(m_stages[i].get()), (int)i)); }
+		}
+	}
+
+	/**
+	* @brief is there a next line, it becomes the current line
+	*/
+	bool hasNext()
+	{
+		if (!m_isInitialized) { init(); }
+		if (!m_needAdvance) { return m_hasNext; }
+		m_needAdvance = false;
+		if (m_curr >= 0)
+		{
+			Stage* s = m_stages[m_curr].get();
+			++s->pos;
+			if (fetch(s)) { m_heap.push(HeapItem(currTs(s), m_curr)); }
+			m_curr = -1;
+		}
+		if (m_heap.empty())
+		{
+			m_hasNext = false;
+			return false;
+		}
+		m_curr = m_heap.top().second;
+		m_heap.pop();
+		Stage* s = m_stages[m_curr].get();
+		m_lineTs = currTs(s);
+		++m_lineCount;
+		m_hasNext = true;
+		return true;
+	}
+
+	/**
+	* @brief current line, the next hasNext moves on
+	*/
+	std::string& getLine()
+	{
+		m_needAdvance = true;
+		if (m_curr < 0) { m_line.clear(); return m_line; }
+		const char* p;
+		size_t n;
+		currLine(m_stages[m_curr].get(), p, n);
+		m_line.assign(p, n);
+		return m_line;
+	}
+
+	/**
+	* @brief current line without copy, valid until the next hasNext
+	*/
+	void getLineView(const char*& p, size_t& n)
+	{
+		m_needAdvance = true;
+		if (m_curr < 0) { p = ""; n = 0; return; }
+		currLine(m_stages[m_curr].get(), p, n);
+	}
+
+	int64_t getLineTs() { return m_lineTs; }
+
+	/** name of the source of the current line */
+	const std::string& getName() { return m_curr >= 0 ? m_stages[m_curr]->name : m_emptyString; }
+
+	int getLineCount() const { return m_lineCount; }
+
+	/**
+	* @brief stop the stages, lines not merged yet are dropped
+	*/
+	void stop()
+	{
+		m_stopping.store(true);
+		for (auto& r : m_readers)
+		{
+			std::lock_guard<std::mutex> lock(r->mutex);
+			r->spaceCv.notify_all();
+		}
+		for (auto& r : m_readers)
+		{
+			if (r->thread.joinable()) { r->thread.join(); }
+		}
+		for (auto& s : m_stages)
+		{
+			if (s->curr) { delete s->curr; s->curr = nullptr; }
+			if (s->pending) { delete s->pending; s->pending = nullptr; }
+			if (s->file) { std::fclose(s->file); s->file = nullptr; }
+			Chunk* c = nullptr;
+			while (s->queue.Dequeue(c)) { delete c; }
+		}
+	}
+
+	/** bytes read ahead and not merged yet */
+	size_t getBytesInFlight() const
+	{
+		size_t n = 0;
+		for (auto& s : m_stages) { n += s->bytesInFlight.load(std::memory_order_relaxed); }
+		return n;
+	}
+
+public:
+	/**
+	* @brief default timestamp parser, the leading integer of the line
+	*/
+	static int64_t parseLeadingInt(const char* p, size_t n)
+	{
+		size_t i = 0;
+		while (i < n && (p[i] == ' ' || p[i] == '\t')) { ++i; }
+		bool neg = (i < n && p[i] == '-');
+		if (neg) { ++i; }
+		int64_t v = 0;
+		for (; i < n && p[i] >= '0' && p[i] <= '9'; ++i) { v = v * 10 + (p[i] - '0'); }
+		return neg ? -v : v;
+	}
+
+protected:
+	/**
+	* lines of a source, stored back to back
+	*/
+	struct Chunk
+	{
+		std::string data;
+		std::vector<uint32_t> offsets; ///< begin of each line, plus the end
+		std::vector<int64_t> ts;
+		size_t bytes() const { return data.capacity() + offsets.capacity() * 4 + ts.capacity() * 8; }
+	};
+
+	struct Stage;
+
+	/**
+	* a reader thread and the stages it reads
+	*/
+	struct Reader
+	{
+		Reader() : producerWaiting(false) {}
+
+		std::thread thread;
+		std::vector<Stage*> stages;
+		std::atomic<bool> producerWaiting;
+		std::mutex mutex;
+		std::condition_variable spaceCv; ///< reader waits for room in one of its stages
+	};
+
+	struct Stage
+	{
+		Stage() : queue(64), quota(0), skipLines(0), reader(nullptr), bytesInFlight(0), finished(false), consumerWaiting(false),
+			pending(nullptr), eof(false), started(false), fileIdx(0), file(nullptr), skip(0), bufPos(0), bufLen(0), hasCarry(false), carryTs(0),
+			curr(nullptr), pos(0) {}
+
+		std::string name;
+		LineFilesPtr lineFiles;
+		std::vector<std::string> files;
+		LineTsParser parser;
+		SPSCRingQueue<Chunk*> queue;
+		size_t quota; ///< bytes this stage may read ahead
+		int skipLines;
+
+		Reader* reader;
+		std::atomic<size_t> bytesInFlight;
+		std::atomic<bool> finished;
+		std::atomic<bool> consumerWaiting;
+		std::mutex mutex;
+		std::condition_variable dataCv; ///< consumer waits for a chunk
+
+		//read position, only used by the reader thread
+		Chunk* pending; ///< chunk read and not handed over yet
+		bool eof;
+		bool started;
+		size_t fileIdx;
+		FILE* file;
+		int skip; ///< header lines left to skip in file
+		std::vector<char> buf;
+		size_t bufPos;
+		size_t bufLen;
+		std::string partial; ///< line split over two reads
+		bool hasCarry; ///< a LineFiles line that did not fit the last chunk
+		std::string carry;
+		int64_t carryTs;
+
+		Chunk* curr; ///< chunk being merged
+		size_t pos; ///< line in curr
+	};
+
+	typedef std::pair<int64_t, int> HeapItem; ///< ts, stage
+	typedef std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem> > Heap;
+
+	Stage* newStage(const std::string& name)
+	{
+		m_stages.emplace_back(new Stage());
+		m_stages.back()->name = name;
+		return m_stages.back().get();
+	}
+
+	static int64_t currTs(Stage* s) { return s->curr->ts[s->pos]; }
+
+	static void currLine(Stage* s, const char*& p, size_t& n)
+	{
+		uint32_t b = s->curr->offsets[s->pos];
+		p = s->curr->data.data() + b;
+		n = s->curr->offsets[s->pos + 1] - b;
+	}
+
+	/**
+	* @brief make sure the stage has a current line
+	*
+	* @return false when the stage has no more lines
+	*/
+	bool fetch(Stage* s)
+	{
+		if (s->curr && s->pos < s->curr->ts.size()) { return true; }
+		if (s->curr)
+		{
+			releaseChunk(s, s->curr);
+			s->curr = nullptr;
+		}
+		for (;;)
+		{
+			Chunk* c = nullptr;
+			if (s->queue.Dequeue(c))
+			{
+				if (c->ts.empty())
+				{
+					releaseChunk(s, c);
+					continue;
+				}
+				s->curr = c;
+				s->pos = 0;
+				return true;
+			}
+			if (s->finished.load(std::memory_order_acquire))
+			{
+				// the last chunks may have been queued right before finished was set
+				if (s->queue.Dequeue(c))
+				{
+					s->curr = c;
+					s->pos = 0;
+					if (!c->ts.empty()) { return true; }
+					releaseChunk(s, c);
+					s->curr = nullptr;
+					continue;
+				}
+				return false;
+			}
+			std::unique_lock<std::mutex> lock(s->mutex);
+			s->consumerWaiting.store(true);
+			s->dataCv.wait_for(lock, std::chrono::milliseconds(1), [s]() { return !s->queue.empty() || s->finished.load(); });
+			s->consumerWaiting.store(false);
+		}
+	}
+
+	void releaseChunk(Stage* s, Chunk* c)
+	{
+		s->bytesInFlight.fetch_sub(c->bytes(), std::memory_order_relaxed);
+		delete c;
+		Reader* r = s->reader;
+		if (r->producerWaiting.load())
+		{
+			std::lock_guard<std::mutex> lock(r->mutex);
+			r->spaceCv.notify_one();
+		}
+	}
+
+	/**
+	* @brief hand a chunk to the merge unless the stage is over its quota
+	*
+	* @return false if there is no room, the chunk is kept by the caller
+	*/
+	bool tryPushChunk(Stage* s, Chunk* c)
+	{
+		size_t b = c->bytes();
+		size_t inflight = s->bytesInFlight.load(std::memory_order_relaxed);
+		if (inflight != 0 && inflight + b > s->quota) { return false; }
+		s->bytesInFlight.fetch_add(b, std::memory_order_relaxed);
+		if (!s->queue.Enqueue(c))
+		{
+			s->bytesInFlight.fetch_sub(b, std::memory_order_relaxed);
+			return false;
+		}
+		if (s->consumerWaiting.load())
+		{
+			std::lock_guard<std::mutex> lock(s->mutex);
+			s->dataCv.notify_one();
+		}
+		return true;
+	}
+
+	void finishStage(Stage* s)
+	{
+		s->finished.store(true, std::memory_order_release);
+		std::lock_guard<std::mutex> lock(s->mutex);
+		s->dataCv.notify_one();
+	}
+
+	static Chunk* newChunk(size_t bytes)
+	{
+		Chunk* c = new Chunk();
+		c->data.reserve(bytes);
+		c->offsets.push_back(0);
+		return c;
+	}
+
+	static void addLine(Chunk* c, const char* p, size_t n, int64_t ts)
+	{
+		c->data.append(p, n);
+		c->offsets.push_back((uint32_t)c->data.size());
+		c->ts.push_back(ts);
+	}
+
+	/**
+	* @brief read the stages of a reader, one chunk per stage and round, until all are finished
+	*/
+	void runReader(Reader* r)
+	{
+		size_t active = r->stages.size();
+		while (active > 0 && !m_stopping.load())
+		{
+			bool progress = false;
+			for (Stage* s : r->stages)
+			{
+				if (s->finished.load(std::memory_order_relaxed)) { continue; }
+				if (!s->pending && !s->eof)
+				{
+					s->pending = newChunk(m_chunkBytes);
+					s->eof = !readChunk(s, s->pending);
+					if (s->pending->ts.empty())
+					{
+						delete s->pending;
+						s->pending = nullptr;
+					}
+				}
+				if (s->pending && tryPushChunk(s, s->pending))
+				{
+					s->pending = nullptr;
+					progress = true;
+				}
+				if (!s->pending && s->eof)
+				{
+					finishStage(s);
+					--active;
+					progress = true;
+				}
+			}
+			if (!progress)
+			{
+				std::unique_lock<std::mutex> lock(r->mutex);
+				r->producerWaiting.store(true);
+				r->spaceCv.wait_for(lock, std::chrono::milliseconds(1));
+				r->producerWaiting.store(false);
+			}
+		}
+	}
+
+	/**
+	* @brief fill a chunk from the read position of the stage
+	*
+	* @return false when the source has no more lines
+	*/
+	bool readChunk(Stage* s, Chunk* c)
+	{
+		if (s->lineFiles) { return readLineFilesChunk(s, c); }
+		return readFilesChunk(s, c);
+	}
+
+	/**
+	* @brief whether a line does not fit a chunk, a chunk takes at least one line
+	*/
+	bool isFull(const Chunk* c, size_t len) const
+	{
+		return !c->ts.empty() && c->data.size() + len > m_chunkBytes;
+	}
+
+	bool readLineFilesChunk(Stage* s, Chunk* c)
+	{
+		LineFilesPtr& lf = s->lineFiles;
+		if (!s->started)
+		{
+			s->started = true;
+			lf->init();
+		}
+		if (s->hasCarry)
+		{
+			s->hasCarry = false;
+			addLine(c, s->carry.data(), s->carry.size(), s->carryTs);
+		}
+		while (lf->hasNext())
+		{
+			std::string& line = lf->getLine();
+			if (isFull(c, line.size()))
+			{
+				s->carry.assign(line);
+				s->carryTs = lf->getLineTs();
+				s->hasCarry = true;
+				return true;
+			}
+			addLine(c, line.data(), line.size(), lf->getLineTs());
+		}
+		return false;
+	}
+
+	/**
+	* @brief add a line of a plain file
+	*
+	* @return false if the line does not fit the chunk, it is left unread
+	*/
+	bool takeLine(Stage* s, Chunk* c, const char* p, size_t len)
+	{
+		if (len > 0 && p[len - 1] == '\r') { --len; }
+		if (s->skip > 0) { --s->skip; return true; }
+		if (len == 0) { return true; }
+		if (isFull(c, len)) { return false; }
+		addLine(c, p, len, s->parser(p, len));
+		return true;
+	}
+
+	bool readFilesChunk(Stage* s, Chunk* c)
+	{
+		for (;;)
+		{
+			if (!s->file)
+			{
+				if (s->fileIdx >= s->files.size())
+				{
+					std::vector<char>().swap(s->buf);
+					return false;
+				}
+				s->file = std::fopen(s->files[s->fileIdx].c_str(), "rb");
+				if (!s->file) { ++s->fileIdx; continue; }
+				s->skip = s->skipLines;
+				s->partial.clear();
+				s->bufPos = s->bufLen = 0;
+				s->buf.resize(m_chunkBytes);
+			}
+			if (s->bufPos == s->bufLen)
+			{
+				size_t n = std::fread(s->buf.data(), 1, s->buf.size(), s->file);
+				if (n == 0)
+				{
+					if (!s->partial.empty())
+					{
+						if (!takeLine(s, c, s->partial.data(), s->partial.size())) { return true; }
+						s->partial.clear();
+					}
+					std::fclose(s->file);
+					s->file = nullptr;
+					++s->fileIdx;
+					continue;
+				}
+				s->bufPos = 0;
+				s->bufLen = n;
+			}
+			const char* p = s->buf.data() + s->bufPos;
+			const char* end = s->buf.data() + s->bufLen;
+			while (p < end)
+			{
+				const char* nl = (const char*)std::memchr(p, '\n', (size_t)(end - p));
+				if (!nl)
+				{
+					s->partial.append(p, (size_t)(end - p));
+					p = end;
+					break;
+				}
+				if (!s->partial.empty())
+				{
+					// the line is complete only with this read, keep both parts until it fits
+					size_t n0 = s->partial.size();
+					s->partial.append(p, (size_t)(nl - p));
+					if (!takeLine(s, c, s->partial.data(), s->partial.size()))
+					{
+						s->partial.resize(n0);
+						s->bufPos = (size_t)(p - s->buf.data());
+						return true;
+					}
+					s->partial.clear();
+				}
+				else if (!takeLine(s, c, p, (size_t)(nl - p)))
+				{
+					s->bufPos = (size_t)(p - s->buf.data());
+					return true;
+				}
+				p = nl + 1;
+			}
+			s->bufPos = (size_t)(p - s->buf.data());
+		}
+	}
+
+protected:
+	std::vector<std::unique_ptr<Stage> > m_stages;
+	std::vector<std::unique_ptr<Reader> > m_readers;
+	Heap m_heap;
+
+	size_t m_memBudget; ///< bytes read ahead over all sources
+	size_t m_chunkBytes; ///< bytes of lines per chunk
+	size_t m_readerCount; ///< reader threads asked for, 0 for one per core
+	std::atomic<bool> m_stopping;
+
+	bool m_isInitialized;
+	bool m_needAdvance;
+	bool m_hasNext;
+	int m_curr; ///< stage of the current line
+	int64_t m_lineTs;
+	int m_lineCount;
+
+	std::string m_line;
+	std::string m_emptyString;
+};//class PipelinedLineFilesGroup
+typedef std::shared_ptr<PipelinedLineFilesGroup> PipelinedLineFilesGroupPtr;
+
+}//namespace XT
+
+#endif
@@ -0,0 +1,375 @@
+#pragma once
+#ifndef XT_PARAM_BINDING_H
+#define XT_PARAM_BINDING_H
+
+/**
+* \file ParamBinding.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide typed parameter blocks bound to StringMap parameters.
+*
+* \description
+*	StringMap::getDouble/getInt parse a string out of a protobuf map on every call.
+*	A ParamBinding declares the typed fields of a plain struct once, parses a StringMap
+*	into a new immutable block on init/update and publishes it through an atomic pointer.
+*	Tick handlers pin the thread (XT::Epoch), which keeps the block they read from being
+*	freed, and read its fields by reference.
+*
+*	struct EdgeParams { double edge = 0.5; int maxpos = 10; bool enabled = true; };
+*
+*	ParamBinding<EdgeParams> m_params;
+*	m_params.schema().add("edge", &EdgeParams::edge).add("maxpos", &EdgeParams::maxpos).add("enabled", &EdgeParams::enabled);
+*	m_params.update(smp);                    // init / updateStrParams
+*	ParamBinding<EdgeParams>::Reader params(m_params); // per tick, pins one block
+*	double edge = params->get().edge;
+*	int maxpos = params->getForIid(iid).maxpos;
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include "XTConfig.h"
+#include "LogUtil.h"
+#include "StringMap.h"
+#include "XTEpoch.h"
+
+namespace XT
+{
+
+	//////parsing of single values
+	template<typename T>
+	struct ParamTraits;
+
+	template<>
+	struct ParamTraits<double>
+	{
+		static bool parse(const std::string& s, double& v)
+		{
+			char* end = nullptr;
+			errno = 0;
+			double d = strtod(s.c_str(), &end);
+			if (end == s.c_str() || errno != 0) { return false; }
+			v = d;
+			return true;
+		}
+	};
+
+	template<>
+	struct ParamTraits<int64_t>
+	{
+		static bool parse(const std::string& s, int64_t& v)
+		{
+			char* end = nullptr;
+			errno = 0;
+			long long i = strtoll(s.c_str(), &end, 10);
+			if (end == s.c_str() || errno != 0) { return false; }
+			v = (int64_t)i;
+			return true;
+		}
+	};
+
+	template<>
+	struct ParamTraits<int>
+	{
+		static bool parse(const std::string& s, int& v)
+		{
+			int64_t i;
+			if (!ParamTraits<int64_t>::parse(s, i)) { return false; }
+			v = (int)i;
+			return true;
+		}
+	};
+
+	template<>
+	struct ParamTraits<bool>
+	{
+		static bool parse(const std::string& s, bool& v)
+		{
+			if (s == "1" || boost::iequals(s, "true") || boost::iequals(s, "yes") || boost::iequals(s, "y")) { v = true; return true; }
+			if (s == "0" || boost::iequals(s, "false") || boost::iequals(s, "no") || boost::iequals(s, "n")) { v = false; return true; }
+			return false;
+		}
+	};
+
+	template<>
+	struct ParamTraits<std::string>
+	{
+		static bool parse(const std::string& s, std::string& v)
+		{
+			v = s;
+			return true;
+		}
+	};
+
+	/**
+	* Named typed fields of a parameter struct P
+	*/
+	template<typename P>
+	class ParamSchema
+	{
+	public:
+		typedef std::function<bool(const std::string&, P&)> Setter;
+
+		/**
+		* @brief declare a field, its default is the value in a default constructed P
+		*
+		* @param name as key in the StringMap
+		* @param field as member pointer
+		*/
+		template<typename T>
+		ParamSchema& add(const std::string& name, T P::* field)
+		{
+			m_names.push_back(name);
+			m_setters.push_back([field](const std::string& s, P& p) { return ParamTraits<T>::parse(s, p.*field); });
+			return *this;
+		}
+
+		/**
+		* @brief apply the declared fields found in smp on top of p
+		*
+		* @return number of values that failed to parse, those keep their previous value
+		*/
+		int apply(const StringMapPtr& smp, P& p) const
+		{
+			int nBad = 0;
+			if (smp == nullptr) { return nBad; }
+			for (size_t k = 0; k < m_names.size(); ++k)
+			{
+				if (!smp->hasKey(m_names[k])) { continue; }
+				std::string s = smp->getString(m_names[k]);
+				if (!m_setters[k](s, p))
+				{
+					++nBad;
+					LOGE("ParamSchema,bad value,name:" + m_names[k] + ",value:" + s);
+				}
+			}
+			return nBad;
+		}
+
+		const std::vector<std::string>& names() const { return m_names; }
+
+	protected:
+		std::vector<std::string> m_names;
+		std::vector<Setter> m_setters;
+	};
+
+	/**
+	* Type erased interface, lets Strat and the chains update every bound block from one StringMap
+	*/
+	class ParamBindingBase
+	{
+	public:
+		virtual ~ParamBindingBase() {}
+
+		virtual void update(const StringMapPtr& smp) = 0;
+
+		virtual void updateForIid(int iid, const StringMapPtr& smp) = 0;
+
+		/** replace strategy level and all iid parameters, published as one version */
+		virtual void updateAll(const StringMapPtr& smp, const std::map<int, StringMapPtr>& iidSmps) = 0;
+	};
+
+	/**
+	* Immutable parameter block of one version, with per iid overrides
+	*/
+	template<typename P>
+	struct ParamBlock
+	{
+		uint64_t version;
+		P base;
+		std::vector<P> byIid; ///< base with the iid overrides applied
+		std::vector<uint8_t> hasIid;
+
+		/** strategy level parameters */
+		const P& get() const { return base; }
+
+		/** parameters for iid, the strategy level ones when the iid has no override */
+		const P& getForIid(int iid) const
+		{
+			return (iid >= 0 && (size_t)iid < hasIid.size() && hasIid[iid]) ? byIid[iid] : base;
+		}
+	};
+
+	/**
+	* Publishes ParamBlock versions. Reads from any thread, updates serialized.
+	*
+	* The current block is a plain atomic pointer; a replaced block is retired to XT::Epoch and
+	* freed once no thread that was pinned when it was replaced is still pinned. Reading takes
+	* no lock and no reference count.
+	*/
+	template<typename P>
+	class ParamBinding : public ParamBindingBase
+	{
+	public:
+		typedef ParamBlock<P> Block;
+
+		/**
+		* Pinned view of the current block: one block for a whole tick, so its fields are read from
+		* the same version, valid until the Reader is destroyed.
+		*/
+		class Reader
+		{
+		public:
+			explicit Reader(const ParamBinding& binding) : m_block(binding.m_current.load(std::memory_order_acquire)) {}
+
+			Reader(const Reader&) = delete;
+			Reader& operator=(const Reader&) = delete;
+
+			const Block& operator*() const { return *m_block; }
+			const Block* operator->() const { return m_block; }
+
+		private:
+			Epoch::Guard m_pin; ///< declared first, pinned before the load
+			const Block* m_block;
+		};
+
+		ParamBinding()
+		{
+			Block* b = new Block();
+			b->version = 0;
+			m_current.store(b, std::memory_order_relaxed);
+		}
+
+		ParamBinding(const ParamBinding&) = delete;
+		ParamBinding& operator=(const ParamBinding&) = delete;
+
+		virtual ~ParamBinding() { delete m_current.load(std::memory_order_relaxed); }
+
+		ParamSchema<P>& schema() { return m_schema; }
+
+		/**
+		* @brief current block, the caller must be pinned (Epoch::Guard or a Reader) while using it
+		*/
+		const Block& block() const { return *m_current.load(std::memory_order_acquire); }
+
+		/**
+		* @brief strategy level parameters of the current block
+		*
+		*	The reference is valid while the calling thread stays pinned (Epoch::Guard); two calls
+		*	may see different versions, use a Reader to read several fields from one.
+		*/
+		const P& get() const { return block().get(); }
+
+		/** parameters for iid of the current block, pinned as get() */
+		const P& getForIid(int iid) const { return block().getForIid(iid); }
+
+		uint64_t version() const { return Reader(*this)->version; }
+
+		/**
+		* @brief parse strategy level parameters and publish, iid overrides are re-applied on top
+		*/
+		virtual void update(const StringMapPtr& smp)
+		{
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			m_baseSmp = smp;
+			publishLocked();
+		}
+
+		/**
+		* @brief parse iid parameters and publish, nullptr removes the override
+		*/
+		virtual void updateForIid(int iid, const StringMapPtr& smp)
+		{
+			if (iid < 0) { return; }
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			if (smp == nullptr)
+			{
+				m_iidSmps.erase(iid);
+			}
+			else
+			{
+				m_iidSmps[iid] = smp;
+			}
+			publishLocked();
+		}
+
+		/**
+		* @brief parse strategy level and iid parameters and publish once, iids not in iidSmps lose their override
+		*/
+		virtual void updateAll(const StringMapPtr& smp, const std::map<int, StringMapPtr>& iidSmps)
+		{
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			m_baseSmp = smp;
+			m_iidSmps.clear();
+			for (auto it = iidSmps.begin(); it != iidSmps.end(); ++it)
+			{
+				if (it->first >= 0 && it->second != nullptr) { m_iidSmps.insert(*it); }
+			}
+			publishLocked();
+		}
+
+	protected:
+		void publishLocked()
+		{
+			const Block* old = m_current.load(std::memory_order_relaxed);
+			std::unique_ptr<Block> b(new Block());
+			b->version = old->version + 1;
+			m_schema.apply(m_baseSmp, b->base);
+			if (!m_iidSmps.empty())
+			{
+				int maxIid = m_iidSmps.rbegin()->first;
+				b->byIid.resize(maxIid + 1);
+				b->hasIid.assign(maxIid + 1, 0);
+				for (auto it = m_iidSmps.begin(); it != m_iidSmps.end(); ++it)
+				{
+					b->byIid[it->first] = b->base;
+					m_schema.apply(it->second, b->byIid[it->first]);
+					b->hasIid[it->first] = 1;
+				}
+			}
+			m_current.store(b.release(), std::memory_order_release);
+			Epoch::Retire(old);
+		}
+
+	protected:
+		ParamSchema<P> m_schema;
+		std::atomic<const Block*> m_current; ///< set by publishLocked, which retires the block it replaces
+		std::mutex m_writeMutex;
+		StringMapPtr m_baseSmp;
+		std::map<int, StringMapPtr> m_iidSmps;
+	};
+
+	/**
+	* Bindings registered by an owner (Strat, OptionsChain, FuturesChain), updated together
+	*/
+	class ParamBindingSet
+	{
+	public:
+		/** register a binding, the owner keeps it alive */
+		void bind(ParamBindingBase* binding) { m_bindings.push_back(binding); }
+
+		void update(const StringMapPtr& smp)
+		{
+			for (ParamBindingBase* b : m_bindings) { b->update(smp); }
+		}
+
+		void updateForIid(int iid, const StringMapPtr& smp)
+		{
+			for (ParamBindingBase* b : m_bindings) { b->updateForIid(iid, smp); }
+		}
+
+		void updateAll(const StringMapPtr& smp, const std::map<int, StringMapPtr>& iidSmps)
+		{
+			for (ParamBindingBase* b : m_bindings) { b->updateAll(smp, iidSmps); }
+		}
+
+		bool empty() const { return m_bindings.empty(); }
+
+	protected:
+		std::vector<ParamBindingBase*> m_bindings;
+	};
+
+}//namespace XT
+
+#endif
@@ -0,0 +1,456 @@
+#pragma once
+#ifndef XT_XTMSG_WIRE_H
+#define XT_XTMSG_WIRE_H
+
+/**
+* \file XTMsgWire.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a flat binary wire format for XTMsg.
+*
+* \description
+*	XTMsg goes over the wire as json/pb/csv strings, each hop allocating strings for
+*	every key and value. The wire format here is a single contiguous buffer:
+*
+*	[XTMsgWireHeader][XTMsgWireEntry * count][name][s][key/value bytes]
+*
+*	Keys known to TagMgr travel as integer tags, other keys travel inline. XTMsgWireView
+*	reads fields straight out of a received buffer (zmq_msg_t, nng_msg) without decoding.
+*	All integers are little endian, as on every box we run on.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "XTConfig.h"
+#include "XTData.pb.h"
+#include "typedef_XTData.pb.h"
+
+#include "XTMsg.h"
+#include "TagMgr.h"
+
+namespace XT
+{
+
+#ifdef _WIN32
+#pragma  pack(push, 1)
+#endif
+	/**
+	* fixed header of a wire message
+	*/
+	struct XTMsgWireHeader
+	{
+		uint32_t magic; ///< XTMSG_WIRE_MAGIC
+		uint16_t version; ///< XTMSG_WIRE_VERSION
+		uint16_t flags; ///< XTMsgWireFlag bits, which of d/i/l/name/s are set
+		uint32_t length; ///< total length including header
+		uint32_t count; ///< number of key/value entries
+		double d;
+		int64_t l;
+		int32_t i;
+		uint32_t name_length;
+		uint32_t s_length;
+		uint32_t _reserved;
+#ifndef _WIN32
+	} __attribute__((packed));
+#else
+	};
+#endif
+
+	/**
+	* key/value entry, offsets are relative to the start of the message
+	*/
+	struct XTMsgWireEntry
+	{
+		int32_t tag; ///< TagMgr tag, 0 when the key is carried inline
+		uint32_t key_offset;
+		uint32_t key_length;
+		uint32_t value_offset;
+		uint32_t value_length;
+#ifndef _WIN32
+	} __attribute__((packed));
+#else
+	};
+#pragma pack(pop)
+#endif
+
+	static const uint32_t XTMSG_WIRE_MAGIC = 0x574D5458; // "XTMW"
+	static const uint16_t XTMSG_WIRE_VERSION = 1;
+
+	class XTMsgWireFlag
+	{
+	public:
+		enum enumtype
+		{
+			HasName = 1,
+			HasD = 2,
+			HasI = 4,
+			HasL = 8,
+			HasS = 16
+		};
+	};
+
+	/**
+	* non owning reference to bytes inside a wire message
+	*/
+	struct XTMsgWireStr
+	{
+		const char* data;
+		uint32_t size;
+
+		XTMsgWireStr() : data(nullptr), size(0) {}
+		XTMsgWireStr(const char* d, uint32_t n) : data(d), size(n) {}
+
+		bool empty() const { return size == 0; }
+		std::string str() const { return (data == nullptr) ? std::string() : std::string(data, size); }
+		bool equals(const char* s, size_t n) const { return (n == size) && (size == 0 || memcmp(data, s, n) == 0); }
+		bool equals(const std::string& s) const { return equals(s.data(), s.size()); }
+	};
+
+	/**
+	* Builds a wire message into a reusable buffer. Once the buffer has grown to the
+	* largest message, encoding does not allocate.
+	*/
+	class XTMsgWireBuilder
+	{
+	public:
+		XTMsgWireBuilder() { clear(); }
+
+		/** start a new message, keeps the capacity of the buffers */
+		void clear()
+		{
+			memset(&m_header, 0, sizeof(m_header));
+			m_header.magic = XTMSG_WIRE_MAGIC;
+			m_header.version = XTMSG_WIRE_VERSION;
+			m_name.clear();
+			m_s.clear();
+			m_entries.clear();
+			m_kv.clear();
+			m_buf.clear();
+		}
+
+		void setName(const std::string& s) { m_name = s; m_header.flags |= XTMsgWireFlag::HasName; }
+
+		void setDouble(double d) { m_header.d = d; m_header.flags |= XTMsgWireFlag::HasD; }
+
+		void setInt(int i) { m_header.i = i; m_header.flags |= XTMsgWireFlag::HasI; }
+
+		void setInt64(int64_t l) { m_header.l = l; m_header.flags |= XTMsgWireFlag::HasL; }
+
+		void setStr(const std::string& s) { m_s = s; m_header.flags |= XTMsgWireFlag::HasS; }
+
+		/**
+		* @brief add key value pair with an interned tag
+		*
+		* @param tag as TagMgr tag, must be positive
+		* @param value
+		*/
+		void addTagValue(int tag, const char* value, size_t n)
+		{
+			XTMsgWireEntry e;
+			e.tag = tag;
+			e.key_offset = 0;
+			e.key_length = 0;
+			e.value_offset = (uint32_t)m_kv.size();
+			e.value_length = (uint32_t)n;
+			m_kv.append(value, n);
+			m_entries.push_back(e);
+		}
+
+		void addTagValue(int tag, const std::string& value) { addTagValue(tag, value.data(), value.size()); }
+
+		/**
+		* @brief add key value pair, the key is interned through TagMgr when it knows it
+		*
+		* @param key
+		* @param value
+		*/
+		void addKeyValueStr(const std::string& key, const std::string& value)
+		{
+			int tag = TagMgr::getInstance()->getTagForName(key);
+			if (tag > 0)
+			{
+				addTagValue(tag, value);
+				return;
+			}
+			XTMsgWireEntry e;
+			e.tag = 0;
+			e.key_offset = (uint32_t)m_kv.size();
+			e.key_length = (uint32_t)key.size();
+			m_kv.append(key);
+			e.value_offset = (uint32_t)m_kv.size();
+			e.value_length = (uint32_t)value.size();
+			m_kv.append(value);
+			m_entries.push_back(e);
+		}
+
+		/** copy every field of a XTMsgData */
+		void fromXTMsgData(const XTMsgData& data)
+		{
+			if (data.has_name()) { setName(data.name()); }
+			if (data.has_d()) { setDouble(data.d()); }
+			if (data.has_i()) { setInt(data.i()); }
+			if (data.has_l()) { setInt64(data.l()); }
+			if (data.has_s()) { setStr(data.s()); }
+			for (auto it = data.strmap().begin(); it != data.strmap().end(); ++it)
+			{
+				addKeyValueStr(it->first, it->second);
+			}
+		}
+
+		/** copy every field of a XTMsg, works for every XTMsgDataPtr flavour */
+		void fromXTMsg(XTMsgPtr& msg)
+		{
+			XTMsgDataPtr& data = msg->data();
+			if (data->has_name()) { setName(data->name()); }
+			if (data->has_d()) { setDouble(data->d()); }
+			if (data->has_i()) { setInt(data->i()); }
+			if (data->has_l()) { setInt64(data->l()); }
+			if (data->has_s()) { setStr(data->s()); }
+			const ::google::protobuf::Map< ::std::string, ::std::string>& strmap = data->strmap();
+			for (auto it = strmap.begin(); it != strmap.end(); ++it)
+			{
+				addKeyValueStr(it->first, it->second);
+			}
+		}
+
+		/**
+		* @brief lay the message out into the internal buffer
+		*
+		* @return encoded message, valid until the next call on the builder
+		*/
+		const std::vector<char>& finish()
+		{
+			const uint32_t tableSize = (uint32_t)(m_entries.size() * sizeof(XTMsgWireEntry));
+			const uint32_t kvBase = (uint32_t)(sizeof(XTMsgWireHeader) + tableSize + m_name.size() + m_s.size());
+			m_header.count = (uint32_t)m_entries.size();
+			m_header.name_length = (uint32_t)m_name.size();
+			m_header.s_length = (uint32_t)m_s.size();
+			m_header.length = kvBase + (uint32_t)m_kv.size();
+
+			m_buf.resize(m_header.length);
+			char* p = m_buf.data();
+			memcpy(p, &m_header, sizeof(m_header));
+			p += sizeof(m_header);
+			for (size_t k = 0; k < m_entries.size(); ++k)
+			{
+				XTMsgWireEntry e = m_entries[k];
+				if (e.key_length > 0) { e.key_offset += kvBase; }
+				e.value_offset += kvBase;
+				memcpy(p, &e, sizeof(e));
+				p += sizeof(e);
+			}
+			if (!m_name.empty()) { memcpy(p, m_name.data(), m_name.size()); p += m_name.size(); }
+			if (!m_s.empty()) { memcpy(p, m_s.data(), m_s.size()); p += m_s.size(); }
+			if (!m_kv.empty()) { memcpy(p, m_kv.data(), m_kv.size()); }
+			return m_buf;
+		}
+
+		const char* data() const { return m_buf.data(); }
+
+		size_t size() const { return m_buf.size(); }
+
+	protected:
+		XTMsgWireHeader m_header;
+		std::string m_name;
+		std::string m_s;
+		std::vector<XTMsgWireEntry> m_entries;
+		std::string m_kv; ///< key/value bytes, offsets in m_entries are relative to it until finish()
+		std::vector<char> m_buf;
+	};
+
+	/**
+	* Read only view over an encoded wire message. Does not copy or own the buffer.
+	*/
+	class XTMsgWireView
+	{
+	public:
+		XTMsgWireView() : m_data(nullptr), m_size(0), m_valid(false) {}
+
+		XTMsgWireView(const void* data, size_t size) { reset(data, size); }
+
+		/**
+		* @brief point the view at a buffer and validate its layout
+		*
+		* @return if the buffer is a well formed wire message
+		*/
+		bool reset(const void* data, size_t size)
+		{
+			m_data = static_cast<const char*>(data);
+			m_size = size;
+			m_valid = validate();
+			return m_valid;
+		}
+
+		/** quick check of the magic, to tell wire messages from json/pb strings on a shared socket */
+		static bool isWireMsg(const void* data, size_t size)
+		{
+			if (data == nullptr || size < sizeof(XTMsgWireHeader)) { return false; }
+			uint32_t magic;
+			memcpy(&magic, data, sizeof(magic));
+			return magic == XTMSG_WIRE_MAGIC;
+		}
+
+		bool valid() const { return m_valid; }
+
+		uint32_t length() const { return header()->length; }
+
+		bool hasName() const { return (header()->flags & XTMsgWireFlag::HasName) != 0; }
+		bool hasDouble() const { return (header()->flags & XTMsgWireFlag::HasD) != 0; }
+		bool hasInt() const { return (header()->flags & XTMsgWireFlag::HasI) != 0; }
+		bool hasInt64() const { return (header()->flags & XTMsgWireFlag::HasL) != 0; }
+		bool hasStr() const { return (header()->flags & XTMsgWireFlag::HasS) != 0; }
+
+		XTMsgWireStr getName() const { return XTMsgWireStr(nameBegin(), header()->name_length); }
+
+		double getDouble() const { return header()->d; }
+
+		int getInt() const { return header()->i; }
+
+		int64_t getInt64() const { return header()->l; }
+
+		XTMsgWireStr getStr() const { return XTMsgWireStr(nameBegin() + header()->name_length, header()->s_length); }
+
+		uint32_t count() const { return header()->count; }
+
+		/** entry k, copied out since entries are not aligned */
+		XTMsgWireEntry entry(uint32_t k) const
+		{
+			XTMsgWireEntry e;
+			memcpy(&e, m_data + sizeof(XTMsgWireHeader) + k * sizeof(XTMsgWireEntry), sizeof(e));
+			return e;
+		}
+
+		XTMsgWireStr entryValue(const XTMsgWireEntry& e) const { return XTMsgWireStr(m_data + e.value_offset, e.value_length); }
+
+		/** key of an entry, resolved through TagMgr for interned keys */
+		std::string entryKey(const XTMsgWireEntry& e) const
+		{
+			if (e.tag > 0)
+			{
+				return TagMgr::getInstance()->getNameForTag(e.tag);
+			}
+			return std::string(m_data + e.key_offset, e.key_length);
+		}
+
+		/**
+		* @brief find value by interned tag, the fast path
+		*
+		* @param tag
+		* @param value output
+		*
+		* @return if the tag exists
+		*/
+		bool findTag(int tag, XTMsgWireStr& value) const
+		{
+			for (uint32_t k = 0; k < count(); ++k)
+			{
+				XTMsgWireEntry e = entry(k);
+				if (e.tag == tag)
+				{
+					value = entryValue(e);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/**
+		* @brief find value by key, callers on a hot path should resolve the tag once and use findTag
+		*
+		* @param key
+		* @param value output
+		*
+		* @return if the key exists
+		*/
+		bool findKey(const std::string& key, XTMsgWireStr& value) const
+		{
+			int tag = TagMgr::getInstance()->getTagForName(key);
+			if (tag > 0 && findTag(tag, value))
+			{
+				return true;
+			}
+			for (uint32_t k = 0; k < count(); ++k)
+			{
+				XTMsgWireEntry e = entry(k);
+				if (e.tag == 0 && XTMsgWireStr(m_data + e.key_offset, e.key_length).equals(key))
+				{
+					value = entryValue(e);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool hasKey(const std::string& key) const
+		{
+			XTMsgWireStr v;
+			return findKey(key, v);
+		}
+
+		/** decode into a XTMsgData, for handlers that still want the protobuf */
+		void toXTMsgData(XTMsgData& data) const
+		{
+			data.Clear();
+			if (hasName()) { XTMsgWireStr n = getName(); data.set_name(n.data, n.size); }
+			if (hasDouble()) { data.set_d(getDouble()); }
+			if (hasInt()) { data.set_i(getInt()); }
+			if (hasInt64()) { data.set_l(getInt64()); }
+			if (hasStr()) { XTMsgWireStr s = getStr(); data.set_s(s.data, s.size); }
+			for (uint32_t k = 0; k < count(); ++k)
+			{
+				XTMsgWireEntry e = entry(k);
+				(*data.mutable_strmap())[entryKey(e)] = entryValue(e).str();
+			}
+		}
+
+		/** decode into a new XTMsg */
+		XTMsgPtr toXTMsg() const
+		{
+			XTMsgPtr msg = XTMsg::create();
+			XTMsgDataPtr& data = msg->data();
+			if (hasName()) { XTMsgWireStr n = getName(); data->set_name(n.data, n.size); }
+			if (hasDouble()) { data->set_d(getDouble()); }
+			if (hasInt()) { data->set_i(getInt()); }
+			if (hasInt64()) { data->set_l(getInt64()); }
+			if (hasStr()) { XTMsgWireStr s = getStr(); data->set_s(s.data, s.size); }
+			for (uint32_t k = 0; k < count(); ++k)
+			{
+				XTMsgWireEntry e = entry(k);
+				(*data->mutable_strmap())[entryKey(e)] = entryValue(e).str();
+			}
+			return msg;
+		}
+
+	protected:
+		const XTMsgWireHeader* header() const { return reinterpret_cast<const XTMsgWireHeader*>(m_data); }
+
+		const char* nameBegin() const { return m_data + sizeof(XTMsgWireHeader) + header()->count * sizeof(XTMsgWireEntry); }
+
+		bool validate() const
+		{
+			if (!isWireMsg(m_data, m_size)) { return false; }
+			const XTMsgWireHeader* h = header();
+			if (h->version != XTMSG_WIRE_VERSION || h->length != m_size) { return false; }
+			uint64_t fixed = sizeof(XTMsgWireHeader) + (uint64_t)h->count * sizeof(XTMsgWireEntry) + h->name_length + h->s_length;
+			if (fixed > m_size) { return false; }
+			for (uint32_t k = 0; k < h->count; ++k)
+			{
+				XTMsgWireEntry e = entry(k);
+				if ((uint64_t)e.key_offset + e.key_length > m_size || (uint64_t)e.value_offset + e.value_length > m_size) { return false; }
+			}
+			return true;
+		}
+
+	protected:
+		const char* m_data;
+		size_t m_size;
+		bool m_valid;
+	};
+
+}//namespace XT
+
+#endif
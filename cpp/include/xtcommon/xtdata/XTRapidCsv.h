@@ -971,7 +971,7 @@ public:
 		SetRowLabels();
 	}
 
-	void ReadCsvGz(const std::string& filename)
+	void ReadCsvGz(const std::string&)
 	{
 		mData.clear();
 		mColumnNames.clear();
@@ -0,0 +1,423 @@
+#pragma once
+#ifndef XT_BAR_DB_WRITER_H
+#define XT_BAR_DB_WRITER_H
+
+/**
+* \file BarDBWriter.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide an asynchronous batch writer of bars to sqlite and mongodb.
+*
+* \description
+*	Designed for persisting the bars closed at a minute boundary without blocking the
+*	market data thread. addBar only queues the bar, a background thread drains the queue
+*	in batches: one transaction per batch on the trade sqlite database in WAL mode, with a
+*	prepared upsert statement or Bar::getSqliteUpsert, and one insertDocuments call per
+*	collection for mongodb, on a MongoDBMgr of the writer's own. The bars of a batch are the
+*	ones queued while the previous batch was committed, so a burst is written with few commits.
+*	A batch is failed if the sqlite commit or the mongodb insert fails.
+*/
+
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <algorithm>
+
+#include "XTConfig.h"
+#include "Bar.h"
+#include "XTMPMCWaitRing.h"
+#include "SQLiteMgr.h"
+#ifndef XT_DISABLE_MONGO
+#include "MongoDBMgr.h"
+#endif
+#include "log4z.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include <SQLiteCpp/Transaction.h>
+
+namespace XT
+{
+
+/**
+* bar queued for writing, the bar must not be changed once queued
+*/
+struct BarDBWriteItem
+{
+	std::string exch;
+	std::string instrid;
+	int span = 0;
+	BarPtr bar;
+};
+
+struct BarDBWriterStats
+{
+	uint64_t queued = 0; ///< bars accepted by addBar
+	uint64_t dropped = 0; ///< bars rejected because the queue was full or the writer stopped
+	uint64_t written = 0; ///< bars committed
+	uint64_t failed = 0; ///< bars of failed batches
+	uint64_t mongoFailed = 0; ///< bars of failed mongodb inserts, also counted in failed
+	uint64_t batches = 0; ///< committed batches
+	size_t depth = 0; ///< bars in the queue
+	size_t peakDepth = 0; ///< peak bars in the queue
+	double lastCommitMs = 0; ///< time of the last batch
+	double maxCommitMs = 0;
+	double avgCommitMs = 0;
+};
+
+class BarDBWriter
+{
+public:
+	/**
+	* @brief constructor
+	*
+	* @param capacity as queue capacity, a power of two
+	* @param maxbatch as maximum bars per batch
+	*/
+	explicit BarDBWriter(size_t capacity = 65536, size_t maxbatch = 8192)
+		: m_queue(capacity), m_maxBatch(std::max<size_t>(maxbatch, 1)), m_toSqlite(false), m_walMode(true),
+		m_running(false), m_queued(0), m_dropped(0), m_done(0), m_written(0), m_failed(0), m_mongoFailed(0), m_batches(0),
+		m_lastCommitUs(0), m_maxCommitUs(0), m_totalCommitUs(0)
+	{
+	}
+
+	BarDBWriter(const BarDBWriter&) = delete;
+	BarDBWriter& operator=(const BarDBWriter&) = delete;
+
+	virtual ~BarDBWriter() { stop(); }
+
+public:
+	/**
+	* @name Configuration, before start
+	*/
+	///@{
+	/**
+	* @brief write the bars to a sqlite database, with its own connection
+	*
+	* The dt_ohlcv tables must exist, see TrdDBMgr::create_dt_ohlcv_exch.
+	*
+	* @param dbfile as database file, empty for the TrdDBMgr trade database
+	* @param walmode as switch the database to WAL journal mode
+	*/
+	void setSqlite(const std::string& dbfile = "", bool walmode = true)
+	{
+		m_dbFile = dbfile.empty() ? TrdDBMgr::getInstance()->getTrdDbFile() : dbfile;
+		m_walMode = walmode;
+		m_toSqlite = true;
+	}
+
+	/**
+	* @brief upsert statement prepared once per exchange instead of Bar::getSqliteUpsert
+	*
+	* "{exch}" is replaced by the exchange id. The named parameters used among :instrid, :span,
+	* :begindt, :enddt, :open, :high, :low, :close, :volume, :amount and :oichg are bound.
+	*/
+	void setSqliteUpsertSql(const std::string& sql)
+	{
+		m_upsertSql = sql;
+		m_upsertParams.clear();
+		for (const char* name : { ":instrid", ":span", ":begindt", ":enddt", ":open", ":high", ":low", ":close", ":volume", ":amount", ":oichg" })
+		{
+			m_upsertParams.push_back(hasParam(sql, name));
+		}
+	}
+
+#ifndef XT_DISABLE_MONGO
+	/**
+	* @brief also insert the bars as documents (Bar::getMongoDocument) into a collection
+	*
+	* The mongodb client is not thread safe, the manager must only be used by the writer thread:
+	* MongoDBMgr::getInstance() is refused.
+	*
+	* @param colname as collection name
+	* @param mgr as mongodb manager of the writer, connected with setConnection
+	*
+	* @return false if mgr is null or the shared instance, mongodb is not written
+	*/
+	bool setMongo(const std::string& colname, const std::shared_ptr<MongoDBMgr>& mgr)
+	{
+		if (!mgr || (MongoDBMgr::hasInstance() && mgr.get() == MongoDBMgr::getInstance()))
+		{
+			LOGW("BarDBWriter needs a MongoDBMgr of its own for " + colname);
+			return false;
+		}
+		m_mongoColName = colname;
+		m_mongo = mgr;
+		return true;
+	}
+#endif
+	///@}
+
+public:
+	/**
+	* @brief start the writer thread
+	*
+	* @return false if the sqlite database cannot be opened
+	*/
+	bool start()
+	{
+		if (m_running.load()) { return true; }
+		if (m_toSqlite)
+		{
+			try
+			{
+				m_db.reset(new SQLite::Database(m_dbFile, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE));
+				m_db->setBusyTimeout(5000);
+				if (m_walMode)
+				{
+					m_db->exec("PRAGMA journal_mode=WAL");
+					m_db->exec("PRAGMA synchronous=NORMAL");
+				}
+			}
+			catch (std::exception& e)
+			{
+				LOGW("BarDBWriter cannot open " + m_dbFile + ": " + e.what());
+				m_db.reset();
+				return false;
+			}
+		}
+		m_running.store(true);
+		m_thread = std::thread([this]() { run(); });
+		return true;
+	}
+
+	/**
+	* @brief queue a closed bar, never blocks
+	*
+	* @return false if the queue is full or the writer is not running, the bar is dropped
+	*/
+	bool addBar(const std::string& exch, const std::string& instrid, int span, const BarPtr& bar)
+	{
+		BarDBWriteItem item;
+		item.exch = exch;
+		item.instrid = instrid;
+		item.span = span;
+		item.bar = bar;
+		if (!m_running.load(std::memory_order_relaxed) || !m_queue.TryEnqueue(std::move(item)))
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		m_queued.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/**
+	* @brief wait until the bars queued so far are committed or failed
+	*/
+	void flush()
+	{
+		uint64_t target = m_queued.load();
+		std::unique_lock<std::mutex> lock(m_doneMutex);
+		m_doneCv.wait(lock, [this, target]() { return m_done.load() >= target || !m_running.load(); });
+	}
+
+	/**
+	* @brief write the queued bars and stop the writer thread
+	*/
+	void stop()
+	{
+		if (!m_running.exchange(false)) { return; }
+		m_queue.Close();
+		if (m_thread.joinable()) { m_thread.join(); }
+		m_statements.clear();
+		m_db.reset();
+		std::lock_guard<std::mutex> lock(m_doneMutex);
+		m_doneCv.notify_all();
+	}
+
+	bool isRunning() const { return m_running.load(); }
+
+	size_t getQueueDepth() const { return m_queue.size(); }
+
+	BarDBWriterStats getStats() const
+	{
+		BarDBWriterStats s;
+		s.queued = m_queued.load();
+		s.dropped = m_dropped.load();
+		s.written = m_written.load();
+		s.failed = m_failed.load();
+		s.mongoFailed = m_mongoFailed.load();
+		s.batches = m_batches.load();
+		s.depth = m_queue.size();
+		s.peakDepth = m_queue.peak();
+		s.lastCommitMs = m_lastCommitUs.load() / 1000.0;
+		s.maxCommitMs = m_maxCommitUs.load() / 1000.0;
+		s.avgCommitMs = s.batches > 0 ? m_totalCommitUs.load() / 1000.0 / s.batches : 0.0;
+		return s;
+	}
+
+	std::string statsStr() const
+	{
+		BarDBWriterStats s = getStats();
+		std::ostringstream os;
+		os << "queued:" << s.queued << " dropped:" << s.dropped << " written:" << s.written << " failed:" << s.failed << " mongofailed:" << s.mongoFailed
+			<< " batches:" << s.batches << " depth:" << s.depth << " peak:" << s.peakDepth
+			<< " commitms last:" << s.lastCommitMs << " avg:" << s.avgCommitMs << " max:" << s.maxCommitMs;
+		return os.str();
+	}
+
+protected:
+	void run()
+	{
+		std::vector<BarDBWriteItem> batch;
+		for (;;)
+		{
+			batch.clear();
+			size_t n = m_queue.DequeueBatch(batch, m_maxBatch);
+			if (n == 0)
+			{
+				if (m_queue.closed()) { break; }
+				continue;
+			}
+			auto t0 = std::chrono::steady_clock::now();
+			bool ok = writeBatch(batch);
+			int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+
+			if (ok)
+			{
+				m_written.fetch_add(n);
+				m_batches.fetch_add(1);
+				m_lastCommitUs.store(us);
+				m_totalCommitUs.fetch_add(us);
+				if (us > m_maxCommitUs.load()) { m_maxCommitUs.store(us); }
+			}
+			else
+			{
+				m_failed.fetch_add(n);
+			}
+			m_done.fetch_add(n);
+			std::lock_guard<std::mutex> lock(m_doneMutex);
+			m_doneCv.notify_all();
+		}
+	}
+
+	bool writeBatch(std::vector<BarDBWriteItem>& batch)
+	{
+		bool ok = true;
+		if (m_db)
+		{
+			try
+			{
+				SQLite::Transaction tr(*m_db);
+				for (BarDBWriteItem& item : batch)
+				{
+					if (!item.bar) { continue; }
+					if (m_upsertSql.empty()) { m_db->exec(item.bar->getSqliteUpsert(item.exch, item.instrid, item.span)); }
+					else { execUpsert(item); }
+				}
+				tr.commit();
+			}
+			catch (std::exception& e)
+			{
+				LOGW("BarDBWriter sqlite batch of " + std::to_string(batch.size()) + " bars failed: " + e.what());
+				// statements may be left in a failed state
+				m_statements.clear();
+				ok = false;
+			}
+		}
+#ifndef XT_DISABLE_MONGO
+		if (m_mongo && !m_mongoColName.empty())
+		{
+			std::vector<std::string> docs;
+			docs.reserve(batch.size());
+			for (BarDBWriteItem& item : batch)
+			{
+				if (item.bar) { docs.push_back(item.bar->getMongoDocument(item.instrid)); }
+			}
+			if (!docs.empty() && (m_mongo->isNULL() || m_mongo->insertDocuments(docs, m_mongoColName) < 0))
+			{
+				LOGW("BarDBWriter mongodb batch of " + std::to_string(docs.size()) + " bars failed on " + m_mongoColName);
+				m_mongoFailed.fetch_add(docs.size());
+				ok = false;
+			}
+		}
+#endif
+		return ok;
+	}
+
+	void execUpsert(BarDBWriteItem& item)
+	{
+		std::unique_ptr<SQLite::Statement>& stmt = m_statements[item.exch];
+		if (!stmt)
+		{
+			std::string sql = m_upsertSql;
+			for (size_t pos; (pos = sql.find("{exch}")) != std::string::npos;) { sql.replace(pos, 6, item.exch); }
+			stmt.reset(new SQLite::Statement(*m_db, sql));
+		}
+		BarPtr& b = item.bar;
+		const std::vector<bool>& p = m_upsertParams;
+		if (p[0]) { stmt->bind(":instrid", item.instrid); }
+		if (p[1]) { stmt->bind(":span", item.span); }
+		if (p[2]) { stmt->bind(":begindt", (long long)b->getBegindt()); }
+		if (p[3]) { stmt->bind(":enddt", (long long)b->getEnddt()); }
+		if (p[4]) { stmt->bind(":open", b->getOpen()); }
+		if (p[5]) { stmt->bind(":high", b->getHigh()); }
+		if (p[6]) { stmt->bind(":low", b->getLow()); }
+		if (p[7]) { stmt->bind(":close", b->getClose()); }
+		if (p[8]) { stmt->bind(":volume", (long long)b->getVolume()); }
+		if (p[9]) { stmt->bind(":amount", b->getAmount()); }
+		if (p[10]) { stmt->bind(":oichg", (long long)b->getOichg()); }
+		stmt->exec();
+		stmt->reset();
+	}
+
+	static bool hasParam(const std::string& sql, const std::string& name)
+	{
+		for (size_t pos = sql.find(name); pos != std::string::npos; pos = sql.find(name, pos + 1))
+		{
+			size_t end = pos + name.size();
+			if (end == sql.size() || !(std::isalnum((unsigned char)sql[end]) || sql[end] == '_')) { return true; }
+		}
+		return false;
+	}
+
+protected:
+	MPMCWaitRing<BarDBWriteItem> m_queue;
+	size_t m_maxBatch;
+
+	bool m_toSqlite;
+	bool m_walMode;
+	std::string m_dbFile;
+	std::unique_ptr<SQLite::Database> m_db; ///< connection of the writer thread
+	std::string m_upsertSql;
+	std::vector<bool> m_upsertParams; ///< named parameters used by m_upsertSql
+	std::map<std::string, std::unique_ptr<SQLite::Statement> > m_statements; ///< prepared upsert by exchange
+
+#ifndef XT_DISABLE_MONGO
+	std::shared_ptr<MongoDBMgr> m_mongo; ///< used by the writer thread only
+	std::string m_mongoColName;
+#endif
+
+	std::thread m_thread;
+	std::atomic<bool> m_running;
+
+	std::atomic<uint64_t> m_queued;
+	std::atomic<uint64_t> m_dropped;
+	std::atomic<uint64_t> m_done; ///< bars written or failed
+	std::atomic<uint64_t> m_written;
+	std::atomic<uint64_t> m_failed;
+	std::atomic<uint64_t> m_mongoFailed;
+	std::atomic<uint64_t> m_batches;
+	std::atomic<int64_t> m_lastCommitUs;
+	std::atomic<int64_t> m_maxCommitUs;
+	std::atomic<int64_t> m_totalCommitUs;
+
+	std::mutex m_doneMutex;
+	std::condition_variable m_doneCv;
+};//class BarDBWriter
+typedef std::shared_ptr<BarDBWriter> BarDBWriterPtr;
+
+}//namespace XT
+
+#endif
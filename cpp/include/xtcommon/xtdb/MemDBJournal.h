@@ -202,6 +202,32 @@ namespace XT
 
 		void write_raw(int64_t trigger_time, int32_t msg_type, uintptr_t data, uint32_t length);
 
+		/** write_raw with a given gen_time, e.g. when converting recorded data into journals */
+		void write_raw_with_time(int64_t gen_time, int32_t msg_type, uintptr_t data, uint32_t length)
+		{
+			assert(sizeof(MemDBFrameHeader) + length + sizeof(MemDBFrameHeader) <= journal_->current_page_->get_page_size());
+			if (journal_->current_frame()->address() + sizeof(MemDBFrameHeader) + length > journal_->current_page_->address_border())
+			{
+				mark(gen_time, MemDBMsgType::PageEnd);
+				journal_->load_next_page();
+			}
+			auto frame = journal_->current_frame();
+			frame->set_header_length();
+			frame->set_trigger_time(0);
+			frame->set_msg_type(msg_type);
+			frame->set_source(journal_->location_->uid);
+			frame->set_dest(journal_->dest_id_);
+
+			if (length > 0)
+			{
+				memcpy(const_cast<void *>(frame->data_address()), reinterpret_cast<const void *>(data), length);
+			}
+			frame->set_gen_time(gen_time);
+			frame->set_data_length(length);
+			journal_->current_page_->set_last_frame_position(frame->address() - journal_->current_page_->address());
+			journal_->next();
+		}
+
 	private:
 		std::mutex writer_mtx_;
 		MemDBJournalPtr journal_;
@@ -0,0 +1,677 @@
+#pragma once
+#ifndef XT_MEMDB_MULTI_JOURNAL_H
+#define XT_MEMDB_MULTI_JOURNAL_H
+
+/**
+* \file MemDBMultiJournal.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a multi-producer MemDB journal.
+*
+* \description
+*	MemDBJournal/MemDBWriter are single-writer: the writer owns the page and bumps
+*	last_frame_position without synchronization. MemDBMultiWriter lets several threads of
+*	one process append into the same journal without a mutex: a writer reserves frame space
+*	with an atomic fetch-add on the page tail, fills header and body, then publishes the frame
+*	by storing its length last. MemDBMultiReader follows the journal in reservation order and
+*	never reads a slot before its length has been committed.
+*	Only one process writes a journal at a time; reservations left open by a writer process that
+*	died are closed by the next one when it opens the journal.
+*/
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "XTConfig.h"
+#include "XTEnum.pb.h"
+#include "log4z.h"
+
+#include "fmt/format.h"
+#include "MemDBData.h"
+#include "MemDBUtil.h"
+#include "MemDBEvent.h"
+#include "MemDBFrame.h"
+#include "MemDBPage.h"
+#include "MemDBTypeRegistry.h"
+
+namespace XT
+{
+
+	/**
+	* Page header of a multi-producer page. Same size and field order as MemDBPageHeader,
+	* but the last field is the reservation tail (offset of the next free byte) instead of
+	* the position of the last frame, and version is MEMDB_MULTI_PAGE_VERSION.
+	* version is stored last when the page is created, a page is not read before it is set.
+	*/
+	struct MemDBMultiPageHeader
+	{
+		std::atomic<uint32_t> version;
+		uint32_t page_header_length;
+		uint32_t page_size;
+		uint32_t frame_header_length;
+		std::atomic<uint64_t> tail;
+	};
+	static_assert(sizeof(MemDBMultiPageHeader) == sizeof(MemDBPageHeader), "multi page header must match MemDBPageHeader");
+
+	/** length bit set while a reserved frame is being filled */
+	static const uint32_t MEMDB_MULTI_PENDING = 0x80000000u;
+	/** version stamped in MemDBMultiPageHeader */
+	static const uint32_t MEMDB_MULTI_PAGE_VERSION = 0x4D500001u;
+	/** frames are 8 bytes aligned so that the length word can be accessed atomically */
+	static const uint32_t MEMDB_MULTI_FRAME_ALIGN = 8;
+
+	/**
+	* atomic view of the length word of a frame header. The header is packed, frames are
+	* MEMDB_MULTI_FRAME_ALIGN aligned so the word is; go through void* to say so.
+	*/
+	inline std::atomic<uint32_t>* memdb_multi_length(MemDBFrameHeader* h)
+	{
+		static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic uint32_t must be lock free and unpadded");
+		static_assert(offsetof(MemDBFrameHeader, length) == 0, "length must be the first word of the frame header");
+		void* p = h;
+		return static_cast<std::atomic<uint32_t>*>(p);
+	}
+
+	/** bytes taken in the page by a frame of frame_length bytes (header included) */
+	inline uint32_t memdb_multi_frame_size(uint32_t frame_length)
+	{
+		return (frame_length + MEMDB_MULTI_FRAME_ALIGN - 1) & ~(MEMDB_MULTI_FRAME_ALIGN - 1);
+	}
+
+	inline int64_t memdb_multi_nanotime()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	* one mapped multi-producer page
+	*/
+	class MemDBMultiPage
+	{
+	public:
+		MemDBMultiPage(const std::string& path, int page_id, uint32_t page_size, bool is_writing) :
+			path_(path), page_id_(page_id), page_size_(page_size), is_writing_(is_writing), header_(nullptr)
+		{
+			uintptr_t address = MemDBUtil::load_mmap_buffer(path_, page_size_, is_writing_, false);
+			header_ = reinterpret_cast<MemDBMultiPageHeader*>(address);
+			if (header_ != nullptr && is_writing_ && header_->version.load(std::memory_order_acquire) == 0)
+			{
+				header_->page_header_length = sizeof(MemDBMultiPageHeader);
+				header_->page_size = page_size_;
+				header_->frame_header_length = sizeof(MemDBFrameHeader);
+				header_->tail.store(sizeof(MemDBMultiPageHeader), std::memory_order_relaxed);
+				header_->version.store(MEMDB_MULTI_PAGE_VERSION, std::memory_order_release);
+			}
+		}
+
+		~MemDBMultiPage()
+		{
+			if (header_ != nullptr)
+			{
+				MemDBUtil::release_mmap_buffer(address(), page_size_, false);
+			}
+		}
+
+		/** the other header fields may only be read once this returned true */
+		bool valid() const { return header_ != nullptr && header_->version.load(std::memory_order_acquire) == MEMDB_MULTI_PAGE_VERSION; }
+
+		int get_page_id() const { return page_id_; }
+
+		uint32_t get_page_size() const { return page_size_; }
+
+		uintptr_t address() const { return reinterpret_cast<uintptr_t>(header_); }
+
+		/** last offset at which a frame may start, leaves room for a PageEnd header */
+		uint64_t border() const { return page_size_ - sizeof(MemDBFrameHeader); }
+
+		uint64_t first_frame_offset() const { return header_->page_header_length; }
+
+		uint64_t tail() const { return header_->tail.load(std::memory_order_acquire); }
+
+		/** reserve size bytes, the returned offset may lie beyond border() if the page is full */
+		uint64_t reserve(uint32_t size) { return header_->tail.fetch_add(size, std::memory_order_acq_rel); }
+
+		/** move the tail past the border, every later reservation fails over to the next page */
+		void close() { header_->tail.store(page_size_, std::memory_order_release); }
+
+		MemDBFrameHeader* frame_at(uint64_t offset) const { return reinterpret_cast<MemDBFrameHeader*>(address() + offset); }
+
+	private:
+		std::string path_;
+		int page_id_;
+		uint32_t page_size_;
+		bool is_writing_;
+		MemDBMultiPageHeader* header_;
+	};
+	typedef std::shared_ptr<MemDBMultiPage> MemDBMultiPagePtr;
+
+	/**
+	* MsgEvent over a committed frame of a multi-producer page
+	*/
+	class MemDBMultiFrame : public MsgEvent
+	{
+	public:
+		MemDBMultiFrame() : header_(nullptr) {}
+
+		explicit MemDBMultiFrame(MemDBFrameHeader* header) : header_(header) {}
+
+		~MemDBMultiFrame() override = default;
+
+		uintptr_t address() const { return reinterpret_cast<uintptr_t>(header_); }
+
+		uint32_t frame_length() const { return header_->length & ~MEMDB_MULTI_PENDING; }
+
+		uint32_t header_length() const { return header_->header_length; }
+
+		uint32_t data_length() const override { return header_->length - header_->header_length; }
+
+		int64_t gen_time() const override { return header_->gen_time; }
+
+		int64_t trigger_time() const override { return header_->trigger_time; }
+
+		int32_t msg_type() const override { return header_->msg_type; }
+
+		uint32_t source() const override { return header_->source; }
+
+		uint32_t dest() const override { return header_->dest; }
+
+		const char *data_as_bytes() const override { return reinterpret_cast<char *>(address() + header_length()); }
+
+		const std::string data_as_string() const override { return std::string(data_as_bytes(), data_length()); }
+
+		const std::string to_string() const override
+		{
+			return fmt::format("gen_time:{},trigger_time:{},msg_type:{},source:{},dest:{},length:{}", gen_time(), trigger_time(), msg_type(), source(), dest(), data_length());
+		}
+
+	protected:
+		const void *data_address() const override { return reinterpret_cast<void *>(address() + header_length()); }
+
+	private:
+		MemDBFrameHeader* header_;
+
+		friend class MemDBMultiReader;
+	};
+
+	/**
+	* Shared state of a multi-producer journal inside one process.
+	* Writers are counted in in_flight_[generation & 1] for the duration of a reservation. Rolled
+	* pages go to retired_; when the counter of the previous generation is zero they move to
+	* draining_ and the generation flips, they are unmapped once the counter they were handed over
+	* to drains. A late writer can always commit into the page it reserved in, and at most the
+	* pages rolled during two generations are kept mapped.
+	*/
+	class MemDBMultiJournal
+	{
+	public:
+		MemDBMultiJournal(const MemDBLocationPtr& location, uint32_t dest_id, uint32_t page_size) :
+			location_(location), dest_id_(dest_id), page_size_(page_size), current_(nullptr), generation_(0), failed_page_(0), n_retired_(0)
+		{
+			assert(page_size_ > 2 * sizeof(MemDBFrameHeader) + sizeof(MemDBMultiPageHeader));
+			in_flight_[0].store(0);
+			in_flight_[1].store(0);
+			std::vector<int> ids = location_->locator->list_page_id(location_, dest_id_);
+			int page_id = ids.empty() ? 1 : ids.back();
+			std::lock_guard<std::mutex> lock(pages_mtx_);
+			if (load_page(page_id) && !recover_page() && load_page(page_id + 1))
+			{
+				reclaim();
+			}
+		}
+
+		~MemDBMultiJournal() = default;
+
+		uint32_t get_dest() const { return dest_id_; }
+
+		const MemDBLocationPtr& get_location() const { return location_; }
+
+		MemDBMultiPage* current_page() const { return current_.load(std::memory_order_seq_cst); }
+
+		/** @return the generation slot to hand back to leave() */
+		int enter()
+		{
+			int g = generation_.load(std::memory_order_seq_cst) & 1;
+			in_flight_[g].fetch_add(1, std::memory_order_seq_cst);
+			return g;
+		}
+
+		void leave(int g)
+		{
+			if (in_flight_[g].fetch_sub(1, std::memory_order_seq_cst) == 1 && n_retired_.load(std::memory_order_relaxed) > 0)
+			{
+				std::unique_lock<std::mutex> lock(pages_mtx_, std::try_to_lock);
+				if (lock.owns_lock()) { reclaim(); }
+			}
+		}
+
+		/**
+		* called by the single writer whose reservation crossed the border of page_id,
+		* other writers spin on current_page() until the new page is published or the roll failed
+		* @return false if the next page could not be loaded, the journal is then failed at page_id
+		*/
+		bool roll_page(int page_id)
+		{
+			std::lock_guard<std::mutex> lock(pages_mtx_);
+			if (!load_page(page_id + 1))
+			{
+				failed_page_.store(page_id, std::memory_order_release);
+				return false;
+			}
+			reclaim();
+			return true;
+		}
+
+		/** if rolling away from page_id failed, writers waiting on it give up */
+		bool roll_failed(int page_id) const { return failed_page_.load(std::memory_order_acquire) == page_id; }
+
+		/** rolled pages still mapped */
+		size_t get_retired_page_count()
+		{
+			std::lock_guard<std::mutex> lock(pages_mtx_);
+			return retired_.size() + draining_.size();
+		}
+
+	private:
+		/** pages_mtx_ held */
+		void reclaim()
+		{
+			int prev = (generation_.load(std::memory_order_seq_cst) & 1) ^ 1;
+			if (!draining_.empty() && in_flight_[prev].load(std::memory_order_seq_cst) == 0)
+			{
+				draining_.clear();
+			}
+			if (draining_.empty() && !retired_.empty())
+			{
+				// writers entering from now on count in prev and only see pages published after retired_
+				draining_.swap(retired_);
+				generation_.fetch_add(1, std::memory_order_seq_cst);
+			}
+			n_retired_.store(retired_.size() + draining_.size(), std::memory_order_relaxed);
+		}
+
+		/**
+		* pages_mtx_ held, no writer of this process in flight.
+		* The writer process before us may have died inside a reservation: its pending slots are
+		* committed as padding, and a slot whose length was never stored closes the page with a
+		* PageEnd, the frames behind it cannot be located.
+		* @return false if the page is closed and writing has to continue on the next one
+		*/
+		bool recover_page()
+		{
+			MemDBMultiPage* page = page_.get();
+			uint64_t tail = page->tail();
+			uint64_t offset = page->first_frame_offset();
+			int nPadded = 0;
+			while (offset < tail && offset <= page->border())
+			{
+				MemDBFrameHeader* h = page->frame_at(offset);
+				uint32_t length = memdb_multi_length(h)->load(std::memory_order_acquire);
+				if (length == 0)
+				{
+					h->header_length = sizeof(MemDBFrameHeader);
+					h->gen_time = memdb_multi_nanotime();
+					h->trigger_time = 0;
+					h->msg_type = MemDBMsgType::PageEnd;
+					h->source = location_->uid;
+					h->dest = dest_id_;
+					memdb_multi_length(h)->store(sizeof(MemDBFrameHeader), std::memory_order_release);
+					page->close();
+					LOGW(fmt::format("MemDBMultiJournal,dest {} page {} closed at an abandoned reservation at {},{} bytes behind it dropped,{} abandoned reservations committed as padding",
+						dest_id_, page->get_page_id(), offset, (tail < page->get_page_size() ? tail : page->get_page_size()) - offset, nPadded));
+					return false;
+				}
+				if (length & MEMDB_MULTI_PENDING)
+				{
+					h->msg_type = 0;
+					length &= ~MEMDB_MULTI_PENDING;
+					memdb_multi_length(h)->store(length, std::memory_order_release);
+					++nPadded;
+				}
+				else if (h->msg_type == MemDBMsgType::PageEnd)
+				{
+					return false; // rolled, the next page was never created
+				}
+				offset += memdb_multi_frame_size(length);
+			}
+			if (nPadded > 0)
+			{
+				LOGW(fmt::format("MemDBMultiJournal,dest {} page {},{} abandoned reservations committed as padding", dest_id_, page->get_page_id(), nPadded));
+			}
+			return tail <= page->border();
+		}
+
+		bool load_page(int page_id)
+		{
+			MemDBMultiPagePtr page = std::make_shared<MemDBMultiPage>(MemDBPage::get_page_path(location_, dest_id_, page_id), page_id, page_size_, true);
+			if (!page->valid())
+			{
+				LOGE(fmt::format("MemDBMultiJournal,failed to load page {} for dest {}", page_id, dest_id_));
+				return false;
+			}
+			if (page_ != nullptr)
+			{
+				retired_.push_back(page_);
+			}
+			page_ = page;
+			current_.store(page.get(), std::memory_order_seq_cst);
+			return true;
+		}
+
+		MemDBLocationPtr location_;
+		const uint32_t dest_id_;
+		const uint32_t page_size_;
+		std::atomic<MemDBMultiPage*> current_;
+		std::atomic<int64_t> in_flight_[2];
+		std::atomic<int> generation_;
+		std::atomic<int> failed_page_;
+		std::atomic<size_t> n_retired_; ///< retired_ + draining_, lets leave() skip the mutex
+		std::mutex pages_mtx_; ///< taken on page roll and to reclaim rolled pages
+		MemDBMultiPagePtr page_;
+		std::vector<MemDBMultiPagePtr> retired_; ///< rolled in the current generation
+		std::vector<MemDBMultiPagePtr> draining_; ///< rolled before the last flip, unmapped once in_flight_ of the previous generation is 0
+	};
+	typedef std::shared_ptr<MemDBMultiJournal> MemDBMultiJournalPtr;
+
+	/**
+	* A reserved frame. Fill data() then commit(); a slot that is never committed
+	* is committed as padding (msg_type 0) by the destructor so that readers do not stall.
+	*/
+	class MemDBMultiSlot
+	{
+	public:
+		MemDBMultiSlot() : journal_(nullptr), header_(nullptr), data_length_(0), generation_(0) {}
+
+		MemDBMultiSlot(MemDBMultiJournal* journal, MemDBFrameHeader* header, uint32_t data_length, int generation) :
+			journal_(journal), header_(header), data_length_(data_length), generation_(generation)
+		{}
+
+		MemDBMultiSlot(const MemDBMultiSlot&) = delete;
+		MemDBMultiSlot& operator=(const MemDBMultiSlot&) = delete;
+
+		MemDBMultiSlot(MemDBMultiSlot&& other) :
+			journal_(other.journal_), header_(other.header_), data_length_(other.data_length_), generation_(other.generation_)
+		{
+			other.header_ = nullptr;
+		}
+
+		~MemDBMultiSlot()
+		{
+			if (header_ != nullptr)
+			{
+				header_->msg_type = 0;
+				commit();
+			}
+		}
+
+		bool valid() const { return header_ != nullptr; }
+
+		void* data() { return reinterpret_cast<char*>(header_) + sizeof(MemDBFrameHeader); }
+
+		template<typename T>
+		T& data_as() { return *reinterpret_cast<T*>(data()); }
+
+		uint32_t data_length() const { return data_length_; }
+
+		/** publish the frame, the length is stored last with release semantics */
+		void commit()
+		{
+			if (header_ == nullptr) { return; }
+			uint32_t length = memdb_multi_length(header_)->load(std::memory_order_relaxed) & ~MEMDB_MULTI_PENDING;
+			memdb_multi_length(header_)->store(length, std::memory_order_release);
+			header_ = nullptr;
+			journal_->leave(generation_);
+		}
+
+	private:
+		MemDBMultiJournal* journal_;
+		MemDBFrameHeader* header_;
+		uint32_t data_length_;
+		int generation_; ///< returned by MemDBMultiJournal::enter
+	};
+
+	/**
+	* Multi-producer writer, one instance may be shared by any number of threads.
+	*/
+	class MemDBMultiWriter
+	{
+	public:
+		/** opens the journal, a new journal starts with the schema frame of the registered types */
+		MemDBMultiWriter(const MemDBLocationPtr& location, uint32_t dest_id, uint32_t page_size) :
+			journal_(std::make_shared<MemDBMultiJournal>(location, dest_id, page_size)), source_(location->uid)
+		{
+			MemDBMultiPage* page = journal_->current_page();
+			if (page != nullptr && page->get_page_id() == 1 && page->tail() == page->first_frame_offset())
+			{
+				memdb_write_schema(*this, 0);
+			}
+		}
+
+		explicit MemDBMultiWriter(const MemDBMultiJournalPtr& journal) :
+			journal_(journal), source_(journal->get_location()->uid)
+		{}
+
+		const MemDBMultiJournalPtr& get_journal() const { return journal_; }
+
+		uint32_t get_dest() const { return journal_->get_dest(); }
+
+		/**
+		* reserve a frame for length bytes of data, the frame becomes visible to readers on commit
+		* gen_time is taken at reservation so that gen_time order matches journal order per writer
+		*/
+		MemDBMultiSlot reserve(int64_t trigger_time, int32_t msg_type, uint32_t length)
+		{
+			uint32_t size = frame_size(length);
+			int g = journal_->enter();
+			MemDBMultiPage* first = journal_->current_page();
+			if (first == nullptr || size > first->border() - first->first_frame_offset())
+			{
+				journal_->leave(g);
+				LOGE(fmt::format("MemDBMultiWriter,no page or frame of {} bytes does not fit in a page", length));
+				return MemDBMultiSlot();
+			}
+
+			for (;;)
+			{
+				MemDBMultiPage* page = journal_->current_page();
+				uint64_t pos = page->reserve(size);
+				if (pos + size <= page->border())
+				{
+					MemDBFrameHeader* h = page->frame_at(pos);
+					memdb_multi_length(h)->store((sizeof(MemDBFrameHeader) + length) | MEMDB_MULTI_PENDING, std::memory_order_relaxed);
+					h->header_length = sizeof(MemDBFrameHeader);
+					h->gen_time = memdb_multi_nanotime();
+					h->trigger_time = trigger_time;
+					h->msg_type = msg_type;
+					h->source = source_;
+					h->dest = journal_->get_dest();
+					return MemDBMultiSlot(journal_.get(), h, length, g);
+				}
+
+				if (pos <= page->border())
+				{
+					// this reservation crossed the border: close the page and roll
+					MemDBFrameHeader* h = page->frame_at(pos);
+					h->header_length = sizeof(MemDBFrameHeader);
+					h->gen_time = memdb_multi_nanotime();
+					h->trigger_time = 0;
+					h->msg_type = MemDBMsgType::PageEnd;
+					h->source = source_;
+					h->dest = journal_->get_dest();
+					memdb_multi_length(h)->store(sizeof(MemDBFrameHeader), std::memory_order_release);
+					if (!journal_->roll_page(page->get_page_id()))
+					{
+						journal_->leave(g);
+						return MemDBMultiSlot();
+					}
+				}
+				else
+				{
+					while (journal_->current_page() == page)
+					{
+						if (journal_->roll_failed(page->get_page_id()))
+						{
+							// logged once by the rolling writer
+							journal_->leave(g);
+							return MemDBMultiSlot();
+						}
+						std::this_thread::yield();
+					}
+				}
+			}
+		}
+
+		template<typename T>
+		void write(int64_t trigger_time, int32_t msg_type, const T &data)
+		{
+			MemDBMultiSlot slot = reserve(trigger_time, msg_type, sizeof(T));
+			if (!slot.valid()) { return; }
+			memcpy(slot.data(), &data, sizeof(T));
+			slot.commit();
+		}
+
+		void write_raw(int64_t trigger_time, int32_t msg_type, uintptr_t data, uint32_t length)
+		{
+			MemDBMultiSlot slot = reserve(trigger_time, msg_type, length);
+			if (!slot.valid()) { return; }
+			memcpy(slot.data(), reinterpret_cast<const void*>(data), length);
+			slot.commit();
+		}
+
+		static uint32_t frame_size(uint32_t length)
+		{
+			return memdb_multi_frame_size(sizeof(MemDBFrameHeader) + length);
+		}
+
+	private:
+		MemDBMultiJournalPtr journal_;
+		const uint32_t source_;
+	};
+	typedef std::shared_ptr<MemDBMultiWriter> MemDBMultiWriterPtr;
+
+	/**
+	* Reader of a multi-producer journal, single thread.
+	* A reserved but uncommitted slot blocks the reader (journal order is kept) until it is
+	* committed: a slot dropped by its writer is committed as padding by MemDBMultiSlot, one
+	* abandoned by a writer process that died is closed when the journal is opened for writing again.
+	* Schema frames are checked against MemDBTypeRegistry and not returned; frames of a msg_type
+	* whose recorded layout differs are skipped and counted in get_schema_rejected_count().
+	*/
+	class MemDBMultiReader
+	{
+	public:
+		MemDBMultiReader(const MemDBLocationPtr& location, uint32_t dest_id, uint32_t page_size) :
+			location_(location), dest_id_(dest_id), page_size_(page_size), page_id_(1), offset_(0), schema_rejected_(0)
+		{
+			std::vector<int> ids = location_->locator->list_page_id(location_, dest_id_);
+			page_id_ = ids.empty() ? 1 : ids.front();
+			load_page(page_id_);
+		}
+
+		/** @return true if the frame under the cursor is committed and can be read */
+		bool data_available()
+		{
+			if (page_ == nullptr && !load_page(page_id_))
+			{
+				return false; // journal not created yet
+			}
+			for (;;)
+			{
+				MemDBFrameHeader* h = page_->frame_at(offset_);
+				uint32_t length = memdb_multi_length(h)->load(std::memory_order_acquire);
+				if (length == 0 || (length & MEMDB_MULTI_PENDING))
+				{
+					return false; // end of journal, or reserved and not committed yet
+				}
+				if (h->msg_type == MemDBMsgType::PageEnd)
+				{
+					if (!load_page(page_->get_page_id() + 1))
+					{
+						return false; // next page not created yet by the rolling writer
+					}
+					continue;
+				}
+				if (h->msg_type == 0)
+				{
+					advance(length);
+					continue;
+				}
+				if (h->msg_type == MemDBExtMsgType::Schema)
+				{
+					MemDBTypeRegistry::getInstance().checkSchemaFrame(MemDBMultiFrame(h), &rejected_);
+					advance(length);
+					continue;
+				}
+				if (!rejected_.empty() && rejected_.count((int32_t)h->msg_type) > 0)
+				{
+					++schema_rejected_;
+					advance(length);
+					continue;
+				}
+				frame_.header_ = h;
+				return true;
+			}
+		}
+
+		/** frame under the cursor, valid only after data_available() returned true */
+		const MemDBMultiFrame& current_frame() const { return frame_; }
+
+		void next()
+		{
+			if (frame_.header_ == nullptr) { return; }
+			advance(frame_.frame_length());
+			frame_.header_ = nullptr;
+		}
+
+		uint64_t get_schema_rejected_count() const { return schema_rejected_; }
+
+	private:
+		void advance(uint32_t length)
+		{
+			offset_ += MemDBMultiWriter::frame_size(length - sizeof(MemDBFrameHeader));
+		}
+
+		bool load_page(int page_id)
+		{
+			std::string path = MemDBPage::get_page_path(location_, dest_id_, page_id);
+			if (!std::ifstream(path).good())
+			{
+				return false;
+			}
+			MemDBMultiPagePtr page = std::make_shared<MemDBMultiPage>(path, page_id, page_size_, false);
+			if (!page->valid())
+			{
+				return false;
+			}
+			page_ = page;
+			page_id_ = page_id;
+			offset_ = page_->first_frame_offset();
+			return true;
+		}
+
+		MemDBLocationPtr location_;
+		const uint32_t dest_id_;
+		const uint32_t page_size_;
+		MemDBMultiPagePtr page_;
+		int page_id_;
+		uint64_t offset_;
+		uint64_t schema_rejected_;
+		std::set<int32_t> rejected_;
+		MemDBMultiFrame frame_;
+	};
+	typedef std::shared_ptr<MemDBMultiReader> MemDBMultiReaderPtr;
+
+}//namespace XT
+
+#endif
@@ -0,0 +1,620 @@
+#pragma once
+#ifndef XT_MEMDB_TYPE_REGISTRY_H
+#define XT_MEMDB_TYPE_REGISTRY_H
+
+/**
+* \file MemDBTypeRegistry.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a schema-aware registry of POD payloads stored in MemDB frames.
+*
+* \description
+*	Maps a msg_type to the POD struct written in its frames. The mapping is declared at
+*	compile time with XT_MEMDB_REGISTER_TYPE, checked against frame length and schema version
+*	at read time, and used by MemDBTypedDispatcher / MemDBColumnarDump to hand typed const
+*	references straight from the mmap page without copying or parsing.
+*/
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <type_traits>
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/stat.h>
+#endif
+
+#include "XTConfig.h"
+#include "XTEnum.pb.h"
+#include "log4z.h"
+
+#include "fmt/format.h"
+#include "MemDBData.h"
+#include "MemDBEvent.h"
+#include "MemDBUtil.h"
+#include "MemDBJournal.h"
+
+namespace XT
+{
+
+	/**
+	* msg types of frames defined in C++ rather than in XTEnum.proto MemDBMsgType.
+	* 20000 and up is left free by the proto, keep new ids in that range.
+	*/
+	struct MemDBExtMsgType
+	{
+		/** schema of the registered types, written by memdb_write_schema */
+		static const int32_t Schema = 20000;
+		/** serialized MktQuoteData, written by JournalRecorder */
+		static const int32_t MktQuoteData = 20001;
+		/** ReplayOrderBookEvent, written by JournalRecorder */
+		static const int32_t OrderBookEvent = 20011;
+	};
+
+	/** field value type used by the columnar dump */
+	enum class MemDBFieldType : int32_t
+	{
+		Unknown = 0,
+		Int8 = 1,
+		UInt8 = 2,
+		Int16 = 3,
+		UInt16 = 4,
+		Int32 = 5,
+		UInt32 = 6,
+		Int64 = 7,
+		UInt64 = 8,
+		Float = 9,
+		Double = 10,
+		Bool = 11,
+		Chars = 12 ///< fixed size char array, zero terminated or full
+	};
+
+	template<typename F, typename Enable = void>
+	struct MemDBFieldTypeOf { static const MemDBFieldType value = MemDBFieldType::Unknown; };
+
+#define XT_MEMDB_FIELD_TYPE_OF(CTYPE, FTYPE) \
+	template<> struct MemDBFieldTypeOf<CTYPE> { static const MemDBFieldType value = MemDBFieldType::FTYPE; };
+
+	XT_MEMDB_FIELD_TYPE_OF(int8_t, Int8)
+	XT_MEMDB_FIELD_TYPE_OF(uint8_t, UInt8)
+	XT_MEMDB_FIELD_TYPE_OF(int16_t, Int16)
+	XT_MEMDB_FIELD_TYPE_OF(uint16_t, UInt16)
+	XT_MEMDB_FIELD_TYPE_OF(int32_t, Int32)
+	XT_MEMDB_FIELD_TYPE_OF(uint32_t, UInt32)
+	XT_MEMDB_FIELD_TYPE_OF(int64_t, Int64)
+	XT_MEMDB_FIELD_TYPE_OF(uint64_t, UInt64)
+	XT_MEMDB_FIELD_TYPE_OF(float, Float)
+	XT_MEMDB_FIELD_TYPE_OF(double, Double)
+	XT_MEMDB_FIELD_TYPE_OF(bool, Bool)
+	XT_MEMDB_FIELD_TYPE_OF(char, Chars)
+
+	template<size_t N>
+	struct MemDBFieldTypeOf<char[N]> { static const MemDBFieldType value = MemDBFieldType::Chars; };
+
+	template<typename E>
+	struct MemDBFieldTypeOf<E, typename std::enable_if<std::is_enum<E>::value>::type> { static const MemDBFieldType value = MemDBFieldType::Int32; };
+
+	/** description of one member of a registered payload */
+	struct MemDBFieldInfo
+	{
+		const char* name;
+		uint32_t offset;
+		uint32_t size;
+		MemDBFieldType type;
+	};
+
+#ifdef _WIN32
+#pragma  pack(push, 1)
+#endif
+	/**
+	* schema entry, written once per registered type at the head of a journal
+	* so that readers can verify the layout of the frames they are going to cast
+	*/
+	struct MemDBSchemaEntry
+	{
+		int32_t msg_type;
+		uint32_t size;
+		uint32_t version;
+		uint32_t name_hash;
+#ifndef _WIN32
+	} __attribute__((packed));
+#else
+};
+#pragma pack(pop)
+#endif
+
+	/**
+	* Compile-time mapping POD type -> msg_type, specialised by XT_MEMDB_REGISTER_TYPE.
+	*/
+	template<typename T>
+	struct MemDBTypeTraits
+	{
+		static const bool registered = false;
+	};
+
+	/** runtime view of one registered type */
+	struct MemDBTypeInfo
+	{
+		int32_t msg_type;
+		uint32_t size;
+		uint32_t version;
+		std::string name;
+		std::vector<MemDBFieldInfo> fields;
+
+		MemDBSchemaEntry schema() const
+		{
+			MemDBSchemaEntry e;
+			e.msg_type = msg_type;
+			e.size = size;
+			e.version = version;
+			e.name_hash = MemDBUtil::hash_str_32(name);
+			return e;
+		}
+	};
+	typedef std::shared_ptr<MemDBTypeInfo> MemDBTypeInfoPtr;
+
+	/**
+	* Runtime index of all registered types, filled by the static registrars
+	* generated by XT_MEMDB_REGISTER_TYPE.
+	*/
+	class MemDBTypeRegistry
+	{
+	public:
+		static MemDBTypeRegistry& getInstance()
+		{
+			static MemDBTypeRegistry instance;
+			return instance;
+		}
+
+		template<typename T>
+		bool add()
+		{
+			static_assert(MemDBTypeTraits<T>::registered, "type is not registered with XT_MEMDB_REGISTER_TYPE");
+			MemDBTypeInfoPtr info = std::make_shared<MemDBTypeInfo>();
+			info->msg_type = MemDBTypeTraits<T>::msg_type;
+			info->size = sizeof(T);
+			info->version = MemDBTypeTraits<T>::version;
+			info->name = MemDBTypeTraits<T>::name();
+			info->fields = MemDBTypeTraits<T>::fields();
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_types.find(info->msg_type);
+			if (it != m_types.end() && it->second->name != info->name)
+			{
+				LOGE(fmt::format("MemDBTypeRegistry,msg_type {} already registered as {},ignore {}", info->msg_type, it->second->name, info->name));
+				return false;
+			}
+			m_types[info->msg_type] = info;
+			return true;
+		}
+
+		MemDBTypeInfoPtr find(int32_t msg_type) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_types.find(msg_type);
+			return (it == m_types.end()) ? nullptr : it->second;
+		}
+
+		bool has(int32_t msg_type) const { return find(msg_type) != nullptr; }
+
+		std::vector<MemDBTypeInfoPtr> all() const
+		{
+			std::vector<MemDBTypeInfoPtr> v;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto& kv : m_types) { v.push_back(kv.second); }
+			return v;
+		}
+
+		/** schema of all registered types, to be written at the beginning of a journal */
+		std::vector<MemDBSchemaEntry> schema() const
+		{
+			std::vector<MemDBSchemaEntry> v;
+			for (auto& info : all()) { v.push_back(info->schema()); }
+			return v;
+		}
+
+		/**
+		* check a schema recorded by a writer against what this process was compiled with
+		* @param rejected receives the msg_types whose recorded layout differs, may be null
+		* @return number of mismatched entries, 0 means every recorded type can be cast safely
+		*/
+		int checkSchema(const std::vector<MemDBSchemaEntry>& recorded, std::set<int32_t>* rejected = nullptr) const
+		{
+			int nMismatch = 0;
+			for (auto& e : recorded)
+			{
+				MemDBTypeInfoPtr info = find(e.msg_type);
+				if (info == nullptr) { continue; }
+				MemDBSchemaEntry mine = info->schema();
+				if (mine.size != e.size || mine.version != e.version || mine.name_hash != e.name_hash)
+				{
+					LOGE(fmt::format("MemDBTypeRegistry,schema mismatch for msg_type {} ({}),size {}/{},version {}/{}", e.msg_type, info->name, e.size, mine.size, e.version, mine.version));
+					++nMismatch;
+					if (rejected != nullptr) { rejected->insert(e.msg_type); }
+				}
+			}
+			return nMismatch;
+		}
+
+		/**
+		* check a MemDBExtMsgType::Schema frame written by memdb_write_schema and record the rejected
+		* msg_types for the journal of the frame, see isRejected. A later schema frame of the same
+		* journal replaces the record.
+		* @param rejected receives the msg_types whose recorded layout differs, may be null
+		* @return number of mismatched entries, -1 if the frame is not a valid schema frame
+		*/
+		int checkSchemaFrame(const MsgEvent& e, std::set<int32_t>* rejected = nullptr)
+		{
+			if (e.msg_type() != MemDBExtMsgType::Schema || e.data_length() % sizeof(MemDBSchemaEntry) != 0)
+			{
+				return -1;
+			}
+			std::vector<MemDBSchemaEntry> recorded(e.data_length() / sizeof(MemDBSchemaEntry));
+			if (!recorded.empty())
+			{
+				memcpy(recorded.data(), e.data_as_bytes(), e.data_length());
+			}
+			std::set<int32_t> mine;
+			int nMismatch = checkSchema(recorded, &mine);
+			if (rejected != nullptr) { rejected->insert(mine.begin(), mine.end()); }
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (mine.empty()) { m_journalRejected.erase(journalKey(e)); }
+			else { m_journalRejected[journalKey(e)] = std::move(mine); }
+			m_nRejectedJournals.store(m_journalRejected.size(), std::memory_order_release);
+			return nMismatch;
+		}
+
+		/**
+		* @return true if the last schema frame of the journal of e rejected the msg_type of e.
+		* Journals are told apart by the source and dest of their frames, so the journals merged by one
+		* MemDBReader each keep their own record. Lock free while no journal has rejected anything.
+		*/
+		bool isRejected(const MsgEvent& e) const
+		{
+			if (m_nRejectedJournals.load(std::memory_order_acquire) == 0) { return false; }
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_journalRejected.find(journalKey(e));
+			return it != m_journalRejected.end() && it->second.count(e.msg_type()) > 0;
+		}
+
+	private:
+		MemDBTypeRegistry() {}
+		MemDBTypeRegistry(const MemDBTypeRegistry&) = delete;
+		MemDBTypeRegistry& operator=(const MemDBTypeRegistry&) = delete;
+
+		static uint64_t journalKey(const MsgEvent& e) { return ((uint64_t)e.source() << 32) | e.dest(); }
+
+		mutable std::mutex m_mutex;
+		std::map<int32_t, MemDBTypeInfoPtr> m_types;
+		std::map<uint64_t, std::set<int32_t>> m_journalRejected; ///< journal key -> msg_types rejected by its schema
+		std::atomic<size_t> m_nRejectedJournals{ 0 };
+	};
+
+	/**
+	* checked zero-copy cast of a frame payload.
+	* Schema frames handed to it are checked like in MemDBTypedDispatcher, so a plain read loop that
+	* casts every frame also skips the msg_types its journal schema rejected.
+	* @return pointer into the frame memory, nullptr if msg_type or length does not match T or the journal schema rejected T
+	*/
+	template<typename T>
+	inline const T* memdb_cast(const MsgEvent& e)
+	{
+		static_assert(MemDBTypeTraits<T>::registered, "type is not registered with XT_MEMDB_REGISTER_TYPE");
+		if (e.msg_type() != MemDBTypeTraits<T>::msg_type || e.data_length() != sizeof(T))
+		{
+			if (e.msg_type() == MemDBExtMsgType::Schema) { MemDBTypeRegistry::getInstance().checkSchemaFrame(e); }
+			return nullptr;
+		}
+		if (MemDBTypeRegistry::getInstance().isRejected(e)) { return nullptr; }
+		return &e.data<T>();
+	}
+
+	/** msg_type registered for T */
+	template<typename T>
+	inline int32_t memdb_msg_type()
+	{
+		static_assert(MemDBTypeTraits<T>::registered, "type is not registered with XT_MEMDB_REGISTER_TYPE");
+		return MemDBTypeTraits<T>::msg_type;
+	}
+
+	/** write a registered payload, msg_type is taken from the registry */
+	template<typename T>
+	inline void memdb_write(MemDBWriter& writer, int64_t trigger_time, const T& data)
+	{
+		writer.write<T>(trigger_time, memdb_msg_type<T>(), data);
+	}
+
+	/**
+	* write the schema of all registered types as one MemDBExtMsgType::Schema frame.
+	* Call it right after a journal is opened for writing, readers check it before casting any frame.
+	* Works with MemDBWriter and MemDBMultiWriter.
+	*/
+	template<typename Writer>
+	inline void memdb_write_schema(Writer& writer, int64_t trigger_time)
+	{
+		std::vector<MemDBSchemaEntry> v = MemDBTypeRegistry::getInstance().schema();
+		if (v.empty()) { return; }
+		writer.write_raw(trigger_time, MemDBExtMsgType::Schema, reinterpret_cast<uintptr_t>(v.data()), (uint32_t)(v.size() * sizeof(MemDBSchemaEntry)));
+	}
+
+	/**
+	* Dispatches frames to handlers by msg_type, handing typed const references into the journal page.
+	* Schema frames are checked against the registry, frames of a msg_type whose recorded layout
+	* differs in their own journal are counted and never handed to a typed handler.
+	* Not thread-safe: register handlers before the read loop starts.
+	*/
+	class MemDBTypedDispatcher
+	{
+	public:
+		typedef std::function<void(const MsgEvent&)> RawHandler;
+
+		/** register handler for registered type T, frames with a wrong length are counted and skipped */
+		template<typename T>
+		void on(std::function<void(const MsgEvent&, const T&)> handler)
+		{
+			static_assert(MemDBTypeTraits<T>::registered, "type is not registered with XT_MEMDB_REGISTER_TYPE");
+			MemDBTypeRegistry::getInstance().add<T>();
+			const int32_t msgType = MemDBTypeTraits<T>::msg_type;
+			uint64_t* pBad = &m_nBadLength;
+			m_handlers[msgType] = [handler, pBad](const MsgEvent& e)
+			{
+				const T* p = memdb_cast<T>(e);
+				if (p == nullptr) { ++(*pBad); return; }
+				handler(e, *p);
+			};
+		}
+
+		/** handler for msg types without a registered type */
+		void onRaw(int32_t msg_type, RawHandler handler) { m_handlers[msg_type] = std::move(handler); }
+
+		/** handler for everything not dispatched by type */
+		void onOther(RawHandler handler) { m_other = std::move(handler); }
+
+		/** @return true if a typed or raw handler consumed the frame */
+		bool dispatch(const MsgEvent& e)
+		{
+			if (e.msg_type() == MemDBExtMsgType::Schema)
+			{
+				MemDBTypeRegistry::getInstance().checkSchemaFrame(e);
+			}
+			auto it = m_handlers.find(e.msg_type());
+			if (it != m_handlers.end())
+			{
+				if (MemDBTypeRegistry::getInstance().isRejected(e))
+				{
+					++m_nSchemaMismatch;
+					return false;
+				}
+				it->second(e);
+				return true;
+			}
+			if (m_other) { m_other(e); }
+			return false;
+		}
+
+		uint64_t getBadLengthCount() const { return m_nBadLength; }
+
+		/** frames skipped because the journal schema of their msg_type differs */
+		uint64_t getSchemaMismatchCount() const { return m_nSchemaMismatch; }
+
+	private:
+		std::map<int32_t, RawHandler> m_handlers;
+		RawHandler m_other;
+		uint64_t m_nBadLength = 0;
+		uint64_t m_nSchemaMismatch = 0;
+	};
+	typedef std::shared_ptr<MemDBTypedDispatcher> MemDBTypedDispatcherPtr;
+
+	/**
+	* Generic dump of registered payloads into one column file per field,
+	* driven purely by the registry (no per-type code).
+	* Schema frames are checked like in MemDBTypedDispatcher, rejected msg_types are not dumped.
+	* Layout under dir (type names made file system safe, XT::TimeRequest -> XT_TimeRequest): <TypeName>/gen_time.bin, <TypeName>/<field>.bin and a <TypeName>.csv header
+	* describing name,type,size of every column. Each .bin is the raw little endian column.
+	*/
+	class MemDBColumnarDump
+	{
+	public:
+		explicit MemDBColumnarDump(const std::string& dir) : m_dir(dir) {}
+
+		~MemDBColumnarDump() { close(); }
+
+		/** append one frame, @return false if the msg_type is not registered, rejected by the journal schema or the length mismatches */
+		bool add(const MsgEvent& e)
+		{
+			if (e.msg_type() == MemDBExtMsgType::Schema)
+			{
+				MemDBTypeRegistry::getInstance().checkSchemaFrame(e);
+				return false;
+			}
+			if (MemDBTypeRegistry::getInstance().isRejected(e)) { return false; }
+			MemDBTypeInfoPtr info = MemDBTypeRegistry::getInstance().find(e.msg_type());
+			if (info == nullptr || e.data_length() != info->size) { return false; }
+			TypeColumns* tc = columnsFor(info);
+			if (tc == nullptr) { return false; }
+			const char* base = e.data_as_bytes();
+			int64_t ts = e.gen_time();
+			tc->gen_time->write(reinterpret_cast<const char*>(&ts), sizeof(ts));
+			for (size_t i = 0; i < info->fields.size(); ++i)
+			{
+				const MemDBFieldInfo& f = info->fields[i];
+				tc->files[i]->write(base + f.offset, f.size);
+			}
+			++tc->rows;
+			return true;
+		}
+
+		/**
+		* drain a reader into the dump
+		* @param end_time stop at the first frame with gen_time > end_time, 0 means until no data is available
+		* @return number of frames dumped
+		*/
+		uint64_t dumpReader(MemDBReader& reader, int64_t end_time = 0)
+		{
+			uint64_t n = 0;
+			while (reader.data_available())
+			{
+				MemDBFramePtr frame = reader.current_frame();
+				if (end_time > 0 && frame->gen_time() > end_time) { break; }
+				if (add(*frame)) { ++n; }
+				reader.next();
+			}
+			return n;
+		}
+
+		/** rows written for msg_type */
+		uint64_t rows(int32_t msg_type) const
+		{
+			auto it = m_columns.find(msg_type);
+			return (it == m_columns.end()) ? 0 : it->second.rows;
+		}
+
+		void close()
+		{
+			for (auto& kv : m_columns)
+			{
+				kv.second.gen_time->close();
+				for (auto& f : kv.second.files) { f->close(); }
+			}
+			m_columns.clear();
+		}
+
+		/** name usable as a file or directory name on every platform, e.g. XT::TimeRequest -> XT_TimeRequest */
+		static std::string fileName(const std::string& name)
+		{
+			std::string out;
+			out.reserve(name.size());
+			for (char c : name)
+			{
+				bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.';
+				if (ok) { out.push_back(c); }
+				else if (out.empty() || out.back() != '_') { out.push_back('_'); }
+			}
+			return out;
+		}
+
+		static const char* fieldTypeName(MemDBFieldType t)
+		{
+			switch (t)
+			{
+			case MemDBFieldType::Int8: return "int8";
+			case MemDBFieldType::UInt8: return "uint8";
+			case MemDBFieldType::Int16: return "int16";
+			case MemDBFieldType::UInt16: return "uint16";
+			case MemDBFieldType::Int32: return "int32";
+			case MemDBFieldType::UInt32: return "uint32";
+			case MemDBFieldType::Int64: return "int64";
+			case MemDBFieldType::UInt64: return "uint64";
+			case MemDBFieldType::Float: return "float32";
+			case MemDBFieldType::Double: return "float64";
+			case MemDBFieldType::Bool: return "bool";
+			case MemDBFieldType::Chars: return "chars";
+			default: return "unknown";
+			}
+		}
+
+	private:
+		typedef std::shared_ptr<std::ofstream> OfstreamPtr;
+		struct TypeColumns
+		{
+			OfstreamPtr gen_time;
+			std::vector<OfstreamPtr> files;
+			uint64_t rows = 0;
+		};
+
+		/** open the column files of info on first use, @return nullptr if one of them cannot be opened, the type is then skipped */
+		TypeColumns* columnsFor(const MemDBTypeInfoPtr& info)
+		{
+			auto it = m_columns.find(info->msg_type);
+			if (it != m_columns.end()) { return &it->second; }
+			if (m_failed.count(info->msg_type) > 0) { return nullptr; }
+
+			std::string typeName = fileName(info->name);
+			std::string typeDir = m_dir + "/" + typeName;
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+			CreateDirectoryA(typeDir.c_str(), NULL);
+#else
+			mkdir(typeDir.c_str(), 0755);
+#endif
+			std::ofstream desc(m_dir + "/" + typeName + ".csv");
+			TypeColumns tc;
+			tc.gen_time = std::make_shared<std::ofstream>(typeDir + "/gen_time.bin", std::ios::binary);
+			bool ok = desc.is_open() && tc.gen_time->is_open();
+			desc << "name,type,size,msg_type,version" << std::endl;
+			desc << "gen_time,int64,8," << info->msg_type << "," << info->version << std::endl;
+			for (size_t i = 0; ok && i < info->fields.size(); ++i)
+			{
+				const MemDBFieldInfo& f = info->fields[i];
+				desc << f.name << "," << fieldTypeName(f.type) << "," << f.size << "," << info->msg_type << "," << info->version << std::endl;
+				tc.files.push_back(std::make_shared<std::ofstream>(typeDir + "/" + f.name + ".bin", std::ios::binary));
+				ok = tc.files.back()->is_open();
+			}
+			if (!ok || !desc)
+			{
+				LOGE(fmt::format("MemDBColumnarDump,failed to open the column files of {} under {}", info->name, typeDir));
+				m_failed.insert(info->msg_type);
+				return nullptr;
+			}
+			return &(m_columns[info->msg_type] = tc);
+		}
+
+		std::string m_dir;
+		std::map<int32_t, TypeColumns> m_columns;
+		std::set<int32_t> m_failed; ///< msg_types whose column files could not be opened
+	};
+	typedef std::shared_ptr<MemDBColumnarDump> MemDBColumnarDumpPtr;
+
+}//namespace XT
+
+#define XT_MEMDB_CONCAT_IMPL(A, B) A##B
+#define XT_MEMDB_CONCAT(A, B) XT_MEMDB_CONCAT_IMPL(A, B)
+
+/** field descriptor used inside XT_MEMDB_REGISTER_TYPE */
+#define XT_MEMDB_FIELD(TYPE, FIELD) \
+	XT::MemDBFieldInfo{ #FIELD, (uint32_t)offsetof(TYPE, FIELD), (uint32_t)sizeof(((TYPE*)0)->FIELD), \
+		XT::MemDBFieldTypeOf<typename std::remove_cv<decltype(((TYPE*)0)->FIELD)>::type>::value }
+
+/**
+* register POD TYPE as the payload of MSG_TYPE, VERSION must be bumped whenever the layout changes.
+* Use at global namespace scope, once per type, e.g.
+*	XT_MEMDB_REGISTER_TYPE(XT::TimeRequest, XT::MemDBMsgType::TimeRequest, 1,
+*		XT_MEMDB_FIELD(XT::TimeRequest, id), XT_MEMDB_FIELD(XT::TimeRequest, duration))
+*/
+#define XT_MEMDB_REGISTER_TYPE(TYPE, MSG_TYPE, VERSION, ...) \
+	namespace XT { \
+	template<> struct MemDBTypeTraits<TYPE> \
+	{ \
+		static_assert(std::is_trivially_copyable<TYPE>::value, #TYPE " must be trivially copyable to live in a MemDB frame"); \
+		static const bool registered = true; \
+		static const int32_t msg_type = (int32_t)(MSG_TYPE); \
+		static const uint32_t version = (VERSION); \
+		static const char* name() { return #TYPE; } \
+		static std::vector<MemDBFieldInfo> fields() { return std::vector<MemDBFieldInfo>{ __VA_ARGS__ }; } \
+	}; \
+	namespace { \
+	static const bool XT_MEMDB_CONCAT(xt_memdb_registered_, __COUNTER__) = MemDBTypeRegistry::getInstance().add<TYPE>(); \
+	} \
+	}
+
+//////
+// built-in control payloads of MemDBData.h
+XT_MEMDB_REGISTER_TYPE(XT::TimeRequest, XT::MemDBMsgType::TimeRequest, 1,
+	XT_MEMDB_FIELD(XT::TimeRequest, id), XT_MEMDB_FIELD(XT::TimeRequest, duration), XT_MEMDB_FIELD(XT::TimeRequest, repeat))
+XT_MEMDB_REGISTER_TYPE(XT::RequestReadFrom, XT::MemDBMsgType::RequestReadFrom, 1,
+	XT_MEMDB_FIELD(XT::RequestReadFrom, source_id), XT_MEMDB_FIELD(XT::RequestReadFrom, from_time))
+XT_MEMDB_REGISTER_TYPE(XT::RequestWriteTo, XT::MemDBMsgType::RequestWriteTo, 1,
+	XT_MEMDB_FIELD(XT::RequestWriteTo, dest_id))
+XT_MEMDB_REGISTER_TYPE(XT::Channel, XT::MemDBMsgType::Channel, 1,
+	XT_MEMDB_FIELD(XT::Channel, source_id), XT_MEMDB_FIELD(XT::Channel, dest_id))
+
+#endif
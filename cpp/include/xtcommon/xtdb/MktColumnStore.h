@@ -0,0 +1,821 @@
+#pragma once
+#ifndef XT_MKT_COLUMN_STORE_H
+#define XT_MKT_COLUMN_STORE_H
+
+/**
+* \file MktColumnStore.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a memory mapped columnar store for ticks and bars.
+*
+* \description
+*	Designed for loading historical market data without parsing. One file holds the ticks
+*	(MktQuoteData fields) or the bars of one span of one exchange and trading day:
+*
+*		header | instrument directory | column table | columns
+*
+*	The directory is sorted by instrument id and gives the row range of each instrument.
+*	Every column is a fixed width 8 byte array (int64 or double) over all rows, 64 byte
+*	aligned, rows of an instrument are contiguous and sorted by time. Readers map the file
+*	and return spans into it. Files are written in the native (little endian) byte order.
+*
+*	Layout on disk: <root>/<exch>/<tradingday>.tick.xtcol and <root>/<exch>/<tradingday>.bar<span>.xtcol
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <queue>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+#include "XTConfig.h"
+#include "XTData.pb.h"
+#include "typedef_XTData.pb.h"
+#include "MemDBUtil.h"
+#include "Bar.h"
+#include "BarColumns.h"
+#include "CsvUtil.h"
+
+namespace XT
+{
+
+	/**
+	* kind of a column store file
+	*/
+	struct MktColumnKind
+	{
+		enum enumtype
+		{
+			Tick = 1,
+			Bar = 2
+		};
+	};
+
+	/**
+	* tick columns, MktQuoteData fields
+	*/
+	struct TickCol
+	{
+		enum enumtype
+		{
+			ExchTs = 0,
+			RecvTs,
+			LastTs,
+			LastPx,
+			TotVolume,
+			TotAmount,
+			TotOi,
+			BidPx0, AskPx0, BidSz0, AskSz0,
+			BidPx1, AskPx1, BidSz1, AskSz1,
+			BidPx2, AskPx2, BidSz2, AskSz2,
+			BidPx3, AskPx3, BidSz3, AskSz3,
+			BidPx4, AskPx4, BidSz4, AskSz4,
+			Count
+		};
+	};
+
+	/**
+	* bar columns, BeginDt and EndDt followed by the BarField columns
+	*/
+	struct BarCol
+	{
+		enum enumtype
+		{
+			BeginDt = 0,
+			EndDt,
+			FirstField,
+			Count = FirstField + BarField::Count
+		};
+	};
+
+#pragma pack(push, 1)
+	struct MktColumnFileHeader
+	{
+		char magic[8]; ///< "XTCOLST1"
+		uint32_t version;
+		uint32_t kind; ///< MktColumnKind
+		int32_t span; ///< bar seconds, 0 for ticks
+		int32_t tradingday;
+		char exchid[16];
+		uint32_t nInstr;
+		uint32_t nColumns;
+		uint64_t nRows;
+		uint64_t dirOffset;
+		uint64_t colOffset;
+		char reserved[56];
+	};
+
+	struct MktColumnDirEntry
+	{
+		char instrid[48];
+		uint64_t rowStart;
+		uint64_t rowCount;
+	};
+
+	struct MktColumnDesc
+	{
+		char name[40];
+		uint32_t type; ///< 0 int64, 1 double
+		uint32_t reserved;
+		uint64_t offset;
+		uint64_t reserved2;
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(MktColumnFileHeader) == 128, "MktColumnFileHeader size");
+	static_assert(sizeof(MktColumnDirEntry) == 64, "MktColumnDirEntry size");
+	static_assert(sizeof(MktColumnDesc) == 64, "MktColumnDesc size");
+
+class MktColumnStore
+{
+public:
+	enum { Version = 1 };
+	enum { TypeInt64 = 0, TypeDouble = 1 };
+
+	static const char* magic() { return "XTCOLST1"; }
+
+	static const char* tickColName(int c)
+	{
+		static const char* names[TickCol::Count] = {
+			"exchts", "recvts", "lastts", "lastpx", "totvolume", "totamount", "totoi",
+			"bidpx0", "askpx0", "bidsz0", "asksz0", "bidpx1", "askpx1", "bidsz1", "asksz1",
+			"bidpx2", "askpx2", "bidsz2", "asksz2", "bidpx3", "askpx3", "bidsz3", "asksz3",
+			"bidpx4", "askpx4", "bidsz4", "asksz4" };
+		return (c >= 0 && c < TickCol::Count) ? names[c] : "";
+	}
+
+	static int tickColType(int c)
+	{
+		switch (c)
+		{
+		case TickCol::ExchTs: case TickCol::RecvTs: case TickCol::LastTs: case TickCol::TotVolume: case TickCol::TotOi:
+		case TickCol::BidSz0: case TickCol::AskSz0: case TickCol::BidSz1: case TickCol::AskSz1: case TickCol::BidSz2: case TickCol::AskSz2:
+		case TickCol::BidSz3: case TickCol::AskSz3: case TickCol::BidSz4: case TickCol::AskSz4:
+			return TypeInt64;
+		default:
+			return TypeDouble;
+		}
+	}
+
+	static const char* barColName(int c)
+	{
+		static const char* names[BarCol::Count] = {
+			"begindt", "enddt", "open", "high", "low", "close", "volume", "oichg", "bsvoldiff",
+			"turnover", "bstdiff", "flipup", "flipdn" };
+		return (c >= 0 && c < BarCol::Count) ? names[c] : "";
+	}
+
+	static int barColType(int c) { return c < BarCol::FirstField ? TypeInt64 : TypeDouble; }
+
+	static std::string tickPath(const std::string& root, const std::string& exch, int tradingday)
+	{
+		return root + "/" + exch + "/" + std::to_string(tradingday) + ".tick.xtcol";
+	}
+
+	static std::string barPath(const std::string& root, const std::string& exch, int tradingday, int span)
+	{
+		return root + "/" + exch + "/" + std::to_string(tradingday) + ".bar" + std::to_string(span) + ".xtcol";
+	}
+
+	/**
+	* @brief trading days with a file of the kind, sorted
+	*
+	* @param span as bar seconds, 0 for ticks
+	*/
+	static std::vector<int> listDays(const std::string& root, const std::string& exch, int span = 0)
+	{
+		std::vector<int> days;
+		std::string suffix = span > 0 ? ".bar" + std::to_string(span) + ".xtcol" : ".tick.xtcol";
+		boost::system::error_code ec;
+		boost::filesystem::directory_iterator it(root + "/" + exch, ec), end;
+		for (; !ec && it != end; it.increment(ec))
+		{
+			std::string name = it->path().filename().string();
+			if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) { continue; }
+			try
+			{
+				days.push_back(std::stoi(name.substr(0, name.size() - suffix.size())));
+			}
+			catch (...)
+			{
+			}
+		}
+		std::sort(days.begin(), days.end());
+		return days;
+	}
+};//class MktColumnStore
+
+/**
+* writer collecting the rows of one file in memory
+*/
+class MktColumnStoreWriter
+{
+public:
+	/**
+	* @brief constructor
+	*
+	* @param kind as MktColumnKind
+	* @param exch as exchange id
+	* @param tradingday as trading day, e.g. 20200103
+	* @param span as bar seconds, 0 for ticks
+	*/
+	MktColumnStoreWriter(MktColumnKind::enumtype kind, const std::string& exch, int tradingday, int span = 0)
+		: m_kind(kind), m_exch(exch), m_tradingDay(tradingday), m_span(span),
+		m_nColumns(kind == MktColumnKind::Tick ? (int)TickCol::Count : (int)BarCol::Count) {}
+
+	/**
+	* @brief add a tick
+	*/
+	void addTick(const MktQuoteData& d)
+	{
+		Rows& r = m_rows[d.instrid()];
+		r.resize(TickCol::Count);
+		pushInt(r, TickCol::ExchTs, d.exchts());
+		pushInt(r, TickCol::RecvTs, d.recvts());
+		pushInt(r, TickCol::LastTs, d.lastts());
+		pushDouble(r, TickCol::LastPx, d.lastpx());
+		pushInt(r, TickCol::TotVolume, d.totvolume());
+		pushDouble(r, TickCol::TotAmount, d.totamount());
+		pushInt(r, TickCol::TotOi, d.totoi());
+		pushDouble(r, TickCol::BidPx0, d.bidpx0()); pushDouble(r, TickCol::AskPx0, d.askpx0());
+		pushInt(r, TickCol::BidSz0, d.bidsz0()); pushInt(r, TickCol::AskSz0, d.asksz0());
+		pushDouble(r, TickCol::BidPx1, d.bidpx1()); pushDouble(r, TickCol::AskPx1, d.askpx1());
+		pushInt(r, TickCol::BidSz1, d.bidsz1()); pushInt(r, TickCol::AskSz1, d.asksz1());
+		pushDouble(r, TickCol::BidPx2, d.bidpx2()); pushDouble(r, TickCol::AskPx2, d.askpx2());
+		pushInt(r, TickCol::BidSz2, d.bidsz2()); pushInt(r, TickCol::AskSz2, d.asksz2());
+		pushDouble(r, TickCol::BidPx3, d.bidpx3()); pushDouble(r, TickCol::AskPx3, d.askpx3());
+		pushInt(r, TickCol::BidSz3, d.bidsz3()); pushInt(r, TickCol::AskSz3, d.asksz3());
+		pushDouble(r, TickCol::BidPx4, d.bidpx4()); pushDouble(r, TickCol::AskPx4, d.askpx4());
+		pushInt(r, TickCol::BidSz4, d.bidsz4()); pushInt(r, TickCol::AskSz4, d.asksz4());
+	}
+
+	/**
+	* @brief add a bar
+	*
+	* @param values as BarField::Count values
+	*/
+	void addBar(const std::string& instrid, int64_t begindt, int64_t enddt, const double* values)
+	{
+		Rows& r = m_rows[instrid];
+		r.resize(BarCol::Count);
+		pushInt(r, BarCol::BeginDt, begindt);
+		pushInt(r, BarCol::EndDt, enddt);
+		for (int f = 0; f < BarField::Count; ++f) { pushDouble(r, BarCol::FirstField + f, values[f]); }
+	}
+
+	/**
+	* @brief add all bars of a BarList, e.g. loaded by TrdDBMgr or MongoDBMgr
+	*/
+	void addBarList(const std::string& instrid, BarListPtr& bl)
+	{
+		if (!bl) { return; }
+		BarColumns bc;
+		for (auto& kv : bl->bars()) { bc.addBar(kv.second); }
+		addBarColumns(instrid, bc);
+	}
+
+	/**
+	* @brief add all bars of a BarColumns
+	*/
+	void addBarColumns(const std::string& instrid, const BarColumns& bc)
+	{
+		BarTsSpan ts = bc.timestamps();
+		BarTsSpan endts = bc.endTimestamps();
+		BarDoubleSpan cols[BarField::Count];
+		for (int f = 0; f < BarField::Count; ++f) { cols[f] = bc.column((BarField::enumtype)f); }
+		double v[BarField::Count];
+		for (size_t i = 0; i < ts.size(); ++i)
+		{
+			for (int f = 0; f < BarField::Count; ++f) { v[f] = cols[f][i]; }
+			addBar(instrid, ts[i], endts[i], v);
+		}
+	}
+
+	size_t getInstrCount() const { return m_rows.size(); }
+
+	/**
+	* @brief write the file, rows of each instrument are sorted by time first
+	*
+	* @return false if the file cannot be written
+	*/
+	bool write(const std::string& path)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::path p(path);
+		if (p.has_parent_path()) { boost::filesystem::create_directories(p.parent_path(), ec); }
+
+		uint64_t nrows = 0;
+		for (auto& kv : m_rows)
+		{
+			sortRows(kv.second);
+			nrows += kv.second.empty() ? 0 : kv.second[0].size();
+		}
+
+		MktColumnFileHeader h;
+		std::memset(&h, 0, sizeof(h));
+		std::memcpy(h.magic, MktColumnStore::magic(), 8);
+		h.version = MktColumnStore::Version;
+		h.kind = (uint32_t)m_kind;
+		h.span = m_span;
+		h.tradingday = m_tradingDay;
+		std::strncpy(h.exchid, m_exch.c_str(), sizeof(h.exchid) - 1);
+		h.nInstr = (uint32_t)m_rows.size();
+		h.nColumns = (uint32_t)m_nColumns;
+		h.nRows = nrows;
+		h.dirOffset = sizeof(MktColumnFileHeader);
+		h.colOffset = h.dirOffset + sizeof(MktColumnDirEntry) * h.nInstr;
+
+		std::vector<MktColumnDirEntry> dir;
+		uint64_t start = 0;
+		for (auto& kv : m_rows)
+		{
+			MktColumnDirEntry e;
+			std::memset(&e, 0, sizeof(e));
+			std::strncpy(e.instrid, kv.first.c_str(), sizeof(e.instrid) - 1);
+			e.rowStart = start;
+			e.rowCount = kv.second.empty() ? 0 : kv.second[0].size();
+			start += e.rowCount;
+			dir.push_back(e);
+		}
+
+		std::vector<MktColumnDesc> cols((size_t)m_nColumns);
+		uint64_t offset = align64(h.colOffset + sizeof(MktColumnDesc) * m_nColumns);
+		for (int c = 0; c < m_nColumns; ++c)
+		{
+			MktColumnDesc& d = cols[c];
+			std::memset(&d, 0, sizeof(d));
+			std::strncpy(d.name, colName(c), sizeof(d.name) - 1);
+			d.type = (uint32_t)colType(c);
+			d.offset = offset;
+			offset = align64(offset + nrows * 8);
+		}
+
+		std::string tmp = path + ".tmp";
+		{
+			std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+			if (!out) { return false; }
+			out.write((const char*)&h, sizeof(h));
+			if (!dir.empty()) { out.write((const char*)dir.data(), sizeof(MktColumnDirEntry) * dir.size()); }
+			out.write((const char*)cols.data(), sizeof(MktColumnDesc) * cols.size());
+			uint64_t pos = h.colOffset + sizeof(MktColumnDesc) * m_nColumns;
+			static const char zeros[64] = {};
+			for (int c = 0; c < m_nColumns; ++c)
+			{
+				out.write(zeros, (std::streamsize)(cols[c].offset - pos));
+				pos = cols[c].offset;
+				for (auto& kv : m_rows)
+				{
+					if (kv.second.empty() || kv.second[c].empty()) { continue; }
+					out.write((const char*)kv.second[c].data(), (std::streamsize)(kv.second[c].size() * 8));
+					pos += kv.second[c].size() * 8;
+				}
+			}
+			out.write(zeros, (std::streamsize)(offset - pos));
+			if (!out) { return false; }
+		}
+		boost::filesystem::rename(tmp, path, ec);
+		return !ec;
+	}
+
+protected:
+	typedef std::vector<std::vector<uint64_t> > Rows; ///< raw 8 byte values per column
+
+	static uint64_t align64(uint64_t v) { return (v + 63) & ~(uint64_t)63; }
+
+	const char* colName(int c) const { return m_kind == MktColumnKind::Tick ? MktColumnStore::tickColName(c) : MktColumnStore::barColName(c); }
+	int colType(int c) const { return m_kind == MktColumnKind::Tick ? MktColumnStore::tickColType(c) : MktColumnStore::barColType(c); }
+
+	static void pushInt(Rows& r, int c, int64_t v)
+	{
+		uint64_t u;
+		std::memcpy(&u, &v, 8);
+		r[c].push_back(u);
+	}
+
+	static void pushDouble(Rows& r, int c, double v)
+	{
+		uint64_t u;
+		std::memcpy(&u, &v, 8);
+		r[c].push_back(u);
+	}
+
+	/** sort the rows by the first column (exchts or begindt) if needed */
+	static void sortRows(Rows& r)
+	{
+		if (r.empty() || r[0].empty()) { return; }
+		const std::vector<uint64_t>& key = r[0];
+		size_t n = key.size();
+		bool sorted = true;
+		for (size_t i = 1; i < n && sorted; ++i) { sorted = (int64_t)key[i - 1] <= (int64_t)key[i]; }
+		if (sorted) { return; }
+		std::vector<size_t> order(n);
+		for (size_t i = 0; i < n; ++i) { order[i] = i; }
+		std::stable_sort(order.begin(), order.end(), [&key](size_t a, size_t b) { return (int64_t)key[a] < (int64_t)key[b]; });
+		std::vector<uint64_t> tmp(n);
+		for (auto& col : r)
+		{
+			for (size_t i = 0; i < n; ++i) { tmp[i] = col[order[i]]; }
+			col.swap(tmp);
+		}
+	}
+
+protected:
+	MktColumnKind::enumtype m_kind;
+	std::string m_exch;
+	int m_tradingDay;
+	int m_span;
+	int m_nColumns;
+	std::map<std::string, Rows> m_rows; ///< columns per instrument id, sorted by id
+};//class MktColumnStoreWriter
+
+class MktColumnStoreReader;
+typedef std::shared_ptr<MktColumnStoreReader> MktColumnStoreReaderPtr;
+
+/**
+* read only mapping of one file
+*/
+class MktColumnStoreReader
+{
+public:
+	MktColumnStoreReader() : m_base(0), m_size(0), m_header(nullptr), m_dir(nullptr), m_cols(nullptr) {}
+
+	MktColumnStoreReader(const MktColumnStoreReader&) = delete;
+	MktColumnStoreReader& operator=(const MktColumnStoreReader&) = delete;
+
+	virtual ~MktColumnStoreReader() { close(); }
+
+	static MktColumnStoreReaderPtr create(const std::string& path)
+	{
+		MktColumnStoreReaderPtr r(new MktColumnStoreReader());
+		return r->open(path) ? r : MktColumnStoreReaderPtr();
+	}
+
+	/**
+	* @brief map and validate a file
+	*
+	* @return false if the file is missing or not a valid column store
+	*/
+	bool open(const std::string& path)
+	{
+		close();
+		boost::system::error_code ec;
+		uint64_t size = boost::filesystem::file_size(path, ec);
+		if (ec || size < sizeof(MktColumnFileHeader)) { return false; }
+		m_base = MemDBUtil::load_mmap_buffer(path, (size_t)size, false, true);
+		if (m_base == 0) { return false; }
+		m_size = (size_t)size;
+		m_path = path;
+		if (!validate())
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+		if (m_base != 0) { MemDBUtil::release_mmap_buffer(m_base, m_size, true); }
+		m_base = 0;
+		m_size = 0;
+		m_header = nullptr;
+		m_dir = nullptr;
+		m_cols = nullptr;
+	}
+
+	bool isOpen() const { return m_header != nullptr; }
+	const std::string& getPath() const { return m_path; }
+
+	MktColumnKind::enumtype getKind() const { return (MktColumnKind::enumtype)m_header->kind; }
+	int getSpan() const { return m_header->span; }
+	int getTradingDay() const { return m_header->tradingday; }
+	std::string getExchID() const { return std::string(m_header->exchid, strnlen(m_header->exchid, sizeof(m_header->exchid))); }
+	int getInstrCount() const { return (int)m_header->nInstr; }
+	uint64_t getRowCount() const { return m_header->nRows; }
+
+	std::string getInstrID(int idx) const
+	{
+		const MktColumnDirEntry& e = m_dir[idx];
+		return std::string(e.instrid, strnlen(e.instrid, sizeof(e.instrid)));
+	}
+
+	std::vector<std::string> getInstrIDs() const
+	{
+		std::vector<std::string> v;
+		for (int i = 0; i < getInstrCount(); ++i) { v.push_back(getInstrID(i)); }
+		return v;
+	}
+
+	/**
+	* @brief directory index of an instrument, binary search
+	*
+	* @return index, -1 if not in the file
+	*/
+	int findInstr(const std::string& instrid) const
+	{
+		int lo = 0, hi = getInstrCount() - 1;
+		while (lo <= hi)
+		{
+			int mid = (lo + hi) / 2;
+			int c = std::strncmp(m_dir[mid].instrid, instrid.c_str(), sizeof(m_dir[mid].instrid));
+			if (c == 0) { return mid; }
+			if (c < 0) { lo = mid + 1; }
+			else { hi = mid - 1; }
+		}
+		return -1;
+	}
+
+	uint64_t getRowStart(int idx) const { return m_dir[idx].rowStart; }
+	uint64_t getRowCount(int idx) const { return m_dir[idx].rowCount; }
+
+	/**
+	* @brief int64 column of an instrument (or of all rows for idx -1)
+	*/
+	BarTsSpan intColumn(int col, int idx = -1) const
+	{
+		return BarTsSpan((const int64_t*)columnBase(col) + rowStart(idx), (size_t)rowCount(idx));
+	}
+
+	/**
+	* @brief double column of an instrument (or of all rows for idx -1)
+	*/
+	BarDoubleSpan doubleColumn(int col, int idx = -1) const
+	{
+		return BarDoubleSpan((const double*)columnBase(col) + rowStart(idx), (size_t)rowCount(idx));
+	}
+
+	bool isIntColumn(int col) const { return m_cols[col].type == MktColumnStore::TypeInt64; }
+
+public:
+	/**
+	* @name Loaders
+	*/
+	///@{
+	/**
+	* @brief append the bars of an instrument to a BarColumns
+	*
+	* @return number of bars, 0 if the file has no bars of it
+	*/
+	size_t loadBarColumns(const std::string& instrid, BarColumns& bc) const
+	{
+		if (getKind() != MktColumnKind::Bar) { return 0; }
+		int idx = findInstr(instrid);
+		if (idx < 0) { return 0; }
+		const double* cols[BarField::Count];
+		for (int f = 0; f < BarField::Count; ++f) { cols[f] = doubleColumn(BarCol::FirstField + f, idx).data(); }
+		BarTsSpan ts = intColumn(BarCol::BeginDt, idx);
+		bc.appendColumns(ts.data(), intColumn(BarCol::EndDt, idx).data(), cols, ts.size());
+		return ts.size();
+	}
+
+	/**
+	* @brief fill a MktQuoteData from a tick row
+	*
+	* @param idx as instrument index
+	* @param row as row of the instrument
+	*/
+	void fillMktQuoteData(int idx, uint64_t row, MktQuoteData& d) const
+	{
+		uint64_t r = m_dir[idx].rowStart + row;
+		d.set_instrid(m_dir[idx].instrid, strnlen(m_dir[idx].instrid, sizeof(m_dir[idx].instrid)));
+		d.set_exchid(m_header->exchid, strnlen(m_header->exchid, sizeof(m_header->exchid)));
+		d.set_tradingday(m_header->tradingday);
+		d.set_exchts(i64(TickCol::ExchTs, r));
+		d.set_recvts(i64(TickCol::RecvTs, r));
+		d.set_lastts(i64(TickCol::LastTs, r));
+		d.set_lastpx(f64(TickCol::LastPx, r));
+		d.set_totvolume(i64(TickCol::TotVolume, r));
+		d.set_totamount(f64(TickCol::TotAmount, r));
+		d.set_totoi(i64(TickCol::TotOi, r));
+		d.set_bidpx0(f64(TickCol::BidPx0, r)); d.set_askpx0(f64(TickCol::AskPx0, r));
+		d.set_bidsz0(i64(TickCol::BidSz0, r)); d.set_asksz0(i64(TickCol::AskSz0, r));
+		d.set_bidpx1(f64(TickCol::BidPx1, r)); d.set_askpx1(f64(TickCol::AskPx1, r));
+		d.set_bidsz1(i64(TickCol::BidSz1, r)); d.set_asksz1(i64(TickCol::AskSz1, r));
+		d.set_bidpx2(f64(TickCol::BidPx2, r)); d.set_askpx2(f64(TickCol::AskPx2, r));
+		d.set_bidsz2(i64(TickCol::BidSz2, r)); d.set_asksz2(i64(TickCol::AskSz2, r));
+		d.set_bidpx3(f64(TickCol::BidPx3, r)); d.set_askpx3(f64(TickCol::AskPx3, r));
+		d.set_bidsz3(i64(TickCol::BidSz3, r)); d.set_asksz3(i64(TickCol::AskSz3, r));
+		d.set_bidpx4(f64(TickCol::BidPx4, r)); d.set_askpx4(f64(TickCol::AskPx4, r));
+		d.set_bidsz4(i64(TickCol::BidSz4, r)); d.set_asksz4(i64(TickCol::AskSz4, r));
+	}
+
+	/**
+	* @brief replay the ticks of all (or some) instruments in exchts order
+	*
+	* @param fn as callback, return false to stop
+	* @param instrids as instruments to replay, empty for all
+	*
+	* @return number of ticks replayed
+	*/
+	uint64_t replayTicks(const std::function<bool(MktQuoteDataPtr&)>& fn, const std::vector<std::string>& instrids = std::vector<std::string>()) const
+	{
+		if (getKind() != MktColumnKind::Tick) { return 0; }
+		typedef std::pair<int64_t, std::pair<int, uint64_t> > Item; ///< exchts, instrument, row
+		std::priority_queue<Item, std::vector<Item>, std::greater<Item> > heap;
+		std::vector<int> idxs;
+		if (instrids.empty()) { for (int i = 0; i < getInstrCount(); ++i) { idxs.push_back(i); } }
+		else { for (const std::string& id : instrids) { int i = findInstr(id); if (i >= 0) { idxs.push_back(i); } } }
+		for (int i : idxs)
+		{
+			if (m_dir[i].rowCount > 0) { heap.push(Item(i64(TickCol::ExchTs, m_dir[i].rowStart), std::make_pair(i, (uint64_t)0))); }
+		}
+		uint64_t n = 0;
+		while (!heap.empty())
+		{
+			Item it = heap.top();
+			heap.pop();
+			int idx = it.second.first;
+			uint64_t row = it.second.second;
+			MktQuoteData* raw = new MktQuoteData();
+			fillMktQuoteData(idx, row, *raw);
+			MktQuoteDataPtr d(raw);
+			++n;
+			if (!fn(d)) { break; }
+			if (++row < m_dir[idx].rowCount) { heap.push(Item(i64(TickCol::ExchTs, m_dir[idx].rowStart + row), std::make_pair(idx, row))); }
+		}
+		return n;
+	}
+	///@}
+
+protected:
+	bool validate()
+	{
+		const MktColumnFileHeader* h = (const MktColumnFileHeader*)m_base;
+		if (std::memcmp(h->magic, MktColumnStore::magic(), 8) != 0 || h->version != MktColumnStore::Version) { return false; }
+		int ncols = h->kind == MktColumnKind::Tick ? (int)TickCol::Count : (h->kind == MktColumnKind::Bar ? (int)BarCol::Count : -1);
+		if (ncols < 0 || (int)h->nColumns != ncols) { return false; }
+		if (h->dirOffset + (uint64_t)h->nInstr * sizeof(MktColumnDirEntry) > m_size) { return false; }
+		if (h->colOffset + (uint64_t)h->nColumns * sizeof(MktColumnDesc) > m_size) { return false; }
+		const MktColumnDirEntry* dir = (const MktColumnDirEntry*)(m_base + h->dirOffset);
+		const MktColumnDesc* cols = (const MktColumnDesc*)(m_base + h->colOffset);
+		for (uint32_t c = 0; c < h->nColumns; ++c)
+		{
+			if ((cols[c].offset & 7) != 0 || cols[c].offset + h->nRows * 8 > m_size) { return false; }
+		}
+		for (uint32_t i = 0; i < h->nInstr; ++i)
+		{
+			if (dir[i].rowStart + dir[i].rowCount > h->nRows) { return false; }
+		}
+		m_header = h;
+		m_dir = dir;
+		m_cols = cols;
+		return true;
+	}
+
+	const char* columnBase(int col) const { return (const char*)m_base + m_cols[col].offset; }
+	uint64_t rowStart(int idx) const { return idx < 0 ? 0 : m_dir[idx].rowStart; }
+	uint64_t rowCount(int idx) const { return idx < 0 ? m_header->nRows : m_dir[idx].rowCount; }
+	int64_t i64(int col, uint64_t r) const { return ((const int64_t*)columnBase(col))[r]; }
+	double f64(int col, uint64_t r) const { return ((const double*)columnBase(col))[r]; }
+
+protected:
+	std::string m_path;
+	uintptr_t m_base; ///< mapped address
+	size_t m_size; ///< mapped bytes
+	const MktColumnFileHeader* m_header;
+	const MktColumnDirEntry* m_dir;
+	const MktColumnDesc* m_cols;
+};//class MktColumnStoreReader
+
+/**
+* loaders over the daily files of a store root
+*/
+class MktColumnStoreLoader
+{
+public:
+	/**
+	* @brief load the bars of an instrument over a range of trading days
+	*
+	* @param root as store root directory
+	* @param exch as exchange id
+	* @param instrid as instrument id
+	* @param span as bar seconds
+	* @param startday as first trading day
+	* @param endday as last trading day
+	*
+	* @return bars, empty if there is no file
+	*/
+	static BarColumnsPtr loadBarColumns(const std::string& root, const std::string& exch, const std::string& instrid, int span, int startday, int endday)
+	{
+		BarColumnsPtr bc = BarColumns::create(span);
+		std::vector<MktColumnStoreReaderPtr> readers;
+		size_t total = 0;
+		for (int day : MktColumnStore::listDays(root, exch, span))
+		{
+			if (day < startday || day > endday) { continue; }
+			MktColumnStoreReaderPtr r = MktColumnStoreReader::create(MktColumnStore::barPath(root, exch, day, span));
+			if (!r) { continue; }
+			int idx = r->findInstr(instrid);
+			if (idx < 0) { continue; }
+			total += (size_t)r->getRowCount(idx);
+			readers.push_back(r);
+		}
+		bc->reserve(total);
+		for (auto& r : readers) { r->loadBarColumns(instrid, *bc); }
+		return bc;
+	}
+
+	/**
+	* @brief replay the ticks of a range of trading days in exchts order within each day
+	*
+	* @param fn as callback, return false to stop
+	*
+	* @return number of ticks replayed
+	*/
+	static uint64_t replayTicks(const std::string& root, const std::string& exch, int startday, int endday,
+		const std::function<bool(MktQuoteDataPtr&)>& fn, const std::vector<std::string>& instrids = std::vector<std::string>())
+	{
+		uint64_t n = 0;
+		bool stopped = false;
+		auto wrapped = [&fn, &stopped](MktQuoteDataPtr& d) { stopped = !fn(d); return !stopped; };
+		for (int day : MktColumnStore::listDays(root, exch, 0))
+		{
+			if (day < startday || day > endday) { continue; }
+			MktColumnStoreReaderPtr r = MktColumnStoreReader::create(MktColumnStore::tickPath(root, exch, day));
+			if (!r) { continue; }
+			n += r->replayTicks(wrapped, instrids);
+			if (stopped) { break; }
+		}
+		return n;
+	}
+};//class MktColumnStoreLoader
+
+/**
+* converters from the existing sources
+*/
+class MktColumnStoreConverter
+{
+public:
+	/**
+	* @brief convert a MktQuoteData csv file with a header line of field names (instrid, exchts, lastpx, ...)
+	*
+	* Ticks are grouped by trading day (tradingday column, or the one given) and written to
+	* one file per day.
+	*
+	* @return number of ticks converted, -1 if the file cannot be read
+	*/
+	static int64_t convertMktQuoteCsv(const std::string& csvpath, const std::string& root, const std::string& exch, int tradingday = 0, char delimiter = ',')
+	{
+		std::ifstream in(csvpath.c_str());
+		if (!in) { return -1; }
+		std::string line;
+		if (!std::getline(in, line)) { return 0; }
+		CsvFields items;
+		CsvUtil::split(line.data(), line.size(), delimiter, items);
+		const google::protobuf::Descriptor* desc = MktQuoteData::descriptor();
+		std::vector<const google::protobuf::FieldDescriptor*> fields;
+		for (const CsvField& name : items) { fields.push_back(desc->FindFieldByName(std::string(name.data(), name.size()))); }
+
+		std::map<int, std::shared_ptr<MktColumnStoreWriter> > writers;
+		int64_t n = 0;
+		MktQuoteData d;
+		while (std::getline(in, line))
+		{
+			if (line.empty()) { continue; }
+			CsvUtil::split(line.data(), line.size(), delimiter, items);
+			d.Clear();
+			for (size_t i = 0; i < items.size() && i < fields.size(); ++i)
+			{
+				if (fields[i] == nullptr || items[i].empty()) { continue; }
+				CsvUtil::setPBField(&d, fields[i], items[i]);
+			}
+			int day = d.has_tradingday() ? d.tradingday() : tradingday;
+			auto& w = writers[day];
+			if (!w) { w.reset(new MktColumnStoreWriter(MktColumnKind::Tick, exch, day)); }
+			w->addTick(d);
+			++n;
+		}
+		for (auto& kv : writers)
+		{
+			if (!kv.second->write(MktColumnStore::tickPath(root, exch, kv.first))) { return -1; }
+		}
+		return n;
+	}
+
+	/**
+	* @brief convert bars loaded as BarLists (TrdDBMgr::getBarListForInstrID, MongoDBMgr::get60sBarListForInstrID)
+	*
+	* @param barlists as bars per instrument id, each BarList covering one trading day
+	*
+	* @return false if the file cannot be written
+	*/
+	static bool convertBarLists(std::map<std::string, BarListPtr>& barlists, const std::string& root, const std::string& exch, int tradingday, int span)
+	{
+		MktColumnStoreWriter w(MktColumnKind::Bar, exch, tradingday, span);
+		for (auto& kv : barlists) { w.addBarList(kv.first, kv.second); }
+		return w.write(MktColumnStore::barPath(root, exch, tradingday, span));
+	}
+};//class MktColumnStoreConverter
+
+}//namespace XT
+
+#endif
@@ -45,7 +45,7 @@
 #include <SQLiteCpp/Column.h>
 #include <SQLiteCpp/Database.h>
 #include <SQLiteCpp/Statement.h>
-#include <SQLiteCpp/SQLiteException.h>
+#include <SQLiteCpp/Exception.h>
 
 
 namespace XT
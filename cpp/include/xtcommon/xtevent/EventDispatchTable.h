@@ -0,0 +1,230 @@
+#pragma once
+#ifndef XT_EVENT_DISPATCH_TABLE_H
+#define XT_EVENT_DISPATCH_TABLE_H
+
+/**
+* \file EventDispatchTable.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a lightweight event fan-out table keyed by iid.
+*
+* \description
+*	boost::signals2 locks a mutex, copies the slot list and checks tracked connections on
+*	every emit. EventDispatchTable keeps an immutable snapshot of subscribers: emit walks
+*	the subscribers of all iids plus those of the event iid and calls them, nothing else.
+*	Subscribing and unsubscribing build a new snapshot (copy on write).
+*
+*	emit() must be called from one thread at a time (the md thread for market data,
+*	the event thread for instrument events); a subscriber may emit again on that thread.
+*	subscribe/unsubscribe may be called from any thread, including from inside a subscriber.
+*/
+
+#include <cstdint>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+namespace XT
+{
+
+	//! Single emitter / copy on write subscriber table, the first event argument is the iid
+	template<typename... Args>
+	class EventDispatchTable
+	{
+	public:
+		typedef std::function<void(int, Args...)> Handler;
+
+		static const int kAllIids = -1; ///< subscribe to every iid
+
+		EventDispatchTable() : m_current(new Snapshot()), m_emitSeq(0), m_emitDepth(0), m_nextId(1) {}
+		EventDispatchTable(const EventDispatchTable&) = delete;
+		EventDispatchTable& operator=(const EventDispatchTable&) = delete;
+
+		~EventDispatchTable()
+		{
+			delete m_current.load();
+		}
+
+		//! Subscribe to events of one iid, or of every iid with kAllIids
+		/*!
+			\return subscription id for unsubscribe()
+		*/
+		uint64_t subscribe(const Handler& fn, int iid = kAllIids)
+		{
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			std::unique_ptr<Snapshot> next(new Snapshot(*m_current.load(std::memory_order_relaxed)));
+			uint64_t id = m_nextId++;
+			Slot s;
+			s.id = id;
+			s.fn = fn;
+			if (iid < 0)
+			{
+				next->all.push_back(s);
+			}
+			else
+			{
+				if ((size_t)iid >= next->byIid.size())
+				{
+					next->byIid.resize(iid + 1);
+				}
+				next->byIid[iid].push_back(s);
+			}
+			++next->count;
+			publishLocked(next.release());
+			return id;
+		}
+
+		//! Remove a subscription
+		/*!
+			\return false if the id is unknown
+		*/
+		bool unsubscribe(uint64_t id)
+		{
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			std::unique_ptr<Snapshot> next(new Snapshot(*m_current.load(std::memory_order_relaxed)));
+			bool found = eraseSlot(next->all, id);
+			for (size_t i = 0; i < next->byIid.size() && !found; ++i)
+			{
+				found = eraseSlot(next->byIid[i], id);
+			}
+			if (!found)
+			{
+				return false;
+			}
+			--next->count;
+			publishLocked(next.release());
+			return true;
+		}
+
+		//! Remove every subscription
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			publishLocked(new Snapshot());
+		}
+
+		//! Call the subscribers of iid (single emitter thread, re-entrant)
+		void emit(int iid, Args... args)
+		{
+			EmitScope scope(*this);
+			const Snapshot* snap = m_current.load(std::memory_order_acquire);
+			for (const Slot& s : snap->all)
+			{
+				s.fn(iid, args...);
+			}
+			if (iid >= 0 && (size_t)iid < snap->byIid.size())
+			{
+				for (const Slot& s : snap->byIid[iid])
+				{
+					s.fn(iid, args...);
+				}
+			}
+		}
+
+		//! Are there subscribers for iid?
+		bool hasSubscribers(int iid) const
+		{
+			const Snapshot* snap = m_current.load(std::memory_order_acquire);
+			return !snap->all.empty() || (iid >= 0 && (size_t)iid < snap->byIid.size() && !snap->byIid[iid].empty());
+		}
+
+		//! Number of subscriptions, one load of the snapshot
+		size_t size() const
+		{
+			return m_current.load(std::memory_order_acquire)->count;
+		}
+
+		//! No subscription at all? Lets a publisher skip emit(), and its fence, for an unused table
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+	protected:
+		struct Slot
+		{
+			uint64_t id;
+			Handler fn;
+		};
+
+		struct Snapshot
+		{
+			std::vector<Slot> all;
+			std::vector<std::vector<Slot> > byIid;
+			size_t count = 0; ///< slots in all and byIid
+		};
+
+		//! Keeps m_emitSeq odd from the outermost emit() to its end, nested emits share its seq
+		struct EmitScope
+		{
+			explicit EmitScope(EventDispatchTable& t) : table(t)
+			{
+				if (table.m_emitDepth++ == 0)
+				{
+					table.m_emitSeq.store(table.m_emitSeq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+				}
+			}
+
+			~EmitScope()
+			{
+				if (--table.m_emitDepth == 0)
+				{
+					table.m_emitSeq.store(table.m_emitSeq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+				}
+			}
+
+			EventDispatchTable& table;
+		};
+
+		static bool eraseSlot(std::vector<Slot>& v, uint64_t id)
+		{
+			auto it = std::find_if(v.begin(), v.end(), [id](const Slot& s) { return s.id == id; });
+			if (it == v.end())
+			{
+				return false;
+			}
+			v.erase(it);
+			return true;
+		}
+
+		//! Swap in a new snapshot and free old ones the emitter can no longer see
+		void publishLocked(Snapshot* next)
+		{
+			const Snapshot* old = m_current.load(std::memory_order_relaxed);
+			m_current.store(next, std::memory_order_release);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const uint64_t seq = m_emitSeq.load(std::memory_order_acquire);
+
+			// an odd seq means an emit is running and may still hold 'old'
+			m_retired.push_back(std::make_pair(std::unique_ptr<const Snapshot>(old), seq));
+			for (auto it = m_retired.begin(); it != m_retired.end();)
+			{
+				if ((it->second & 1) == 0 || it->second != seq)
+				{
+					it = m_retired.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+		}
+
+	protected:
+		std::atomic<const Snapshot*> m_current;
+		std::atomic<uint64_t> m_emitSeq; ///< odd while emit() runs
+		int m_emitDepth; ///< nesting of emit() on the emitter thread
+		std::mutex m_writeMutex;
+		std::list<std::pair<std::unique_ptr<const Snapshot>, uint64_t> > m_retired; ///< snapshot and emit seq when it was replaced
+		uint64_t m_nextId;
+	};
+
+}//namespace XT
+
+#endif
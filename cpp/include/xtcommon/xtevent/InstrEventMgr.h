@@ -34,6 +34,7 @@
 #include "typedef_XTData.pb.h"
 
 #include "InstrEventHandler.h"
+#include "EventDispatchTable.h"
 
 namespace XT
 {
@@ -92,8 +93,61 @@ public:
 	* @param flag
 	*/
 	void publish(int iid, int oid, int qid, int eventtype);
+
+	/**
+	* @brief dispatch table, a lighter alternative to signal() with optional per iid subscription
+	*
+	*	The signal is fed through a subscriber of the table, see setSignalDispatch; clear() on the
+	*	table drops it too.
+	*
+	* @return dispatch table
+	*/
+	EventDispatchTable<int, int, int>& dispatchTable() { return m_table; }
+
+	/**
+	* @brief feed signal() from publishAll, on by default. Turn it off for processes subscribed only
+	* through the table: publishAll then never touches the signals2 mutex.
+	*
+	*	Call it at setup, not concurrently with itself. Turned back on, the signal comes after the
+	*	table subscribers of every iid already there.
+	*
+	* @param b
+	*/
+	void setSignalDispatch(bool b)
+	{
+		if (b && m_signalBridgeId == 0)
+		{
+			m_signalBridgeId = m_table.subscribe([this](int iid, int oid, int qid, int eventtype) { publish(iid, oid, qid, eventtype); });
+		}
+		else if (!b && m_signalBridgeId != 0)
+		{
+			m_table.unsubscribe(m_signalBridgeId);
+			m_signalBridgeId = 0;
+		}
+	}
+
+	/**
+	* @brief publish event to the dispatch table subscribers, the signal among them unless turned off
+	*
+	*	Takes no lock: the subscriber count comes from the table snapshot.
+	*
+	* @param iid
+	* @param oid
+	* @param qid
+	* @param flag
+	*/
+	void publishAll(int iid, int oid, int qid, int eventtype)
+	{
+		if (!m_table.empty())
+		{
+			m_table.emit(iid, oid, qid, eventtype);
+		}
+	}
 protected:
 	std::shared_ptr< boost::signals2::signal<void(int,int,int,int)> > m_signal;
+	EventDispatchTable<int, int, int> m_table; ///< emitted from the publishing thread only
+	/// table subscriber emitting the signal, subscribed first so signal slots keep running before the table ones
+	uint64_t m_signalBridgeId = m_table.subscribe([this](int iid, int oid, int qid, int eventtype) { publish(iid, oid, qid, eventtype); });
 
 protected:
 	void onTimer(int inttime);
@@ -11,6 +11,10 @@
 *
 * \description
 *	This component provides a class for publishing market data events.
+*	The md gateways (SimMd::onMktQuoteData and the live md callbacks, built outside this
+*	header set) are expected to call publishMktEventAndShmQuote once a tick has been applied to
+*	its Instr; publishMktEvent and publishMktEventAll reach in-process subscribers only and
+*	leave the shared memory ring empty.
 */
 
 #include <cstdint>
@@ -33,10 +37,13 @@
 #include "XTData.pb.h"
 #include "typedef_XTData.pb.h"
 
+#include "GlobalMgr.h"
 #include "InstrMgr.h"
 
 #include "MktDataEventSubscriber.h"
 #include "MktDataEventPublisher.h"
+#include "MktDataShmRing.h"
+#include "EventDispatchTable.h"
 
 
 namespace XT
@@ -116,11 +123,169 @@ public:
 	*/
 	void publishOptMktEvent(int iid);
 
+	/**
+	* @brief dispatch table for mkt events, a lighter alternative to the publisher signals
+	*
+	*	The mkt publisher signal is fed through a subscriber of the table, see setSignalDispatch;
+	*	clear() on the table drops it too.
+	*
+	* @return dispatch table
+	*/
+	EventDispatchTable<>& mktDispatchTable() { return m_mktTable; }
+
+	/**
+	* @brief dispatch table for optmkt events, fed to the optmkt publisher signal as mktDispatchTable
+	*
+	* @return dispatch table
+	*/
+	EventDispatchTable<>& optMktDispatchTable() { return m_optMktTable; }
+
+	/**
+	* @brief publish mkt event to the dispatch table subscribers, the publisher signal among them
+	*
+	*	Takes no lock: the subscriber count comes from the table snapshot, and after
+	*	setSignalDispatch(false) a tick never reaches the signals2 mutex.
+	*
+	* @param integer id
+	*/
+	void publishMktEventAll(int iid)
+	{
+		if (!m_mktTable.empty())
+		{
+			m_mktTable.emit(iid);
+		}
+	}
+
+	/**
+	* @brief publish optmkt event to the dispatch table subscribers, the publisher signal among them
+	*
+	* @param integer id
+	*/
+	void publishOptMktEventAll(int iid)
+	{
+		if (!m_optMktTable.empty())
+		{
+			m_optMktTable.emit(iid);
+		}
+	}
+
+	/**
+	* @brief feed the publisher signals from the publish*All functions, on by default. Turn it off for
+	* processes subscribed only through the tables.
+	*
+	*	Call it at setup, not concurrently with itself. Turned back on, the signals come after the
+	*	table subscribers of every iid already there.
+	*
+	* @param b
+	*/
+	void setSignalDispatch(bool b)
+	{
+		if (b && m_mktBridgeId == 0)
+		{
+			m_mktBridgeId = m_mktTable.subscribe([this](int iid) { publishMktEvent(iid); });
+			m_optMktBridgeId = m_optMktTable.subscribe([this](int iid) { publishOptMktEvent(iid); });
+		}
+		else if (!b && m_mktBridgeId != 0)
+		{
+			m_mktTable.unsubscribe(m_mktBridgeId);
+			m_optMktTable.unsubscribe(m_optMktBridgeId);
+			m_mktBridgeId = 0;
+			m_optMktBridgeId = 0;
+		}
+	}
+
+	/**
+	* @brief set shared memory quote ring, nullptr disables shared memory publishing
+	*
+	* @param ring
+	*/
+	void setShmQuoteRing(const ShmMktQuoteRingPtr& ring)
+	{
+		m_shmQuoteRing = ring;
+		m_shmTradingDay = GlobalMgr::getInstance()->getTradingDay();
+	}
+
+	/**
+	* @brief get shared memory quote ring
+	*
+	* @return ring
+	*/
+	ShmMktQuoteRingPtr& shmQuoteRing() { return m_shmQuoteRing; }
+
+	/**
+	* @brief trading day stamped on the shared memory records, set from GlobalMgr by setShmQuoteRing
+	*
+	* @param tradingday
+	*/
+	void setShmQuoteTradingDay(int tradingday) { m_shmTradingDay = tradingday; }
+
+	/**
+	* @brief publish current quote of instrument into the shared memory ring
+	*
+	* @param integer id
+	* @param instr as instrument of iid, already at hand in the md callbacks
+	*/
+	void publishShmQuote(int iid, InstrPtr& instr)
+	{
+		if (!m_shmQuoteRing || !instr) { return; }
+		ShmMktQuote q;
+		ShmMktQuoteUtil::fromInstr(iid, instr, q, m_shmTradingDay);
+		m_shmQuoteRing->Publish(q);
+	}
+
+	/**
+	* @brief publish current quote of instrument into the shared memory ring, looked up without locking
+	*
+	* @param integer id
+	*/
+	void publishShmQuote(int iid)
+	{
+		if (!m_shmQuoteRing) { return; }
+		InstrPtr instr = InstrMgr::getInstance()->findInstrByIid(iid);
+		publishShmQuote(iid, instr);
+	}
+
+	/**
+	* @brief publish mkt event to in-process subscribers and the shared memory ring
+	*
+	*	Entry point of the md thread for every tick, called by the md gateway right after the
+	*	tick was applied to instr, in place of publishMktEvent(iid).
+	*
+	* @param integer id
+	* @param instr as instrument of iid
+	*/
+	void publishMktEventAndShmQuote(int iid, InstrPtr& instr)
+	{
+		publishMktEventAll(iid);
+		publishShmQuote(iid, instr);
+	}
+
+	/**
+	* @brief publish mkt event to in-process subscribers and the shared memory ring,
+	* for md callbacks that do not hold the Instr of iid
+	*
+	* @param integer id
+	*/
+	void publishMktEventAndShmQuote(int iid)
+	{
+		publishMktEventAll(iid);
+		publishShmQuote(iid);
+	}
+
 protected:
 	std::shared_ptr< MktDataEventPublisher > m_mktPub;
 	std::shared_ptr< MktDataEventPublisher > m_optMktPub;
 
 	std::unordered_map<std::string, std::shared_ptr< MktDataEventPublisher > > m_pubMap;
+
+	ShmMktQuoteRingPtr m_shmQuoteRing; ///< single writer, publish from the md thread only
+	int m_shmTradingDay = 0;
+
+	EventDispatchTable<> m_mktTable; ///< mkt event subscribers, emitted from the md thread only
+	EventDispatchTable<> m_optMktTable; ///< optmkt event subscribers, emitted from the md thread only
+	/// table subscribers emitting the publisher signals, subscribed first so signal slots keep running before the table ones
+	uint64_t m_mktBridgeId = m_mktTable.subscribe([this](int iid) { publishMktEvent(iid); });
+	uint64_t m_optMktBridgeId = m_optMktTable.subscribe([this](int iid) { publishOptMktEvent(iid); });
  
 
 };
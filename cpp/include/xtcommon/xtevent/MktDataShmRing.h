@@ -0,0 +1,124 @@
+#pragma once
+#ifndef XT_MKT_DATA_SHM_RING_H
+#define XT_MKT_DATA_SHM_RING_H
+
+/**
+* \file MktDataShmRing.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a fixed size market quote record and its shared memory broadcast ring.
+*
+* \description
+*	ShmMktQuote is the POD image of a MktQuoteData keyed by iid. It is published by
+*	MktDataEventPubMgr into a SharedBroadcastRing so that strategy processes on the same
+*	box receive ticks without going through ZMQ/NNG sockets.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <memory>
+
+#include "XTConfig.h"
+#include "XTEnum.pb.h"
+#include "XTData.pb.h"
+#include "typedef_XTData.pb.h"
+
+#include "XTSharedBroadcastRing.h"
+#include "Instr.h"
+
+namespace XT
+{
+
+	/**
+	* fixed size market quote record, 256 bytes including the ring sequence word
+	*/
+	struct ShmMktQuote
+	{
+		static const int kLevels = 5;
+
+		int32_t iid;
+		int32_t tradingday;
+		int64_t exchts;
+		int64_t recvts;
+		int64_t lastts;
+		double lastpx;
+		int64_t totvolume;
+		double totamount;
+		int64_t totoi;
+		double bidpx[kLevels];
+		double askpx[kLevels];
+		int64_t bidsz[kLevels];
+		int64_t asksz[kLevels];
+		char _pad[24];
+	};
+	static_assert(sizeof(ShmMktQuote) + sizeof(uint64_t) == 256, "ShmMktQuote slot must stay 256 bytes");
+
+	typedef SharedBroadcastRing<ShmMktQuote> ShmMktQuoteRing;
+	typedef std::shared_ptr<ShmMktQuoteRing> ShmMktQuoteRingPtr;
+	typedef SharedBroadcastRingReader<ShmMktQuote> ShmMktQuoteReader;
+	typedef std::shared_ptr<ShmMktQuoteReader> ShmMktQuoteReaderPtr;
+
+	class ShmMktQuoteUtil
+	{
+	public:
+		/**
+		* @brief fill record from a MktQuoteData
+		*
+		* @param iid
+		* @param mktdata
+		* @param q output record
+		*/
+		static void fromMktQuoteData(int iid, const MktQuoteData& mktdata, ShmMktQuote& q)
+		{
+			memset(&q, 0, sizeof(q));
+			q.iid = iid;
+			q.tradingday = mktdata.tradingday();
+			q.exchts = mktdata.exchts();
+			q.recvts = mktdata.recvts();
+			q.lastts = mktdata.lastts();
+			q.lastpx = mktdata.lastpx();
+			q.totvolume = mktdata.totvolume();
+			q.totamount = mktdata.totamount();
+			q.totoi = mktdata.totoi();
+			q.bidpx[0] = mktdata.bidpx0(); q.askpx[0] = mktdata.askpx0(); q.bidsz[0] = mktdata.bidsz0(); q.asksz[0] = mktdata.asksz0();
+			q.bidpx[1] = mktdata.bidpx1(); q.askpx[1] = mktdata.askpx1(); q.bidsz[1] = mktdata.bidsz1(); q.asksz[1] = mktdata.asksz1();
+			q.bidpx[2] = mktdata.bidpx2(); q.askpx[2] = mktdata.askpx2(); q.bidsz[2] = mktdata.bidsz2(); q.asksz[2] = mktdata.asksz2();
+			q.bidpx[3] = mktdata.bidpx3(); q.askpx[3] = mktdata.askpx3(); q.bidsz[3] = mktdata.bidsz3(); q.asksz[3] = mktdata.asksz3();
+			q.bidpx[4] = mktdata.bidpx4(); q.askpx[4] = mktdata.askpx4(); q.bidsz[4] = mktdata.bidsz4(); q.asksz[4] = mktdata.asksz4();
+		}
+
+		/**
+		* @brief fill record from the current market state of an instrument
+		*
+		* @param iid
+		* @param instr
+		* @param q output record
+		* @param tradingday as trading day of the quote, Instr does not keep it
+		*/
+		static void fromInstr(int iid, InstrPtr& instr, ShmMktQuote& q, int tradingday)
+		{
+			memset(&q, 0, sizeof(q));
+			q.iid = iid;
+			q.tradingday = tradingday;
+			q.exchts = instr->getMktTs();
+			q.recvts = instr->getMktRcvTs();
+			q.lastts = instr->getMktLastTrdTs();
+			q.lastpx = instr->getMktLastTrdPx();
+			q.totvolume = instr->getMktTotVolume();
+			q.totamount = instr->getMktTotAmount();
+			q.totoi = instr->getMktTotOI();
+			for (int i = 0; i < ShmMktQuote::kLevels; ++i)
+			{
+				q.bidpx[i] = instr->getMktLevelPx(BuySellType::Buy, i);
+				q.askpx[i] = instr->getMktLevelPx(BuySellType::Sell, i);
+				q.bidsz[i] = instr->getMktLevelSz(BuySellType::Buy, i);
+				q.asksz[i] = instr->getMktLevelSz(BuySellType::Sell, i);
+			}
+		}
+	};
+
+}//namespace XT
+
+#endif
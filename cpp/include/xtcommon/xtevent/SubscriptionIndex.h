@@ -0,0 +1,240 @@
+#pragma once
+#ifndef XT_SUBSCRIPTION_INDEX_H
+#define XT_SUBSCRIPTION_INDEX_H
+
+/**
+* \file SubscriptionIndex.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide an iid to subscriber bitmap index.
+*
+* \description
+*	Strategies select their instruments with prefixes, exchanges and products, and used to
+*	re-check them with string compares on every InstrEventInfo. The index evaluates the
+*	selection once per (subscriber, instrument) and keeps one bitmap of subscribers per iid,
+*	so an event only reaches the subscribers whose bit is set.
+*
+*	Lookups read an immutable snapshot through an atomic raw pointer while the thread is pinned
+*	with XT::Epoch; adding subscribers or instruments publishes a new one and retires the old
+*	one, which is freed once the readers pinned before the swap are done.
+*/
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "XTConfig.h"
+#include "Instr.h"
+#include "XTEpoch.h"
+
+namespace XT
+{
+
+	/** index of the lowest set bit, bits must not be 0 */
+	inline size_t subscriptionLowestBit(uint64_t bits)
+	{
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanForward64(&idx, bits);
+		return (size_t)idx;
+#else
+		return (size_t)__builtin_ctzll(bits);
+#endif
+	}
+
+	/**
+	* Immutable iid -> subscriber bitmap, T is the subscriber handle (e.g. StratPtr)
+	*/
+	template<typename T>
+	class SubscriptionSnapshot
+	{
+	public:
+		SubscriptionSnapshot() : m_nSubscribers(0), m_words(1) {}
+
+		size_t subscriberCount() const { return m_nSubscribers; }
+
+		const T& subscriber(size_t slot) const { return m_subscribers[slot]; }
+
+		/** is iid indexed, unknown iids need SubscriptionIndex::addInstr first */
+		bool hasIid(int iid) const { return iid >= 0 && (size_t)iid < m_indexed.size() && m_indexed[iid] != 0; }
+
+		bool isSubscribed(int iid, size_t slot) const
+		{
+			if (!hasIid(iid) || slot >= m_nSubscribers) { return false; }
+			return (m_bits[(size_t)iid * m_words + slot / 64] >> (slot % 64)) & 1;
+		}
+
+		/**
+		* @brief call fn(subscriber) for every subscriber of iid
+		*/
+		template<typename F>
+		void forEachSubscriber(int iid, F&& fn) const
+		{
+			if (!hasIid(iid)) { return; }
+			const uint64_t* w = &m_bits[(size_t)iid * m_words];
+			for (size_t k = 0; k < m_words; ++k)
+			{
+				uint64_t bits = w[k];
+				while (bits != 0)
+				{
+					size_t slot = k * 64 + subscriptionLowestBit(bits);
+					fn(m_subscribers[slot]);
+					bits &= bits - 1;
+				}
+			}
+		}
+
+		/**
+		* @brief call fn(subscriber) for every subscriber, for events that are not about one instrument
+		*/
+		template<typename F>
+		void forEach(F&& fn) const
+		{
+			for (const T& t : m_subscribers)
+			{
+				fn(t);
+			}
+		}
+
+	protected:
+		template<typename U> friend class SubscriptionIndex;
+
+		std::vector<T> m_subscribers; ///< by slot
+		size_t m_nSubscribers;
+		size_t m_words; ///< 64 bit words per iid
+		std::vector<uint64_t> m_bits; ///< iid major
+		std::vector<uint8_t> m_indexed; ///< 1 if the iid has been evaluated
+	};
+
+	/**
+	* Builds and publishes SubscriptionSnapshot versions. Readers on any thread, writers serialized.
+	* Read through a Reader, which pins the thread so the snapshot it loaded cannot be freed.
+	*/
+	template<typename T>
+	class SubscriptionIndex
+	{
+	public:
+		typedef SubscriptionSnapshot<T> Snapshot;
+		typedef std::function<bool(const InstrPtr&)> Matcher;
+
+		/**
+		* Pinned view of the current snapshot, valid until the Reader is destroyed. One per event on
+		* the routing thread: pinning is a store and a fence, no lock and no reference count.
+		*/
+		class Reader
+		{
+		public:
+			explicit Reader(const SubscriptionIndex& index) : m_index(index), m_snap(index.m_current.load(std::memory_order_acquire)) {}
+
+			Reader(const Reader&) = delete;
+			Reader& operator=(const Reader&) = delete;
+
+			/** load the current snapshot again, e.g. after addInstr from the reading thread */
+			void reload() { m_snap = m_index.m_current.load(std::memory_order_acquire); }
+
+			const Snapshot& operator*() const { return *m_snap; }
+			const Snapshot* operator->() const { return m_snap; }
+
+		private:
+			Epoch::Guard m_pin; ///< declared first, pinned before the load
+			const SubscriptionIndex& m_index;
+			const Snapshot* m_snap;
+		};
+
+		SubscriptionIndex() : m_current(new Snapshot()) {}
+
+		SubscriptionIndex(const SubscriptionIndex&) = delete;
+		SubscriptionIndex& operator=(const SubscriptionIndex&) = delete;
+
+		~SubscriptionIndex() { delete m_current.load(std::memory_order_relaxed); }
+
+		/**
+		* @brief rebuild the index for the given subscribers over the given instruments
+		*
+		* @param subscribers as subscriber handles, slot = position
+		* @param matchers as one instrument selector per subscriber
+		* @param instrs as all known instruments
+		*/
+		void build(const std::vector<T>& subscribers, const std::vector<Matcher>& matchers, const std::vector<InstrPtr>& instrs)
+		{
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			m_matchers = matchers;
+			m_matchers.resize(subscribers.size());
+			std::unique_ptr<Snapshot> snap(new Snapshot());
+			snap->m_subscribers = subscribers;
+			snap->m_nSubscribers = subscribers.size();
+			snap->m_words = (m_matchers.size() + 63) / 64;
+			if (snap->m_words == 0) { snap->m_words = 1; }
+			for (const InstrPtr& instr : instrs)
+			{
+				indexInstr(*snap, instr);
+			}
+			publishLocked(snap.release());
+		}
+
+		/**
+		* @brief index instruments added at runtime
+		*/
+		void addInstrs(const std::vector<InstrPtr>& instrs)
+		{
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			std::unique_ptr<Snapshot> snap(new Snapshot(*m_current.load(std::memory_order_relaxed)));
+			for (const InstrPtr& instr : instrs)
+			{
+				indexInstr(*snap, instr);
+			}
+			publishLocked(snap.release());
+		}
+
+		void addInstr(const InstrPtr& instr)
+		{
+			std::vector<InstrPtr> v(1, instr);
+			addInstrs(v);
+		}
+
+	protected:
+		void publishLocked(const Snapshot* next)
+		{
+			const Snapshot* old = m_current.load(std::memory_order_relaxed);
+			m_current.store(next, std::memory_order_release);
+			Epoch::Retire(old);
+		}
+
+		void indexInstr(Snapshot& snap, const InstrPtr& instr)
+		{
+			if (instr == nullptr) { return; }
+			int iid = instr->getIid();
+			if (iid < 0) { return; }
+			if ((size_t)iid >= snap.m_indexed.size())
+			{
+				snap.m_indexed.resize(iid + 1, 0);
+				snap.m_bits.resize((size_t)(iid + 1) * snap.m_words, 0);
+			}
+			uint64_t* w = &snap.m_bits[(size_t)iid * snap.m_words];
+			for (size_t k = 0; k < snap.m_words; ++k) { w[k] = 0; }
+			for (size_t slot = 0; slot < m_matchers.size(); ++slot)
+			{
+				if (m_matchers[slot] && m_matchers[slot](instr))
+				{
+					w[slot / 64] |= (uint64_t)1 << (slot % 64);
+				}
+			}
+			snap.m_indexed[iid] = 1;
+		}
+
+	protected:
+		std::atomic<const Snapshot*> m_current; ///< replaced under m_writeMutex, the old one goes to Epoch::Retire
+		std::mutex m_writeMutex;
+		std::vector<Matcher> m_matchers;
+	};
+
+}//namespace XT
+
+#endif
@@ -0,0 +1,766 @@
+#pragma once
+#ifndef XT_BAR_CACHE_H
+#define XT_BAR_CACHE_H
+
+/**
+* \file BarCache.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a process wide cache of bars loaded from the databases.
+*
+* \description
+*	BarMgr::getBarListForInstr and getBarListForInstrWithLimit read the whole requested
+*	range from sqlite or mongodb on every call. BarCache keeps the loaded bars per
+*	(instrument, span) together with the time ranges known to be complete, and only
+*	queries the parts of a request that are not covered yet. Each entry publishes an
+*	immutable snapshot through an atomic pointer: a request inside covered ranges is served
+*	pinned with XT::Epoch, with one acquire load and no lock or reference count. Loads are
+*	serialized per entry and publish a merged copy; the replaced snapshot is retired to the
+*	Epoch. The (instrument, span) -> entry map is published and retired the same way.
+*	Entries beyond the memory budget are dropped in least recently used order. prefetch
+*	loads configured instruments at startup, optionally on a background thread.
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <limits>
+#include <sstream>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include "XTConfig.h"
+#include "Bar.h"
+#include "InstrMgr.h"
+#include "SettingsMgr.h"
+#include "BarMgr.h"
+#include "XTEpoch.h"
+#include "log4z.h"
+
+namespace XT
+{
+
+/**
+* immutable bars of one (instrument, span), sorted by begin timestamp
+*/
+struct BarCacheSnapshot
+{
+	typedef std::pair<int64_t, int64_t> Range;
+
+	std::vector<int64_t> ts;
+	std::vector<BarPtr> bars;
+	std::vector<Range> covered;	///< sorted, disjoint, closed ranges of complete begin timestamps
+	RollingType::enumtype rollingType = RollingType::Time;
+	DateTimeType::enumtype dtType = DateTimeType::UTS;
+	bool hasTypes = false;
+	size_t bytes = 0;
+
+	/**
+	* @brief if all bars beginning in [a, b] are cached
+	*/
+	bool covers(int64_t a, int64_t b) const
+	{
+		auto it = std::upper_bound(covered.begin(), covered.end(), Range(a, std::numeric_limits<int64_t>::max()));
+		if (it == covered.begin()) { return false; }
+		--it;
+		return it->first <= a && it->second >= b;
+	}
+
+	/**
+	* @brief parts of [a, b] not covered
+	*/
+	void gaps(int64_t a, int64_t b, std::vector<Range>& out) const
+	{
+		out.clear();
+		int64_t cur = a;
+		for (const Range& r : covered)
+		{
+			if (r.second < cur) { continue; }
+			if (r.first > b) { break; }
+			if (r.first > cur) { out.push_back(Range(cur, r.first - 1)); }
+			if (r.second >= b) { return; }
+			cur = r.second + 1;
+		}
+		out.push_back(Range(cur, b));
+	}
+
+	/**
+	* @brief mark [a, b] as complete
+	*/
+	void cover(int64_t a, int64_t b)
+	{
+		if (a > b) { return; }
+		std::vector<Range> merged;
+		merged.reserve(covered.size() + 1);
+		for (const Range& r : covered)
+		{
+			// adjacent ranges are merged too
+			bool before = r.second != std::numeric_limits<int64_t>::max() && r.second + 1 < a;
+			bool after = r.first != std::numeric_limits<int64_t>::min() && r.first - 1 > b;
+			if (before || after) { merged.push_back(r); continue; }
+			a = std::min(a, r.first);
+			b = std::max(b, r.second);
+		}
+		merged.push_back(Range(a, b));
+		std::sort(merged.begin(), merged.end());
+		covered.swap(merged);
+	}
+
+	/**
+	* @brief index range of the bars beginning in [a, b]
+	*/
+	std::pair<size_t, size_t> findRange(int64_t a, int64_t b) const
+	{
+		size_t i0 = std::lower_bound(ts.begin(), ts.end(), a) - ts.begin();
+		size_t i1 = std::upper_bound(ts.begin(), ts.end(), b) - ts.begin();
+		return std::make_pair(i0, std::max(i0, i1));
+	}
+
+	/**
+	* @brief merge bars, a loaded bar replaces the cached bar with the same begin timestamp
+	*/
+	void merge(std::vector<std::pair<int64_t, BarPtr> >& loaded)
+	{
+		if (loaded.empty()) { return; }
+		std::sort(loaded.begin(), loaded.end(), [](const std::pair<int64_t, BarPtr>& x, const std::pair<int64_t, BarPtr>& y) { return x.first < y.first; });
+		std::vector<int64_t> nts;
+		std::vector<BarPtr> nbars;
+		nts.reserve(ts.size() + loaded.size());
+		nbars.reserve(ts.size() + loaded.size());
+		size_t i = 0, j = 0;
+		while (i < ts.size() || j < loaded.size())
+		{
+			if (j == loaded.size() || (i < ts.size() && ts[i] < loaded[j].first))
+			{
+				nts.push_back(ts[i]);
+				nbars.push_back(bars[i]);
+				++i;
+				continue;
+			}
+			if (i < ts.size() && ts[i] == loaded[j].first) { ++i; }
+			if (nts.empty() || nts.back() != loaded[j].first)
+			{
+				nts.push_back(loaded[j].first);
+				nbars.push_back(loaded[j].second);
+			}
+			else { nbars.back() = loaded[j].second; }
+			++j;
+		}
+		ts.swap(nts);
+		bars.swap(nbars);
+		bytes = ts.size() * bytesPerBar() + covered.size() * sizeof(Range);
+	}
+
+	static size_t bytesPerBar()
+	{
+		// bar object, shared pointer control block, pointer and timestamp
+		return sizeof(Bar) + 2 * sizeof(void*) + sizeof(BarPtr) + sizeof(int64_t);
+	}
+};
+
+/**
+* bars of one (instrument, span)
+*/
+struct BarCacheEntry
+{
+	/**
+	* pinned view of the current snapshot, valid until destroyed; bars copied out of it stay valid after
+	*/
+	class Reader
+	{
+	public:
+		explicit Reader(const BarCacheEntry& e) : m_snap(e.current.load(std::memory_order_acquire)) {}
+
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+
+		const BarCacheSnapshot& operator*() const { return *m_snap; }
+		const BarCacheSnapshot* operator->() const { return m_snap; }
+
+	private:
+		Epoch::Guard m_pin; ///< before m_snap, so the thread is pinned when current is loaded
+		const BarCacheSnapshot* m_snap;
+	};
+
+	std::string instrid;
+	int span = 0;
+	std::atomic<const BarCacheSnapshot*> current; ///< owned; BarCache::publish swaps it holding loadMutex, so a loadMutex holder may read it unpinned
+	std::atomic<uint64_t> lastUse;
+	std::mutex loadMutex;
+
+	BarCacheEntry() : current(new BarCacheSnapshot()), lastUse(0) {}
+
+	BarCacheEntry(const BarCacheEntry&) = delete;
+	BarCacheEntry& operator=(const BarCacheEntry&) = delete;
+
+	~BarCacheEntry() { delete current.load(std::memory_order_relaxed); }
+};
+
+/**
+* counters of a BarCache
+*/
+struct BarCacheStats
+{
+	uint64_t hits = 0;			///< requests served without a query
+	uint64_t misses = 0;		///< requests with at least one query
+	uint64_t queries = 0;		///< loader calls
+	uint64_t loadedBars = 0;	///< bars returned by the loader
+	uint64_t evictions = 0;		///< entries dropped for the memory budget
+	uint64_t bytes = 0;			///< estimated bytes of the cached bars
+	uint64_t budget = 0;		///< memory budget, 0 for unlimited
+	uint64_t entries = 0;		///< (instrument, span) entries
+};
+
+/**
+* Process wide cache of bars per (instrument, span). Any number of reader threads.
+*
+* The loaders must return the bars beginning in [startdt, enddt], or the latest numlimit
+* bars beginning at or before enddt; a null BarListPtr is a failed query and marks nothing
+* as covered. Bars are shared with the returned BarLists and must not be changed.
+*/
+class BarCache
+{
+public:
+	typedef std::function<BarListPtr(InstrPtr& instr, int64_t startdt, int64_t enddt, int spanseconds)> RangeLoader;
+	typedef std::function<BarListPtr(InstrPtr& instr, int64_t enddt, int numlimit, int spanseconds)> LimitLoader;
+	typedef std::function<int64_t(int spanseconds)> CoverLimit;
+
+	/**
+	* @name Constructors and Destructors
+	*/
+	///@{
+	BarCache() : m_entries(new EntryMap()), m_budget(0), m_bytes(0), m_tick(0),
+		m_hits(0), m_misses(0), m_queries(0), m_loadedBars(0), m_evictions(0)
+	{
+		m_rangeLoader = [](InstrPtr& instr, int64_t startdt, int64_t enddt, int spanseconds)
+		{
+			return BarMgr::getInstance()->getBarListForInstr(instr, startdt, enddt, spanseconds);
+		};
+		m_limitLoader = [](InstrPtr& instr, int64_t enddt, int numlimit, int spanseconds)
+		{
+			return BarMgr::getInstance()->getBarListForInstrWithLimit(instr, enddt, numlimit, spanseconds);
+		};
+	}
+
+	BarCache(const BarCache&) = delete;
+	BarCache& operator=(const BarCache&) = delete;
+
+	virtual ~BarCache()
+	{
+		joinPrefetch();
+		delete m_entries.load(std::memory_order_relaxed);
+	}
+
+	/**
+	* @brief get singleton instance
+	*
+	* @return singleton instance
+	*/
+	static BarCache* getInstance()
+	{
+		static BarCache instance;
+		return &instance;
+	}
+	///@}
+
+public:
+	/**
+	* @name Settings
+	*/
+	///@{
+	/**
+	* @brief set the range loader, BarMgr::getBarListForInstr by default
+	*/
+	void setRangeLoader(const RangeLoader& loader)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_rangeLoader = loader;
+	}
+
+	/**
+	* @brief set the number limited loader, BarMgr::getBarListForInstrWithLimit by default
+	*/
+	void setLimitLoader(const LimitLoader& loader)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_limitLoader = loader;
+	}
+
+	/**
+	* @brief set the latest begin timestamp that may be marked complete for a span
+	*
+	* Bars of the current session are still being written, so ranges after the limit
+	* are returned but queried again on the next request. No limit by default.
+	*/
+	void setCoverLimit(const CoverLimit& limit)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_coverLimit = limit;
+	}
+
+	/**
+	* @brief set the memory budget in bytes, 0 for unlimited
+	*/
+	void setMemoryBudget(size_t bytes)
+	{
+		m_budget.store(bytes, std::memory_order_relaxed);
+		evictIfNeeded(nullptr);
+	}
+	///@}
+
+public:
+	/**
+	* @name Bars
+	*/
+	///@{
+	/**
+	* @brief get the bars beginning in [startdt, enddt], querying only the missing ranges
+	*
+	* @param instr as instrument
+	* @param startdt as start timestamp
+	* @param enddt as end timestamp
+	* @param spanseconds as bar seconds
+	*
+	* @return barlist
+	*/
+	BarListPtr getBarList(InstrPtr& instr, int64_t startdt, int64_t enddt, int spanseconds)
+	{
+		BarCacheEntry* e = getEntry(instr->getInstrID(), spanseconds);
+		touch(e);
+		{
+			BarCacheEntry::Reader r(*e);
+			if (r->covers(startdt, enddt))
+			{
+				m_hits.fetch_add(1, std::memory_order_relaxed);
+				return makeBarList(*r, startdt, enddt, spanseconds);
+			}
+		}
+
+		BarListPtr bl;
+		{
+			std::lock_guard<std::mutex> lock(e->loadMutex);
+			const BarCacheSnapshot* s = e->current.load(std::memory_order_relaxed);
+			if (s->covers(startdt, enddt)) { m_hits.fetch_add(1, std::memory_order_relaxed); }
+			else
+			{
+				std::vector<BarCacheSnapshot::Range> gaps;
+				s->gaps(startdt, enddt, gaps);
+				m_misses.fetch_add(1, std::memory_order_relaxed);
+				RangeLoader loader;
+				int64_t limit = getLoaderAndCoverLimit(spanseconds, loader);
+				std::unique_ptr<BarCacheSnapshot> ns(new BarCacheSnapshot(*s));
+				for (const BarCacheSnapshot::Range& g : gaps)
+				{
+					m_queries.fetch_add(1, std::memory_order_relaxed);
+					BarListPtr loaded = loader(instr, g.first, g.second, spanseconds);
+					if (loaded == nullptr) { continue; }
+					addLoaded(*ns, loaded, g.first, g.second);
+					ns->cover(g.first, std::min(g.second, limit));
+				}
+				s = ns.get();
+				publish(e, ns.release());
+			}
+			bl = makeBarList(*s, startdt, enddt, spanseconds);
+		}
+		evictIfNeeded(e);
+		return bl;
+	}
+
+	/**
+	* @brief get the latest numlimit bars beginning at or before enddt
+	*
+	* @param instr as instrument
+	* @param enddt as end timestamp
+	* @param numlimit as maximum number of bars
+	* @param spanseconds as bar seconds
+	*
+	* @return barlist
+	*/
+	BarListPtr getBarListWithLimit(InstrPtr& instr, int64_t enddt, int numlimit, int spanseconds)
+	{
+		BarCacheEntry* e = getEntry(instr->getInstrID(), spanseconds);
+		touch(e);
+		BarListPtr bl = makeLimitBarList(*BarCacheEntry::Reader(*e), enddt, numlimit, spanseconds);
+		if (bl != nullptr)
+		{
+			m_hits.fetch_add(1, std::memory_order_relaxed);
+			return bl;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(e->loadMutex);
+			const BarCacheSnapshot* s = e->current.load(std::memory_order_relaxed);
+			bl = makeLimitBarList(*s, enddt, numlimit, spanseconds);
+			if (bl != nullptr)
+			{
+				m_hits.fetch_add(1, std::memory_order_relaxed);
+				return bl;
+			}
+			m_misses.fetch_add(1, std::memory_order_relaxed);
+			LimitLoader loader;
+			int64_t limit = getLoaderAndCoverLimit(spanseconds, loader);
+			m_queries.fetch_add(1, std::memory_order_relaxed);
+			BarListPtr loaded = loader(instr, enddt, numlimit, spanseconds);
+			if (loaded != nullptr)
+			{
+				std::unique_ptr<BarCacheSnapshot> ns(new BarCacheSnapshot(*s));
+				int64_t first = std::numeric_limits<int64_t>::min();
+				int n = addLoaded(*ns, loaded, std::numeric_limits<int64_t>::min(), enddt, &first);
+				// fewer bars than asked for means there are no earlier bars
+				if (n < numlimit) { first = std::numeric_limits<int64_t>::min(); }
+				ns->cover(first, std::min(enddt, limit));
+				s = ns.get();
+				publish(e, ns.release());
+			}
+			bl = makeLimitBarList(*s, enddt, numlimit, spanseconds, true);
+		}
+		evictIfNeeded(e);
+		return bl;
+	}
+
+	/**
+	* @brief load bars of instruments, e.g. the configured ones at startup
+	*
+	* @param instrids as instrument ids
+	* @param startdt as start timestamp
+	* @param enddt as end timestamp
+	* @param spanseconds as bar seconds
+	* @param async as if loading on a background thread
+	*/
+	void prefetch(const std::vector<std::string>& instrids, int64_t startdt, int64_t enddt, int spanseconds, bool async = false)
+	{
+		if (!async)
+		{
+			prefetchNow(instrids, startdt, enddt, spanseconds);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_prefetchThreads.push_back(std::thread([this, instrids, startdt, enddt, spanseconds]()
+		{
+			prefetchNow(instrids, startdt, enddt, spanseconds);
+		}));
+	}
+
+	/**
+	* @brief load the 60 seconds bars of the bar60s instruments in the settings
+	*/
+	void prefetchConfigured(int64_t startdt, int64_t enddt, bool async = false)
+	{
+		prefetch(SettingsMgr::getInstance()->getBar60sInstrIDs(), startdt, enddt, 60, async);
+	}
+
+	/**
+	* @brief wait for background prefetches
+	*/
+	void joinPrefetch()
+	{
+		std::vector<std::thread> threads;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			threads.swap(m_prefetchThreads);
+		}
+		for (std::thread& t : threads) { if (t.joinable()) { t.join(); } }
+	}
+
+	/**
+	* @brief drop the bars of an (instrument, span)
+	*/
+	void invalidate(const std::string& instrid, int spanseconds)
+	{
+		BarCacheEntry* e = findEntry(makeKey(instrid, spanseconds));
+		if (e == nullptr) { return; }
+		std::lock_guard<std::mutex> lock(e->loadMutex);
+		publish(e, new BarCacheSnapshot());
+	}
+
+	/**
+	* @brief drop all bars
+	*/
+	void clear()
+	{
+		// entries are never freed, only the map is, so they are locked unpinned
+		std::vector<BarCacheEntry*> entries;
+		{
+			MapReader map(*this);
+			entries.reserve(map->size());
+			for (auto& kv : *map) { entries.push_back(kv.second); }
+		}
+		for (BarCacheEntry* e : entries)
+		{
+			std::lock_guard<std::mutex> lock(e->loadMutex);
+			publish(e, new BarCacheSnapshot());
+		}
+	}
+	///@}
+
+public:
+	/**
+	* @name Stats
+	*/
+	///@{
+	BarCacheStats getStats() const
+	{
+		BarCacheStats s;
+		s.hits = m_hits.load(std::memory_order_relaxed);
+		s.misses = m_misses.load(std::memory_order_relaxed);
+		s.queries = m_queries.load(std::memory_order_relaxed);
+		s.loadedBars = m_loadedBars.load(std::memory_order_relaxed);
+		s.evictions = m_evictions.load(std::memory_order_relaxed);
+		s.bytes = m_bytes.load(std::memory_order_relaxed);
+		s.budget = m_budget.load(std::memory_order_relaxed);
+		s.entries = MapReader(*this)->size();
+		return s;
+	}
+
+	std::string statsStr() const
+	{
+		BarCacheStats s = getStats();
+		std::ostringstream os;
+		os << "hits=" << s.hits << " misses=" << s.misses << " queries=" << s.queries
+			<< " loadedbars=" << s.loadedBars << " evictions=" << s.evictions
+			<< " bytes=" << s.bytes << " budget=" << s.budget << " entries=" << s.entries;
+		return os.str();
+	}
+	///@}
+
+private:
+	typedef std::unordered_map<std::string, BarCacheEntry*> EntryMap;
+
+	/**
+	* pinned view of the entry map; the entries it points to outlive it
+	*/
+	class MapReader
+	{
+	public:
+		explicit MapReader(const BarCache& cache) : m_map(cache.m_entries.load(std::memory_order_acquire)) {}
+
+		MapReader(const MapReader&) = delete;
+		MapReader& operator=(const MapReader&) = delete;
+
+		const EntryMap& operator*() const { return *m_map; }
+		const EntryMap* operator->() const { return m_map; }
+
+	private:
+		Epoch::Guard m_pin; ///< pins the thread ahead of the load of m_entries
+		const EntryMap* m_map;
+	};
+
+	static std::string makeKey(const std::string& instrid, int spanseconds)
+	{
+		return instrid + "|" + std::to_string(spanseconds);
+	}
+
+	/**
+	* @brief entry of an (instrument, span), created on first use
+	*/
+	BarCacheEntry* getEntry(const std::string& instrid, int spanseconds)
+	{
+		std::string key = makeKey(instrid, spanseconds);
+		BarCacheEntry* found = findEntry(key);
+		if (found != nullptr) { return found; }
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const EntryMap* map = m_entries.load(std::memory_order_relaxed);
+		auto it = map->find(key);
+		if (it != map->end()) { return it->second; }
+		std::unique_ptr<BarCacheEntry> e(new BarCacheEntry());
+		e->instrid = instrid;
+		e->span = spanseconds;
+		BarCacheEntry* ret = e.get();
+		m_entryStore.push_back(std::move(e));
+		EntryMap* nmap = new EntryMap(*map);
+		(*nmap)[key] = ret;
+		m_entries.store(nmap, std::memory_order_release);
+		Epoch::Retire(map);
+		return ret;
+	}
+
+	/**
+	* @brief entry of a key if created already, null otherwise
+	*/
+	BarCacheEntry* findEntry(const std::string& key) const
+	{
+		MapReader map(*this);
+		auto it = map->find(key);
+		return it != map->end() ? it->second : nullptr;
+	}
+
+	void touch(BarCacheEntry* e)
+	{
+		e->lastUse.store(m_tick.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	template<typename Loader>
+	int64_t getLoaderAndCoverLimit(int spanseconds, Loader& loader)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		getLoader(loader);
+		return m_coverLimit ? m_coverLimit(spanseconds) : std::numeric_limits<int64_t>::max();
+	}
+
+	void getLoader(RangeLoader& loader) { loader = m_rangeLoader; }
+	void getLoader(LimitLoader& loader) { loader = m_limitLoader; }
+
+	/**
+	* @brief add the loaded bars beginning in [a, b] to a snapshot
+	*
+	* @param firstts as set to the earliest added timestamp if any
+	*
+	* @return number of bars added
+	*/
+	int addLoaded(BarCacheSnapshot& ns, BarListPtr& loaded, int64_t a, int64_t b, int64_t* firstts = nullptr)
+	{
+		if (!ns.hasTypes)
+		{
+			ns.rollingType = loaded->getRollingType();
+			ns.dtType = loaded->getDateTimeType();
+			ns.hasTypes = true;
+		}
+		std::vector<std::pair<int64_t, BarPtr> > bars;
+		for (auto& kv : loaded->bars())
+		{
+			if (kv.second == nullptr) { continue; }
+			int64_t ts = kv.second->getBegindt();
+			if (ts < a || ts > b) { continue; }
+			bars.push_back(std::make_pair(ts, kv.second));
+		}
+		m_loadedBars.fetch_add(bars.size(), std::memory_order_relaxed);
+		int n = (int)bars.size();
+		ns.merge(bars);
+		if (firstts != nullptr && n > 0) { *firstts = ns.ts[std::lower_bound(ns.ts.begin(), ns.ts.end(), a) - ns.ts.begin()]; }
+		return n;
+	}
+
+	BarListPtr makeBarList(const BarCacheSnapshot& s, size_t i0, size_t i1, int spanseconds) const
+	{
+		BarListPtr bl = BarList::create(spanseconds);
+		if (s.hasTypes)
+		{
+			bl->setRollingType(s.rollingType);
+			bl->setDateTimeType(s.dtType);
+		}
+		if (i1 > i0)
+		{
+			std::vector<BarPtr> bars(s.bars.begin() + i0, s.bars.begin() + i1);
+			bl->addBarVector(bars);
+		}
+		return bl;
+	}
+
+	BarListPtr makeBarList(const BarCacheSnapshot& s, int64_t startdt, int64_t enddt, int spanseconds) const
+	{
+		std::pair<size_t, size_t> r = s.findRange(startdt, enddt);
+		return makeBarList(s, r.first, r.second, spanseconds);
+	}
+
+	/**
+	* @brief latest numlimit bars at or before enddt if they are all cached
+	*
+	* @param partial as if returning the cached bars when the range is not covered
+	*
+	* @return barlist, null if not covered and not partial
+	*/
+	BarListPtr makeLimitBarList(const BarCacheSnapshot& s, int64_t enddt, int numlimit, int spanseconds, bool partial = false) const
+	{
+		size_t i1 = s.findRange(std::numeric_limits<int64_t>::min(), enddt).second;
+		size_t n = (size_t)std::max(numlimit, 0);
+		size_t i0 = i1 >= n ? i1 - n : 0;
+		if (n == 0) { return makeBarList(s, i1, i1, spanseconds); }
+		int64_t first = i1 - i0 == n ? s.ts[i0] : std::numeric_limits<int64_t>::min();
+		if (!partial && !s.covers(first, enddt)) { return BarListPtr(); }
+		return makeBarList(s, i0, i1, spanseconds);
+	}
+
+	/**
+	* @brief replace the snapshot of an entry, the entry load mutex must be held
+	*
+	*	The old snapshot is deleted by the Epoch once no pinned reader can still see it.
+	*
+	* @param ns as new snapshot, owned by the entry from now on
+	*/
+	void publish(BarCacheEntry* e, const BarCacheSnapshot* ns)
+	{
+		const BarCacheSnapshot* old = e->current.load(std::memory_order_relaxed);
+		e->current.store(ns, std::memory_order_release);
+		m_bytes.fetch_add(ns->bytes, std::memory_order_relaxed);
+		m_bytes.fetch_sub(old->bytes, std::memory_order_relaxed);
+		Epoch::Retire(old);
+	}
+
+	/**
+	* @brief drop least recently used entries until the cache fits the budget
+	*
+	* @param keep as entry just used, kept even if it alone exceeds the budget
+	*/
+	void evictIfNeeded(BarCacheEntry* keep)
+	{
+		size_t budget = m_budget.load(std::memory_order_relaxed);
+		if (budget == 0 || m_bytes.load(std::memory_order_relaxed) <= budget) { return; }
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<std::pair<uint64_t, BarCacheEntry*> > lru;
+		for (auto& e : m_entryStore)
+		{
+			if (e.get() == keep || BarCacheEntry::Reader(*e)->bytes == 0) { continue; }
+			lru.push_back(std::make_pair(e->lastUse.load(std::memory_order_relaxed), e.get()));
+		}
+		std::sort(lru.begin(), lru.end());
+		for (auto& kv : lru)
+		{
+			if (m_bytes.load(std::memory_order_relaxed) <= budget) { break; }
+			// skip entries being loaded instead of waiting for the query
+			std::unique_lock<std::mutex> elock(kv.second->loadMutex, std::try_to_lock);
+			if (!elock.owns_lock()) { continue; }
+			publish(kv.second, new BarCacheSnapshot());
+			m_evictions.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void prefetchNow(const std::vector<std::string>& instrids, int64_t startdt, int64_t enddt, int spanseconds)
+	{
+		for (const std::string& instrid : instrids)
+		{
+			InstrPtr& instr = InstrMgr::getInstance()->getInstr(instrid);
+			if (instr == nullptr)
+			{
+				LOGW("BarCache cannot prefetch unknown instrument " + instrid);
+				continue;
+			}
+			BarListPtr bl = getBarList(instr, startdt, enddt, spanseconds);
+			LOGI("BarCache prefetched " + std::to_string(bl->getBarCount()) + " bars of " + instrid + " span " + std::to_string(spanseconds));
+		}
+	}
+
+private:
+	std::atomic<const EntryMap*> m_entries; ///< getEntry stores a grown copy under m_mutex and retires the previous map
+	std::list<std::unique_ptr<BarCacheEntry> > m_entryStore;
+	std::mutex m_mutex;
+
+	RangeLoader m_rangeLoader;
+	LimitLoader m_limitLoader;
+	CoverLimit m_coverLimit;
+
+	std::atomic<size_t> m_budget;
+	std::atomic<size_t> m_bytes;
+	std::atomic<uint64_t> m_tick;
+
+	std::vector<std::thread> m_prefetchThreads;
+
+	std::atomic<uint64_t> m_hits;
+	std::atomic<uint64_t> m_misses;
+	std::atomic<uint64_t> m_queries;
+	std::atomic<uint64_t> m_loadedBars;
+	std::atomic<uint64_t> m_evictions;
+};//class BarCache
+
+}//namespace XT
+
+#endif
@@ -0,0 +1,645 @@
+#pragma once
+#ifndef XT_BAR_COLUMNS_H
+#define XT_BAR_COLUMNS_H
+
+/**
+* \file BarColumns.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a columnar bar list.
+*
+* \description
+*	Designed for long bar histories (e.g. months of 60 s bars). Bars are kept as one
+*	contiguous, 64 byte aligned array per field plus sorted begin and end timestamp columns,
+*	without a Bar object per bar. Columns are returned as spans, bars are looked up by
+*	binary search on the timestamps and Bar objects are only created on demand (getBar,
+*	toBarList). Spans stay valid until the next call that grows the columns; reserve()
+*	the expected size first when spans are kept while bars are added.
+*/
+
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <utility>
+
+#include <boost/align/aligned_allocator.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "XTConfig.h"
+#include "Bar.h"
+
+namespace XT
+{
+
+/**
+* read only view of a contiguous column
+*/
+template<typename T>
+class BarSpan
+{
+public:
+	BarSpan() : m_data(nullptr), m_size(0) {}
+	BarSpan(const T* data, size_t size) : m_data(data), m_size(size) {}
+
+	const T* data() const { return m_data; }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	const T& operator[](size_t i) const { return m_data[i]; }
+	const T& front() const { return m_data[0]; }
+	const T& back() const { return m_data[m_size - 1]; }
+
+	const T* begin() const { return m_data; }
+	const T* end() const { return m_data + m_size; }
+
+	/**
+	* @brief sub view
+	*
+	* @param offset as first element
+	* @param count as number of elements, clipped to the end
+	*/
+	BarSpan subspan(size_t offset, size_t count = (size_t)-1) const
+	{
+		if (offset >= m_size) { return BarSpan(); }
+		return BarSpan(m_data + offset, std::min(count, m_size - offset));
+	}
+
+	/** last n elements */
+	BarSpan last(size_t n) const { return n >= m_size ? *this : BarSpan(m_data + m_size - n, n); }
+
+	/** copy, for interfaces taking vectors */
+	std::vector<T> toVector() const { return std::vector<T>(begin(), end()); }
+
+protected:
+	const T* m_data;
+	size_t m_size;
+};
+
+typedef BarSpan<double> BarDoubleSpan;
+typedef BarSpan<int64_t> BarTsSpan;
+
+/**
+* double fields of BarColumns
+*/
+struct BarField
+{
+	enum enumtype
+	{
+		Open = 0,
+		High,
+		Low,
+		Close,
+		Volume,
+		Oichg,
+		Bsvoldiff,
+		Turnover,
+		Bstdiff,
+		Flipup,
+		Flipdn,
+		Count
+	};
+};
+
+class BarColumns;
+//////typedef for BarColumns
+#if defined(USE_BOOST_SHARED_PTR)
+
+typedef ::boost::shared_ptr<BarColumns> BarColumnsPtr;
+
+#elif defined(USE_STD_SHARED_PTR)
+
+typedef ::std::shared_ptr<BarColumns> BarColumnsPtr;
+
+#elif defined(USE_SAFE_PTR)
+
+typedef ::sf::safe_ptr<BarColumns> BarColumnsPtr;
+
+#else
+
+typedef ::std::shared_ptr<BarColumns> BarColumnsPtr;
+#endif
+//////end typedef for BarColumns
+
+class BarColumns
+{
+public:
+	typedef std::vector<double, boost::alignment::aligned_allocator<double, 64> > DoubleColumn;
+	typedef std::vector<int64_t, boost::alignment::aligned_allocator<int64_t, 64> > TsColumn;
+
+	/**
+	* @brief constructor
+	*
+	* @param span as bar seconds for time bars, ticks per bar for tick bars
+	* @param rtype as RollingType
+	* @param dttype as DateTimeType of the timestamps
+	*/
+	explicit BarColumns(int span = 60, RollingType::enumtype rtype = RollingType::Time, DateTimeType::enumtype dttype = DateTimeType::UTS)
+		: m_hasNewBar(false), m_hasNewBarHigh(false), m_hasNewBarLow(false), m_ticksInBar(0)
+	{
+		setSpan(span, rtype, dttype);
+	}
+
+	BarColumns(const BarColumns& from)
+	{
+		boost::shared_lock<boost::shared_mutex> lock(from.m_mutex);
+		copyFrom(from);
+	}
+
+	BarColumns& operator=(const BarColumns& from)
+	{
+		if (this == &from) { return *this; }
+		boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+		boost::shared_lock<boost::shared_mutex> lock2(from.m_mutex);
+		copyFrom(from);
+		return *this;
+	}
+
+	virtual ~BarColumns() {}
+
+	static BarColumnsPtr create(int span, RollingType::enumtype rtype = RollingType::Time, DateTimeType::enumtype dttype = DateTimeType::UTS)
+	{
+		return BarColumnsPtr(new BarColumns(span, rtype, dttype));
+	}
+
+public:
+	/**
+	* @brief set span, clears the bars
+	*
+	* @param span as bar seconds for time bars, ticks per bar for tick bars
+	* @param rtype as RollingType
+	* @param dttype as DateTimeType of the timestamps
+	*/
+	void setSpan(int span, RollingType::enumtype rtype = RollingType::Time, DateTimeType::enumtype dttype = DateTimeType::UTS)
+	{
+		boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+		m_span = std::max(1, span);
+		m_rollingType = rtype;
+		m_dtType = dttype;
+		if (rtype == RollingType::Tick) { m_spandt = m_span; }
+		else { m_spandt = (int64_t)m_span * (dttype == DateTimeType::NET ? 10000000LL : 1000000LL); }
+		clearWithoutLock();
+	}
+
+	int getSpan() const { return m_span; }
+	int64_t getSpanDT() const { return m_spandt; }
+	RollingType::enumtype getRollingType() const { return m_rollingType; }
+	DateTimeType::enumtype getDateTimeType() const { return m_dtType; }
+
+	/**
+	* @brief reserve room for bars, spans stay valid while size() <= n
+	*/
+	void reserve(size_t n)
+	{
+		boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+		m_ts.reserve(n);
+		m_endTs.reserve(n);
+		for (auto& c : m_columns) { c.reserve(n); }
+	}
+
+	void clear()
+	{
+		boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+		clearWithoutLock();
+	}
+
+	int getBarCount() const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		return (int)m_ts.size();
+	}
+
+	bool empty() const { return getBarCount() == 0; }
+
+	/** bytes held by the columns */
+	size_t memoryBytes() const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		return m_ts.capacity() * sizeof(int64_t) * 2 + m_columns[0].capacity() * sizeof(double) * BarField::Count;
+	}
+
+public:
+	/**
+	* @name Spans
+	*/
+	///@{
+	BarDoubleSpan column(BarField::enumtype f) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		return BarDoubleSpan(m_columns[f].data(), m_columns[f].size());
+	}
+
+	BarDoubleSpan opens() const { return column(BarField::Open); }
+	BarDoubleSpan highs() const { return column(BarField::High); }
+	BarDoubleSpan lows() const { return column(BarField::Low); }
+	BarDoubleSpan closes() const { return column(BarField::Close); }
+	BarDoubleSpan volumes() const { return column(BarField::Volume); }
+	BarDoubleSpan oichgs() const { return column(BarField::Oichg); }
+	BarDoubleSpan bsvoldiffs() const { return column(BarField::Bsvoldiff); }
+	BarDoubleSpan turnovers() const { return column(BarField::Turnover); }
+	BarDoubleSpan bstdiffs() const { return column(BarField::Bstdiff); }
+	BarDoubleSpan flipups() const { return column(BarField::Flipup); }
+	BarDoubleSpan flipdns() const { return column(BarField::Flipdn); }
+
+	/** begin timestamps, sorted */
+	BarTsSpan timestamps() const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		return BarTsSpan(m_ts.data(), m_ts.size());
+	}
+
+	/** end timestamps */
+	BarTsSpan endTimestamps() const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		return BarTsSpan(m_endTs.data(), m_endTs.size());
+	}
+	///@}
+
+public:
+	/**
+	* @name Lookup
+	*/
+	///@{
+	/**
+	* @brief index of the bar beginning at ts
+	*
+	* @return bar index, -1 if none
+	*/
+	int findIdx(int64_t ts) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		auto it = std::lower_bound(m_ts.begin(), m_ts.end(), ts);
+		return (it != m_ts.end() && *it == ts) ? (int)(it - m_ts.begin()) : -1;
+	}
+
+	/**
+	* @brief index of the bar containing ts
+	*
+	* @return bar index, -1 if ts is before the first bar
+	*/
+	int findIdxAtOrBefore(int64_t ts) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		auto it = std::upper_bound(m_ts.begin(), m_ts.end(), ts);
+		return (int)(it - m_ts.begin()) - 1;
+	}
+
+	/**
+	* @brief index range of the bars beginning in [ts0, ts1)
+	*
+	* @return first index and one past the last index
+	*/
+	std::pair<int, int> findIdxRange(int64_t ts0, int64_t ts1) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		int i0 = (int)(std::lower_bound(m_ts.begin(), m_ts.end(), ts0) - m_ts.begin());
+		int i1 = (int)(std::lower_bound(m_ts.begin(), m_ts.end(), ts1) - m_ts.begin());
+		return std::make_pair(i0, std::max(i0, i1));
+	}
+
+	int64_t getTsByIdx(int idx) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		return (idx >= 0 && idx < (int)m_ts.size()) ? m_ts[idx] : 0;
+	}
+
+	int64_t getLastTs() const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		return m_ts.empty() ? 0 : m_ts.back();
+	}
+
+	double getValue(BarField::enumtype f, int idx) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		return (idx >= 0 && idx < (int)m_ts.size()) ? m_columns[f][idx] : NAN;
+	}
+	///@}
+
+public:
+	/**
+	* @name Adding
+	*/
+	///@{
+	/**
+	* @brief set a whole bar, replaces the bar with the same begin timestamp
+	*
+	* @param ts as begin timestamp
+	* @param endts as end timestamp
+	* @param values as BarField::Count values
+	*/
+	void setBar(int64_t ts, int64_t endts, const double* values)
+	{
+		boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+		setBarWithoutLock(ts, endts, values);
+	}
+
+	/**
+	* @brief append bars later than the last bar, e.g. columns of a mapped file
+	*
+	* @param ts as begin timestamps
+	* @param endts as end timestamps
+	* @param cols as BarField::Count column pointers
+	* @param n as number of bars
+	*/
+	void appendColumns(const int64_t* ts, const int64_t* endts, const double* const* cols, size_t n)
+	{
+		if (n == 0) { return; }
+		boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+		if (!m_ts.empty() && ts[0] <= m_ts.back())
+		{
+			// overlapping ranges go through the upsert path
+			double v[BarField::Count];
+			for (size_t i = 0; i < n; ++i)
+			{
+				for (int f = 0; f < BarField::Count; ++f) { v[f] = cols[f][i]; }
+				setBarWithoutLock(ts[i], endts[i], v);
+			}
+			return;
+		}
+		m_ts.insert(m_ts.end(), ts, ts + n);
+		m_endTs.insert(m_endTs.end(), endts, endts + n);
+		for (int f = 0; f < BarField::Count; ++f) { m_columns[f].insert(m_columns[f].end(), cols[f], cols[f] + n); }
+	}
+
+	/**
+	* @brief set a bar from a Bar object
+	*/
+	void addBar(const BarPtr& bar)
+	{
+		if (!bar) { return; }
+		double v[BarField::Count];
+		v[BarField::Open] = bar->getOpen();
+		v[BarField::High] = bar->getHigh();
+		v[BarField::Low] = bar->getLow();
+		v[BarField::Close] = bar->getClose();
+		v[BarField::Volume] = (double)bar->getVolume();
+		v[BarField::Oichg] = (double)bar->getOichg();
+		v[BarField::Bsvoldiff] = (double)bar->getBsvoldiff();
+		v[BarField::Turnover] = bar->getAmount();
+		v[BarField::Bstdiff] = bar->getBsadiff();
+		v[BarField::Flipup] = bar->getFlipups();
+		v[BarField::Flipdn] = bar->getFlipdns();
+		setBar(bar->getBegindt(), bar->getEnddt(), v);
+	}
+
+	/**
+	* @brief add a tick to the bars
+	*
+	* @param ts as timestamp
+	* @param px as price
+	* @param volume as trading volume
+	* @param oichg as open interest change
+	* @param bsvoldiff as buy sell volume difference
+	* @param turnover as sum of (volume*fillprice)
+	* @param bstdiff as buy sell turnover difference
+	* @param flipup as flip ups
+	* @param flipdn as flip downs
+	*
+	* @return if a new bar was started
+	*/
+	bool addData(int64_t ts, double px, int64_t volume, int64_t oichg, int64_t bsvoldiff, double turnover, double bstdiff, double flipup, double flipdn)
+	{
+		boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+		m_hasNewBarHigh = false;
+		m_hasNewBarLow = false;
+		bool newbar = false;
+		if (m_ts.empty()) { newbar = true; }
+		else if (m_rollingType == RollingType::Tick) { newbar = m_ticksInBar >= m_span; }
+		else { newbar = barBegin(ts) > m_ts.back(); }
+
+		if (newbar)
+		{
+			double v[BarField::Count] = {};
+			v[BarField::Open] = v[BarField::High] = v[BarField::Low] = v[BarField::Close] = px;
+			int64_t begin = m_rollingType == RollingType::Tick ? ts : barBegin(ts);
+			int64_t end = m_rollingType == RollingType::Tick ? ts : begin + m_spandt;
+			if (!m_ts.empty() && begin <= m_ts.back()) { begin = m_ts.back() + 1; }
+			appendWithoutLock(begin, end, v);
+			m_ticksInBar = 0;
+		}
+		size_t i = m_ts.size() - 1;
+		if (px > m_columns[BarField::High][i]) { m_columns[BarField::High][i] = px; m_hasNewBarHigh = true; }
+		if (px < m_columns[BarField::Low][i]) { m_columns[BarField::Low][i] = px; m_hasNewBarLow = true; }
+		m_columns[BarField::Close][i] = px;
+		m_columns[BarField::Volume][i] += (double)volume;
+		m_columns[BarField::Oichg][i] += (double)oichg;
+		m_columns[BarField::Bsvoldiff][i] += (double)bsvoldiff;
+		m_columns[BarField::Turnover][i] += turnover;
+		m_columns[BarField::Bstdiff][i] += bstdiff;
+		m_columns[BarField::Flipup][i] += flipup;
+		m_columns[BarField::Flipdn][i] += flipdn;
+		if (m_rollingType == RollingType::Tick) { m_endTs[i] = ts; }
+		++m_ticksInBar;
+		m_hasNewBar = newbar;
+		return newbar;
+	}
+
+	bool hasNewBar() const { return m_hasNewBar; }
+	bool hasNewBarHigh() const { return m_hasNewBarHigh; }
+	bool hasNewBarLow() const { return m_hasNewBarLow; }
+	///@}
+
+public:
+	/**
+	* @name Bar objects
+	*/
+	///@{
+	/**
+	* @brief create the Bar object of an index
+	*
+	* @return bar, null if idx is out of range
+	*/
+	BarPtr getBar(int idx) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		if (idx < 0 || idx >= (int)m_ts.size()) { return BarPtr(); }
+		return makeBar(idx);
+	}
+
+	/**
+	* @brief create the Bar object of the bar beginning at ts
+	*/
+	BarPtr getBarByTs(int64_t ts) const
+	{
+		return getBar(findIdx(ts));
+	}
+
+	/**
+	* @brief create a BarList with Bar objects, for code using BarList
+	*
+	* @param idx0 as first index
+	* @param idx1 as one past the last index, -1 for all
+	*/
+	BarListPtr toBarList(int idx0 = 0, int idx1 = -1) const
+	{
+		BarListPtr bl = BarList::create(m_span);
+		bl->setRollingType(m_rollingType);
+		bl->setDateTimeType(m_dtType);
+		std::vector<BarPtr> bars;
+		{
+			boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+			int n = (int)m_ts.size();
+			if (idx1 < 0 || idx1 > n) { idx1 = n; }
+			for (int i = std::max(0, idx0); i < idx1; ++i) { bars.push_back(makeBar(i)); }
+		}
+		bl->addBarVector(bars);
+		return bl;
+	}
+
+	/**
+	* @brief load the bars of a BarList
+	*/
+	static BarColumnsPtr fromBarList(BarListPtr& bl)
+	{
+		BarColumnsPtr bc = create(bl->getSpan(), bl->getRollingType(), bl->getDateTimeType());
+		std::map<int64_t, BarPtr>& bars = bl->bars();
+		bc->reserve(bars.size());
+		for (auto& kv : bars) { bc->addBar(kv.second); }
+		return bc;
+	}
+	///@}
+
+public:
+	/**
+	* @name Stat Functions
+	*/
+	///@{
+	double getHighPxBetween(int idx0, int idx1) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		const DoubleColumn& c = m_columns[BarField::High];
+		if (!clipRange(idx0, idx1)) { return NAN; }
+		return *std::max_element(c.begin() + idx0, c.begin() + idx1 + 1);
+	}
+
+	double getLowPxBetween(int idx0, int idx1) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		const DoubleColumn& c = m_columns[BarField::Low];
+		if (!clipRange(idx0, idx1)) { return NAN; }
+		return *std::min_element(c.begin() + idx0, c.begin() + idx1 + 1);
+	}
+
+	double getMeanPxBetween(int idx0, int idx1) const
+	{
+		boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+		const DoubleColumn& c = m_columns[BarField::Close];
+		if (!clipRange(idx0, idx1)) { return NAN; }
+		double s = 0;
+		for (int i = idx0; i <= idx1; ++i) { s += c[i]; }
+		return s / (idx1 - idx0 + 1);
+	}
+	///@}
+
+protected:
+	int64_t barBegin(int64_t ts) const
+	{
+		int64_t r = ts % m_spandt;
+		return r < 0 ? ts - r - m_spandt : ts - r;
+	}
+
+	/** clip an inclusive index range, false if empty */
+	bool clipRange(int& idx0, int& idx1) const
+	{
+		idx0 = std::max(0, idx0);
+		idx1 = std::min((int)m_ts.size() - 1, idx1);
+		return idx0 <= idx1;
+	}
+
+	BarPtr makeBar(int idx) const
+	{
+		BarPtr bar(new Bar());
+		bar->setBegindt(m_ts[idx]);
+		bar->setEnddt(m_endTs[idx]);
+		bar->setOpen(m_columns[BarField::Open][idx]);
+		bar->setHigh(m_columns[BarField::High][idx]);
+		bar->setLow(m_columns[BarField::Low][idx]);
+		bar->setClose(m_columns[BarField::Close][idx]);
+		bar->setVolume((int64_t)m_columns[BarField::Volume][idx]);
+		bar->setOichg((int64_t)m_columns[BarField::Oichg][idx]);
+		bar->setBsvoldiff((int64_t)m_columns[BarField::Bsvoldiff][idx]);
+		bar->setAmount(m_columns[BarField::Turnover][idx]);
+		bar->setBsadiff(m_columns[BarField::Bstdiff][idx]);
+		bar->setFlipups(m_columns[BarField::Flipup][idx]);
+		bar->setFlipdns(m_columns[BarField::Flipdn][idx]);
+		return bar;
+	}
+
+	void appendWithoutLock(int64_t ts, int64_t endts, const double* values)
+	{
+		m_ts.push_back(ts);
+		m_endTs.push_back(endts);
+		for (int f = 0; f < BarField::Count; ++f) { m_columns[f].push_back(values[f]); }
+	}
+
+	void setBarWithoutLock(int64_t ts, int64_t endts, const double* values)
+	{
+		if (m_ts.empty() || ts > m_ts.back())
+		{
+			appendWithoutLock(ts, endts, values);
+			return;
+		}
+		size_t i = std::lower_bound(m_ts.begin(), m_ts.end(), ts) - m_ts.begin();
+		if (m_ts[i] == ts)
+		{
+			m_endTs[i] = endts;
+			for (int f = 0; f < BarField::Count; ++f) { m_columns[f][i] = values[f]; }
+			return;
+		}
+		// out of order bar, rare
+		m_ts.insert(m_ts.begin() + i, ts);
+		m_endTs.insert(m_endTs.begin() + i, endts);
+		for (int f = 0; f < BarField::Count; ++f) { m_columns[f].insert(m_columns[f].begin() + i, values[f]); }
+	}
+
+	void clearWithoutLock()
+	{
+		m_ts.clear();
+		m_endTs.clear();
+		for (auto& c : m_columns) { c.clear(); }
+		m_hasNewBar = m_hasNewBarHigh = m_hasNewBarLow = false;
+		m_ticksInBar = 0;
+	}
+
+	void copyFrom(const BarColumns& from)
+	{
+		m_span = from.m_span;
+		m_spandt = from.m_spandt;
+		m_rollingType = from.m_rollingType;
+		m_dtType = from.m_dtType;
+		m_ts = from.m_ts;
+		m_endTs = from.m_endTs;
+		for (int f = 0; f < BarField::Count; ++f) { m_columns[f] = from.m_columns[f]; }
+		m_hasNewBar = from.m_hasNewBar;
+		m_hasNewBarHigh = from.m_hasNewBarHigh;
+		m_hasNewBarLow = from.m_hasNewBarLow;
+		m_ticksInBar = from.m_ticksInBar;
+	}
+
+protected:
+	int m_span; ///< bar seconds, or ticks per bar
+	int64_t m_spandt; ///< bar length in timestamp units
+	RollingType::enumtype m_rollingType; ///< rolling type
+	DateTimeType::enumtype m_dtType; ///< datetime type
+
+	TsColumn m_ts; ///< begin timestamps, sorted
+	TsColumn m_endTs; ///< end timestamps
+	DoubleColumn m_columns[BarField::Count]; ///< one column per BarField
+
+	bool m_hasNewBar; ///< new bar flag
+	bool m_hasNewBarHigh; ///< new high flag
+	bool m_hasNewBarLow; ///< new low flag
+	int m_ticksInBar; ///< ticks in the last bar, for tick bars
+
+	mutable boost::shared_mutex m_mutex;
+};//class BarColumns
+
+}//namespace XT
+
+#endif
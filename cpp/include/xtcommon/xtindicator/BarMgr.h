@@ -14,9 +14,11 @@
 */
 
 #include <cstdint>
+#include <string>
 #include <set>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <boost/unordered_map.hpp>
 #include <boost/signals2.hpp>
 
@@ -46,6 +48,12 @@
 #include "Bar.h"
 #include "BarIndicator.h"
 #include "BarMaker.h"
+#include "BarColumns.h"
+#include "MktColumnStore.h"
+#include "SQLiteMgr.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
 
 namespace XT
 {
@@ -154,6 +162,71 @@ public:
 	*/
 	BarListPtr get60sBarListForInstr(InstrPtr& instr, int64_t startdt, int64_t enddt);
 
+	/**
+	* @brief get 60 seconds bars for instrument from a column store, without per bar objects
+	*
+	* @param root as column store root directory
+	* @param instr as instrument
+	* @param startday as first trading day
+	* @param endday as last trading day
+	*
+	* @return bar columns, empty if the store has no bars of the instrument
+	*/
+	BarColumnsPtr get60sBarColumnsForInstrFromStore(const std::string& root, InstrPtr& instr, int startday, int endday)
+	{
+		return MktColumnStoreLoader::loadBarColumns(root, instr->getExchID(), instr->getInstrID(), 60, startday, endday);
+	}
+
+	/**
+	* @brief get bars for instrument from a sqlite database into columns, without per bar objects
+	*
+	* The select returns begindt and enddt, then up to BarField::Count values in BarField order
+	* (open, high, low, close, volume, oichg, bsvoldiff, turnover, ...); fields it does not
+	* return are 0. "{exch}" and "{span}" are replaced by the exchange id and the span, the
+	* named parameters :instrid, :startdt and :enddt are bound. The rows are counted first so
+	* the columns are reserved once, then each row is set with BarColumns::setBar.
+	*
+	* @param dbfile as database file, empty for the TrdDBMgr trade database
+	* @param selectsql as select statement
+	* @param instr as instrument
+	* @param startdt as start timestamp
+	* @param enddt as end timestamp
+	* @param spanseconds as bar seconds
+	*
+	* @return bar columns, empty if the query fails
+	*/
+	BarColumnsPtr getBarColumnsForInstrFromSqlite(const std::string& dbfile, const std::string& selectsql, InstrPtr& instr, int64_t startdt, int64_t enddt, int spanseconds)
+	{
+		BarColumnsPtr bc = BarColumns::create(spanseconds);
+		const std::string file = dbfile.empty() ? TrdDBMgr::getInstance()->getTrdDbFile() : dbfile;
+		std::string sql = selectsql;
+		for (size_t pos; (pos = sql.find("{exch}")) != std::string::npos;) { sql.replace(pos, 6, instr->getExchID()); }
+		for (size_t pos; (pos = sql.find("{span}")) != std::string::npos;) { sql.replace(pos, 6, std::to_string(spanseconds)); }
+		try
+		{
+			SQLite::Database db(file, SQLite::OPEN_READONLY);
+			SQLite::Statement count(db, "SELECT COUNT(*) FROM (" + sql + ")");
+			bindBarQuery(count, instr->getInstrID(), startdt, enddt);
+			if (count.executeStep()) { bc->reserve((size_t)count.getColumn(0).getInt64()); }
+
+			SQLite::Statement query(db, sql);
+			bindBarQuery(query, instr->getInstrID(), startdt, enddt);
+			const int nfields = std::min(query.getColumnCount() - 2, (int)BarField::Count);
+			double v[BarField::Count];
+			while (query.executeStep())
+			{
+				for (int f = 0; f < BarField::Count; ++f) { v[f] = f < nfields ? query.getColumn(2 + f).getDouble() : 0; }
+				bc->setBar(query.getColumn(0).getInt64(), query.getColumn(1).getInt64(), v);
+			}
+		}
+		catch (std::exception& e)
+		{
+			LOGW("BarMgr cannot load bars of " + instr->getInstrID() + " from " + file + ": " + e.what());
+			bc->clear();
+		}
+		return bc;
+	}
+
 	/**
 	* @brief get day barlist for instr
 	*
@@ -480,6 +553,16 @@ protected:
 	void onInstrComboMktData(int iid);
 
 	///@}
+
+	/**
+	* @brief bind the named parameters of a bar select
+	*/
+	static void bindBarQuery(SQLite::Statement& stmt, const std::string& instrid, int64_t startdt, int64_t enddt)
+	{
+		stmt.bind(":instrid", instrid);
+		stmt.bind(":startdt", (long long)startdt);
+		stmt.bind(":enddt", (long long)enddt);
+	}
 protected:
 	BarPtr m_emptyBar;
 	BarListPtr m_emptyBarList;
@@ -0,0 +1,535 @@
+#pragma once
+#ifndef XT_MARKET_BAR_ENGINE_H
+#define XT_MARKET_BAR_ENGINE_H
+
+/**
+* \file MarketBarEngine.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a bar engine building bars of all instruments of a market.
+*
+* \description
+*	Designed for building 1s/60s bars for every instrument of an exchange. The open bars
+*	of all instruments for one span are kept in struct of arrays form, indexed by a slot
+*	per iid. A batch of ticks is applied in one pass and all bars are closed at the bar
+*	boundary with one sweep. Closed bars are handed to the sinks (BarList, database,
+*	indicators) as one batch per boundary, on TaskPool strands when a pool is set, so
+*	the market data thread never waits for them. The BarMgr sink always runs on the
+*	calling thread, BarLists and indicators are not thread safe.
+*
+*	addTicks(), onTime() and flush() must be called from one thread.
+*/
+
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+#include "XTConfig.h"
+#include "XTTaskPool.h"
+#include "Bar.h"
+#include "BarColumns.h"
+#include "BarMgr.h"
+#include "BarDBWriter.h"
+
+namespace XT
+{
+
+	/**
+	* tick input of MarketBarEngine
+	*/
+	struct MarketTick
+	{
+		int iid;
+		int64_t ts;
+		double px;
+		int64_t volume; ///< volume of the tick
+		int64_t oichg;
+		int64_t bsvoldiff;
+		double turnover;
+		double bstdiff;
+		double flipups;
+		double flipdns;
+	};
+
+	/**
+	* closed bar of MarketBarEngine
+	*/
+	struct MarketBar
+	{
+		int iid;
+		int ticks; ///< ticks in the bar, 0 for a filled empty bar
+		double open;
+		double high;
+		double low;
+		double close;
+		double volume;
+		double oichg;
+		double bsvoldiff;
+		double turnover;
+		double bstdiff;
+		double flipups;
+		double flipdns;
+	};
+
+	/**
+	* bars closed at one boundary
+	*/
+	struct MarketBarBatch
+	{
+		int span; ///< bar seconds
+		int64_t begindt; ///< begin timestamp of the bars
+		int64_t enddt; ///< end timestamp of the bars
+		std::vector<MarketBar> bars;
+	};
+	typedef std::shared_ptr<const MarketBarBatch> MarketBarBatchPtr;
+
+class MarketBarEngine
+{
+public:
+	typedef std::function<void(const MarketBarBatchPtr&)> BarSink;
+
+	/**
+	* @brief constructor
+	*
+	* @param span as bar seconds
+	* @param dttype as DateTimeType of the tick timestamps
+	*/
+	explicit MarketBarEngine(int span = 60, DateTimeType::enumtype dttype = DateTimeType::UTS)
+		: m_span(std::max(1, span)), m_dtType(dttype), m_currBegin(INT64_MIN), m_fillEmptyBars(false),
+		m_pool(nullptr), m_ticks(0), m_lateTicks(0), m_unknownTicks(0), m_batches(0)
+	{
+		m_spandt = (int64_t)m_span * (dttype == DateTimeType::NET ? 10000000LL : 1000000LL);
+	}
+
+	MarketBarEngine(const MarketBarEngine&) = delete;
+	MarketBarEngine& operator=(const MarketBarEngine&) = delete;
+
+	virtual ~MarketBarEngine() {}
+
+public:
+	/**
+	* @name Setup
+	*/
+	///@{
+	int getSpan() const { return m_span; }
+	int64_t getSpanDT() const { return m_spandt; }
+
+	/**
+	* @brief add an instrument
+	*
+	* @param iid as integer id
+	*
+	* @return slot of the instrument
+	*/
+	int addInstr(int iid)
+	{
+		if (iid < 0) { return -1; }
+		if ((size_t)iid >= m_slotOfIid.size()) { m_slotOfIid.resize((size_t)iid + 1, -1); }
+		if (m_slotOfIid[iid] >= 0) { return m_slotOfIid[iid]; }
+		int slot = (int)m_iids.size();
+		m_slotOfIid[iid] = slot;
+		m_iids.push_back(iid);
+		m_tickCounts.push_back(0);
+		m_lastClose.push_back(NAN);
+		m_open.push_back(0);
+		m_high.push_back(0);
+		m_low.push_back(0);
+		m_close.push_back(0);
+		m_volume.push_back(0);
+		m_oichg.push_back(0);
+		m_bsvoldiff.push_back(0);
+		m_turnover.push_back(0);
+		m_bstdiff.push_back(0);
+		m_flipups.push_back(0);
+		m_flipdns.push_back(0);
+		return slot;
+	}
+
+	bool hasInstr(int iid) const { return slotOf(iid) >= 0; }
+
+	int getInstrCount() const { return (int)m_iids.size(); }
+
+	/**
+	* @brief emit a flat bar at the last close for instruments without ticks in a bar
+	*/
+	void setFillEmptyBars(bool v) { m_fillEmptyBars = v; }
+
+	/**
+	* @brief run the sinks on a task pool, one strand per sink, instead of the calling thread
+	*
+	* @param pool as started task pool, must outlive the engine, set before adding sinks
+	*/
+	void setTaskPool(TaskPool* pool) { m_pool = pool; }
+
+	/**
+	* @brief add a sink receiving every batch of closed bars
+	*
+	* @param name as strand name
+	* @param sink as callback
+	* @param onpool as run it on a strand of the task pool, false to run it on the thread calling addTicks
+	*/
+	void addSink(const std::string& name, const BarSink& sink, bool onpool = true)
+	{
+		Sink s;
+		s.fn = sink;
+		s.strand = (m_pool && onpool) ? m_pool->AddStrand("bars" + std::to_string(m_span) + "." + name) : -1;
+		m_sinks.push_back(s);
+	}
+
+	/**
+	* @brief add a sink writing the closed bars into BarColumns
+	*
+	* @param columnsof as function returning the columns of an iid, null to skip it
+	*/
+	void addBarColumnsSink(const std::function<BarColumnsPtr(int)>& columnsof)
+	{
+		addSink("columns", [columnsof](const MarketBarBatchPtr& batch) {
+			double v[BarField::Count];
+			for (const MarketBar& b : batch->bars)
+			{
+				BarColumnsPtr bc = columnsof(b.iid);
+				if (!bc) { continue; }
+				toValues(b, v);
+				bc->setBar(batch->begindt, batch->enddt, v);
+			}
+		});
+	}
+
+	/**
+	* @brief add a sink appending the closed bars to the BarLists of the BarMakers in BarMgr,
+	* then updating their indicators and firing their NewBar signals
+	*
+	* Runs on the thread calling addTicks/onTime/flush even with a task pool, that thread must be
+	* the one updating the BarMakers, as their BarLists and indicators have no locks.
+	*
+	* @param tomongo as also insert the bars to MongoDB, blocks the calling thread, prefer addBarDBWriterSink
+	*/
+	void addBarMgrSink(bool tomongo = false)
+	{
+		int span = m_span;
+		addSink("barmgr", [span, tomongo](const MarketBarBatchPtr& batch) {
+			BarMgr* mgr = BarMgr::getInstance();
+			for (const MarketBar& b : batch->bars)
+			{
+				if (!mgr->hasBarMakerForIidWithSpan(b.iid, span)) { continue; }
+				BarMakerPtr& bm = mgr->getBarMakerForIidWithSpan(b.iid, span);
+				BarPtr bar = toBar(b, batch->begindt, batch->enddt);
+				bm->bars()->addBar(bar);
+				for (const std::string& name : bm->getBarIndicatorNames())
+				{
+					bm->getBarIndicatorByName(name)->onNewBar();
+				}
+				if (tomongo) { bm->insertBarToMongo(bar, bm->getName(), bm->getMongo60sColName()); }
+				bm->emitSignalNewBar(b.iid, batch->begindt);
+			}
+		}, false);
+	}
+
+	/**
+	* @brief add a sink queueing the closed bars to a BarDBWriter
+	*
+	* @param writer as started writer
+	* @param exch as exchange id
+	* @param instrof as function returning the instrument id of an iid, empty to skip it
+	*/
+	void addBarDBWriterSink(const BarDBWriterPtr& writer, const std::string& exch, const std::function<std::string(int)>& instrof)
+	{
+		int span = m_span;
+		addSink("dbwriter", [writer, exch, instrof, span](const MarketBarBatchPtr& batch) {
+			for (const MarketBar& b : batch->bars)
+			{
+				std::string instrid = instrof(b.iid);
+				if (instrid.empty()) { continue; }
+				writer->addBar(exch, instrid, span, toBar(b, batch->begindt, batch->enddt));
+			}
+		});
+	}
+	///@}
+
+public:
+	/**
+	* @name Updating
+	*/
+	///@{
+	/**
+	* @brief apply a batch of ticks, sorted by time
+	*
+	* Bars are closed when a tick of a later bar arrives. Ticks older than the open bars
+	* are dropped and counted as late, their bars are already emitted.
+	*/
+	void addTicks(const MarketTick* ticks, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			const MarketTick& t = ticks[i];
+			int slot = slotOf(t.iid);
+			if (slot < 0)
+			{
+				++m_unknownTicks;
+				continue;
+			}
+			int64_t begin = barBegin(t.ts);
+			if (begin > m_currBegin)
+			{
+				if (m_currBegin != INT64_MIN) { closeBars(); }
+				m_currBegin = begin;
+			}
+			else if (begin < m_currBegin)
+			{
+				++m_lateTicks;
+				continue;
+			}
+			if (m_tickCounts[slot] == 0)
+			{
+				m_open[slot] = m_high[slot] = m_low[slot] = t.px;
+			}
+			else
+			{
+				if (t.px > m_high[slot]) { m_high[slot] = t.px; }
+				if (t.px < m_low[slot]) { m_low[slot] = t.px; }
+			}
+			m_close[slot] = t.px;
+			m_volume[slot] += (double)t.volume;
+			m_oichg[slot] += (double)t.oichg;
+			m_bsvoldiff[slot] += (double)t.bsvoldiff;
+			m_turnover[slot] += t.turnover;
+			m_bstdiff[slot] += t.bstdiff;
+			m_flipups[slot] += t.flipups;
+			m_flipdns[slot] += t.flipdns;
+			++m_tickCounts[slot];
+			++m_ticks;
+		}
+	}
+
+	void addTicks(const std::vector<MarketTick>& ticks)
+	{
+		if (!ticks.empty()) { addTicks(ticks.data(), ticks.size()); }
+	}
+
+	/**
+	* @brief close the open bars if ts is past their end, e.g. from a timer when the market is quiet
+	*
+	* @return if bars were closed
+	*/
+	bool onTime(int64_t ts)
+	{
+		if (m_currBegin == INT64_MIN || ts < m_currBegin + m_spandt) { return false; }
+		closeBars();
+		m_currBegin = barBegin(ts);
+		return true;
+	}
+
+	/**
+	* @brief close the open bars now, e.g. at the session end
+	*/
+	void flush()
+	{
+		if (m_currBegin == INT64_MIN) { return; }
+		closeBars();
+		m_currBegin = INT64_MIN;
+	}
+
+	/** begin timestamp of the open bars */
+	int64_t getCurrBegin() const { return m_currBegin; }
+	///@}
+
+public:
+	/**
+	* @name Open bars
+	*/
+	///@{
+	int getTickCount(int iid) const
+	{
+		int slot = slotOf(iid);
+		return slot < 0 ? 0 : m_tickCounts[slot];
+	}
+
+	/**
+	* @brief open bar of an instrument
+	*
+	* @return false if it has no tick in the open bar
+	*/
+	bool getOpenBar(int iid, MarketBar& bar) const
+	{
+		int slot = slotOf(iid);
+		if (slot < 0 || m_tickCounts[slot] == 0) { return false; }
+		bar = makeBar(slot);
+		return true;
+	}
+	///@}
+
+	std::string statsStr() const
+	{
+		return "span:" + std::to_string(m_span) + ",instrs:" + std::to_string(m_iids.size()) + ",ticks:" + std::to_string(m_ticks)
+			+ ",late:" + std::to_string(m_lateTicks) + ",unknown:" + std::to_string(m_unknownTicks) + ",batches:" + std::to_string(m_batches);
+	}
+
+	/**
+	* @brief fill BarField values of a bar
+	*/
+	static void toValues(const MarketBar& b, double* v)
+	{
+		v[BarField::Open] = b.open;
+		v[BarField::High] = b.high;
+		v[BarField::Low] = b.low;
+		v[BarField::Close] = b.close;
+		v[BarField::Volume] = b.volume;
+		v[BarField::Oichg] = b.oichg;
+		v[BarField::Bsvoldiff] = b.bsvoldiff;
+		v[BarField::Turnover] = b.turnover;
+		v[BarField::Bstdiff] = b.bstdiff;
+		v[BarField::Flipup] = b.flipups;
+		v[BarField::Flipdn] = b.flipdns;
+	}
+
+	/**
+	* @brief create a Bar object, e.g. for BarList::addBar
+	*/
+	static BarPtr toBar(const MarketBar& b, int64_t begindt, int64_t enddt)
+	{
+		BarPtr bar(new Bar());
+		bar->setBegindt(begindt);
+		bar->setEnddt(enddt);
+		bar->setOpen(b.open);
+		bar->setHigh(b.high);
+		bar->setLow(b.low);
+		bar->setClose(b.close);
+		bar->setVolume((int64_t)b.volume);
+		bar->setOichg((int64_t)b.oichg);
+		bar->setBsvoldiff((int64_t)b.bsvoldiff);
+		bar->setAmount(b.turnover);
+		bar->setBsadiff(b.bstdiff);
+		bar->setFlipups(b.flipups);
+		bar->setFlipdns(b.flipdns);
+		return bar;
+	}
+
+protected:
+	struct Sink
+	{
+		BarSink fn;
+		int strand;
+	};
+
+	int slotOf(int iid) const
+	{
+		return (iid >= 0 && (size_t)iid < m_slotOfIid.size()) ? m_slotOfIid[iid] : -1;
+	}
+
+	int64_t barBegin(int64_t ts) const
+	{
+		int64_t r = ts % m_spandt;
+		return r < 0 ? ts - r - m_spandt : ts - r;
+	}
+
+	MarketBar makeBar(int slot) const
+	{
+		MarketBar b;
+		b.iid = m_iids[slot];
+		b.ticks = m_tickCounts[slot];
+		b.open = m_open[slot];
+		b.high = m_high[slot];
+		b.low = m_low[slot];
+		b.close = m_close[slot];
+		b.volume = m_volume[slot];
+		b.oichg = m_oichg[slot];
+		b.bsvoldiff = m_bsvoldiff[slot];
+		b.turnover = m_turnover[slot];
+		b.bstdiff = m_bstdiff[slot];
+		b.flipups = m_flipups[slot];
+		b.flipdns = m_flipdns[slot];
+		return b;
+	}
+
+	/**
+	* @brief emit and reset the open bars in one sweep
+	*/
+	void closeBars()
+	{
+		std::shared_ptr<MarketBarBatch> batch(new MarketBarBatch());
+		batch->span = m_span;
+		batch->begindt = m_currBegin;
+		batch->enddt = m_currBegin + m_spandt;
+		size_t n = m_iids.size();
+		batch->bars.reserve(n);
+		for (size_t s = 0; s < n; ++s)
+		{
+			if (m_tickCounts[s] > 0)
+			{
+				batch->bars.push_back(makeBar((int)s));
+				m_lastClose[s] = m_close[s];
+			}
+			else if (m_fillEmptyBars && !std::isnan(m_lastClose[s]))
+			{
+				MarketBar b = makeBar((int)s);
+				b.open = b.high = b.low = b.close = m_lastClose[s];
+				batch->bars.push_back(b);
+			}
+		}
+		std::fill(m_tickCounts.begin(), m_tickCounts.end(), 0);
+		std::fill(m_volume.begin(), m_volume.end(), 0.0);
+		std::fill(m_oichg.begin(), m_oichg.end(), 0.0);
+		std::fill(m_bsvoldiff.begin(), m_bsvoldiff.end(), 0.0);
+		std::fill(m_turnover.begin(), m_turnover.end(), 0.0);
+		std::fill(m_bstdiff.begin(), m_bstdiff.end(), 0.0);
+		std::fill(m_flipups.begin(), m_flipups.end(), 0.0);
+		std::fill(m_flipdns.begin(), m_flipdns.end(), 0.0);
+		if (batch->bars.empty()) { return; }
+
+		++m_batches;
+		MarketBarBatchPtr cbatch(batch);
+		for (const Sink& s : m_sinks)
+		{
+			if (m_pool && s.strand >= 0 && m_pool->running())
+			{
+				BarSink fn = s.fn;
+				m_pool->Post(s.strand, [fn, cbatch]() { fn(cbatch); });
+			}
+			else
+			{
+				s.fn(cbatch);
+			}
+		}
+	}
+
+protected:
+	int m_span; ///< bar seconds
+	int64_t m_spandt; ///< bar length in timestamp units
+	DateTimeType::enumtype m_dtType; ///< datetime type
+	int64_t m_currBegin; ///< begin timestamp of the open bars
+	bool m_fillEmptyBars; ///< emit flat bars for instruments without ticks
+
+	std::vector<int> m_slotOfIid; ///< iid to slot, -1 if not added
+	std::vector<int> m_iids; ///< slot to iid
+
+	std::vector<int> m_tickCounts; ///< ticks in the open bar
+	std::vector<double> m_lastClose; ///< close of the last emitted bar
+	std::vector<double> m_open; ///< open of the open bar
+	std::vector<double> m_high; ///< high of the open bar
+	std::vector<double> m_low; ///< low of the open bar
+	std::vector<double> m_close; ///< close of the open bar
+	std::vector<double> m_volume; ///< volume of the open bar
+	std::vector<double> m_oichg; ///< open interest change of the open bar
+	std::vector<double> m_bsvoldiff; ///< buy sell volume difference of the open bar
+	std::vector<double> m_turnover; ///< turnover of the open bar
+	std::vector<double> m_bstdiff; ///< buy sell turnover difference of the open bar
+	std::vector<double> m_flipups; ///< flip ups of the open bar
+	std::vector<double> m_flipdns; ///< flip downs of the open bar
+
+	TaskPool* m_pool; ///< pool running the sinks, null to run them inline
+	std::vector<Sink> m_sinks; ///< sinks of closed bars
+
+	uint64_t m_ticks; ///< ticks applied
+	uint64_t m_lateTicks; ///< ticks older than the open bars, dropped
+	uint64_t m_unknownTicks; ///< ticks of instruments not added
+	uint64_t m_batches; ///< batches emitted
+};//class MarketBarEngine
+
+}//namespace XT
+
+#endif
@@ -0,0 +1,185 @@
+#pragma once
+#ifndef XT_STREAM_BAR_INDICATOR_H
+#define XT_STREAM_BAR_INDICATOR_H
+
+/**
+* \file StreamBarIndicator.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a bar indicator updated incrementally on new bars.
+*
+* \description
+*	Designed for indicators on live bars. The full TA-Lib calculation of BarIndicator is
+*	used for the warm-up (calcAll), after which the TAStream of the function keeps the
+*	outputs of the last bars up to date in O(1) per bar. Functions without a stream fall
+*	back to BarIndicator. verifyStream() checks the streamed outputs against TA-Lib.
+*/
+
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "XTConfig.h"
+#include "StringMap.h"
+#include "Bar.h"
+#include "BarIndicator.h"
+#include "TALibFuncInfo.h"
+#include "TAStream.h"
+#include "log4z.h"
+
+namespace XT
+{
+
+class StreamBarIndicator : public BarIndicator
+{
+public:
+	StreamBarIndicator() : m_consumed(0) {}
+
+	virtual ~StreamBarIndicator() {}
+
+public:
+	/**
+	* @brief initialize with parameters and create the stream of the function
+	*
+	* @param smp as string map parameters, optional inputs by TA-Lib parameter name
+	*/
+	virtual void init(StringMapPtr& smp) override
+	{
+		BarIndicator::init(smp);
+		m_consumed = 0;
+		m_stream.reset();
+		if (!m_talibFuncInfo || !TAStream::isSupported(m_talibFuncInfo->getName())) { return; }
+
+		std::map<std::string, double> params;
+		for (auto& info : m_talibFuncInfo->optInputParameterInfos())
+		{
+			const std::string& pname = info->getParamName();
+			if (smp && smp->hasKey(pname)) { params[pname] = smp->getDouble(pname); }
+			else { params[pname] = info->getDefaultValue(); }
+		}
+		m_stream = TAStream::create(m_talibFuncInfo->getName(), params);
+	}
+
+	/**
+	* @brief calculate all bars with TA-Lib and rebuild the stream state
+	*/
+	virtual void calcAll() override
+	{
+		BarIndicator::calcAll();
+		if (!m_stream) { return; }
+		m_stream->reset();
+		m_consumed = 0;
+		int n = barCount();
+		for (int i = 0; i < n; ++i) { m_stream->push(barAt(i)); }
+		m_consumed = n;
+	}
+
+	/**
+	* @brief update the last bar and calculate the new ones
+	*/
+	virtual void onNewBar() override
+	{
+		if (!m_stream)
+		{
+			BarIndicator::onNewBar();
+			return;
+		}
+		int n = barCount();
+		if (n < m_consumed || m_consumed == 0)
+		{
+			calcAll();
+			return;
+		}
+		resizeOutputs(n);
+		// the last consumed bar may have been updated before it was closed
+		m_stream->replaceLast(barAt(m_consumed - 1));
+		writeOutputs(m_consumed - 1);
+		for (int i = m_consumed; i < n; ++i)
+		{
+			m_stream->push(barAt(i));
+			writeOutputs(i);
+		}
+		m_consumed = n;
+	}
+
+	/**
+	* @brief compare the streamed outputs with a full TA-Lib calculation, which replaces them
+	*
+	* @param tol as absolute tolerance
+	*
+	* @return number of mismatched values
+	*/
+	int verifyStream(double tol = 1e-9)
+	{
+		if (!m_stream) { return 0; }
+		boost::array<std::vector<double>, 3 > streamed = m_doubleOutputs;
+		calcAll();
+		int mismatches = 0;
+		int nbout = m_stream->getNbOutput();
+		for (int k = 0; k < nbout; ++k)
+		{
+			size_t n = std::min(streamed[k].size(), m_doubleOutputs[k].size());
+			for (size_t i = (size_t)std::max(0, m_stream->getLookback()); i < n; ++i)
+			{
+				if (std::fabs(streamed[k][i] - m_doubleOutputs[k][i]) > tol)
+				{
+					if (mismatches == 0)
+					{
+						LOGW("StreamBarIndicator " + m_name + " output " + std::to_string(k) + " differs at bar " + std::to_string(i)
+							+ ": stream " + std::to_string(streamed[k][i]) + " talib " + std::to_string(m_doubleOutputs[k][i]));
+					}
+					++mismatches;
+				}
+			}
+		}
+		if (mismatches > 0) { LOGW("StreamBarIndicator " + m_name + " mismatches:" + std::to_string(mismatches)); }
+		return mismatches;
+	}
+
+	/** is the indicator updated by a stream */
+	bool isStreaming() const { return (bool)m_stream; }
+
+	const TAStreamPtr& getStream() const { return m_stream; }
+
+protected:
+	int barCount()
+	{
+		return m_barList ? (int)m_barList->closes().size() : 0;
+	}
+
+	TABar barAt(int i)
+	{
+		TABar b;
+		b.open = m_barList->opens()[i];
+		b.high = m_barList->highs()[i];
+		b.low = m_barList->lows()[i];
+		b.close = m_barList->closes()[i];
+		b.volume = m_barList->volumes()[i];
+		return b;
+	}
+
+	void resizeOutputs(int n)
+	{
+		for (int k = 0; k < m_stream->getNbOutput(); ++k)
+		{
+			if ((int)m_doubleOutputs[k].size() < n) { m_doubleOutputs[k].resize(n, 0.0); }
+		}
+	}
+
+	void writeOutputs(int i)
+	{
+		if (!m_stream->isReady()) { return; }
+		for (int k = 0; k < m_stream->getNbOutput(); ++k) { m_doubleOutputs[k][i] = m_stream->getOutput(k); }
+	}
+
+protected:
+	TAStreamPtr m_stream; ///< stream of the function, null if not supported
+	int m_consumed; ///< bars pushed to the stream
+};//class StreamBarIndicator
+
+}//namespace XT
+
+#endif
@@ -55,12 +55,12 @@ public:
 	/**
 	* @brief default copy constructor
 	*/
-	TALibMgr(const TALibMgr& from) {}// = delete;
+	TALibMgr(const TALibMgr&) {}// = delete;
 
 	/**
 	* @brief default copy assignment
 	*/
-	TALibMgr& operator=(const TALibMgr& from) { return *this; } // = delete;
+	TALibMgr& operator=(const TALibMgr&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
@@ -0,0 +1,693 @@
+#pragma once
+#ifndef XT_TASTREAM_H
+#define XT_TASTREAM_H
+
+/**
+* \file TAStream.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide streaming versions of common TA-Lib functions.
+*
+* \description
+*	Designed for updating bar indicators in O(1) per new or updated bar. Each stream follows
+*	the arithmetic of the TA-Lib function (default compatibility, no unstable period) run
+*	from the first bar, so the outputs match a full TA-Lib calculation over the same bars.
+*	push() appends a bar, replaceLast() recalculates the last bar after it was updated.
+*
+*	Supported: SMA, EMA, RSI, MACD, ATR, TRANGE, STDDEV, VAR, BBANDS (SMA middle band), ADX.
+*/
+
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+
+#include "XTConfig.h"
+
+namespace XT
+{
+
+	/**
+	* bar input of a stream
+	*/
+	struct TABar
+	{
+		double open;
+		double high;
+		double low;
+		double close;
+		double volume;
+	};
+
+	class TAStream;
+	typedef std::shared_ptr<TAStream> TAStreamPtr;
+
+class TAStream
+{
+public:
+	/**
+	* @brief constructor
+	*
+	* @param name as TA-Lib function name
+	* @param nboutput as number of outputs
+	* @param lookback as index of the first bar with output
+	*/
+	TAStream(const std::string& name, int nboutput, int lookback)
+		: m_name(name), m_nbOutput(nboutput), m_lookback(lookback), m_count(0), m_idx(-1), m_ready(false)
+	{
+		m_out[0] = m_out[1] = m_out[2] = 0.0;
+	}
+
+	virtual ~TAStream() {}
+
+	const std::string& getName() const { return m_name; }
+
+	/** number of outputs, 1 to 3 */
+	int getNbOutput() const { return m_nbOutput; }
+
+	/** index of the first bar with output, as TA-Lib lookback */
+	int getLookback() const { return m_lookback; }
+
+	/** number of bars pushed */
+	int getCount() const { return m_count; }
+
+	/** does the last bar have output */
+	bool isReady() const { return m_ready; }
+
+	/**
+	* @brief output of the last bar
+	*
+	* @param outidx as output index, 0 to 2
+	*/
+	double getOutput(int outidx) const { return m_out[outidx]; }
+
+	/**
+	* @brief append a bar
+	*/
+	void push(const TABar& bar)
+	{
+		save();
+		m_idx = m_count++;
+		m_ready = step(bar);
+	}
+
+	/**
+	* @brief recalculate the last bar after it was updated
+	*/
+	void replaceLast(const TABar& bar)
+	{
+		if (m_count == 0)
+		{
+			push(bar);
+			return;
+		}
+		restore();
+		m_ready = step(bar);
+	}
+
+	/**
+	* @brief drop all bars
+	*/
+	void reset()
+	{
+		clear();
+		m_count = 0;
+		m_idx = -1;
+		m_ready = false;
+	}
+
+public:
+	/**
+	* @brief create a stream for a TA-Lib function
+	*
+	* @param funcname as TA-Lib function name such as EMA
+	* @param params as TA-Lib optional inputs by name, e.g. optInTimePeriod, missing ones use TA-Lib defaults
+	*
+	* @return stream, nullptr if the function is not supported
+	*/
+	static TAStreamPtr create(const std::string& funcname, const std::map<std::string, double>& params);
+
+	/**
+	* @brief is there a stream for the TA-Lib function
+	*/
+	static bool isSupported(const std::string& funcname)
+	{
+		static const char* names[] = { "SMA", "EMA", "RSI", "MACD", "ATR", "TRANGE", "STDDEV", "VAR", "BBANDS", "ADX" };
+		for (const char* n : names)
+		{
+			if (funcname == n) { return true; }
+		}
+		return false;
+	}
+
+	/** TA_IS_ZERO of TA-Lib */
+	static bool isZero(double v) { return (-0.00000001 < v) && (v < 0.00000001); }
+
+	/** TA_IS_ZERO_OR_NEG of TA-Lib */
+	static bool isZeroOrNeg(double v) { return v < 0.00000001; }
+
+	/** true range as TA-Lib TRANGE */
+	static double trueRange(double high, double low, double prevclose)
+	{
+		double greatest = high - low;
+		double v = std::fabs(prevclose - high);
+		if (v > greatest) { greatest = v; }
+		v = std::fabs(prevclose - low);
+		if (v > greatest) { greatest = v; }
+		return greatest;
+	}
+
+	/** PER_TO_K of TA-Lib */
+	static double perToK(int period) { return 2.0 / (double)(period + 1); }
+
+protected:
+	/** keep the state before the bar being pushed */
+	virtual void save() = 0;
+	/** go back to the state before the last bar */
+	virtual void restore() = 0;
+	/** reset the state */
+	virtual void clear() = 0;
+	/**
+	* @brief calculate bar m_idx from the state of the previous bar
+	*
+	* @return if the bar has output
+	*/
+	virtual bool step(const TABar& bar) = 0;
+
+protected:
+	std::string m_name; ///< function name
+	int m_nbOutput; ///< number of outputs
+	int m_lookback; ///< index of first output
+	int m_count; ///< bars pushed
+	int m_idx; ///< index of the bar being calculated
+	bool m_ready; ///< last bar has output
+	double m_out[3]; ///< outputs of the last bar
+};//class TAStream
+
+/**
+* stream with a copyable state, saved before each new bar
+*/
+template<typename S>
+class TAStreamWithState : public TAStream
+{
+public:
+	TAStreamWithState(const std::string& name, int nboutput, int lookback) : TAStream(name, nboutput, lookback) {}
+
+protected:
+	void save() override { m_saved = m_state; }
+	void restore() override { m_state = m_saved; }
+	void clear() override { m_state = S(); m_saved = S(); }
+
+protected:
+	S m_state; ///< state after the last bar
+	S m_saved; ///< state before the last bar
+};
+
+/**
+* last period values of a window, slot of bar i is i % period
+*/
+class TAWindow
+{
+public:
+	explicit TAWindow(int period) : m_values((size_t)std::max(1, period), 0.0) {}
+
+	void set(int idx, double v) { m_values[(size_t)idx % m_values.size()] = v; }
+	double get(int idx) const { return m_values[(size_t)idx % m_values.size()]; }
+
+protected:
+	std::vector<double> m_values;
+};
+
+struct TASumState
+{
+	double total;
+	double total2;
+	TASumState() : total(0), total2(0) {}
+};
+
+/**
+* SMA on close, as TA_INT_SMA
+*/
+class TAStreamSMA : public TAStreamWithState<TASumState>
+{
+public:
+	explicit TAStreamSMA(int period, const std::string& name = "SMA")
+		: TAStreamWithState<TASumState>(name, 1, period - 1), m_period(period), m_window(period) {}
+
+protected:
+	bool step(const TABar& bar) override
+	{
+		double x = bar.close;
+		m_window.set(m_idx, x);
+		if (m_idx < m_period - 1)
+		{
+			m_state.total += x;
+			return false;
+		}
+		m_state.total += x;
+		double tmp = m_state.total;
+		m_state.total -= m_window.get(m_idx - m_period + 1);
+		m_out[0] = tmp / m_period;
+		return true;
+	}
+
+	int m_period;
+	TAWindow m_window;
+};
+
+struct TAEmaState
+{
+	double sum;
+	double ema;
+	TAEmaState() : sum(0), ema(0) {}
+};
+
+/**
+* EMA on close seeded with the SMA of the first period bars, as TA_INT_EMA
+*/
+class TAStreamEMA : public TAStreamWithState<TAEmaState>
+{
+public:
+	explicit TAStreamEMA(int period)
+		: TAStreamWithState<TAEmaState>("EMA", 1, period - 1), m_period(period), m_k(perToK(period)) {}
+
+protected:
+	bool step(const TABar& bar) override
+	{
+		double x = bar.close;
+		if (m_idx < m_period - 1)
+		{
+			m_state.sum += x;
+			return false;
+		}
+		if (m_idx == m_period - 1)
+		{
+			m_state.sum += x;
+			m_state.ema = m_state.sum / m_period;
+		}
+		else
+		{
+			m_state.ema = ((x - m_state.ema) * m_k) + m_state.ema;
+		}
+		m_out[0] = m_state.ema;
+		return true;
+	}
+
+	int m_period;
+	double m_k;
+};
+
+struct TARsiState
+{
+	double prevValue;
+	double gain;
+	double loss;
+	TARsiState() : prevValue(0), gain(0), loss(0) {}
+};
+
+/**
+* RSI on close with Wilder smoothing, as TA_RSI
+*/
+class TAStreamRSI : public TAStreamWithState<TARsiState>
+{
+public:
+	explicit TAStreamRSI(int period)
+		: TAStreamWithState<TARsiState>("RSI", 1, period), m_period(period) {}
+
+protected:
+	bool step(const TABar& bar) override
+	{
+		double x = bar.close;
+		if (m_idx == 0)
+		{
+			m_state.prevValue = x;
+			return false;
+		}
+		double diff = x - m_state.prevValue;
+		m_state.prevValue = x;
+		if (m_idx <= m_period)
+		{
+			if (diff < 0) { m_state.loss -= diff; }
+			else { m_state.gain += diff; }
+			if (m_idx < m_period) { return false; }
+			m_state.loss /= m_period;
+			m_state.gain /= m_period;
+		}
+		else
+		{
+			m_state.loss *= (m_period - 1);
+			m_state.gain *= (m_period - 1);
+			if (diff < 0) { m_state.loss -= diff; }
+			else { m_state.gain += diff; }
+			m_state.loss /= m_period;
+			m_state.gain /= m_period;
+		}
+		double t = m_state.gain + m_state.loss;
+		m_out[0] = !isZero(t) ? 100.0 * (m_state.gain / t) : 0.0;
+		return true;
+	}
+
+	int m_period;
+};
+
+struct TAMacdState
+{
+	double slowSum;
+	double fastSum;
+	double slowEma;
+	double fastEma;
+	double signalSum;
+	double signal;
+	TAMacdState() : slowSum(0), fastSum(0), slowEma(0), fastEma(0), signalSum(0), signal(0) {}
+};
+
+/**
+* MACD on close, outputs MACD, MACDSignal, MACDHist, as TA_MACD
+*
+* The fast EMA is seeded on the same bar as the slow one, with the SMA of its last fast period bars.
+*/
+class TAStreamMACD : public TAStreamWithState<TAMacdState>
+{
+public:
+	TAStreamMACD(int fast, int slow, int signal)
+		: TAStreamWithState<TAMacdState>("MACD", 3, std::max(fast, slow) - 1 + signal - 1),
+		m_fast(std::min(fast, slow)), m_slow(std::max(fast, slow)), m_signal(signal),
+		m_kFast(perToK(std::min(fast, slow))), m_kSlow(perToK(std::max(fast, slow))), m_kSignal(perToK(signal)) {}
+
+protected:
+	bool step(const TABar& bar) override
+	{
+		double x = bar.close;
+		if (m_idx < m_slow - 1)
+		{
+			m_state.slowSum += x;
+			if (m_idx >= m_slow - m_fast) { m_state.fastSum += x; }
+			return false;
+		}
+		if (m_idx == m_slow - 1)
+		{
+			m_state.slowSum += x;
+			m_state.fastSum += x;
+			m_state.slowEma = m_state.slowSum / m_slow;
+			m_state.fastEma = m_state.fastSum / m_fast;
+		}
+		else
+		{
+			m_state.slowEma = ((x - m_state.slowEma) * m_kSlow) + m_state.slowEma;
+			m_state.fastEma = ((x - m_state.fastEma) * m_kFast) + m_state.fastEma;
+		}
+		double macd = m_state.fastEma - m_state.slowEma;
+		int j = m_idx - (m_slow - 1);
+		if (j < m_signal - 1)
+		{
+			m_state.signalSum += macd;
+			return false;
+		}
+		if (j == m_signal - 1)
+		{
+			m_state.signalSum += macd;
+			m_state.signal = m_state.signalSum / m_signal;
+		}
+		else
+		{
+			m_state.signal = ((macd - m_state.signal) * m_kSignal) + m_state.signal;
+		}
+		m_out[0] = macd;
+		m_out[1] = m_state.signal;
+		m_out[2] = macd - m_state.signal;
+		return true;
+	}
+
+	int m_fast;
+	int m_slow;
+	int m_signal;
+	double m_kFast;
+	double m_kSlow;
+	double m_kSignal;
+};
+
+struct TAAtrState
+{
+	double prevClose;
+	double sum;
+	double atr;
+	TAAtrState() : prevClose(0), sum(0), atr(0) {}
+};
+
+/**
+* ATR with Wilder smoothing, as TA_ATR, TRANGE for period 1
+*/
+class TAStreamATR : public TAStreamWithState<TAAtrState>
+{
+public:
+	explicit TAStreamATR(int period, const std::string& name = "ATR")
+		: TAStreamWithState<TAAtrState>(name, 1, std::max(1, period)), m_period(std::max(1, period)) {}
+
+protected:
+	bool step(const TABar& bar) override
+	{
+		if (m_idx == 0)
+		{
+			m_state.prevClose = bar.close;
+			return false;
+		}
+		double tr = trueRange(bar.high, bar.low, m_state.prevClose);
+		m_state.prevClose = bar.close;
+		if (m_period == 1)
+		{
+			m_out[0] = tr;
+			return true;
+		}
+		if (m_idx < m_period)
+		{
+			m_state.sum += tr;
+			return false;
+		}
+		if (m_idx == m_period)
+		{
+			m_state.sum += tr;
+			m_state.atr = m_state.sum / m_period;
+		}
+		else
+		{
+			m_state.atr *= m_period - 1;
+			m_state.atr += tr;
+			m_state.atr /= m_period;
+		}
+		m_out[0] = m_state.atr;
+		return true;
+	}
+
+	int m_period;
+};
+
+/**
+* STDDEV or VAR on close, as TA_STDDEV and TA_VAR
+*/
+class TAStreamSTDDEV : public TAStreamWithState<TASumState>
+{
+public:
+	TAStreamSTDDEV(int period, double nbdev, bool variance = false)
+		: TAStreamWithState<TASumState>(variance ? "VAR" : "STDDEV", 1, period - 1),
+		m_period(period), m_nbDev(nbdev), m_variance(variance), m_window(period) {}
+
+protected:
+	bool step(const TABar& bar) override
+	{
+		double x = bar.close;
+		m_window.set(m_idx, x);
+		m_state.total += x;
+		m_state.total2 += x * x;
+		if (m_idx < m_period - 1) { return false; }
+		double mean1 = m_state.total / m_period;
+		double mean2 = m_state.total2 / m_period;
+		double t = m_window.get(m_idx - m_period + 1);
+		m_state.total -= t;
+		m_state.total2 -= t * t;
+		double var = mean2 - mean1 * mean1;
+		if (m_variance) { m_out[0] = var; }
+		else { m_out[0] = !isZeroOrNeg(var) ? std::sqrt(var) * m_nbDev : 0.0; }
+		return true;
+	}
+
+	int m_period;
+	double m_nbDev;
+	bool m_variance;
+	TAWindow m_window;
+};
+
+/**
+* BBANDS on close with an SMA middle band, outputs upper, middle, lower, as TA_BBANDS
+*/
+class TAStreamBBANDS : public TAStreamWithState<TASumState>
+{
+public:
+	TAStreamBBANDS(int period, double nbdevup, double nbdevdn)
+		: TAStreamWithState<TASumState>("BBANDS", 3, period - 1),
+		m_period(period), m_nbDevUp(nbdevup), m_nbDevDn(nbdevdn), m_window(period) {}
+
+protected:
+	bool step(const TABar& bar) override
+	{
+		double x = bar.close;
+		m_window.set(m_idx, x);
+		m_state.total += x;
+		m_state.total2 += x * x;
+		if (m_idx < m_period - 1) { return false; }
+		double tmp = m_state.total;
+		double mean2 = m_state.total2 / m_period;
+		double t = m_window.get(m_idx - m_period + 1);
+		m_state.total -= t;
+		m_state.total2 -= t * t;
+		double ma = tmp / m_period;
+		mean2 -= ma * ma;
+		double sd = !isZeroOrNeg(mean2) ? std::sqrt(mean2) : 0.0;
+		m_out[0] = ma + sd * m_nbDevUp;
+		m_out[1] = ma;
+		m_out[2] = ma - sd * m_nbDevDn;
+		return true;
+	}
+
+	int m_period;
+	double m_nbDevUp;
+	double m_nbDevDn;
+	TAWindow m_window;
+};
+
+struct TAAdxState
+{
+	double prevHigh;
+	double prevLow;
+	double prevClose;
+	double minusDM;
+	double plusDM;
+	double tr;
+	double sumDX;
+	double adx;
+	TAAdxState() : prevHigh(0), prevLow(0), prevClose(0), minusDM(0), plusDM(0), tr(0), sumDX(0), adx(0) {}
+};
+
+/**
+* ADX, as TA_ADX
+*/
+class TAStreamADX : public TAStreamWithState<TAAdxState>
+{
+public:
+	explicit TAStreamADX(int period)
+		: TAStreamWithState<TAAdxState>("ADX", 1, 2 * period - 1), m_period(period) {}
+
+protected:
+	bool step(const TABar& bar) override
+	{
+		TAAdxState& s = m_state;
+		if (m_idx == 0)
+		{
+			s.prevHigh = bar.high;
+			s.prevLow = bar.low;
+			s.prevClose = bar.close;
+			return false;
+		}
+		double diffP = bar.high - s.prevHigh;
+		s.prevHigh = bar.high;
+		double diffM = s.prevLow - bar.low;
+		s.prevLow = bar.low;
+		if (m_idx >= m_period)
+		{
+			s.minusDM -= s.minusDM / m_period;
+			s.plusDM -= s.plusDM / m_period;
+		}
+		if ((diffM > 0) && (diffP < diffM)) { s.minusDM += diffM; }
+		else if ((diffP > 0) && (diffP > diffM)) { s.plusDM += diffP; }
+		double tr = trueRange(s.prevHigh, s.prevLow, s.prevClose);
+		if (m_idx < m_period) { s.tr += tr; }
+		else { s.tr = s.tr - (s.tr / m_period) + tr; }
+		s.prevClose = bar.close;
+		if (m_idx < m_period) { return false; }
+
+		bool hasDX = false;
+		double dx = 0;
+		if (!isZero(s.tr))
+		{
+			double minusDI = 100.0 * (s.minusDM / s.tr);
+			double plusDI = 100.0 * (s.plusDM / s.tr);
+			double t = minusDI + plusDI;
+			if (!isZero(t))
+			{
+				dx = 100.0 * (std::fabs(minusDI - plusDI) / t);
+				hasDX = true;
+			}
+		}
+		if (m_idx < 2 * m_period - 1)
+		{
+			if (hasDX) { s.sumDX += dx; }
+			return false;
+		}
+		if (m_idx == 2 * m_period - 1)
+		{
+			if (hasDX) { s.sumDX += dx; }
+			s.adx = s.sumDX / m_period;
+		}
+		else if (hasDX)
+		{
+			s.adx = ((s.adx * (m_period - 1)) + dx) / m_period;
+		}
+		m_out[0] = s.adx;
+		return true;
+	}
+
+	int m_period;
+};
+
+inline TAStreamPtr TAStream::create(const std::string& funcname, const std::map<std::string, double>& params)
+{
+	auto param = [&params](const char* key, double def) {
+		auto it = params.find(key);
+		return it != params.end() ? it->second : def;
+	};
+	// periods out of the TA-Lib ranges are left to TA-Lib, which rejects them
+	auto period = [&param](const char* key, double def, int minv) {
+		int v = (int)param(key, def);
+		return (v >= minv && v <= 100000) ? v : -1;
+	};
+	if (funcname == "TRANGE") { return TAStreamPtr(new TAStreamATR(1, "TRANGE")); }
+	if (funcname == "MACD")
+	{
+		int fast = period("optInFastPeriod", 12, 2);
+		int slow = period("optInSlowPeriod", 26, 2);
+		int signal = period("optInSignalPeriod", 9, 2);
+		if (fast < 0 || slow < 0 || signal < 0) { return TAStreamPtr(); }
+		return TAStreamPtr(new TAStreamMACD(fast, slow, signal));
+	}
+	if (funcname == "ATR")
+	{
+		int n = period("optInTimePeriod", 14, 1);
+		return n > 0 ? TAStreamPtr(new TAStreamATR(n)) : TAStreamPtr();
+	}
+	int n = -1;
+	if (funcname == "SMA" || funcname == "EMA") { n = period("optInTimePeriod", 30, 2); }
+	else if (funcname == "RSI" || funcname == "ADX") { n = period("optInTimePeriod", 14, 2); }
+	else if (funcname == "STDDEV" || funcname == "VAR" || funcname == "BBANDS") { n = period("optInTimePeriod", 5, 2); }
+	if (n < 0) { return TAStreamPtr(); }
+
+	if (funcname == "SMA") { return TAStreamPtr(new TAStreamSMA(n)); }
+	if (funcname == "EMA") { return TAStreamPtr(new TAStreamEMA(n)); }
+	if (funcname == "RSI") { return TAStreamPtr(new TAStreamRSI(n)); }
+	if (funcname == "ADX") { return TAStreamPtr(new TAStreamADX(n)); }
+	if (funcname == "STDDEV") { return TAStreamPtr(new TAStreamSTDDEV(n, param("optInNbDev", 1.0))); }
+	if (funcname == "VAR") { return TAStreamPtr(new TAStreamSTDDEV(n, 1.0, true)); }
+	if (funcname == "BBANDS")
+	{
+		// only the SMA middle band (optInMAType 0) is streamed
+		if ((int)param("optInMAType", 0) != 0) { return TAStreamPtr(); }
+		return TAStreamPtr(new TAStreamBBANDS(n, param("optInNbDevUp", 2.0), param("optInNbDevDn", 2.0)));
+	}
+	return TAStreamPtr();
+}
+
+}//namespace XT
+
+#endif
@@ -0,0 +1,183 @@
+/**
+* \file TestBarCache.cpp
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Check BarCache coverage, limits, eviction and concurrent readers.
+*
+* \description
+*	The loaders serve a bar every 60 seconds from 0 to 599940 and count their calls, so each
+*	check states how many queries a request may cost. The last check runs readers against a
+*	writer that loads new ranges, invalidates and evicts, then requires every retired snapshot
+*	and entry map to be reclaimed. Returns the number of failed checks; run it under
+*	-fsanitize=address or thread to catch a snapshot freed under a reader.
+*
+*	Bar, BarList, Instr and the managers are compiled into the xtcommon library, outside this
+*	header tree. The few members BarCache calls are defined below; bars and instruments are
+*	raw storage only used through those members.
+*/
+
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BarCache.h"
+
+using namespace XT;
+
+#define CHECK(cond) check((cond), __LINE__)
+
+namespace
+{
+	const int64_t kLastBar = 599940;
+
+	int s_failures = 0;
+	std::atomic<int> s_queries(0);
+	std::mutex s_mutex;
+	std::map<const Bar*, int64_t> s_begindt;
+	std::string s_instrid = "rb2501";
+
+	void check(bool ok, int line)
+	{
+		if (ok) { return; }
+		std::printf("check failed at line %d\n", line);
+		++s_failures;
+	}
+
+	BarPtr makeBar(int64_t ts)
+	{
+		BarPtr b(reinterpret_cast<Bar*>(new char[sizeof(Bar)]), [](Bar* p)
+		{
+			{
+				std::lock_guard<std::mutex> lock(s_mutex);
+				s_begindt.erase(p);
+			}
+			delete[] reinterpret_cast<char*>(p);
+		});
+		std::lock_guard<std::mutex> lock(s_mutex);
+		s_begindt[b.get()] = ts;
+		return b;
+	}
+
+	BarListPtr loadRange(InstrPtr&, int64_t startdt, int64_t enddt, int spanseconds)
+	{
+		++s_queries;
+		BarListPtr bl = BarList::create(spanseconds);
+		std::vector<BarPtr> bars;
+		for (int64_t t = std::max<int64_t>(0, (startdt + 59) / 60 * 60); t <= enddt && t <= kLastBar; t += 60) { bars.push_back(makeBar(t)); }
+		bl->addBarVector(bars);
+		return bl;
+	}
+
+	BarListPtr loadLimit(InstrPtr&, int64_t enddt, int numlimit, int spanseconds)
+	{
+		++s_queries;
+		BarListPtr bl = BarList::create(spanseconds);
+		std::vector<BarPtr> bars;
+		for (int64_t t = std::min<int64_t>(enddt / 60 * 60, kLastBar); t >= 0 && (int)bars.size() < numlimit; t -= 60) { bars.push_back(makeBar(t)); }
+		bl->addBarVector(bars);
+		return bl;
+	}
+}
+
+// out of line members used by BarCache
+int64_t Bar::getBegindt() { std::lock_guard<std::mutex> lock(s_mutex); return s_begindt[this]; }
+BarList::BarList() {}
+BarList::~BarList() {}
+BarListPtr BarList::create(int) { return BarListPtr(new BarList()); }
+std::map<int64_t, BarPtr>& BarList::bars() { return m_bars; }
+void BarList::addBarVector(std::vector<BarPtr>& bars) { for (BarPtr& b : bars) { m_bars[b->getBegindt()] = b; } }
+int BarList::getBarCount() { return (int)m_bars.size(); }
+void BarList::setRollingType(RollingType::enumtype) {}
+void BarList::setDateTimeType(DateTimeType::enumtype) {}
+RollingType::enumtype BarList::getRollingType() { return RollingType::Time; }
+DateTimeType::enumtype BarList::getDateTimeType() { return DateTimeType::UTS; }
+const std::string& Instr::getInstrID() { return s_instrid; }
+BarMgr* BarMgr::getInstance() { return nullptr; }
+BarListPtr BarMgr::getBarListForInstr(InstrPtr&, int64_t, int64_t, int) { return BarListPtr(); }
+BarListPtr BarMgr::getBarListForInstrWithLimit(InstrPtr&, int64_t, int, int) { return BarListPtr(); }
+InstrMgr* InstrMgr::getInstance() { return nullptr; }
+InstrPtr& InstrMgr::getInstr(const std::string&) { static InstrPtr p; return p; }
+SettingsMgr* SettingsMgr::getInstance() { return nullptr; }
+std::vector<std::string> SettingsMgr::getBar60sInstrIDs() { return std::vector<std::string>(); }
+namespace zsummer { namespace log4z { ILog4zManager* ILog4zManager::getInstance() { return nullptr; } } }
+
+int main()
+{
+	BarCache cache;
+	cache.setRangeLoader(loadRange);
+	cache.setLimitLoader(loadLimit);
+	InstrPtr instr(reinterpret_cast<Instr*>(new char[sizeof(Instr)]), [](Instr* p) { delete[] reinterpret_cast<char*>(p); });
+
+	// ranges: only the gaps are queried
+	CHECK(cache.getBarList(instr, 6000, 12000, 60)->getBarCount() == 101 && s_queries == 1);
+	CHECK(cache.getBarList(instr, 7000, 9000, 60)->getBarCount() == 34 && s_queries == 1);
+	CHECK(cache.getBarList(instr, 0, 30000, 60)->getBarCount() == 501 && s_queries == 3);
+	CHECK(cache.getBarList(instr, 0, 30000, 60)->getBarCount() == 501 && s_queries == 3);
+
+	// limits: served from the cache when covered, fewer bars than asked cover back to the start
+	BarListPtr bl = cache.getBarListWithLimit(instr, 20000, 50, 60);
+	CHECK(bl->getBarCount() == 50 && s_queries == 3 && bl->bars().rbegin()->first == 19980);
+	CHECK(cache.getBarListWithLimit(instr, 600, 100, 60)->getBarCount() == 11 && s_queries == 4);
+	CHECK(cache.getBarListWithLimit(instr, 600, 100, 60)->getBarCount() == 11 && s_queries == 4);
+	CHECK(cache.getBarList(instr, -5000, 100, 60)->getBarCount() == 2 && s_queries == 4);
+	CHECK(cache.getBarListWithLimit(instr, 50000, 100, 60)->getBarCount() == 100 && s_queries == 5);
+	CHECK(cache.getBarList(instr, 44100, 50000, 60)->getBarCount() == 99 && s_queries == 5);
+
+	// cover limit: the part after the limit is queried again
+	cache.setCoverLimit([](int) { return (int64_t)100000; });
+	CHECK(cache.getBarList(instr, 90000, 110000, 60)->getBarCount() == 334 && s_queries == 6);
+	CHECK(cache.getBarList(instr, 90000, 110000, 60)->getBarCount() == 334 && s_queries == 7);
+	CHECK(cache.getBarList(instr, 90000, 99000, 60)->getBarCount() == 151 && s_queries == 7);
+
+	// budget: a second instrument evicts the first
+	size_t bytes = cache.getStats().bytes;
+	cache.setMemoryBudget(bytes + 1000);
+	s_instrid = "ag2506";
+	cache.getBarList(instr, 0, 30000, 60);
+	BarCacheStats st = cache.getStats();
+	CHECK(st.evictions == 1 && st.bytes <= bytes + 1000 && st.entries == 2);
+	s_instrid = "rb2501";
+	int queries = s_queries;
+	cache.getBarList(instr, 7000, 9000, 60);
+	CHECK(s_queries == queries + 1);
+
+	// invalidate
+	queries = s_queries;
+	cache.invalidate("rb2501", 60);
+	CHECK(cache.getBarList(instr, 7000, 9000, 60)->getBarCount() == 34 && s_queries == queries + 1);
+
+	// readers against a writer loading, invalidating and evicting
+	cache.setMemoryBudget(0);
+	std::atomic<bool> stop(false);
+	std::atomic<int> bad(0);
+	std::vector<std::thread> readers;
+	for (int k = 0; k < 4; ++k)
+	{
+		readers.push_back(std::thread([&cache, &instr, &stop, &bad]()
+		{
+			while (!stop.load())
+			{
+				if (cache.getBarList(instr, 7000, 9000, 60)->getBarCount() != 34) { ++bad; }
+				if (cache.getStats().entries == 0) { ++bad; }
+			}
+		}));
+	}
+	for (int i = 0; i < 200; ++i)
+	{
+		cache.getBarList(instr, 200000 + i * 1000, 200999 + i * 1000, 60);
+		if (i % 50 == 49) { cache.invalidate("rb2501", 60); }
+		if (i % 50 == 25) { cache.setMemoryBudget(1); cache.setMemoryBudget(0); }
+	}
+	stop = true;
+	for (std::thread& t : readers) { t.join(); }
+	CHECK(bad.load() == 0);
+	CHECK(Epoch::Reclaim() == 0);
+
+	std::printf("%s\n%d failed\n", cache.statsStr().c_str(), s_failures);
+	return s_failures;
+}
@@ -0,0 +1,160 @@
+/**
+* \file TestTAStreamParity.cpp
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Check TAStream outputs against the bundled TA-Lib bit for bit.
+*
+* \description
+*	Every bar is first pushed with a perturbed close, high and low, then replaceLast() is
+*	called twice with the real bar, as StreamBarIndicator does for an updated last bar.
+*	Outputs must equal the full TA-Lib calculation exactly, and a stream must become ready
+*	on the first bar TA-Lib outputs. Returns the number of mismatches.
+*
+*	Built and run by the CMakeLists.txt next to this file, which compiles the TA-Lib C sources
+*	under third/ta-lib:
+*	cmake -S . -B build && cmake --build build && ctest --test-dir build --output-on-failure
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TAStream.h"
+extern "C" {
+#include "ta_libc.h"
+}
+
+using namespace XT;
+
+namespace
+{
+	const int kBars = 3000;
+
+	int s_mismatches = 0;
+
+	/**
+	* @brief feed bars with intermediate updates and compare every output from TA-Lib's begIdx on
+	*
+	* @param name as function name
+	* @param params as TA-Lib optional inputs
+	* @param bars
+	* @param ref as TA-Lib outputs, ref[k][i - beg] is output k of bar i
+	* @param beg as TA-Lib begIdx
+	*/
+	void checkStream(const std::string& name, const std::map<std::string, double>& params, const std::vector<TABar>& bars,
+		const std::vector<std::vector<double> >& ref, int beg)
+	{
+		TAStreamPtr s = TAStream::create(name, params);
+		if (!s)
+		{
+			printf("%s: no stream\n", name.c_str());
+			++s_mismatches;
+			return;
+		}
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<double> noise(-1, 1);
+		int bad = 0;
+		for (int i = 0; i < (int)bars.size(); ++i)
+		{
+			TABar b = bars[i];
+			b.close += noise(rng);
+			b.high = std::max(b.high, b.close) + 0.5;
+			b.low = std::min(b.low, b.close) - 0.5;
+			s->push(b);
+			s->replaceLast(bars[i]);
+			s->replaceLast(bars[i]);
+			if (i < beg)
+			{
+				if (s->isReady()) { ++bad; printf("%s: ready early at bar %d\n", name.c_str(), i); }
+				continue;
+			}
+			if (!s->isReady())
+			{
+				++bad;
+				printf("%s: not ready at bar %d\n", name.c_str(), i);
+				continue;
+			}
+			for (size_t k = 0; k < ref.size(); ++k)
+			{
+				double r = ref[k][i - beg];
+				if (s->getOutput((int)k) != r)
+				{
+					if (bad < 3) { printf("%s: out %zu bar %d stream %.17g talib %.17g\n", name.c_str(), k, i, s->getOutput((int)k), r); }
+					++bad;
+				}
+			}
+		}
+		printf("%s: lookback %d begIdx %d mismatches %d\n", name.c_str(), s->getLookback(), beg, bad);
+		s_mismatches += bad;
+	}
+}
+
+int main()
+{
+	TA_Initialize();
+
+	//random walk with flat stretches, TA-Lib has special cases for zero ranges
+	std::vector<TABar> bars(kBars);
+	std::vector<double> o(kBars), h(kBars), l(kBars), c(kBars);
+	std::mt19937 rng(1);
+	std::normal_distribution<double> nd(0, 1);
+	double px = 100;
+	for (int i = 0; i < kBars; ++i)
+	{
+		double op = px;
+		px += nd(rng);
+		double hi = std::max(op, px) + std::fabs(nd(rng));
+		double lo = std::min(op, px) - std::fabs(nd(rng));
+		if (i % 200 < 20) { hi = lo = px = op; }
+		bars[i] = TABar{ op, hi, lo, px, 1000 };
+		o[i] = op; h[i] = hi; l[i] = lo; c[i] = px;
+	}
+
+	int beg = 0;
+	int nb = 0;
+	std::vector<double> r1(kBars), r2(kBars), r3(kBars);
+	for (int per : { 1, 2, 5, 14, 30 })
+	{
+		std::map<std::string, double> p = { { "optInTimePeriod", (double)per } };
+		TA_ATR(0, kBars - 1, h.data(), l.data(), c.data(), per, &beg, &nb, r1.data());
+		checkStream("ATR", p, bars, { r1 }, beg);
+		if (per < 2) { continue; }
+		TA_SMA(0, kBars - 1, c.data(), per, &beg, &nb, r1.data());
+		checkStream("SMA", p, bars, { r1 }, beg);
+		TA_EMA(0, kBars - 1, c.data(), per, &beg, &nb, r1.data());
+		checkStream("EMA", p, bars, { r1 }, beg);
+		TA_RSI(0, kBars - 1, c.data(), per, &beg, &nb, r1.data());
+		checkStream("RSI", p, bars, { r1 }, beg);
+		TA_ADX(0, kBars - 1, h.data(), l.data(), c.data(), per, &beg, &nb, r1.data());
+		checkStream("ADX", p, bars, { r1 }, beg);
+		TA_VAR(0, kBars - 1, c.data(), per, 1.0, &beg, &nb, r1.data());
+		checkStream("VAR", p, bars, { r1 }, beg);
+		p["optInNbDev"] = 1.5;
+		TA_STDDEV(0, kBars - 1, c.data(), per, 1.5, &beg, &nb, r1.data());
+		checkStream("STDDEV", p, bars, { r1 }, beg);
+		p["optInNbDevUp"] = 2;
+		p["optInNbDevDn"] = 1.5;
+		p["optInMAType"] = 0;
+		TA_BBANDS(0, kBars - 1, c.data(), per, 2, 1.5, TA_MAType_SMA, &beg, &nb, r1.data(), r2.data(), r3.data());
+		checkStream("BBANDS", p, bars, { r1, r2, r3 }, beg);
+	}
+
+	TA_TRANGE(0, kBars - 1, h.data(), l.data(), c.data(), &beg, &nb, r1.data());
+	checkStream("TRANGE", {}, bars, { r1 }, beg);
+
+	int macds[][3] = { { 12, 26, 9 }, { 26, 12, 9 }, { 3, 10, 16 }, { 5, 5, 2 } };
+	for (auto& m : macds)
+	{
+		TA_MACD(0, kBars - 1, c.data(), m[0], m[1], m[2], &beg, &nb, r1.data(), r2.data(), r3.data());
+		std::map<std::string, double> p = { { "optInFastPeriod", (double)m[0] }, { "optInSlowPeriod", (double)m[1] }, { "optInSignalPeriod", (double)m[2] } };
+		checkStream("MACD", p, bars, { r1, r2, r3 }, beg);
+	}
+
+	TA_Shutdown();
+	printf("TAStream parity: %d mismatches\n", s_mismatches);
+	return s_mismatches;
+}
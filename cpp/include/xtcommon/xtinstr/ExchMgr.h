@@ -64,12 +64,12 @@ public:
 	/**
 	* @brief default copy constructor
 	*/
-	ExchMgr(const ExchMgr& from) {}// = delete;
+	ExchMgr(const ExchMgr&) {}// = delete;
 
 	/**
 	* @brief default copy assignment
 	*/
-	ExchMgr& operator=(const ExchMgr& from) { return *this; }// = delete;
+	ExchMgr& operator=(const ExchMgr&) { return *this; }// = delete;
 
 	/**
 	* @brief destructor
@@ -31,6 +31,7 @@
 #include "Instr.h"
 
 #include "Curve.h"
+#include "ParamBinding.h"
 
 namespace XT
 {
@@ -76,6 +77,22 @@ public:
 	*/
 	void updateStrParams(const StringMapPtr& smp);
 
+	/**
+	* @brief update with string parameters, then swap in the bound typed parameter blocks
+	*
+	* @param string parameters
+	*/
+	void applyStrParams(const StringMapPtr& smp)
+	{
+		updateStrParams(smp);
+		m_paramBindings.update(smp);
+	}
+
+	/**
+	* @brief typed parameter blocks updated by applyStrParams()
+	*/
+	ParamBindingSet& paramBindings() { return m_paramBindings; }
+
 	/**
 	* @brief initialize product
 	*
@@ -346,6 +363,7 @@ protected:
 	FCDataPtr m_data;
 
 	StringMapPtr m_strParams;
+	ParamBindingSet m_paramBindings; ///< typed parameter blocks
 
 	CurvePtr m_curvePrevSettle; ///<  previous settle curve
 
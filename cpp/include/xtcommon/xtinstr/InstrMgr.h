@@ -70,6 +70,7 @@
 #include "OptionsChain.h"
 #include "OptionsChains.h"
 #include "ProductInstrs.h"
+#include "InstrRegistry.h"
 
 //#include "SqliteUtil.h"
 //#include "MongoUtil.h"
@@ -109,12 +110,12 @@ public:
 	/**
 	* @brief default copy constructor
 	*/
-	InstrMgr(const InstrMgr& from) {}// = delete;
+	InstrMgr(const InstrMgr&) {}// = delete;
 
 	/**
 	* @brief default copy assignment
 	*/
-	InstrMgr& operator=(const InstrMgr& from) { return *this; }// = delete;
+	InstrMgr& operator=(const InstrMgr&) { return *this; }// = delete;
 
 	/**
 	* @brief destructor
@@ -339,6 +340,8 @@ protected:
 
 	sf::contfree_safe_ptr<std::unordered_set<std::string> > m_invalidSpecInstrIDSet; ///< set for instrid which has invalid instrspec 
 
+	InstrRegistry m_instrRegistry; ///< lock free snapshot of instruments for hot path lookups
+
 
 public:
 	/** 
@@ -692,6 +695,74 @@ public:
 	*/
 	int getIidForInstr(const std::string& instrid);
 
+	/**
+	* @brief read-mostly registry of instruments
+	*
+	* @return registry
+	*/
+	InstrRegistry& instrRegistry() { return m_instrRegistry; }
+
+	/**
+	* @brief copy of every instrument of iidToInstrMap
+	*/
+	std::vector<InstrPtr> collectInstrs()
+	{
+		std::vector<InstrPtr> instrs;
+		auto locked = sf::slock_safe_ptr(m_iidToInstrMap);
+		instrs.reserve(locked->size());
+		for (auto it = locked->begin(); it != locked->end(); ++it)
+		{
+			instrs.push_back(it->second);
+		}
+		return instrs;
+	}
+
+	/**
+	* @brief publish a new registry snapshot from iidToInstrMap, call after bulk loading instruments
+	*/
+	void publishInstrRegistry()
+	{
+		m_instrRegistry.reset(collectInstrs());
+	}
+
+	/**
+	* @brief get instrument by iid from the registry snapshot
+	*
+	*	Instruments added after the last publishInstrRegistry are looked up with getInstrByIid
+	*	and published into the registry, so later lookups of them do not lock. A bulk load that
+	*	was not published is published whole, once, under the registry write lock.
+	*
+	* @param iid as integer id
+	*
+	* @return instr
+	*/
+	InstrPtr findInstrByIid(int iid)
+	{
+		InstrPtr instr = m_instrRegistry.getInstrByIid(iid);
+		if (instr != nullptr) { return instr; }
+		instr = getInstrByIid(iid);
+		if (instr == nullptr) { return instr; }
+		size_t nbinstrs = sf::slock_safe_ptr(m_iidToInstrMap)->size();
+		m_instrRegistry.addMissing(instr, nbinstrs, [this]() { return collectInstrs(); });
+		return instr;
+	}
+
+	/**
+	* @brief get integer id by instrid from the registry snapshot, publishes instruments missing from it as findInstrByIid
+	*
+	* @param instrid as instrid
+	*
+	* @return integer id
+	*/
+	int findIidForInstr(const std::string& instrid)
+	{
+		int iid = m_instrRegistry.getIidForInstr(instrid);
+		if (iid >= 0) { return iid; }
+		iid = getIidForInstr(instrid);
+		if (iid >= 0) { findInstrByIid(iid); }
+		return iid;
+	}
+
 	/**
 	* @brief get all instrument ids
 	*
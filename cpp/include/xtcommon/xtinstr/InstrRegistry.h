@@ -0,0 +1,618 @@
+#pragma once
+#ifndef XT_INSTR_REGISTRY_H
+#define XT_INSTR_REGISTRY_H
+
+/**
+* \file InstrRegistry.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a read-mostly registry of instruments.
+*
+* \description
+*	InstrMgr keeps its lookup maps in sf::contfree_safe_ptr, whose shared mutex has a fixed
+*	number of reader slots and degrades to exclusive locking beyond them. InstrRegistry
+*	publishes immutable snapshots instead: iid-indexed dense vectors and a perfect hash
+*	from instrid to iid, plus an overlay of the instruments added since. Snapshots are
+*	published through an atomic raw pointer and reclaimed with XT::Epoch, so readers neither
+*	lock nor touch a reference count.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <unordered_map>
+
+#include "XTConfig.h"
+#include "Instr.h"
+#include "XTEpoch.h"
+
+namespace XT
+{
+
+	/**
+	* Minimal perfect hash from instrid to iid (hash and displace).
+	* Every key lands in its own slot; lookups verify the key against the snapshot instrids.
+	*/
+	class InstrPerfectHash
+	{
+	public:
+		InstrPerfectHash() : m_seed(0), m_mask(0), m_nBuckets(1), m_disp(1, 0), m_slots(1, -1) {}
+
+		/**
+		* @brief build the table
+		*
+		* @param ids as instrid for each key
+		* @param iids as iid for each key, same size as ids
+		*
+		* @return false if no table was found, which only happens for full 64 bit hash collisions
+		*/
+		bool build(const std::vector<const std::string*>& ids, const std::vector<int>& iids)
+		{
+			for (uint64_t seed = 0; seed < 16; ++seed)
+			{
+				if (buildWithSeed(ids, iids, seed))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/**
+		* @brief candidate iid for instrid, the caller must verify the instrid of the candidate
+		*
+		* @return iid or -1
+		*/
+		int candidate(const char* s, size_t n) const
+		{
+			uint64_t h = hashStr(s, n, m_seed);
+			uint32_t b = bucketOf(h);
+			return m_slots[slotOf(h, m_disp[b])];
+		}
+
+		size_t tableSize() const { return m_slots.size(); }
+
+	protected:
+		static uint64_t mix(uint64_t h)
+		{
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdULL;
+			h ^= h >> 33;
+			h *= 0xc4ceb9fe1a85ec53ULL;
+			h ^= h >> 33;
+			return h;
+		}
+
+		static uint64_t hashStr(const char* s, size_t n, uint64_t seed)
+		{
+			uint64_t h = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+			for (size_t i = 0; i < n; ++i)
+			{
+				h ^= (unsigned char)s[i];
+				h *= 1099511628211ULL;
+			}
+			return mix(h);
+		}
+
+		uint32_t bucketOf(uint64_t h) const { return (uint32_t)((h >> 32) % m_nBuckets); }
+
+		size_t slotOf(uint64_t h, uint32_t d) const { return (size_t)(mix(h + (uint64_t)d * 0x9E3779B97F4A7C15ULL) & m_mask); }
+
+		bool buildWithSeed(const std::vector<const std::string*>& ids, const std::vector<int>& iids, uint64_t seed)
+		{
+			const size_t n = ids.size();
+			size_t m = 1;
+			while (m < n + n / 4 + 1) { m <<= 1; }
+			m_seed = seed;
+			m_mask = m - 1;
+			m_nBuckets = (uint32_t)(n / 4 + 1);
+			m_disp.assign(m_nBuckets, 0);
+			m_slots.assign(m, -1);
+
+			std::vector<uint64_t> hashes(n);
+			std::vector<std::vector<uint32_t> > buckets(m_nBuckets);
+			for (size_t i = 0; i < n; ++i)
+			{
+				hashes[i] = hashStr(ids[i]->data(), ids[i]->size(), seed);
+				buckets[bucketOf(hashes[i])].push_back((uint32_t)i);
+			}
+			std::vector<uint32_t> order(m_nBuckets);
+			for (uint32_t b = 0; b < m_nBuckets; ++b) { order[b] = b; }
+			std::sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+			std::vector<size_t> placed;
+			for (uint32_t b : order)
+			{
+				const std::vector<uint32_t>& keys = buckets[b];
+				if (keys.empty()) { break; }
+				bool ok = false;
+				for (uint32_t d = 0; d < (1u << 16) && !ok; ++d)
+				{
+					placed.clear();
+					ok = true;
+					for (uint32_t k : keys)
+					{
+						size_t slot = slotOf(hashes[k], d);
+						if (m_slots[slot] != -1 || std::find(placed.begin(), placed.end(), slot) != placed.end())
+						{
+							ok = false;
+							break;
+						}
+						placed.push_back(slot);
+					}
+					if (ok)
+					{
+						m_disp[b] = d;
+						for (size_t j = 0; j < keys.size(); ++j)
+						{
+							m_slots[placed[j]] = iids[keys[j]];
+						}
+					}
+				}
+				if (!ok) { return false; }
+			}
+			return true;
+		}
+
+	protected:
+		uint64_t m_seed;
+		size_t m_mask;
+		uint32_t m_nBuckets;
+		std::vector<uint32_t> m_disp; ///< displacement per bucket
+		std::vector<int> m_slots; ///< iid per slot, -1 for empty
+	};
+
+	/**
+	* Immutable instrument table: iid-indexed dense vectors and a perfect hash from instrid to iid.
+	* Built in one pass and shared by every snapshot published until the next rebuild.
+	*/
+	class InstrRegistryTable
+	{
+	public:
+		InstrRegistryTable() : m_count(0) {}
+
+		/** number of instruments */
+		size_t size() const { return m_count; }
+
+		const InstrPtr& getInstrByIid(int iid) const
+		{
+			return (iid >= 0 && (size_t)iid < m_instrs.size()) ? m_instrs[iid] : emptyInstr();
+		}
+
+		const std::string& getInstrIDForIid(int iid) const
+		{
+			return (iid >= 0 && (size_t)iid < m_ids.size()) ? m_ids[iid] : emptyID();
+		}
+
+		/** @return iid or -1 */
+		int getIidForInstr(const char* s, size_t n) const
+		{
+			if (m_count == 0) { return -1; }
+			int iid = m_hash.candidate(s, n);
+			if (iid < 0) { return -1; }
+			const std::string& id = m_ids[iid];
+			return (id.size() == n && memcmp(id.data(), s, n) == 0) ? iid : -1;
+		}
+
+		/** iids of all instruments, ascending */
+		const std::vector<int>& iids() const { return m_iids; }
+
+		/**
+		* @brief fill the table, later entries win for duplicate iids or instrids
+		*
+		* @return false if the perfect hash could not be built
+		*/
+		bool build(const std::vector<InstrPtr>& instrs)
+		{
+			std::unordered_map<std::string, int> byId;
+			byId.reserve(instrs.size());
+			int maxIid = -1;
+			for (const InstrPtr& p : instrs)
+			{
+				if (p == nullptr || p->getIid() < 0) { continue; }
+				maxIid = std::max(maxIid, p->getIid());
+			}
+			m_instrs.assign(maxIid + 1, InstrPtr());
+			m_ids.assign(maxIid + 1, std::string());
+			for (const InstrPtr& p : instrs)
+			{
+				if (p == nullptr || p->getIid() < 0) { continue; }
+				int iid = p->getIid();
+				const std::string& id = p->getInstrID();
+				auto it = byId.find(id);
+				if (it != byId.end() && it->second != iid)
+				{
+					m_instrs[it->second] = InstrPtr();
+					m_ids[it->second].clear();
+				}
+				if (!m_ids[iid].empty() && m_ids[iid] != id)
+				{
+					byId.erase(m_ids[iid]);
+				}
+				m_instrs[iid] = p;
+				m_ids[iid] = id;
+				byId[id] = iid;
+			}
+
+			std::vector<const std::string*> ids;
+			m_iids.clear();
+			for (int iid = 0; iid <= maxIid; ++iid)
+			{
+				if (m_instrs[iid] == nullptr) { continue; }
+				m_iids.push_back(iid);
+				ids.push_back(&m_ids[iid]);
+			}
+			m_count = m_iids.size();
+			return m_hash.build(ids, m_iids);
+		}
+
+		static const InstrPtr& emptyInstr()
+		{
+			static const InstrPtr empty;
+			return empty;
+		}
+
+		static const std::string& emptyID()
+		{
+			static const std::string empty;
+			return empty;
+		}
+
+	protected:
+		size_t m_count;
+		std::vector<InstrPtr> m_instrs; ///< indexed by iid
+		std::vector<std::string> m_ids; ///< indexed by iid
+		std::vector<int> m_iids;
+		InstrPerfectHash m_hash;
+	};
+
+	/**
+	* Immutable view of all instruments at one version: a shared InstrRegistryTable plus a small
+	* overlay of the instruments added since the table was built. Lookups check the overlay, a
+	* binary search of a few entries, then the table.
+	*/
+	class InstrRegistrySnapshot
+	{
+	public:
+		InstrRegistrySnapshot() : m_version(0), m_count(0), m_table(std::make_shared<InstrRegistryTable>()), m_pTable(m_table.get()) {}
+
+		uint64_t version() const { return m_version; }
+
+		/** number of instruments */
+		size_t size() const { return m_count; }
+
+		/** number of instruments added or removed since the table was built */
+		size_t overlaySize() const { return m_byIid.size(); }
+
+		bool hasIid(int iid) const { return getInstrByIid(iid) != nullptr; }
+
+		/**
+		* @brief instrument by iid
+		*
+		* @return instr, or an empty pointer
+		*/
+		const InstrPtr& getInstrByIid(int iid) const
+		{
+			const IidEntry* e = findIid(iid);
+			return e != nullptr ? e->instr : m_pTable->getInstrByIid(iid);
+		}
+
+		/** instrid by iid, empty string if unknown */
+		const std::string& getInstrIDForIid(int iid) const
+		{
+			const IidEntry* e = findIid(iid);
+			return e != nullptr ? e->id : m_pTable->getInstrIDForIid(iid);
+		}
+
+		/**
+		* @brief iid by instrid
+		*
+		* @return iid or -1
+		*/
+		int getIidForInstr(const char* s, size_t n) const
+		{
+			const IdEntry* e = findId(s, n);
+			return e != nullptr ? e->iid : m_pTable->getIidForInstr(s, n);
+		}
+
+		int getIidForInstr(const std::string& instrid) const { return getIidForInstr(instrid.data(), instrid.size()); }
+
+		const InstrPtr& getInstr(const std::string& instrid) const { return getInstrByIid(getIidForInstr(instrid)); }
+
+		/** iids of all instruments, ascending */
+		std::vector<int> iids() const
+		{
+			std::vector<int> v;
+			v.reserve(m_count);
+			const std::vector<int>& base = m_pTable->iids();
+			size_t i = 0;
+			for (const IidEntry& e : m_byIid)
+			{
+				for (; i < base.size() && base[i] < e.iid; ++i) { v.push_back(base[i]); }
+				if (i < base.size() && base[i] == e.iid) { ++i; }
+				if (e.instr != nullptr) { v.push_back(e.iid); }
+			}
+			v.insert(v.end(), base.begin() + i, base.end());
+			return v;
+		}
+
+	protected:
+		friend class InstrRegistry;
+
+		struct IidEntry
+		{
+			int iid;
+			InstrPtr instr; ///< empty if the iid was removed
+			std::string id;
+		};
+
+		struct IdEntry
+		{
+			std::string id;
+			int iid; ///< -1 if the instrid was removed
+		};
+
+		const IidEntry* findIid(int iid) const
+		{
+			if (m_byIid.empty()) { return nullptr; }
+			auto it = std::lower_bound(m_byIid.begin(), m_byIid.end(), iid, [](const IidEntry& e, int v) { return e.iid < v; });
+			return (it != m_byIid.end() && it->iid == iid) ? &*it : nullptr;
+		}
+
+		const IdEntry* findId(const char* s, size_t n) const
+		{
+			if (m_byId.empty()) { return nullptr; }
+			auto it = std::lower_bound(m_byId.begin(), m_byId.end(), 0,
+				[s, n](const IdEntry& e, int) { return e.id.compare(0, std::string::npos, s, n) < 0; });
+			return (it != m_byId.end() && it->id.compare(0, std::string::npos, s, n) == 0) ? &*it : nullptr;
+		}
+
+		/** set the overlay entry of iid, keeping m_byIid sorted */
+		void setIid(int iid, const InstrPtr& instr, const std::string& id)
+		{
+			auto it = std::lower_bound(m_byIid.begin(), m_byIid.end(), iid, [](const IidEntry& e, int v) { return e.iid < v; });
+			if (it != m_byIid.end() && it->iid == iid)
+			{
+				it->instr = instr;
+				it->id = id;
+			}
+			else
+			{
+				m_byIid.insert(it, IidEntry{ iid, instr, id });
+			}
+		}
+
+		/** set the overlay entry of instrid, keeping m_byId sorted */
+		void setId(const std::string& id, int iid)
+		{
+			auto it = std::lower_bound(m_byId.begin(), m_byId.end(), id, [](const IdEntry& e, const std::string& v) { return e.id < v; });
+			if (it != m_byId.end() && it->id == id)
+			{
+				it->iid = iid;
+			}
+			else
+			{
+				m_byId.insert(it, IdEntry{ id, iid });
+			}
+		}
+
+		/** add or replace instr in the overlay, an instrid or iid it takes over from another instrument is removed */
+		void apply(const InstrPtr& instr)
+		{
+			int iid = instr->getIid();
+			const std::string& id = instr->getInstrID();
+			int prevIid = getIidForInstr(id);
+			if (prevIid >= 0 && prevIid != iid)
+			{
+				setIid(prevIid, InstrPtr(), std::string());
+				--m_count;
+			}
+			const InstrPtr& prev = getInstrByIid(iid);
+			if (prev == nullptr)
+			{
+				++m_count;
+			}
+			else
+			{
+				std::string prevId = getInstrIDForIid(iid);
+				if (prevId != id) { setId(prevId, -1); }
+			}
+			setIid(iid, instr, id);
+			setId(id, iid);
+		}
+
+	protected:
+		uint64_t m_version;
+		size_t m_count;
+		std::shared_ptr<const InstrRegistryTable> m_table; ///< owner, only touched by writers
+		const InstrRegistryTable* m_pTable; ///< what readers go through
+		std::vector<IidEntry> m_byIid; ///< sorted by iid
+		std::vector<IdEntry> m_byId; ///< sorted by instrid
+	};
+
+	/**
+	* Publishes InstrRegistrySnapshot versions. Any number of reader threads, writers serialized.
+	*
+	* The current snapshot is a plain atomic pointer. Readers pin the thread with XT::Epoch, load
+	* it with acquire and look up; a replaced snapshot is retired to the Epoch and deleted once
+	* the readers that may have loaded it have unpinned. No lock and no reference count is taken
+	* on the read side.
+	*
+	* An add copies the overlay of the current snapshot, O(overlay), and folds the overlay into a
+	* new table and perfect hash once it grows past sqrt(size), so a rebuild is paid every
+	* sqrt(size) adds instead of every add.
+	*
+	* The lookups of InstrRegistry pin for one call and return by value. Hot loops should keep a
+	* Reader for the whole event and look up by reference through it.
+	*/
+	class InstrRegistry
+	{
+	public:
+		/**
+		* Pinned view of the current snapshot. The snapshot and the references it returns stay
+		* valid until the Reader is destroyed; keep it on the stack, do not block while holding it.
+		*/
+		class Reader
+		{
+		public:
+			explicit Reader(const InstrRegistry& registry) : m_snap(registry.m_current.load(std::memory_order_acquire)) {}
+
+			Reader(const Reader&) = delete;
+			Reader& operator=(const Reader&) = delete;
+
+			const InstrRegistrySnapshot& operator*() const { return *m_snap; }
+			const InstrRegistrySnapshot* operator->() const { return m_snap; }
+
+		private:
+			Epoch::Guard m_pin; ///< declared first, pinned before the load
+			const InstrRegistrySnapshot* m_snap;
+		};
+
+		InstrRegistry() : m_current(new InstrRegistrySnapshot()) {}
+
+		InstrRegistry(const InstrRegistry&) = delete;
+		InstrRegistry& operator=(const InstrRegistry&) = delete;
+
+		~InstrRegistry() { delete m_current.load(std::memory_order_relaxed); }
+
+		InstrPtr getInstrByIid(int iid) const { return Reader(*this)->getInstrByIid(iid); }
+
+		int getIidForInstr(const std::string& instrid) const { return Reader(*this)->getIidForInstr(instrid); }
+
+		InstrPtr getInstr(const std::string& instrid) const { return Reader(*this)->getInstr(instrid); }
+
+		uint64_t version() const { return Reader(*this)->version(); }
+
+		size_t size() const { return Reader(*this)->size(); }
+
+		/**
+		* @brief add or replace one instrument and publish
+		*/
+		void add(const InstrPtr& instr)
+		{
+			std::vector<InstrPtr> v(1, instr);
+			addBatch(v);
+		}
+
+		/**
+		* @brief add or replace instruments and publish once, use it for bulk loading
+		*/
+		void addBatch(const std::vector<InstrPtr>& instrs)
+		{
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			addLocked(instrs);
+		}
+
+		/**
+		* @brief publish instr unless the current snapshot already has it
+		*
+		*	When the snapshot lags the source by more than this instrument, i.e. a bulk load was
+		*	not published, the whole source is published instead. The check runs under the write
+		*	lock, so threads missing at the same time rebuild once: the later ones find the
+		*	instrument published.
+		*
+		* @param instr as instrument missing from the snapshot
+		* @param sourceSize as number of instruments of the source
+		* @param collect as callable returning std::vector<InstrPtr> of every instrument of the source
+		*/
+		template<typename Collect>
+		void addMissing(const InstrPtr& instr, size_t sourceSize, Collect collect)
+		{
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			const InstrRegistrySnapshot* cur = m_current.load(std::memory_order_relaxed);
+			if (instr == nullptr || cur->getInstrByIid(instr->getIid()) == instr) { return; }
+			if (cur->size() + 1 < sourceSize)
+			{
+				resetLocked(collect());
+			}
+			else
+			{
+				addLocked(std::vector<InstrPtr>(1, instr));
+			}
+		}
+
+		/**
+		* @brief replace the whole content and publish
+		*/
+		void reset(const std::vector<InstrPtr>& instrs)
+		{
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			resetLocked(instrs);
+		}
+
+	protected:
+		/** overlay size past which the next add rebuilds the table */
+		static size_t foldLimit(size_t n)
+		{
+			size_t limit = 32;
+			while (limit * limit < n) { limit <<= 1; }
+			return limit;
+		}
+
+		void addLocked(const std::vector<InstrPtr>& instrs)
+		{
+			const InstrRegistrySnapshot* cur = m_current.load(std::memory_order_relaxed);
+			size_t limit = foldLimit(cur->size() + instrs.size());
+			if (cur->overlaySize() + instrs.size() > limit)
+			{
+				// fold: one rebuild of the table with everything
+				std::vector<InstrPtr> all;
+				all.reserve(cur->size() + instrs.size());
+				for (int iid : cur->iids())
+				{
+					all.push_back(cur->getInstrByIid(iid));
+				}
+				all.insert(all.end(), instrs.begin(), instrs.end());
+				if (resetLocked(all)) { return; }
+				// keep serving from the overlay, it is only slower
+			}
+			std::unique_ptr<InstrRegistrySnapshot> next(new InstrRegistrySnapshot(*cur));
+			next->m_version = cur->version() + 1;
+			for (const InstrPtr& p : instrs)
+			{
+				if (p == nullptr || p->getIid() < 0) { continue; }
+				next->apply(p);
+			}
+			publishLocked(next.release());
+		}
+
+		/** @return false if the table could not be built, the current version stays */
+		bool resetLocked(const std::vector<InstrPtr>& instrs)
+		{
+			const InstrRegistrySnapshot* cur = m_current.load(std::memory_order_relaxed);
+			std::shared_ptr<InstrRegistryTable> table = std::make_shared<InstrRegistryTable>();
+			if (!table->build(instrs))
+			{
+				LOGE("InstrRegistry,perfect hash build failed,keeping version " + std::to_string(cur->version()));
+				return false;
+			}
+			std::unique_ptr<InstrRegistrySnapshot> next(new InstrRegistrySnapshot());
+			next->m_version = cur->version() + 1;
+			next->m_count = table->size();
+			next->m_pTable = table.get();
+			next->m_table = std::move(table);
+			publishLocked(next.release());
+			return true;
+		}
+
+		void publishLocked(const InstrRegistrySnapshot* next)
+		{
+			const InstrRegistrySnapshot* old = m_current.load(std::memory_order_relaxed);
+			m_current.store(next, std::memory_order_release);
+			Epoch::Retire(old);
+		}
+
+	protected:
+		std::atomic<const InstrRegistrySnapshot*> m_current; ///< swapped by writers holding m_writeMutex, readers load it pinned
+		std::mutex m_writeMutex;
+	};
+
+}//namespace XT
+
+#endif
@@ -0,0 +1,738 @@
+#pragma once
+#ifndef XT_INSTR_SNAPSHOT_H
+#define XT_INSTR_SNAPSHOT_H
+
+/**
+* \file InstrSnapshot.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a binary snapshot of the instruments of InstrMgr.
+*
+* \description
+*	Designed for warm restarts during a session. Building the instruments from the main db
+*	or mongodb rows and rebuilding the chains takes long with all products loaded, so once
+*	initialized InstrMgr is saved as one file: the serialized InstrSpecData and iid of every
+*	instrument, its futures and options chain names, and the session config of every
+*	exchange and product. The file is mapped, validated (format, checksum, source db
+*	version and trading day) and the instruments are added back with their iids. Any
+*	mismatch makes load fail, the caller then falls back to the cold load.
+*
+*	The source db version is a checksum of the rows or documents the instruments are loaded
+*	from (mainDbVersion, mongoDbVersion). loadOrBuild times every step of the restart.
+*
+*	File layout: header, records sorted by iid, session entries, blob of strings and specs.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include "XTConfig.h"
+#include "XTData.pb.h"
+#include "typedef_XTData.pb.h"
+#include "MemDBUtil.h"
+#include "InstrSpec.h"
+#include "Instr.h"
+#include "InstrMgr.h"
+#include "SQLiteMgr.h"
+#include "MongoDBMgr.h"
+#include "log4z.h"
+
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+
+namespace XT
+{
+
+#pragma pack(push, 1)
+	struct InstrSnapshotHeader
+	{
+		char magic[8]; ///< "XTINSNP1"
+		uint32_t version;
+		uint32_t nInstr;
+		uint32_t nSessions;
+		int32_t tradingday;
+		int32_t instrCount; ///< InstrMgr instrument counter
+		int32_t reserved0;
+		int64_t createdTs; ///< seconds since epoch
+		uint64_t recOffset;
+		uint64_t sessOffset;
+		uint64_t blobOffset;
+		uint64_t blobSize;
+		uint64_t checksum; ///< FNV-1a of everything after the header
+		char dbVersion[48]; ///< version of the source db
+	};
+
+	struct InstrSnapshotRecord
+	{
+		int32_t iid;
+		uint32_t specLen;
+		uint64_t specOffset; ///< serialized InstrSpecData in the blob
+		uint64_t instridOffset;
+		uint32_t instridLen;
+		uint32_t fcNameLen;
+		uint64_t fcNameOffset; ///< FuturesChain name, empty if none
+		uint32_t ocNameLen;
+		uint32_t reserved;
+		uint64_t ocNameOffset; ///< OptionsChain name, empty if none
+		char reserved2[8];
+	};
+
+	struct InstrSnapshotSession
+	{
+		uint64_t exchOffset;
+		uint64_t productOffset;
+		uint64_t cfgOffset;
+		uint32_t exchLen;
+		uint32_t productLen;
+		uint32_t cfgLen;
+		char reserved[12];
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(InstrSnapshotHeader) == 128, "InstrSnapshotHeader size");
+	static_assert(sizeof(InstrSnapshotRecord) == 64, "InstrSnapshotRecord size");
+	static_assert(sizeof(InstrSnapshotSession) == 48, "InstrSnapshotSession size");
+
+/**
+* writer of a snapshot file, independent of InstrMgr
+*/
+class InstrSnapshotWriter
+{
+public:
+	enum { Version = 1 };
+
+	static const char* magic() { return "XTINSNP1"; }
+
+	InstrSnapshotWriter(const std::string& dbversion, int tradingday, int instrcount)
+		: m_dbVersion(dbversion), m_tradingDay(tradingday), m_instrCount(instrcount)
+	{
+	}
+
+	/**
+	* @brief add an instrument
+	*
+	* @param spec as serialized InstrSpecData
+	*/
+	void addInstr(int iid, const std::string& instrid, const std::string& spec, const std::string& fcname, const std::string& ocname)
+	{
+		InstrSnapshotRecord r;
+		std::memset(&r, 0, sizeof(r));
+		r.iid = iid;
+		r.instridOffset = addBlob(instrid, r.instridLen);
+		r.specOffset = addBlob(spec, r.specLen);
+		r.fcNameOffset = addBlob(fcname, r.fcNameLen);
+		r.ocNameOffset = addBlob(ocname, r.ocNameLen);
+		m_records.push_back(r);
+	}
+
+	void addSession(const std::string& exch, const std::string& product, const std::string& cfg)
+	{
+		InstrSnapshotSession s;
+		std::memset(&s, 0, sizeof(s));
+		s.exchOffset = addBlob(exch, s.exchLen);
+		s.productOffset = addBlob(product, s.productLen);
+		s.cfgOffset = addBlob(cfg, s.cfgLen);
+		m_sessions.push_back(s);
+	}
+
+	/**
+	* @brief write the file, through a temporary file renamed at the end
+	*/
+	bool write(const std::string& path)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::path p(path);
+		if (p.has_parent_path()) { boost::filesystem::create_directories(p.parent_path(), ec); }
+
+		std::sort(m_records.begin(), m_records.end(), [](const InstrSnapshotRecord& a, const InstrSnapshotRecord& b) { return a.iid < b.iid; });
+
+		InstrSnapshotHeader h;
+		std::memset(&h, 0, sizeof(h));
+		std::memcpy(h.magic, magic(), 8);
+		h.version = Version;
+		h.nInstr = (uint32_t)m_records.size();
+		h.nSessions = (uint32_t)m_sessions.size();
+		h.tradingday = m_tradingDay;
+		h.instrCount = m_instrCount;
+		h.createdTs = (int64_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		h.recOffset = sizeof(InstrSnapshotHeader);
+		h.sessOffset = h.recOffset + sizeof(InstrSnapshotRecord) * m_records.size();
+		h.blobOffset = h.sessOffset + sizeof(InstrSnapshotSession) * m_sessions.size();
+		h.blobSize = m_blob.size();
+		std::strncpy(h.dbVersion, m_dbVersion.c_str(), sizeof(h.dbVersion) - 1);
+
+		uint64_t sum = fnv1a(m_records.data(), sizeof(InstrSnapshotRecord) * m_records.size());
+		sum = fnv1a(m_sessions.data(), sizeof(InstrSnapshotSession) * m_sessions.size(), sum);
+		h.checksum = fnv1a(m_blob.data(), m_blob.size(), sum);
+
+		std::string tmp = path + ".tmp";
+		{
+			std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+			if (!out) { return false; }
+			out.write((const char*)&h, sizeof(h));
+			if (!m_records.empty()) { out.write((const char*)m_records.data(), sizeof(InstrSnapshotRecord) * m_records.size()); }
+			if (!m_sessions.empty()) { out.write((const char*)m_sessions.data(), sizeof(InstrSnapshotSession) * m_sessions.size()); }
+			out.write(m_blob.data(), (std::streamsize)m_blob.size());
+			if (!out) { return false; }
+		}
+		boost::filesystem::rename(tmp, path, ec);
+		return !ec;
+	}
+
+	/** FNV-1a 64 bits */
+	static uint64_t fnv1a(const void* p, size_t n, uint64_t h = 14695981039346656037ULL)
+	{
+		const unsigned char* c = (const unsigned char*)p;
+		for (size_t i = 0; i < n; ++i)
+		{
+			h ^= c[i];
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+
+protected:
+	uint64_t addBlob(const std::string& s, uint32_t& len)
+	{
+		uint64_t off = m_blob.size();
+		m_blob.append(s);
+		len = (uint32_t)s.size();
+		return off;
+	}
+
+protected:
+	std::string m_dbVersion;
+	int m_tradingDay;
+	int m_instrCount;
+	std::vector<InstrSnapshotRecord> m_records;
+	std::vector<InstrSnapshotSession> m_sessions;
+	std::string m_blob;
+};//class InstrSnapshotWriter
+
+/**
+* read only mapping of a snapshot file
+*/
+class InstrSnapshotReader
+{
+public:
+	InstrSnapshotReader() : m_base(0), m_size(0), m_header(nullptr), m_records(nullptr), m_sessions(nullptr), m_blob(nullptr) {}
+
+	InstrSnapshotReader(const InstrSnapshotReader&) = delete;
+	InstrSnapshotReader& operator=(const InstrSnapshotReader&) = delete;
+
+	virtual ~InstrSnapshotReader() { close(); }
+
+	/**
+	* @brief map and validate a file
+	*
+	* @param dbversion as expected source db version, empty to accept any
+	* @param tradingday as expected trading day, 0 to accept any
+	*
+	* @return false if the file is missing, corrupted or stale
+	*/
+	bool open(const std::string& path, const std::string& dbversion = "", int tradingday = 0)
+	{
+		close();
+		boost::system::error_code ec;
+		uint64_t size = boost::filesystem::file_size(path, ec);
+		if (ec || size < sizeof(InstrSnapshotHeader)) { return false; }
+		m_base = MemDBUtil::load_mmap_buffer(path, (size_t)size, false, true);
+		if (m_base == 0) { return false; }
+		m_size = (size_t)size;
+		if (!validate(dbversion, tradingday))
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+		if (m_base != 0) { MemDBUtil::release_mmap_buffer(m_base, m_size, true); }
+		m_base = 0;
+		m_size = 0;
+		m_header = nullptr;
+		m_records = nullptr;
+		m_sessions = nullptr;
+		m_blob = nullptr;
+	}
+
+	bool isOpen() const { return m_header != nullptr; }
+
+	/** why the last open failed */
+	const std::string& getError() const { return m_error; }
+
+	int getInstrCount() const { return (int)m_header->nInstr; }
+	int getSessionCount() const { return (int)m_header->nSessions; }
+	int getTradingDay() const { return m_header->tradingday; }
+	int getMgrInstrCount() const { return m_header->instrCount; }
+	int64_t getCreatedTs() const { return m_header->createdTs; }
+	std::string getDbVersion() const { return std::string(m_header->dbVersion, strnlen(m_header->dbVersion, sizeof(m_header->dbVersion))); }
+
+	int getIid(int i) const { return m_records[i].iid; }
+	std::string getInstrID(int i) const { return str(m_records[i].instridOffset, m_records[i].instridLen); }
+	std::string getFCName(int i) const { return str(m_records[i].fcNameOffset, m_records[i].fcNameLen); }
+	std::string getOCName(int i) const { return str(m_records[i].ocNameOffset, m_records[i].ocNameLen); }
+
+	/** serialized InstrSpecData, in the mapping */
+	const char* getSpecData(int i) const { return m_blob + m_records[i].specOffset; }
+	size_t getSpecSize(int i) const { return m_records[i].specLen; }
+
+	std::string getSessionExchID(int i) const { return str(m_sessions[i].exchOffset, m_sessions[i].exchLen); }
+	std::string getSessionProductID(int i) const { return str(m_sessions[i].productOffset, m_sessions[i].productLen); }
+	std::string getSessionCfgStr(int i) const { return str(m_sessions[i].cfgOffset, m_sessions[i].cfgLen); }
+
+protected:
+	bool fail(const std::string& s)
+	{
+		m_error = s;
+		return false;
+	}
+
+	bool validate(const std::string& dbversion, int tradingday)
+	{
+		const InstrSnapshotHeader* h = (const InstrSnapshotHeader*)m_base;
+		if (std::memcmp(h->magic, InstrSnapshotWriter::magic(), 8) != 0 || h->version != InstrSnapshotWriter::Version) { return fail("format"); }
+		if (h->recOffset + (uint64_t)h->nInstr * sizeof(InstrSnapshotRecord) > h->sessOffset
+			|| h->sessOffset + (uint64_t)h->nSessions * sizeof(InstrSnapshotSession) > h->blobOffset
+			|| h->blobOffset + h->blobSize != m_size)
+		{
+			return fail("size");
+		}
+		std::string version(h->dbVersion, strnlen(h->dbVersion, sizeof(h->dbVersion)));
+		if (!dbversion.empty() && version != dbversion) { return fail("db version " + version + " expected " + dbversion); }
+		if (tradingday != 0 && h->tradingday != tradingday) { return fail("trading day " + std::to_string(h->tradingday)); }
+		if (InstrSnapshotWriter::fnv1a((const char*)m_base + h->recOffset, m_size - h->recOffset) != h->checksum) { return fail("checksum"); }
+
+		const InstrSnapshotRecord* recs = (const InstrSnapshotRecord*)(m_base + h->recOffset);
+		const InstrSnapshotSession* sess = (const InstrSnapshotSession*)(m_base + h->sessOffset);
+		for (uint32_t i = 0; i < h->nInstr; ++i)
+		{
+			const InstrSnapshotRecord& r = recs[i];
+			if (!inBlob(h, r.instridOffset, r.instridLen) || !inBlob(h, r.specOffset, r.specLen)
+				|| !inBlob(h, r.fcNameOffset, r.fcNameLen) || !inBlob(h, r.ocNameOffset, r.ocNameLen))
+			{
+				return fail("record " + std::to_string(i));
+			}
+			if (i > 0 && recs[i - 1].iid >= r.iid) { return fail("iid order"); }
+		}
+		for (uint32_t i = 0; i < h->nSessions; ++i)
+		{
+			const InstrSnapshotSession& s = sess[i];
+			if (!inBlob(h, s.exchOffset, s.exchLen) || !inBlob(h, s.productOffset, s.productLen) || !inBlob(h, s.cfgOffset, s.cfgLen))
+			{
+				return fail("session " + std::to_string(i));
+			}
+		}
+		m_header = h;
+		m_records = recs;
+		m_sessions = sess;
+		m_blob = (const char*)m_base + h->blobOffset;
+		m_error.clear();
+		return true;
+	}
+
+	static bool inBlob(const InstrSnapshotHeader* h, uint64_t off, uint32_t len) { return off + len <= h->blobSize; }
+
+	std::string str(uint64_t off, uint32_t len) const { return std::string(m_blob + off, len); }
+
+protected:
+	uintptr_t m_base;
+	size_t m_size;
+	const InstrSnapshotHeader* m_header;
+	const InstrSnapshotRecord* m_records;
+	const InstrSnapshotSession* m_sessions;
+	const char* m_blob;
+	std::string m_error;
+};//class InstrSnapshotReader
+
+/**
+* time spent in each step of a restart, in milliseconds
+*/
+struct InstrSnapshotStats
+{
+	double versionMs = 0; ///< computing the source db version
+	double openMs = 0; ///< mapping and validating the file
+	double decodeMs = 0; ///< parsing the specs
+	double buildMs = 0; ///< creating and adding the instruments
+	double verifyMs = 0; ///< checking iids, chains and sessions
+	double publishMs = 0; ///< publishing the instrument registry
+	double totalMs = 0; ///< whole loadOrBuild
+	int instrs = 0;
+	bool warm = false; ///< snapshot used
+
+	std::string str() const
+	{
+		char buf[192];
+		std::snprintf(buf, sizeof(buf), "version %.1f open %.1f decode %.1f build %.1f verify %.1f publish %.1f ms",
+			versionMs, openMs, decodeMs, buildMs, verifyMs, publishMs);
+		return buf;
+	}
+};
+
+/**
+* saving and restoring the instruments of InstrMgr
+*/
+class InstrSnapshot
+{
+public:
+	/**
+	* @brief version of the main db instruments: schema of the db and checksum of the rows the instruments are loaded from
+	*
+	*	Every table definition of sqlite_master and every column of every row returned by sql are
+	*	hashed, so any edited, added or removed instrument row changes the version, unlike the
+	*	file size or modification time. Give sql an ORDER BY for a version independent of the
+	*	physical row order.
+	*
+	* @param sql as query the instruments are loaded with, e.g. the one of addInstrsFromMainDB
+	* @param dbfile as file, empty for the MainDBMgr main db
+	*
+	* @return "sqlite:<rows>:<checksum>", empty if the db cannot be read
+	*/
+	static std::string mainDbVersion(const std::string& sql, const std::string& dbfile = "")
+	{
+		const std::string path = dbfile.empty() ? MainDBMgr::getInstance()->getMainDbFile() : dbfile;
+		try
+		{
+			SQLite::Database db(path, SQLite::OPEN_READONLY);
+			uint64_t sum = InstrSnapshotWriter::fnv1a(nullptr, 0);
+			SQLite::Statement schema(db, "SELECT type, name, sql FROM sqlite_master WHERE sql IS NOT NULL ORDER BY type, name");
+			while (schema.executeStep())
+			{
+				for (int c = 0; c < 3; ++c) { sum = hashColumn(schema.getColumn(c), sum); }
+			}
+			SQLite::Statement rows(db, sql);
+			uint64_t n = 0;
+			while (rows.executeStep())
+			{
+				for (int c = 0; c < rows.getColumnCount(); ++c) { sum = hashColumn(rows.getColumn(c), sum); }
+				++n;
+			}
+			return versionStr("sqlite", n, sum);
+		}
+		catch (std::exception& e)
+		{
+			LOGW("InstrSnapshot cannot read " + path + ": " + e.what());
+			return "";
+		}
+	}
+
+#ifndef XT_DISABLE_MONGO
+	/**
+	* @brief version of the mongodb instruments: checksum of the documents the instruments are loaded from
+	*
+	*	Documents are hashed in sorted order, the natural order of a collection is not stable.
+	*
+	* @param query as query string the instruments are loaded with
+	* @param colname as collection name
+	*
+	* @return "mongo:<documents>:<checksum>", empty if the query returns nothing
+	*/
+	static std::string mongoDbVersion(const std::string& query, const std::string& colname, MongoDBMgr* mongo = MongoDBMgr::getInstance())
+	{
+		std::vector<std::string> docs = mongo->getQueryResults(query, colname);
+		if (docs.empty()) { return ""; }
+		std::sort(docs.begin(), docs.end());
+		uint64_t sum = InstrSnapshotWriter::fnv1a(nullptr, 0);
+		for (const std::string& d : docs)
+		{
+			sum = InstrSnapshotWriter::fnv1a(d.data(), d.size(), sum);
+			sum = InstrSnapshotWriter::fnv1a("\n", 1, sum);
+		}
+		return versionStr("mongo", docs.size(), sum);
+	}
+#endif
+
+	/**
+	* @brief save the instruments of InstrMgr
+	*
+	* @param path as snapshot file
+	* @param dbversion as version of the db the instruments were loaded from
+	* @param tradingday as trading day of the instruments
+	*
+	* @return false if the file cannot be written
+	*/
+	static bool save(const std::string& path, const std::string& dbversion, int tradingday, InstrMgr* mgr = InstrMgr::getInstance())
+	{
+		InstrSnapshotWriter w(dbversion, tradingday, mgr->getInstrCount());
+		std::map<std::pair<std::string, std::string>, bool> products;
+		std::vector<InstrPtr> instrs;
+		{
+			auto locked = sf::slock_safe_ptr(mgr->iidToInstrMap());
+			instrs.reserve(locked->size());
+			for (auto it = locked->begin(); it != locked->end(); ++it) { instrs.push_back(it->second); }
+		}
+		auto fcs = sf::slock_safe_ptr(mgr->futureIidToChainMap());
+		auto ocs = sf::slock_safe_ptr(mgr->optionIidToChainMap());
+		std::string spec;
+		for (InstrPtr& instr : instrs)
+		{
+			if (instr == nullptr || instr->spec() == nullptr) { continue; }
+			int iid = instr->getIid();
+			spec.clear();
+			if (!instr->spec()->data()->SerializeToString(&spec))
+			{
+				LOGW("InstrSnapshot cannot serialize the spec of " + instr->getInstrID());
+				return false;
+			}
+			w.addInstr(iid, instr->getInstrID(), spec, chainNameOf(fcs, iid), chainNameOf(ocs, iid));
+			products[std::make_pair(instr->getExchID(), instr->getProductID())] = true;
+		}
+		for (auto& kv : products)
+		{
+			w.addSession(kv.first.first, kv.first.second, mgr->getSessionsCfgStr(kv.first.first, kv.first.second));
+		}
+		return w.write(path);
+	}
+
+	/**
+	* @brief add the instruments of a snapshot to an empty InstrMgr
+	*
+	*	All specs are parsed first, spread over threads, before InstrMgr is touched. The
+	*	instruments are then created and added in iid order with their iid: InstrMgr owns the
+	*	chains and maps they go into. The iids, chain names and session configs are checked
+	*	against the snapshot, one lock per map.
+	*
+	* @param path as snapshot file
+	* @param dbversion as expected source db version, empty to accept any
+	* @param tradingday as expected trading day, 0 to accept any
+	* @param stats as time spent in each step, may be null
+	*
+	* @return false if the snapshot is missing, stale or does not match once restored,
+	*	InstrMgr must then be cleared (clearAll) and loaded from the db
+	*/
+	static bool load(const std::string& path, const std::string& dbversion, int tradingday, InstrMgr* mgr = InstrMgr::getInstance(),
+		InstrSnapshotStats* stats = nullptr)
+	{
+		InstrSnapshotStats local;
+		InstrSnapshotStats& st = stats != nullptr ? *stats : local;
+		StepTimer timer;
+		InstrSnapshotReader r;
+		if (!r.open(path, dbversion, tradingday))
+		{
+			LOGI("InstrSnapshot " + path + " not used: " + (r.getError().empty() ? std::string("missing") : r.getError()));
+			return false;
+		}
+		if (!sf::slock_safe_ptr(mgr->iidToInstrMap())->empty())
+		{
+			LOGW("InstrSnapshot " + path + " not used: InstrMgr already has instruments");
+			return false;
+		}
+		st.openMs = timer.step();
+
+		const int n = r.getInstrCount();
+		std::vector<InstrSpecDataPtr> datas;
+		int bad = decodeSpecs(r, datas);
+		if (bad >= 0)
+		{
+			LOGW("InstrSnapshot " + path + " bad spec for " + r.getInstrID(bad));
+			return false;
+		}
+		st.decodeMs = timer.step();
+
+		for (int i = 0; i < n; ++i)
+		{
+			InstrSpecPtr spec = mgr->createInstrSpecFromData(datas[i]);
+			InstrPtr instr = mgr->createInstr(spec);
+			if (instr == nullptr)
+			{
+				LOGW("InstrSnapshot " + path + " cannot create " + r.getInstrID(i));
+				return false;
+			}
+			instr->setIid(r.getIid(i));
+			mgr->addInstr(instr);
+		}
+		if (mgr->getInstrCount() < r.getMgrInstrCount()) { mgr->setInstrCount(r.getMgrInstrCount()); }
+		st.buildMs = timer.step();
+
+		int mismatches = verify(r, path, mgr);
+		if (mismatches > 0)
+		{
+			LOGW("InstrSnapshot " + path + " mismatches:" + std::to_string(mismatches));
+			return false;
+		}
+		st.verifyMs = timer.step();
+
+		mgr->publishInstrRegistry();
+		st.publishMs = timer.step();
+		st.instrs = n;
+		LOGI("InstrSnapshot " + path + " loaded " + std::to_string(n) + " instruments: " + st.str());
+		return true;
+	}
+
+	/**
+	* @brief warm restart from the snapshot, or cold load and save a new snapshot
+	*
+	*	The db version is computed first and is part of the measured restart. An empty
+	*	version means the source cannot be checked: the snapshot is neither used nor written.
+	*
+	* @param dbversion as computing the version of the source db, e.g. mainDbVersion or mongoDbVersion
+	* @param coldload as loading InstrMgr from the db
+	* @param stats as time spent in each step, may be null
+	*
+	* @return true if the snapshot was used
+	*/
+	static bool loadOrBuild(const std::string& path, const std::function<std::string()>& dbversion, int tradingday, const std::function<void()>& coldload,
+		InstrMgr* mgr = InstrMgr::getInstance(), InstrSnapshotStats* stats = nullptr)
+	{
+		InstrSnapshotStats local;
+		InstrSnapshotStats& st = stats != nullptr ? *stats : local;
+		StepTimer total;
+		StepTimer timer;
+		const std::string version = dbversion();
+		st.versionMs = timer.step();
+		if (!version.empty() && load(path, version, tradingday, mgr, &st))
+		{
+			st.warm = true;
+			st.totalMs = total.step();
+			LOGI("InstrSnapshot warm restart in " + std::to_string(st.totalMs) + " ms");
+			return true;
+		}
+		mgr->clearAll();
+		coldload();
+		mgr->publishInstrRegistry();
+		if (!version.empty() && !save(path, version, tradingday, mgr)) { LOGW("InstrSnapshot cannot write " + path); }
+		st.warm = false;
+		st.totalMs = total.step();
+		LOGI("InstrSnapshot cold load in " + std::to_string(st.totalMs) + " ms");
+		return false;
+	}
+
+	/**
+	* @brief parse the specs of all records, spread over threads
+	*
+	* @param datas set to one InstrSpecData per record
+	*
+	* @return index of a record that does not parse, -1 if all do
+	*/
+	static int decodeSpecs(const InstrSnapshotReader& r, std::vector<InstrSpecDataPtr>& datas)
+	{
+		const int n = r.getInstrCount();
+		datas.assign(n, InstrSpecDataPtr());
+		std::atomic<int> bad(n);
+		auto decode = [&r, &datas, &bad](int i0, int i1)
+		{
+			for (int i = i0; i < i1; ++i)
+			{
+				InstrSpecData* d = new InstrSpecData();
+				datas[i] = InstrSpecDataPtr(d);
+				if (!d->ParseFromArray(r.getSpecData(i), (int)r.getSpecSize(i)))
+				{
+					int cur = bad.load();
+					while (i < cur && !bad.compare_exchange_weak(cur, i)) {}
+					return;
+				}
+			}
+		};
+		// a thread per kDecodeChunk records at most, small snapshots are parsed inline
+		const int nthreads = std::max(1, std::min((int)std::thread::hardware_concurrency(), n / kDecodeChunk));
+		std::vector<std::thread> threads;
+		const int per = (n + nthreads - 1) / nthreads;
+		for (int t = 1; t < nthreads; ++t)
+		{
+			threads.emplace_back(decode, std::min(n, t * per), std::min(n, (t + 1) * per));
+		}
+		decode(0, std::min(n, per));
+		for (std::thread& t : threads) { t.join(); }
+		return bad.load() < n ? bad.load() : -1;
+	}
+
+protected:
+	enum { kDecodeChunk = 2048 };
+
+	/** milliseconds between calls */
+	class StepTimer
+	{
+	public:
+		StepTimer() : m_t(std::chrono::steady_clock::now()) {}
+
+		double step()
+		{
+			std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(t - m_t).count();
+			m_t = t;
+			return ms;
+		}
+
+	protected:
+		std::chrono::steady_clock::time_point m_t;
+	};
+
+	static uint64_t hashColumn(const SQLite::Column& col, uint64_t sum)
+	{
+		const char type = (char)col.getType();
+		sum = InstrSnapshotWriter::fnv1a(&type, 1, sum);
+		const void* p = col.getBlob();
+		const uint32_t len = (uint32_t)col.getBytes();
+		sum = InstrSnapshotWriter::fnv1a(&len, sizeof(len), sum);
+		return InstrSnapshotWriter::fnv1a(p, len, sum);
+	}
+
+	static std::string versionStr(const char* source, uint64_t n, uint64_t sum)
+	{
+		char buf[48];
+		std::snprintf(buf, sizeof(buf), "%s:%llu:%016llx", source, (unsigned long long)n, (unsigned long long)sum);
+		return buf;
+	}
+
+	/**
+	* @brief compare the restored InstrMgr with the records
+	*
+	* @return number of differences
+	*/
+	static int verify(const InstrSnapshotReader& r, const std::string& path, InstrMgr* mgr)
+	{
+		int mismatches = 0;
+		{
+			auto ids = sf::slock_safe_ptr(mgr->idToIidMap());
+			auto fcs = sf::slock_safe_ptr(mgr->futureIidToChainMap());
+			auto ocs = sf::slock_safe_ptr(mgr->optionIidToChainMap());
+			for (int i = 0; i < r.getInstrCount(); ++i)
+			{
+				const int iid = r.getIid(i);
+				auto id = ids->find(r.getInstrID(i));
+				if (id == ids->end() || id->second != iid || chainNameOf(fcs, iid) != r.getFCName(i) || chainNameOf(ocs, iid) != r.getOCName(i))
+				{
+					if (mismatches == 0) { LOGW("InstrSnapshot " + path + " differs for " + r.getInstrID(i)); }
+					++mismatches;
+				}
+			}
+		}
+		for (int i = 0; i < r.getSessionCount(); ++i)
+		{
+			if (mgr->getSessionsCfgStr(r.getSessionExchID(i), r.getSessionProductID(i)) != r.getSessionCfgStr(i))
+			{
+				if (mismatches == 0) { LOGW("InstrSnapshot " + path + " sessions differ for " + r.getSessionProductID(i)); }
+				++mismatches;
+			}
+		}
+		return mismatches;
+	}
+
+	/** name of the chain of iid in a locked iid to chain map, empty if none */
+	template<typename L>
+	static std::string chainNameOf(const L& chains, int iid)
+	{
+		auto it = chains->find(iid);
+		return (it != chains->end() && it->second != nullptr) ? it->second->getName() : std::string();
+	}
+};//class InstrSnapshot
+
+}//namespace XT
+
+#endif
@@ -43,6 +43,7 @@
 #include "RollingXY.h"
 
 #include "LogUtil.h"
+#include "ParamBinding.h"
 #include "CfgMgr.h"
 #include "ExchMgr.h"
 
@@ -157,6 +158,22 @@ public:
 	*/
 	void updateStrParams(const StringMapPtr& smp);
 
+	/**
+	* @brief update with string parameters, then swap in the bound typed parameter blocks
+	*
+	* @param string parameters
+	*/
+	void applyStrParams(const StringMapPtr& smp)
+	{
+		updateStrParams(smp);
+		m_paramBindings.update(smp);
+	}
+
+	/**
+	* @brief typed parameter blocks updated by applyStrParams()
+	*/
+	ParamBindingSet& paramBindings() { return m_paramBindings; }
+
 	/**
 	* @brief initialize productid and expireintdate
 	*
@@ -1249,6 +1266,7 @@ protected:
 	OCDataPtr m_data;
 
 	StringMapPtr m_strParams;
+	ParamBindingSet m_paramBindings; ///< typed parameter blocks
 protected:
 	RollingPtr m_unldyBiasRolling;
 	RollingPtr m_undlyChgRolling;
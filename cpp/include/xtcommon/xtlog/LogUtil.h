@@ -51,11 +51,11 @@ public:
 	/**
 	* @brief disable copy constructor
 	*/
-	LogUtil(const LogUtil& from) {}// = delete;
+	LogUtil(const LogUtil&) {}// = delete;
 	/**
 	* @brief disable copy assignment
 	*/
-	const LogUtil& operator=(const LogUtil& from) { return *this; } // = delete;
+	const LogUtil& operator=(const LogUtil&) { return *this; } // = delete;
 	/**
 	* @brief destructor
 	*/
@@ -0,0 +1,551 @@
+#pragma once
+#ifndef XT_FASTLOG_H
+#define XT_FASTLOG_H
+
+/**
+* \file XTFastLog.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a deferred formatting backend for log4z.
+*
+* \description
+*	LOG_STREAM formats into a 8K LogData on the calling thread. The FLOG_* macros here
+*	only copy a call site id, a timestamp and the raw argument bytes into a per thread
+*	SPSCRingBuffer; a background thread formats them with fmt and hands the text to log4z,
+*	so filtering, files and rolling stay exactly as configured for log4z.
+*
+*	FLOGI("px:{},sz:{},instr:{}", px, sz, instrid);
+*
+*	Arguments must be arithmetic, enums, strings or other trivially copyable types fmt
+*	can format. Strings are copied (truncated to fit a record), pointers to other data are not.
+*	Until FastLogMgr::start() is called, records are formatted on the calling thread.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <type_traits>
+#include <functional>
+
+#include "XTConfig.h"
+#include "log4z.h"
+#include "fmt/format.h"
+
+#include "XTSPSCRingBuffer.h"
+
+namespace XT
+{
+
+	/**
+	* header of an encoded log record, followed by the raw argument bytes
+	*/
+	struct FastLogRecordHeader
+	{
+		uint32_t size; ///< total record size including header
+		uint32_t site; ///< call site id from FastLogMgr::registerSite
+		int64_t ts; ///< wall clock in nanoseconds since epoch
+	};
+
+	typedef void(*FastLogFormatFn)(fmt::memory_buffer& out, const char* format, const char* args);
+
+	/**
+	* static description of a logging call site
+	*/
+	struct FastLogSite
+	{
+		LoggerId id;
+		int level;
+		const char* file;
+		int line;
+		const char* format;
+		FastLogFormatFn fn;
+	};
+
+	//////encoding of single arguments
+	template<typename T, typename Enable = void>
+	struct FastLogArg
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "FLOG arguments must be trivially copyable or strings");
+		typedef T decoded_type;
+
+		static char* write(char* p, char* end, const T& v)
+		{
+			if ((size_t)(end - p) < sizeof(T)) { return nullptr; }
+			memcpy(p, &v, sizeof(T));
+			return p + sizeof(T);
+		}
+
+		static T read(const char*& p)
+		{
+			T v;
+			memcpy(&v, p, sizeof(T));
+			p += sizeof(T);
+			return v;
+		}
+	};
+
+	struct FastLogStrArg
+	{
+		typedef fmt::string_view decoded_type;
+
+		static char* write(char* p, char* end, const char* s, size_t n)
+		{
+			if ((size_t)(end - p) < sizeof(uint32_t)) { return nullptr; }
+			size_t room = (size_t)(end - p) - sizeof(uint32_t);
+			uint32_t len = (uint32_t)std::min(n, room);
+			memcpy(p, &len, sizeof(len));
+			memcpy(p + sizeof(len), s, len);
+			return p + sizeof(len) + len;
+		}
+
+		static fmt::string_view read(const char*& p)
+		{
+			uint32_t len;
+			memcpy(&len, p, sizeof(len));
+			fmt::string_view v(p + sizeof(len), len);
+			p += sizeof(len) + len;
+			return v;
+		}
+	};
+
+	template<>
+	struct FastLogArg<const char*> : public FastLogStrArg
+	{
+		static char* write(char* p, char* end, const char* s)
+		{
+			if (s == nullptr) { s = "(null)"; }
+			return FastLogStrArg::write(p, end, s, strlen(s));
+		}
+	};
+
+	template<>
+	struct FastLogArg<char*> : public FastLogArg<const char*>
+	{
+	};
+
+	template<>
+	struct FastLogArg<std::string> : public FastLogStrArg
+	{
+		static char* write(char* p, char* end, const std::string& s)
+		{
+			return FastLogStrArg::write(p, end, s.data(), s.size());
+		}
+	};
+
+	//////encoding and decoding of argument packs
+	inline char* fastLogEncode(char* p, char*)
+	{
+		return p;
+	}
+
+	template<typename H, typename... T>
+	inline char* fastLogEncode(char* p, char* end, const H& h, const T&... t)
+	{
+		p = FastLogArg<typename std::decay<H>::type>::write(p, end, h);
+		if (p == nullptr) { return nullptr; }
+		return fastLogEncode(p, end, t...);
+	}
+
+	template<typename... Ts>
+	struct FastLogDecoder;
+
+	template<>
+	struct FastLogDecoder<>
+	{
+		template<typename... Vs>
+		static void run(fmt::memory_buffer& out, const char* format, const char*, const Vs&... vs)
+		{
+			fmt::format_to(out, format, vs...);
+		}
+
+		static void decode(fmt::memory_buffer& out, const char* format, const char* args)
+		{
+			run(out, format, args);
+		}
+	};
+
+	template<typename H, typename... T>
+	struct FastLogDecoder<H, T...>
+	{
+		template<typename... Vs>
+		static void run(fmt::memory_buffer& out, const char* format, const char* p, const Vs&... vs)
+		{
+			typename FastLogArg<H>::decoded_type v = FastLogArg<H>::read(p);
+			FastLogDecoder<T...>::run(out, format, p, vs..., v);
+		}
+
+		static void decode(fmt::memory_buffer& out, const char* format, const char* args)
+		{
+			run(out, format, args);
+		}
+	};
+
+	/** type list of a call site, only used in decltype */
+	template<typename... Ts>
+	struct FastLogTypes
+	{
+	};
+
+	template<typename... Args>
+	FastLogTypes<typename std::decay<Args>::type...> fastLogTypes(const Args&...);
+
+	/**
+	* per thread ring, owned jointly by the thread and FastLogMgr
+	*/
+	struct FastLogRing
+	{
+		explicit FastLogRing(size_t capacity) : ring(capacity), closed(false), dropped(0) {}
+
+		SPSCRingBuffer ring;
+		std::atomic<bool> closed; ///< producer thread has exited
+		std::atomic<uint64_t> dropped; ///< records dropped because the ring was full
+	};
+
+	typedef std::shared_ptr<FastLogRing> FastLogRingPtr;
+
+	/**
+	* Manager of the deferred formatting backend
+	*/
+	class FastLogMgr
+	{
+	public:
+		static const size_t kMaxSites = 8192; ///< max number of FLOG call sites in a process
+		static const size_t kMaxRecordSize = 2048; ///< max encoded record size, longer strings are truncated
+		static const size_t kDefaultRingCapacity = 1 << 20; ///< bytes per thread
+
+		FastLogMgr() : m_nSites(0), m_nDroppedClosed(0), m_ringCapacity(kDefaultRingCapacity), m_pollUs(50), m_blockWhenFull(false),
+			m_running(false), m_nFormatted(0), m_nDropped(0), m_nBadFormat(0)
+		{
+		}
+
+		FastLogMgr(const FastLogMgr&) = delete;
+		FastLogMgr& operator=(const FastLogMgr&) = delete;
+
+		~FastLogMgr() { stop(); }
+
+		/**
+		* @brief get singleton instance
+		*
+		* @return singleton instance
+		*/
+		static FastLogMgr* getInstance()
+		{
+			static FastLogMgr instance;
+			return &instance;
+		}
+
+		/**
+		* @brief ring size in bytes for threads that log for the first time after this call
+		*
+		* @param capacity as power of two
+		*/
+		void setRingCapacity(size_t capacity) { m_ringCapacity = capacity; }
+
+		/** idle sleep of the background thread */
+		void setPollInterval(int us) { m_pollUs = us; }
+
+		/** spin until the ring has room instead of dropping, trades caller latency for completeness */
+		void setBlockWhenFull(bool b) { m_blockWhenFull = b; }
+
+		/** called first in the background thread, e.g. to pin it to a cpu, set before start() */
+		void setThreadInit(std::function<void()> fn) { m_threadInit = fn; }
+
+		/**
+		* @brief start the background formatting thread
+		*/
+		void start()
+		{
+			bool expected = false;
+			if (!m_running.compare_exchange_strong(expected, true)) { return; }
+			m_thread = std::thread([this]() { run(); });
+		}
+
+		/**
+		* @brief stop the background thread after draining every ring
+		*/
+		void stop()
+		{
+			bool expected = true;
+			if (!m_running.compare_exchange_strong(expected, false)) { return; }
+			if (m_thread.joinable()) { m_thread.join(); }
+			drain();
+		}
+
+		bool isRunning() const { return m_running.load(std::memory_order_relaxed); }
+
+		/**
+		* @brief register a call site, done once per site through a function local static
+		*
+		* @return site id, kMaxSites when the table is full
+		*/
+		template<typename... Ts>
+		uint32_t registerSite(FastLogTypes<Ts...>, LoggerId id, int level, const char* file, int line, const char* format)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			uint32_t n = m_nSites.load(std::memory_order_relaxed);
+			if (n >= kMaxSites)
+			{
+				return (uint32_t)kMaxSites;
+			}
+			FastLogSite& s = m_sites[n];
+			s.id = id;
+			s.level = level;
+			s.file = file;
+			s.line = line;
+			s.format = format;
+			s.fn = &FastLogDecoder<Ts...>::decode;
+			m_nSites.store(n + 1, std::memory_order_release);
+			return n;
+		}
+
+		/**
+		* @brief record a log call, never formats on the calling thread once started
+		*
+		* @param site as registered call site
+		* @param args to be copied into the record
+		*/
+		template<typename... Args>
+		void write(uint32_t site, const Args&... args)
+		{
+			if (site >= kMaxSites)
+			{
+				m_nDropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			char buf[kMaxRecordSize];
+			char* end = fastLogEncode(buf + sizeof(FastLogRecordHeader), buf + kMaxRecordSize, args...);
+			if (end == nullptr)
+			{
+				m_nDropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			FastLogRecordHeader h;
+			h.size = (uint32_t)(end - buf);
+			h.site = site;
+			h.ts = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			memcpy(buf, &h, sizeof(h));
+
+			if (!m_running.load(std::memory_order_relaxed))
+			{
+				fmt::memory_buffer out;
+				emit(buf, out);
+				return;
+			}
+
+			FastLogRing* ring = threadRing();
+			while (!ring->ring.Enqueue(buf, h.size))
+			{
+				if (!m_blockWhenFull || !m_running.load(std::memory_order_relaxed))
+				{
+					ring->dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				std::this_thread::yield();
+			}
+		}
+
+		/** records formatted and pushed to log4z */
+		uint64_t getFormattedCount() const { return m_nFormatted.load(std::memory_order_relaxed); }
+
+		/** records dropped, ring full or record too large */
+		uint64_t getDroppedCount()
+		{
+			uint64_t n = m_nDropped.load(std::memory_order_relaxed);
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto& r : m_rings)
+			{
+				n += r->dropped.load(std::memory_order_relaxed);
+			}
+			return n + m_nDroppedClosed;
+		}
+
+		/** records whose format string did not match the arguments */
+		uint64_t getBadFormatCount() const { return m_nBadFormat.load(std::memory_order_relaxed); }
+
+	protected:
+		struct ThreadRingHolder
+		{
+			FastLogRingPtr ring;
+			~ThreadRingHolder()
+			{
+				if (ring != nullptr) { ring->closed.store(true, std::memory_order_release); }
+			}
+		};
+
+		FastLogRing* threadRing()
+		{
+			static thread_local ThreadRingHolder holder;
+			if (holder.ring == nullptr)
+			{
+				holder.ring = std::make_shared<FastLogRing>(m_ringCapacity);
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_rings.push_back(holder.ring);
+			}
+			return holder.ring.get();
+		}
+
+		/** format one record and push it to log4z */
+		void emit(const char* rec, fmt::memory_buffer& out)
+		{
+			FastLogRecordHeader h;
+			memcpy(&h, rec, sizeof(h));
+			const FastLogSite& s = m_sites[h.site];
+			out.clear();
+			try
+			{
+				s.fn(out, s.format, rec + sizeof(h));
+			}
+			catch (const fmt::format_error& e)
+			{
+				m_nBadFormat.fetch_add(1, std::memory_order_relaxed);
+				out.clear();
+				fmt::format_to(out, "{} [bad log format: {}]", s.format, e.what());
+			}
+
+			zsummer::log4z::ILog4zManager* mgr = zsummer::log4z::ILog4zManager::getPtr();
+			zsummer::log4z::LogData* pLog = mgr->makeLogData(s.id, s.level);
+			pLog->_time = (time_t)(h.ts / 1000000000);
+			pLog->_precise = (unsigned int)((h.ts / 1000000) % 1000);
+			int room = LOG4Z_LOG_BUF_SIZE - pLog->_contentLen;
+			int n = std::min((int)out.size(), room);
+			memcpy(pLog->_content + pLog->_contentLen, out.data(), n);
+			pLog->_contentLen += n;
+			mgr->pushLog(pLog, s.file, s.line);
+			m_nFormatted.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/**
+		* drain every ring once, records of one pass are emitted in timestamp order
+		*
+		* @return number of records emitted
+		*/
+		size_t drain()
+		{
+			std::vector<FastLogRingPtr> rings;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				rings = m_rings;
+			}
+
+			m_pass.clear();
+			m_order.clear();
+			for (auto& r : rings)
+			{
+				FastLogRecordHeader h;
+				size_t n = sizeof(h);
+				while (r->ring.Dequeue(&h, n))
+				{
+					size_t offset = m_pass.size();
+					m_pass.resize(offset + h.size);
+					memcpy(&m_pass[offset], &h, sizeof(h));
+					size_t rest = h.size - sizeof(h);
+					if (rest > 0)
+					{
+						r->ring.Dequeue(&m_pass[offset + sizeof(h)], rest);
+					}
+					m_order.push_back(std::make_pair(h.ts, offset));
+					n = sizeof(h);
+				}
+			}
+			std::stable_sort(m_order.begin(), m_order.end(),
+				[](const std::pair<int64_t, size_t>& a, const std::pair<int64_t, size_t>& b) { return a.first < b.first; });
+			for (auto& o : m_order)
+			{
+				emit(&m_pass[o.second], m_out);
+			}
+
+			// forget rings of exited threads once they are empty
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto it = m_rings.begin(); it != m_rings.end();)
+			{
+				if ((*it)->closed.load(std::memory_order_acquire) && (*it)->ring.empty())
+				{
+					m_nDroppedClosed += (*it)->dropped.load(std::memory_order_relaxed);
+					it = m_rings.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+			return m_order.size();
+		}
+
+		void run()
+		{
+			if (m_threadInit) { m_threadInit(); }
+			while (m_running.load(std::memory_order_relaxed))
+			{
+				if (drain() == 0)
+				{
+					std::this_thread::sleep_for(std::chrono::microseconds(m_pollUs));
+				}
+			}
+		}
+
+	protected:
+		FastLogSite m_sites[kMaxSites];
+		std::atomic<uint32_t> m_nSites;
+
+		std::mutex m_mutex; ///< guards m_rings and site registration
+		std::vector<FastLogRingPtr> m_rings;
+		uint64_t m_nDroppedClosed; ///< dropped by rings already forgotten
+
+		size_t m_ringCapacity;
+		int m_pollUs;
+		bool m_blockWhenFull;
+
+		std::atomic<bool> m_running;
+		std::thread m_thread;
+		std::function<void()> m_threadInit;
+
+		// owned by the formatting thread
+		std::vector<char> m_pass;
+		std::vector<std::pair<int64_t, size_t> > m_order;
+		fmt::memory_buffer m_out;
+
+		std::atomic<uint64_t> m_nFormatted;
+		std::atomic<uint64_t> m_nDropped;
+		std::atomic<uint64_t> m_nBadFormat;
+	};
+
+}//namespace XT
+
+
+//! base macro, logformat must be a string literal in fmt syntax
+#define FLOG_FORMAT(id, level, file, line, logformat, ...) \
+do{ \
+    if (zsummer::log4z::ILog4zManager::getPtr()->prePushLog(id,level)) \
+    {\
+        static const uint32_t __flogSite = XT::FastLogMgr::getInstance()->registerSite(decltype(XT::fastLogTypes(__VA_ARGS__))(), id, level, file, line, logformat); \
+        XT::FastLogMgr::getInstance()->write(__flogSite, ##__VA_ARGS__); \
+    }\
+} while (0)
+
+//! fast macro
+#define FLOG_TRACE(id, logformat, ...) FLOG_FORMAT(id, LOG_LEVEL_TRACE, __FILE__, __LINE__, logformat, ##__VA_ARGS__)
+#define FLOG_DEBUG(id, logformat, ...) FLOG_FORMAT(id, LOG_LEVEL_DEBUG, __FILE__, __LINE__, logformat, ##__VA_ARGS__)
+#define FLOG_INFO(id, logformat, ...)  FLOG_FORMAT(id, LOG_LEVEL_INFO, __FILE__, __LINE__, logformat, ##__VA_ARGS__)
+#define FLOG_WARN(id, logformat, ...)  FLOG_FORMAT(id, LOG_LEVEL_WARN, __FILE__, __LINE__, logformat, ##__VA_ARGS__)
+#define FLOG_ERROR(id, logformat, ...) FLOG_FORMAT(id, LOG_LEVEL_ERROR, __FILE__, __LINE__, logformat, ##__VA_ARGS__)
+#define FLOG_ALARM(id, logformat, ...) FLOG_FORMAT(id, LOG_LEVEL_ALARM, __FILE__, __LINE__, logformat, ##__VA_ARGS__)
+#define FLOG_FATAL(id, logformat, ...) FLOG_FORMAT(id, LOG_LEVEL_FATAL, __FILE__, __LINE__, logformat, ##__VA_ARGS__)
+
+//! super macro.
+#define FLOGT(logformat, ...) FLOG_TRACE(LOG4Z_MAIN_LOGGER_ID, logformat, ##__VA_ARGS__)
+#define FLOGD(logformat, ...) FLOG_DEBUG(LOG4Z_MAIN_LOGGER_ID, logformat, ##__VA_ARGS__)
+#define FLOGI(logformat, ...) FLOG_INFO(LOG4Z_MAIN_LOGGER_ID, logformat, ##__VA_ARGS__)
+#define FLOGW(logformat, ...) FLOG_WARN(LOG4Z_MAIN_LOGGER_ID, logformat, ##__VA_ARGS__)
+#define FLOGE(logformat, ...) FLOG_ERROR(LOG4Z_MAIN_LOGGER_ID, logformat, ##__VA_ARGS__)
+#define FLOGA(logformat, ...) FLOG_ALARM(LOG4Z_MAIN_LOGGER_ID, logformat, ##__VA_ARGS__)
+#define FLOGF(logformat, ...) FLOG_FATAL(LOG4Z_MAIN_LOGGER_ID, logformat, ##__VA_ARGS__)
+
+#endif
@@ -848,7 +848,7 @@ inline zsummer::log4z::Log4zStream & zsummer::log4z::Log4zStream::writeWString(c
         }
     }
 #else
-    //not support
+    (void)t; //not support
 #endif
     return *this;
 }
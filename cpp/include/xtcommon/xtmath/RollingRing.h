@@ -0,0 +1,540 @@
+#pragma once
+#ifndef XT_ROLLING_RING_H
+#define XT_ROLLING_RING_H
+/**
+* \file RollingRing.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a ring buffer rolling window with the getters of Rolling.
+*
+* \description
+*	Designed for per tick updates in bar makers. The current and previous windows share one
+*	ring of (dt, value), min/max use monotonic queues of ring positions, and the window sums
+*	are compensated (Neumaier) so add/remove does not drift. Totals are compensated as well,
+*	with a Welford mean and variance.
+*
+*	Single writer, no locks: add, update and the getters must be called from the same thread,
+*	and dt must not decrease.
+*	Tick windows never allocate after init; time windows allocate only when the number of
+*	values in two spans exceeds the capacity, which then doubles.
+*/
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <boost/smart_ptr.hpp>
+
+#include "safe_ptr.h"
+
+#include "XTConfig.h"
+#include "XTEnum.pb.h"
+
+namespace XT {
+
+	/**
+	* Neumaier compensated sum, supports adding negative values to remove an earlier add
+	*/
+	struct CompensatedSum
+	{
+		double sum;
+		double comp;
+
+		CompensatedSum() : sum(0), comp(0) {}
+
+		void add(double x)
+		{
+			double t = sum + x;
+			if (std::fabs(sum) >= std::fabs(x)) { comp += (sum - t) + x; }
+			else { comp += (x - t) + sum; }
+			sum = t;
+		}
+
+		double value() const { return sum + comp; }
+
+		void reset() { sum = 0; comp = 0; }
+	};
+
+class RollingRing {
+public:
+
+	/**
+	* @name Constructor
+	*/
+	///@{
+
+	/**
+	* @brief constructor
+	*
+	* @param span in seconds, or in ticks for a tick window
+	* @param rtype as rolling type
+	* @param dttype as date time type
+	* @param capacity as initial ring size for a time window, tick windows use two spans
+	*/
+	RollingRing(int32_t span = 60, RollingType::enumtype rtype = RollingType::Time, DateTimeType::enumtype dttype = DateTimeType::UTS, size_t capacity = 1024)
+	{
+		init(span, rtype, dttype, capacity);
+	}
+
+	/**
+	* @brief initialization, clears all values
+	*
+	* @param span in seconds, or in ticks for a tick window
+	* @param rtype as rolling type
+	* @param dttype as date time type
+	* @param capacity as initial ring size for a time window
+	*/
+	void init(int32_t span, RollingType::enumtype rtype, DateTimeType::enumtype dttype, size_t capacity = 1024)
+	{
+		m_rollingType = rtype;
+		m_dtType = dttype;
+		m_span = span;
+		if (rtype == RollingType::Tick) { m_spanDT = span; }
+		else { m_spanDT = (int64_t)span * (dttype == DateTimeType::NET ? 10000000LL : 1000000LL); }
+
+		size_t need = (rtype == RollingType::Tick) ? (size_t)std::max(1, span) * 2 + 1 : std::max<size_t>(capacity, 2);
+		size_t n = 1;
+		while (n < need) { n <<= 1; }
+		m_mask = n - 1;
+		m_dts.assign(n, 0);
+		m_values.assign(n, 0.0);
+		m_minQ.reset(n);
+		m_maxQ.reset(n);
+		m_minQPrev.reset(n);
+		m_maxQPrev.reset(n);
+		m_head = m_mid = m_tail = 0;
+
+		m_seqnum = 0;
+		m_beginDT = 0;
+		m_currDT = 0;
+		m_last = 0;
+		m_min = 0;
+		m_max = 0;
+		m_hasNewMin = false;
+		m_hasNewMax = false;
+
+		m_curr.reset();
+		m_prev.reset();
+		m_tot.reset();
+		m_meanTot = 0;
+		m_m2Tot = 0;
+	}
+
+	///@}
+
+	/**
+	* @name Updating Functions
+	*/
+	///@{
+
+	/**
+	* @brief add x value
+	*
+	* @param dt as timestamp or tick
+	* @param x as double value
+	*/
+	void add(int64_t dt, double x)
+	{
+		if (m_seqnum == 0)
+		{
+			m_beginDT = dt;
+			m_min = x;
+			m_max = x;
+			m_hasNewMin = true;
+			m_hasNewMax = true;
+		}
+		else
+		{
+			m_hasNewMin = x < m_min;
+			m_hasNewMax = x > m_max;
+			if (m_hasNewMin) { m_min = x; }
+			if (m_hasNewMax) { m_max = x; }
+		}
+		++m_seqnum;
+		m_last = x;
+
+		m_tot.add(x);
+		double delta = x - m_meanTot;
+		m_meanTot += delta / m_seqnum;
+		m_m2Tot += delta * (x - m_meanTot);
+
+		if (dt > m_currDT || m_seqnum == 1) { m_currDT = dt; }
+		if (m_tail - m_head > m_mask) { grow(); }
+		uint64_t pos = m_tail++;
+		m_dts[pos & m_mask] = dt;
+		m_values[pos & m_mask] = x;
+		m_curr.add(x);
+		pushMin(m_minQ, pos, x);
+		pushMax(m_maxQ, pos, x);
+
+		evict();
+	}
+
+	/**
+	* @brief update time or tick
+	*
+	* @param dt as timestamp or tick
+	*/
+	void update(int64_t dt)
+	{
+		if (dt > m_currDT)
+		{
+			m_currDT = dt;
+			evict();
+		}
+	}
+
+	/**
+	* @brief update time
+	*
+	* @param dt as timestamp
+	*/
+	void updateByTime(int64_t dt) { update(dt); }
+
+	/**
+	* @brief update tick
+	*
+	* @param dt as tick number
+	*/
+	void updateByTick(int64_t dt) { update(dt); }
+
+	///@}
+
+	/**
+	* @name Getters
+	*/
+	///@{
+
+	int32_t getSeqnum() const { return m_seqnum; }
+	int64_t getBeginDT() const { return m_beginDT; }
+	int64_t getSpanDT() const { return m_spanDT; }
+	int64_t getCurrDT() const { return m_currDT; }
+	double getLast() const { return m_last; }
+
+	/** sum of all values */
+	double getSumTot() const { return m_tot.sum.value(); }
+	/** average of all values (Welford mean) */
+	double getAvgTot() const { return m_seqnum > 0 ? m_meanTot : 0.0; }
+	double getSumAbsTot() const { return m_tot.sumAbs.value(); }
+	double getAvgAbsTot() const { return avg(m_tot.sumAbs.value(), m_seqnum); }
+	/** sum of all positives, the positive and negative averages are over all values */
+	double getSumPosTot() const { return m_tot.sumPos.value(); }
+	double getAvgPosTot() const { return avg(m_tot.sumPos.value(), m_seqnum); }
+	double getSumNegTot() const { return m_tot.sumNeg.value(); }
+	double getAvgNegTot() const { return avg(m_tot.sumNeg.value(), m_seqnum); }
+	/** sum of all x*x */
+	double getSumM2Tot() const { return m_tot.sumM2.value(); }
+	double getAvgM2Tot() const { return avg(m_tot.sumM2.value(), m_seqnum); }
+	/** population variance of all values (Welford) */
+	double getVarTot() const { return m_seqnum > 0 ? m_m2Tot / m_seqnum : 0.0; }
+
+	/** begin and end of the windows, 0 when the window is empty */
+	double getBeginValue() const { return m_tail > m_mid ? m_values[m_mid & m_mask] : 0.0; }
+	double getEndValue() const { return m_tail > m_mid ? m_values[(m_tail - 1) & m_mask] : 0.0; }
+	double getBeginValuePrev() const { return m_mid > m_head ? m_values[m_head & m_mask] : 0.0; }
+	double getEndValuePrev() const { return m_mid > m_head ? m_values[(m_mid - 1) & m_mask] : 0.0; }
+	int64_t getBeginTs() const { return m_tail > m_mid ? m_dts[m_mid & m_mask] : 0; }
+	int64_t getEndTs() const { return m_tail > m_mid ? m_dts[(m_tail - 1) & m_mask] : 0; }
+	int64_t getBeginTsPrev() const { return m_mid > m_head ? m_dts[m_head & m_mask] : 0; }
+	int64_t getEndTsPrev() const { return m_mid > m_head ? m_dts[(m_mid - 1) & m_mask] : 0; }
+
+	/** min and max of all values */
+	double getMinValue() const { return m_min; }
+	double getMaxValue() const { return m_max; }
+	/** did the last add set a new min or max of all values */
+	bool hasNewMin() const { return m_hasNewMin; }
+	bool hasNewMax() const { return m_hasNewMax; }
+
+	double getSum() const { return m_curr.sum.value(); }
+	double getAvg() const { return avg(m_curr.sum.value(), getSizeCurr()); }
+	double getSumAbs() const { return m_curr.sumAbs.value(); }
+	double getAvgAbs() const { return avg(m_curr.sumAbs.value(), getSizeCurr()); }
+	double getSumPos() const { return m_curr.sumPos.value(); }
+	double getAvgPos() const { return avg(m_curr.sumPos.value(), getSizeCurr()); }
+	double getSumNeg() const { return m_curr.sumNeg.value(); }
+	double getAvgNeg() const { return avg(m_curr.sumNeg.value(), getSizeCurr()); }
+	double getSumM2() const { return m_curr.sumM2.value(); }
+	double getAvgM2() const { return avg(m_curr.sumM2.value(), getSizeCurr()); }
+
+	int getSizeCurr() const { return (int)(m_tail - m_mid); }
+	int getSizePrev() const { return (int)(m_mid - m_head); }
+
+	double getSumPrev() const { return m_prev.sum.value(); }
+	double getAvgPrev() const { return avg(m_prev.sum.value(), getSizePrev()); }
+	double getSumAbsPrev() const { return m_prev.sumAbs.value(); }
+	double getAvgAbsPrev() const { return avg(m_prev.sumAbs.value(), getSizePrev()); }
+	double getSumPosPrev() const { return m_prev.sumPos.value(); }
+	double getAvgPosPrev() const { return avg(m_prev.sumPos.value(), getSizePrev()); }
+	double getSumNegPrev() const { return m_prev.sumNeg.value(); }
+	double getAvgNegPrev() const { return avg(m_prev.sumNeg.value(), getSizePrev()); }
+	double getSumM2Prev() const { return m_prev.sumM2.value(); }
+	double getAvgM2Prev() const { return avg(m_prev.sumM2.value(), getSizePrev()); }
+
+	/** 100 * positives / (positives + |negatives|) in the window, 50 when both are 0 */
+	double getRsi() const { return rsi(m_curr); }
+	double getRsiPrev() const { return rsi(m_prev); }
+	double getRsiChg() const { return getRsi() - getRsiPrev(); }
+
+	/** min and max in the windows, 0 when the window is empty */
+	double getMinRolling() const { return m_minQ.empty() ? 0.0 : m_values[m_minQ.front() & m_mask]; }
+	double getMinRollingPrev() const { return m_minQPrev.empty() ? 0.0 : m_values[m_minQPrev.front() & m_mask]; }
+	double getMaxRolling() const { return m_maxQ.empty() ? 0.0 : m_values[m_maxQ.front() & m_mask]; }
+	double getMaxRollingPrev() const { return m_maxQPrev.empty() ? 0.0 : m_values[m_maxQPrev.front() & m_mask]; }
+
+	/** ring size */
+	size_t capacity() const { return m_mask + 1; }
+
+	///@}
+
+protected:
+	/**
+	* sums of a window or of all values
+	*/
+	struct Sums
+	{
+		CompensatedSum sum;
+		CompensatedSum sumAbs;
+		CompensatedSum sumPos;
+		CompensatedSum sumNeg;
+		CompensatedSum sumM2;
+
+		void add(double x)
+		{
+			sum.add(x);
+			sumAbs.add(std::fabs(x));
+			if (x > 0) { sumPos.add(x); }
+			else if (x < 0) { sumNeg.add(x); }
+			sumM2.add(x * x);
+		}
+
+		void remove(double x)
+		{
+			sum.add(-x);
+			sumAbs.add(-std::fabs(x));
+			if (x > 0) { sumPos.add(-x); }
+			else if (x < 0) { sumNeg.add(-x); }
+			sumM2.add(-x * x);
+		}
+
+		void reset()
+		{
+			sum.reset();
+			sumAbs.reset();
+			sumPos.reset();
+			sumNeg.reset();
+			sumM2.reset();
+		}
+	};
+
+	/**
+	* monotonic queue of ring positions
+	*/
+	struct PosQueue
+	{
+		std::vector<uint64_t> pos;
+		uint64_t head;
+		uint64_t tail;
+		size_t mask;
+
+		void reset(size_t n)
+		{
+			pos.assign(n, 0);
+			head = tail = 0;
+			mask = n - 1;
+		}
+
+		bool empty() const { return head == tail; }
+		uint64_t front() const { return pos[head & mask]; }
+		uint64_t back() const { return pos[(tail - 1) & mask]; }
+		void push(uint64_t p) { pos[(tail++) & mask] = p; }
+		void popBack() { --tail; }
+		void popFrontIf(uint64_t p)
+		{
+			if (head != tail && pos[head & mask] == p) { ++head; }
+		}
+	};
+
+	static double avg(double sum, int64_t n) { return n > 0 ? sum / n : 0.0; }
+
+	static double rsi(const Sums& s)
+	{
+		double up = s.sumPos.value();
+		double dn = -s.sumNeg.value();
+		return (up + dn) > 0 ? 100.0 * up / (up + dn) : 50.0;
+	}
+
+	void pushMin(PosQueue& q, uint64_t pos, double x)
+	{
+		while (!q.empty() && m_values[q.back() & m_mask] >= x) { q.popBack(); }
+		q.push(pos);
+	}
+
+	void pushMax(PosQueue& q, uint64_t pos, double x)
+	{
+		while (!q.empty() && m_values[q.back() & m_mask] <= x) { q.popBack(); }
+		q.push(pos);
+	}
+
+	/**
+	* @brief move values older than a span to the previous window, drop values older than two spans
+	*/
+	void evict()
+	{
+		int64_t cutoff = m_currDT - m_spanDT;
+		while (m_mid < m_tail && m_dts[m_mid & m_mask] <= cutoff)
+		{
+			double x = m_values[m_mid & m_mask];
+			m_curr.remove(x);
+			m_prev.add(x);
+			m_minQ.popFrontIf(m_mid);
+			m_maxQ.popFrontIf(m_mid);
+			pushMin(m_minQPrev, m_mid, x);
+			pushMax(m_maxQPrev, m_mid, x);
+			++m_mid;
+		}
+		cutoff -= m_spanDT;
+		while (m_head < m_mid && m_dts[m_head & m_mask] <= cutoff)
+		{
+			m_prev.remove(m_values[m_head & m_mask]);
+			m_minQPrev.popFrontIf(m_head);
+			m_maxQPrev.popFrontIf(m_head);
+			++m_head;
+		}
+		// an empty window restarts its sums exactly at 0
+		if (m_mid == m_tail) { m_curr.reset(); }
+		if (m_head == m_mid) { m_prev.reset(); }
+	}
+
+	/**
+	* @brief double the ring, positions are logical so only the storage moves
+	*/
+	void grow()
+	{
+		size_t n = (m_mask + 1) * 2;
+		std::vector<int64_t> dts(n);
+		std::vector<double> values(n);
+		for (uint64_t p = m_head; p < m_tail; ++p)
+		{
+			dts[p & (n - 1)] = m_dts[p & m_mask];
+			values[p & (n - 1)] = m_values[p & m_mask];
+		}
+		m_dts.swap(dts);
+		m_values.swap(values);
+		growQueue(m_minQ, n);
+		growQueue(m_maxQ, n);
+		growQueue(m_minQPrev, n);
+		growQueue(m_maxQPrev, n);
+		m_mask = n - 1;
+	}
+
+	static void growQueue(PosQueue& q, size_t n)
+	{
+		std::vector<uint64_t> pos(n);
+		for (uint64_t i = q.head; i < q.tail; ++i) { pos[i & (n - 1)] = q.pos[i & q.mask]; }
+		q.pos.swap(pos);
+		q.mask = n - 1;
+	}
+
+protected:
+	RollingType::enumtype m_rollingType; ///< rolling type
+	DateTimeType::enumtype m_dtType; ///< datetime type
+
+	int32_t m_span; ///< span
+	int64_t m_spanDT; ///< span datetime
+	int32_t m_seqnum; ///< sequence number
+	int64_t m_beginDT; ///< begin datetime
+	int64_t m_currDT; ///< current datetime
+	double m_last; ///< last value
+
+	double m_min; ///< min value
+	double m_max; ///< max value
+	bool m_hasNewMin; ///< got new min
+	bool m_hasNewMax; ///< got new max
+
+	std::vector<int64_t> m_dts; ///< ring of datetimes
+	std::vector<double> m_values; ///< ring of values
+	size_t m_mask; ///< ring size - 1
+	uint64_t m_head; ///< first position of the previous window
+	uint64_t m_mid; ///< first position of the current window
+	uint64_t m_tail; ///< next position
+
+	Sums m_curr; ///< sums of the current window
+	Sums m_prev; ///< sums of the previous window
+	Sums m_tot; ///< sums of all values
+	double m_meanTot; ///< Welford mean of all values
+	double m_m2Tot; ///< Welford sum of squared deviations of all values
+
+	PosQueue m_minQ; ///< increasing values of the current window
+	PosQueue m_maxQ; ///< decreasing values of the current window
+	PosQueue m_minQPrev; ///< increasing values of the previous window
+	PosQueue m_maxQPrev; ///< decreasing values of the previous window
+
+}; //end class RollingRing
+
+/**
+* x, y and x*y ring windows, as RollingXY
+*/
+class RollingXYRing {
+public:
+	RollingXYRing(int32_t span = 60, RollingType::enumtype rtype = RollingType::Time, DateTimeType::enumtype dttype = DateTimeType::UTS, size_t capacity = 1024)
+		: m_rx(span, rtype, dttype, capacity), m_ry(span, rtype, dttype, capacity), m_rxy(span, rtype, dttype, capacity) {}
+
+	/**
+	* @brief add x,y values
+	*
+	* @param dt as timestamp or tick
+	* @param x as first value
+	* @param y as second value
+	*/
+	void add(int64_t dt, double x, double y)
+	{
+		m_rx.add(dt, x);
+		m_ry.add(dt, y);
+		m_rxy.add(dt, x * y);
+	}
+
+	/**
+	* @brief update time or tick
+	*
+	* @param dt as timestamp or tick
+	*/
+	void update(int64_t dt)
+	{
+		m_rx.update(dt);
+		m_ry.update(dt);
+		m_rxy.update(dt);
+	}
+
+	RollingRing& rx() { return m_rx; }
+	RollingRing& ry() { return m_ry; }
+	RollingRing& rxy() { return m_rxy; }
+
+protected:
+	RollingRing m_rx; ///< rolling x window
+	RollingRing m_ry; ///< rolling y window
+	RollingRing m_rxy; ///< rolling x*y window
+}; //end class RollingXYRing
+
+   //////typedef for RollingRing
+#if defined(USE_BOOST_SHARED_PTR)
+
+typedef ::boost::shared_ptr<RollingRing> RollingRingPtr;
+typedef ::boost::shared_ptr<RollingXYRing> RollingXYRingPtr;
+
+#elif defined(USE_STD_SHARED_PTR)
+
+typedef ::std::shared_ptr<RollingRing> RollingRingPtr;
+typedef ::std::shared_ptr<RollingXYRing> RollingXYRingPtr;
+
+#else
+
+typedef ::boost::shared_ptr<RollingRing> RollingRingPtr;
+typedef ::boost::shared_ptr<RollingXYRing> RollingXYRingPtr;
+#endif
+//////end typedef for RollingRing
+
+} //end namespace XT
+
+
+#endif
@@ -53,12 +53,12 @@ namespace XT
 		/**
 		* @brief default copy constructor
 		*/
-		CurlMgr(const CurlMgr& from) {} // = delete;
+		CurlMgr(const CurlMgr&) {} // = delete;
 
 		/**
 		* @brief default copy assignment
 		*/
-		CurlMgr& operator=(const CurlMgr& from) { return *this; } // = delete;
+		CurlMgr& operator=(const CurlMgr&) { return *this; } // = delete;
 
 		/**
 		* @brief destructor
@@ -51,12 +51,12 @@ namespace XT
 		/**
 		* @brief default copy constructor
 		*/
-		WebMgr(const WebMgr& from) {} // = delete;
+		WebMgr(const WebMgr&) {} // = delete;
 
 		/**
 		* @brief default copy assignment
 		*/
-		WebMgr& operator=(const WebMgr& from) { return *this; } // = delete;
+		WebMgr& operator=(const WebMgr&) { return *this; } // = delete;
 
 		/**
 		* @brief destructor
@@ -23,6 +23,8 @@
 #include <deque>
 #include <unordered_set>
 #include <unordered_map>
+#include <mutex>
+#include <functional>
 
 #include <boost/unordered_map.hpp>
 #include <boost/smart_ptr.hpp>
@@ -50,10 +52,25 @@
 #include "XTTimer.h"
 
 #include "OrderQuoteInfo.h" 
+#include "RequestIdTable.h"
 
 namespace XT {
 
-
+	/**
+	* oid or qid entry of the order lifecycle table
+	*/
+	struct OrderIdEntry
+	{
+		int32_t iid; ///< integer id
+		int32_t idx; ///< index in the OrderInfo or QuoteInfo pool
+		int32_t qid; ///< quote id of a quote order, 0 otherwise
+		int32_t status; ///< OrderQuoteStatus bits
+		union
+		{
+			OrderInfoPtr* orderinfo; ///< pool element of an oid, nullptr until the pool index is known
+			QuoteInfoPtr* quoteinfo; ///< pool element of a qid
+		};
+	};
 
 
 class XT_COMMON_API OrderMgr {
@@ -71,12 +88,12 @@ public:
 	/**
 	* @brief default copy constructor
 	*/
-	OrderMgr(const OrderMgr& from) {}// = delete;
+	OrderMgr(const OrderMgr&) {}// = delete;
 
 	/**
 	* @brief default copy assignment
 	*/
-	OrderMgr& operator=(const OrderMgr& from) { return *this; } // = delete;
+	OrderMgr& operator=(const OrderMgr&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
@@ -189,9 +206,13 @@ public:
 	*
 	* @param oid as order id
 	*
-	* @return integer id
+	* @return integer id, -1 if unknown
 	*/
-	int getIidByOid(int oid);
+	int getIidByOid(int oid)
+	{
+		OrderIdEntry e;
+		return findOrIndexOid(oid, e) ? e.iid : -1;
+	}
 
 	/**
 	* @brief has quoteid
@@ -206,18 +227,31 @@ public:
 	*
 	* @param qid as quote id
 	*
-	* @return integer id
+	* @return integer id, -1 if unknown
 	*/
-	int getIidByQid(int qid);
+	int getIidByQid(int qid)
+	{
+		OrderIdEntry e;
+		return findOrIndexQid(qid, e) ? e.iid : -1;
+	}
 
 	/**
 	* @brief get OrderInforPtr for oid
 	*
 	* @param orderid
 	*
-	* @return OrderInfoPtr
+	* @return OrderInfoPtr, nullOrderInfo() if the oid is unknown or its pool slot was reused
 	*/
-	OrderInfoPtr& getOrderInfoForOid(int oid);
+	OrderInfoPtr& getOrderInfoForOid(int oid)
+	{
+		OrderIdEntry e;
+		if (findOrIndexOid(oid, e) && e.orderinfo != nullptr)
+		{
+			OrderInfoPtr& orderinfo = *e.orderinfo;
+			if (orderinfo.get() != nullptr && orderinfo->orderid() == oid) { return orderinfo; }
+		}
+		return m_nullOrderInfo;
+	}
 
 	/**
 	* @brief get QuoteInforPtr for quote oid
@@ -233,9 +267,18 @@ public:
 	*
 	* @param qid
 	*
-	* @return QuoteInfoPtr
+	* @return QuoteInfoPtr, nullQuoteInfo() if the qid is unknown or its pool slot was reused
 	*/
-	QuoteInfoPtr& getQuoteInfoForQid(int qid);
+	QuoteInfoPtr& getQuoteInfoForQid(int qid)
+	{
+		OrderIdEntry e;
+		if (findOrIndexQid(qid, e) && e.quoteinfo != nullptr)
+		{
+			QuoteInfoPtr& quoteinfo = *e.quoteinfo;
+			if (quoteinfo.get() != nullptr && quoteinfo->qid() == qid) { return quoteinfo; }
+		}
+		return m_nullQuoteInfo;
+	}
 
 	/**
 	* @brief get opensz for oid
@@ -272,18 +315,70 @@ public:
 	*
 	* @param oid
 	*
-	* @return status
+	* @return status, Unknown if the oid is unknown
 	*/
-	int getStatusForOid(int oid);
+	int getStatusForOid(int oid)
+	{
+		OrderIdEntry e;
+		return findOrIndexOid(oid, e) ? e.status : (int)OrderQuoteStatus_enumtype_Unknown;
+	}
 
 	/**
 	* @brief get status for qid
 	*
+	* @param qid
+	*
+	* @return status, Unknown if the qid is unknown
+	*/
+	int getStatusForQid(int qid)
+	{
+		OrderIdEntry e;
+		return findOrIndexQid(qid, e) ? e.status : (int)OrderQuoteStatus_enumtype_Unknown;
+	}
+
+	/**
+	* @brief set status of an order, a terminal status lets a later oid reuse its table slot
+	*
 	* @param oid
+	* @param status as OrderQuoteStatus bits
+	*
+	* @return false if the oid is unknown
+	*/
+	bool setStatusForOid(int oid, int status)
+	{
+		OrderIdEntry e;
+		if (!findOrIndexOid(oid, e)) { return false; }
+		if (e.orderinfo != nullptr)
+		{
+			OrderInfoPtr& orderinfo = *e.orderinfo;
+			if (orderinfo.get() != nullptr && orderinfo->orderid() == oid) { orderinfo->set_status(status); }
+		}
+		m_oidTable.modify(oid, [status](OrderIdEntry& entry) { entry.status = status; });
+		if (isTerminalStatus(status)) { m_oidTable.markTerminal(oid); }
+		return true;
+	}
+
+	/**
+	* @brief set status of a quote, a terminal status lets a later qid reuse its table slot
+	*
+	* @param qid
+	* @param status as OrderQuoteStatus bits
 	*
-	* @return status
+	* @return false if the qid is unknown
 	*/
-	int getStatusForQid(int qid);
+	bool setStatusForQid(int qid, int status)
+	{
+		OrderIdEntry e;
+		if (!findOrIndexQid(qid, e)) { return false; }
+		if (e.quoteinfo != nullptr)
+		{
+			QuoteInfoPtr& quoteinfo = *e.quoteinfo;
+			if (quoteinfo.get() != nullptr && quoteinfo->qid() == qid) { quoteinfo->set_status(status); }
+		}
+		m_qidTable.modify(qid, [status](OrderIdEntry& entry) { entry.status = status; });
+		if (isTerminalStatus(status)) { m_qidTable.markTerminal(qid); }
+		return true;
+	}
 
 	/**
 	* @brief get ocflag for oid
@@ -369,21 +464,67 @@ public:
 	/**
 	* @brief next OrderInfo
 	*
-	* @param orderid
-	* @param bs as buy sell type
+	* @param iid as integer id
+	* @param oid as order id
 	*
-	* @return next OrderInfo
+	* @return next OrderInfo, indexed in the oid table
 	*/
-	OrderInfoPtr& nextOrderInfo(int iid, int oid);
+	OrderInfoPtr& nextOrderInfo(int iid, int oid)
+	{
+		int idx = -1;
+		OrderInfoPtr& orderinfo = allocOrderInfo(iid, oid, idx);
+		if (idx >= 0) { indexOid(oid, iid, idx, &orderinfo); }
+		return orderinfo;
+	}
 
 	/**
 	* @brief next QuoteInfo
 	*
-	* @param apitype
+	* @param iid as integer id
+	* @param qid as quote id
+	* @param bidoid as order id of the bid side
+	* @param askoid as order id of the ask side
+	*
+	* @return next QuoteInfo, its qid and both oids indexed in the tables
+	*/
+	QuoteInfoPtr& nextQuoteInfo(int iid, int qid, int bidoid, int askoid)
+	{
+		int idx = -1;
+		QuoteInfoPtr& quoteinfo = allocQuoteInfo(iid, qid, bidoid, askoid, idx);
+		if (idx >= 0)
+		{
+			indexQid(qid, iid, idx, &quoteinfo);
+			// the side orders live in the QuoteInfo, not in the OrderInfo pool
+			if (bidoid != 0) { indexOid(bidoid, iid, -1, nullptr, qid); }
+			if (askoid != 0) { indexOid(askoid, iid, -1, nullptr, qid); }
+		}
+		return quoteinfo;
+	}
+
+protected:
+	/**
+	* @brief take an OrderInfo from the pool and map oid to iid and pool index
+	*
+	* @param iid as integer id
+	* @param oid as order id
+	* @param idx set to the pool index, left at -1 if the pool is exhausted
+	*
+	* @return pool element, nullOrderInfo() if the pool is exhausted
+	*/
+	OrderInfoPtr& allocOrderInfo(int iid, int oid, int& idx);
+
+	/**
+	* @brief take a QuoteInfo from the pool and map qid and both oids
 	*
-	* @return next QuoteInfo
+	* @param iid as integer id
+	* @param qid as quote id
+	* @param bidoid as order id of the bid side
+	* @param askoid as order id of the ask side
+	* @param idx set to the pool index, left at -1 if the pool is exhausted
+	*
+	* @return pool element, nullQuoteInfo() if the pool is exhausted
 	*/
-	QuoteInfoPtr& nextQuoteInfo(int iid, int qid, int bidoid, int askoid);
+	QuoteInfoPtr& allocQuoteInfo(int iid, int qid, int bidoid, int askoid, int& idx);
 
 
  
@@ -696,6 +837,286 @@ public:
 	*/
 	void logSummary();	
 
+public:
+	/**
+	* @name timers on XTTimerMgr::getTimerWheel()
+	*/
+	///@{
+
+	/**
+	* @brief call fn(oid) if the order is still tracked after timeoutns, e.g. to send a cancel
+	*
+	* A new timeout for the same oid replaces the previous one.
+	*
+	* @param oid as order id
+	* @param timeoutns as timeout in nanoseconds
+	* @param fn
+	*/
+	void scheduleOrderTimeout(int oid, int64_t timeoutns, const std::function<void(int)>& fn)
+	{
+		XTTimerWheel* wheel = XTTimerMgr::getTimerWheel();
+		std::lock_guard<std::mutex> lock(m_timerMutex);
+		auto it = m_oidToTimerMap.find(oid);
+		if (it != m_oidToTimerMap.end())
+		{
+			wheel->cancel(it->second);
+		}
+		m_oidToTimerMap[oid] = wheel->schedule(timeoutns, [this, oid, fn](uint64_t timerid, int64_t) {
+			{
+				std::lock_guard<std::mutex> lock(m_timerMutex);
+				auto it = m_oidToTimerMap.find(oid);
+				if (it == m_oidToTimerMap.end() || it->second != timerid) { return; }
+				m_oidToTimerMap.erase(it);
+			}
+			fn(oid);
+		});
+	}
+
+	/**
+	* @brief drop the timeout of an order, call on fill, cancel or reject
+	*
+	* @param oid as order id
+	*
+	* @return false if there was no pending timeout
+	*/
+	bool cancelOrderTimeout(int oid)
+	{
+		std::lock_guard<std::mutex> lock(m_timerMutex);
+		auto it = m_oidToTimerMap.find(oid);
+		if (it == m_oidToTimerMap.end()) { return false; }
+		XTTimerMgr::getTimerWheel()->cancel(it->second);
+		m_oidToTimerMap.erase(it);
+		return true;
+	}
+
+	/**
+	* @brief call fn(qid) every periodns until cancelQuoteRefresh, a new refresh for the same qid replaces the previous one
+	*
+	* @param qid as quote id
+	* @param periodns as period in nanoseconds
+	* @param fn
+	*/
+	void scheduleQuoteRefresh(int qid, int64_t periodns, const std::function<void(int)>& fn)
+	{
+		XTTimerWheel* wheel = XTTimerMgr::getTimerWheel();
+		std::lock_guard<std::mutex> lock(m_timerMutex);
+		auto it = m_qidToTimerMap.find(qid);
+		if (it != m_qidToTimerMap.end())
+		{
+			wheel->cancel(it->second);
+		}
+		m_qidToTimerMap[qid] = wheel->schedulePeriodic(periodns, [qid, fn](uint64_t, int64_t) { fn(qid); });
+	}
+
+	/**
+	* @brief stop refreshing a quote
+	*
+	* @param qid as quote id
+	*
+	* @return false if there was no refresh timer
+	*/
+	bool cancelQuoteRefresh(int qid)
+	{
+		std::lock_guard<std::mutex> lock(m_timerMutex);
+		auto it = m_qidToTimerMap.find(qid);
+		if (it == m_qidToTimerMap.end()) { return false; }
+		XTTimerMgr::getTimerWheel()->cancel(it->second);
+		m_qidToTimerMap.erase(it);
+		return true;
+	}
+
+	///@}
+
+public:
+	/**
+	* @name lock free oid and qid table
+	*
+	* nextOrderInfo and nextQuoteInfo index each new id with its pool element; getIidByOid,
+	* getOrderInfoForOid, getStatusForOid and their qid counterparts read the table without
+	* hashing or locking. An id the table has not seen (mapped before the table was filled, or
+	* whose terminal slot was taken by a later id) is read from the oid/qid maps once and indexed.
+	* Entries point at pool elements, like the references the get* functions hand out, so the
+	* pools must not grow once ids are indexed. Status changes go through setStatusForOid and
+	* setStatusForQid, which keep the table and the pool element in step.
+	*/
+	///@{
+
+	/**
+	* @brief index an order
+	*
+	* @param oid as order id
+	* @param iid as integer id
+	* @param idx as index in the OrderInfo pool, -1 for a side order of a quote
+	* @param orderinfo as pool element at idx, nullptr for a side order of a quote
+	* @param qid as quote id for a quote order
+	*/
+	void indexOid(int oid, int iid, int idx, OrderInfoPtr* orderinfo, int qid = 0)
+	{
+		OrderIdEntry e;
+		e.iid = iid;
+		e.idx = idx;
+		e.qid = qid;
+		e.status = qid != 0 ? (int)OrderQuoteStatus_enumtype_IsQuote : 0;
+		e.orderinfo = orderinfo;
+		m_oidTable.insert(oid, e);
+	}
+
+	/**
+	* @brief index a quote
+	*
+	* @param qid as quote id
+	* @param iid as integer id
+	* @param idx as index in the QuoteInfo pool
+	* @param quoteinfo as pool element at idx
+	*/
+	void indexQid(int qid, int iid, int idx, QuoteInfoPtr* quoteinfo)
+	{
+		OrderIdEntry e;
+		e.iid = iid;
+		e.idx = idx;
+		e.qid = qid;
+		e.status = OrderQuoteStatus_enumtype_IsQuote;
+		e.quoteinfo = quoteinfo;
+		m_qidTable.insert(qid, e);
+	}
+
+	/**
+	* @brief is status final (rejected, cancelled, filled or finished)
+	*/
+	static bool isTerminalStatus(int status)
+	{
+		return (status & (OrderQuoteStatus_enumtype_SentRejected | OrderQuoteStatus_enumtype_Cxled
+			| OrderQuoteStatus_enumtype_AllFilled | OrderQuoteStatus_enumtype_Finished)) != 0;
+	}
+
+	/**
+	* @brief find the table entry of an oid
+	*
+	* @return false if not indexed
+	*/
+	bool findOid(int oid, OrderIdEntry& e) const { return m_oidTable.find(oid, e); }
+
+	/**
+	* @brief find the table entry of a qid
+	*
+	* @return false if not indexed
+	*/
+	bool findQid(int qid, OrderIdEntry& e) const { return m_qidTable.find(qid, e); }
+
+	/**
+	* @brief table statistics
+	*/
+	std::string requestIdTableStatsStr() const
+	{
+		return "oid:{" + m_oidTable.statsStr() + "},qid:{" + m_qidTable.statsStr() + "}";
+	}
+
+	///@}
+
+protected:
+	/**
+	* @brief table entry of an oid, indexed from m_oidToIidMap, m_oidToIdxMap and the pool on a miss
+	*/
+	bool findOrIndexOid(int oid, OrderIdEntry& e)
+	{
+		if (m_oidTable.find(oid, e)) { return true; }
+		int iid = -1;
+		int idx = -1;
+		{
+			auto locked = sf::slock_safe_ptr(m_oidToIidMap);
+			auto it = locked->find(oid);
+			if (it == locked->end()) { return false; }
+			iid = it->second;
+		}
+		{
+			auto locked = sf::slock_safe_ptr(m_oidToIdxMap);
+			auto it = locked->find(oid);
+			if (it != locked->end()) { idx = it->second; }
+		}
+		int qid = 0;
+		{
+			auto locked = sf::slock_safe_ptr(m_oidToQidMap);
+			auto it = locked->find(oid);
+			if (it != locked->end()) { qid = it->second; }
+		}
+		OrderInfoPtr* orderinfo = nullptr;
+		if (idx >= 0)
+		{
+			auto locked = sf::slock_safe_ptr(m_orderInfoPool);
+			// the shared lock only hands out const access, the element itself is mutable
+			if ((size_t)idx < locked->size()) { orderinfo = const_cast<OrderInfoPtr*>(&locked->at(idx)); }
+		}
+		if (orderinfo == nullptr && qid == 0)
+		{
+			// the pool index is added after the iid, index once both are there
+			e.iid = iid;
+			e.idx = idx;
+			e.qid = qid;
+			e.status = 0;
+			e.orderinfo = nullptr;
+			return true;
+		}
+		indexOid(oid, iid, idx, orderinfo, qid);
+		if (orderinfo != nullptr && (*orderinfo).get() != nullptr && (*orderinfo)->orderid() == oid)
+		{
+			int status = (*orderinfo)->status();
+			m_oidTable.modify(oid, [status](OrderIdEntry& entry) { entry.status = status; });
+		}
+		return m_oidTable.find(oid, e);
+	}
+
+	/**
+	* @brief table entry of a qid, indexed from m_qidToIidMap, m_qidToIdxMap and the pool on a miss
+	*/
+	bool findOrIndexQid(int qid, OrderIdEntry& e)
+	{
+		if (m_qidTable.find(qid, e)) { return true; }
+		int iid = -1;
+		int idx = -1;
+		{
+			auto locked = sf::slock_safe_ptr(m_qidToIidMap);
+			auto it = locked->find(qid);
+			if (it == locked->end()) { return false; }
+			iid = it->second;
+		}
+		{
+			auto locked = sf::slock_safe_ptr(m_qidToIdxMap);
+			auto it = locked->find(qid);
+			if (it != locked->end()) { idx = it->second; }
+		}
+		QuoteInfoPtr* quoteinfo = nullptr;
+		if (idx >= 0)
+		{
+			auto locked = sf::slock_safe_ptr(m_quoteInfoPool);
+			if ((size_t)idx < locked->size()) { quoteinfo = const_cast<QuoteInfoPtr*>(&locked->at(idx)); }
+		}
+		if (quoteinfo == nullptr)
+		{
+			e.iid = iid;
+			e.idx = idx;
+			e.qid = qid;
+			e.status = OrderQuoteStatus_enumtype_IsQuote;
+			e.quoteinfo = nullptr;
+			return true;
+		}
+		indexQid(qid, iid, idx, quoteinfo);
+		if ((*quoteinfo).get() != nullptr && (*quoteinfo)->qid() == qid)
+		{
+			int status = (*quoteinfo)->status();
+			m_qidTable.modify(qid, [status](OrderIdEntry& entry) { entry.status = status; });
+		}
+		return m_qidTable.find(qid, e);
+	}
+
+protected:
+	RequestIdTable<OrderIdEntry> m_oidTable; ///< oid to iid, pool index and status
+	RequestIdTable<OrderIdEntry> m_qidTable; ///< qid to iid, pool index and status
+
+protected:
+	std::mutex m_timerMutex;
+	std::unordered_map<int, uint64_t> m_oidToTimerMap; ///< oid to timeout timer id
+	std::unordered_map<int, uint64_t> m_qidToTimerMap; ///< qid to refresh timer id
+
  
 
 }; //class OrderQuoteMgr
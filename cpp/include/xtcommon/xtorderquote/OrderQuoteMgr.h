@@ -30,6 +30,7 @@
 #include "LogUtil.h"
 #include "EnumUtil.h"
 #include "Util.h"
+#include "RequestIdTable.h"
  
 
 namespace XT {
@@ -485,6 +486,88 @@ public:
 
 	///@}
 
+	/**
+	* @name lock free oid and qid to iid table
+	*
+	* A cache in front of oidToIidMap()/qidToIidMap(). addOidIid and addQidIid do not fill it;
+	* findIidByOid/findIidByQid read the map once on a miss and index the id, later lookups on
+	* the ack, fill and cancel path read the table only.
+	*/
+	///@{
+
+	/**
+	* @brief index orderId to Iid
+	*
+	* @param oid as order id
+	* @param iid as integer id
+	*/
+	void indexOidIid(int32_t oid, int32_t iid) { m_oidTable.insert(oid, iid); }
+
+	/**
+	* @brief index quoteId to Iid
+	*
+	* @param qid as quote id
+	* @param iid as integer id
+	*/
+	void indexQidIid(int32_t qid, int32_t iid) { m_qidTable.insert(qid, iid); }
+
+	/**
+	* @brief get Iid by Oid, without locking once the oid is indexed
+	*
+	* @param oid as order id
+	*
+	* @return integer id, -1 if unknown
+	*/
+	int32_t findIidByOid(int32_t oid)
+	{
+		int32_t iid = -1;
+		if (m_oidTable.find(oid, iid)) { return iid; }
+		auto it = m_oidToIidMap.find(oid);
+		if (it == m_oidToIidMap.end()) { return -1; }
+		iid = it->second;
+		indexOidIid(oid, iid);
+		return iid;
+	}
+
+	/**
+	* @brief get Iid by Qid, without locking once the qid is indexed
+	*
+	* @param qid as quote id
+	*
+	* @return integer id, -1 if unknown
+	*/
+	int32_t findIidByQid(int32_t qid)
+	{
+		int32_t iid = -1;
+		if (m_qidTable.find(qid, iid)) { return iid; }
+		auto it = m_qidToIidMap.find(qid);
+		if (it == m_qidToIidMap.end()) { return -1; }
+		iid = it->second;
+		indexQidIid(qid, iid);
+		return iid;
+	}
+
+	/**
+	* @brief mark an order finished (filled, cancelled, rejected) so a later oid may reuse its slot
+	*
+	* @param oid as order id
+	*/
+	void retireOid(int32_t oid) { m_oidTable.markTerminal(oid); }
+
+	/**
+	* @brief mark a quote finished so a later qid may reuse its slot
+	*
+	* @param qid as quote id
+	*/
+	void retireQid(int32_t qid) { m_qidTable.markTerminal(qid); }
+
+	///@}
+
+protected:
+	RequestIdTable<int32_t> m_oidTable; ///< orderId to Iid
+	RequestIdTable<int32_t> m_qidTable; ///< quoteId to Iid
+
+public:
 	///////////////////////////////////
 	/**
 	* @brief log summary
@@ -0,0 +1,370 @@
+#pragma once
+#ifndef XT_REQUEST_ID_TABLE_H
+#define XT_REQUEST_ID_TABLE_H
+
+/**
+* \file RequestIdTable.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a direct indexed table for order and quote ids.
+*
+* \description
+*	Designed for the order lifecycle path (ack, fill, cancel) where oid and qid lookups come
+*	from gateway and strategy threads. The slot of an id is id & mask, mask being the
+*	capacity (a power of two) minus one. Ids from RequestMgr keep the per second sequence in
+*	the low digits, so live requests mostly land in distinct slots.
+*	Each slot is guarded by a version (seqlock): readers never lock and retry if a writer
+*	was active, writers claim the slot with a CAS. A slot of a terminal request stays
+*	readable until a new id needs it. Ids colliding with a live slot go to a locked
+*	overflow map, which is only consulted while it is not empty.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+
+#include "XTConfig.h"
+
+namespace XT {
+
+template<typename V>
+class RequestIdTable
+{
+	static_assert(std::is_trivially_copyable<V>::value, "RequestIdTable value must be trivially copyable");
+
+public:
+	/**
+	* @brief constructor
+	*
+	* @param capacity as number of slots, rounded up to power of two, should exceed the live requests of the session
+	*/
+	explicit RequestIdTable(size_t capacity = 65536)
+		: m_live(0), m_overflowSize(0), m_collisions(0), m_recycled(0)
+	{
+		size_t n = 1;
+		while (n < capacity) { n <<= 1; }
+		m_mask = (uint32_t)(n - 1);
+		m_slots.reset(new Slot[n]);
+		for (size_t i = 0; i < n; ++i)
+		{
+			m_slots[i].version.store(0, std::memory_order_relaxed);
+			m_slots[i].state.store(SlotEmpty, std::memory_order_relaxed);
+			m_slots[i].key.store(0, std::memory_order_relaxed);
+			for (int w = 0; w < kWords; ++w) { m_slots[i].words[w].store(0, std::memory_order_relaxed); }
+		}
+	}
+
+	RequestIdTable(const RequestIdTable&) = delete;
+	RequestIdTable& operator=(const RequestIdTable&) = delete;
+
+public:
+	/**
+	* @brief add or replace the value of an id
+	*
+	* @param id as oid or qid
+	* @param v as value
+	*/
+	void insert(int id, const V& v)
+	{
+		if (m_overflowSize.load(std::memory_order_acquire) > 0 && overflowUpdate(id, v)) { return; }
+		Slot& s = slot(id);
+		uint32_t ver = lockSlot(s);
+		int state = s.state.load(std::memory_order_relaxed);
+		int key = s.key.load(std::memory_order_relaxed);
+		if (state == SlotLive && key != id)
+		{
+			unlockSlot(s, ver);
+			m_collisions.fetch_add(1, std::memory_order_relaxed);
+			overflowInsert(id, v);
+			return;
+		}
+		if (state == SlotTerminal && key != id) { m_recycled.fetch_add(1, std::memory_order_relaxed); }
+		if (state != SlotLive) { m_live.fetch_add(1, std::memory_order_relaxed); }
+		s.key.store(id, std::memory_order_relaxed);
+		s.state.store(SlotLive, std::memory_order_relaxed);
+		storeValue(s, v);
+		unlockSlot(s, ver);
+	}
+
+	/**
+	* @brief lock free lookup
+	*
+	* @param id as oid or qid
+	* @param v as value found
+	*
+	* @return false if the id is unknown or its slot was recycled
+	*/
+	bool find(int id, V& v) const
+	{
+		const Slot& s = slot(id);
+		for (;;)
+		{
+			uint32_t ver = s.version.load(std::memory_order_acquire);
+			if (ver & 1)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			int state = s.state.load(std::memory_order_relaxed);
+			int key = s.key.load(std::memory_order_relaxed);
+			uint64_t words[kWords];
+			for (int w = 0; w < kWords; ++w) { words[w] = s.words[w].load(std::memory_order_relaxed); }
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (s.version.load(std::memory_order_relaxed) != ver) { continue; }
+			if (state != SlotEmpty && key == id)
+			{
+				std::memcpy(&v, words, sizeof(V));
+				return true;
+			}
+			break;
+		}
+		return m_overflowSize.load(std::memory_order_acquire) > 0 && overflowFind(id, v);
+	}
+
+	bool contains(int id) const
+	{
+		V v;
+		return find(id, v);
+	}
+
+	/**
+	* @brief update the value of a known id in place
+	*
+	* @param id as oid or qid
+	* @param fn as void(V&), called with the slot locked
+	*
+	* @return false if the id is unknown
+	*/
+	template<typename Fn>
+	bool modify(int id, Fn fn)
+	{
+		Slot& s = slot(id);
+		uint32_t ver = lockSlot(s);
+		if (s.state.load(std::memory_order_relaxed) != SlotEmpty && s.key.load(std::memory_order_relaxed) == id)
+		{
+			V v = loadValue(s);
+			fn(v);
+			storeValue(s, v);
+			unlockSlot(s, ver);
+			return true;
+		}
+		unlockSlot(s, ver);
+		if (m_overflowSize.load(std::memory_order_acquire) == 0) { return false; }
+		std::lock_guard<std::mutex> lock(m_overflowMutex);
+		auto it = m_overflow.find(id);
+		if (it == m_overflow.end()) { return false; }
+		fn(it->second.value);
+		return true;
+	}
+
+	/**
+	* @brief mark a request as finished (filled, cancelled, rejected), its slot may be reused by a new id
+	*
+	* @param id as oid or qid
+	*
+	* @return false if the id is unknown
+	*/
+	bool markTerminal(int id)
+	{
+		Slot& s = slot(id);
+		uint32_t ver = lockSlot(s);
+		if (s.state.load(std::memory_order_relaxed) == SlotLive && s.key.load(std::memory_order_relaxed) == id)
+		{
+			s.state.store(SlotTerminal, std::memory_order_relaxed);
+			unlockSlot(s, ver);
+			m_live.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+		unlockSlot(s, ver);
+		if (m_overflowSize.load(std::memory_order_acquire) == 0) { return false; }
+		std::lock_guard<std::mutex> lock(m_overflowMutex);
+		auto it = m_overflow.find(id);
+		if (it == m_overflow.end()) { return false; }
+		it->second.terminal = true;
+		return true;
+	}
+
+	/**
+	* @brief remove an id
+	*
+	* @param id as oid or qid
+	*
+	* @return false if the id is unknown
+	*/
+	bool erase(int id)
+	{
+		Slot& s = slot(id);
+		uint32_t ver = lockSlot(s);
+		int state = s.state.load(std::memory_order_relaxed);
+		if (state != SlotEmpty && s.key.load(std::memory_order_relaxed) == id)
+		{
+			s.state.store(SlotEmpty, std::memory_order_relaxed);
+			unlockSlot(s, ver);
+			if (state == SlotLive) { m_live.fetch_sub(1, std::memory_order_relaxed); }
+			return true;
+		}
+		unlockSlot(s, ver);
+		if (m_overflowSize.load(std::memory_order_acquire) == 0) { return false; }
+		std::lock_guard<std::mutex> lock(m_overflowMutex);
+		bool erased = m_overflow.erase(id) > 0;
+		m_overflowSize.store(m_overflow.size(), std::memory_order_release);
+		return erased;
+	}
+
+	/**
+	* @brief remove all ids, not safe against concurrent writers
+	*/
+	void clear()
+	{
+		for (size_t i = 0; i <= m_mask; ++i)
+		{
+			Slot& s = m_slots[i];
+			uint32_t ver = lockSlot(s);
+			s.state.store(SlotEmpty, std::memory_order_relaxed);
+			unlockSlot(s, ver);
+		}
+		std::lock_guard<std::mutex> lock(m_overflowMutex);
+		m_overflow.clear();
+		m_overflowSize.store(0, std::memory_order_release);
+		m_live.store(0, std::memory_order_relaxed);
+	}
+
+public:
+	size_t capacity() const { return (size_t)m_mask + 1; }
+
+	/** live (not terminal) ids in the slots */
+	int64_t live() const { return m_live.load(std::memory_order_relaxed); }
+
+	/** ids in the overflow map */
+	size_t overflowSize() const { return m_overflowSize.load(std::memory_order_relaxed); }
+
+	/** inserts that met a live slot of another id */
+	uint64_t collisions() const { return m_collisions.load(std::memory_order_relaxed); }
+
+	/** terminal slots reused by a new id */
+	uint64_t recycled() const { return m_recycled.load(std::memory_order_relaxed); }
+
+	std::string statsStr() const
+	{
+		return "capacity:" + std::to_string(capacity()) + ",live:" + std::to_string(live())
+			+ ",overflow:" + std::to_string(overflowSize()) + ",collisions:" + std::to_string(collisions())
+			+ ",recycled:" + std::to_string(recycled());
+	}
+
+protected:
+	enum { kWords = (int)((sizeof(V) + 7) / 8) };
+	enum { SlotEmpty = 0, SlotLive = 1, SlotTerminal = 2 };
+
+	struct Slot
+	{
+		std::atomic<uint32_t> version; ///< odd while a writer holds the slot
+		std::atomic<int> state;
+		std::atomic<int> key;
+		std::atomic<uint64_t> words[kWords];
+	};
+
+	struct OverflowEntry
+	{
+		V value;
+		bool terminal;
+	};
+
+	Slot& slot(int id) { return m_slots[(uint32_t)id & m_mask]; }
+	const Slot& slot(int id) const { return m_slots[(uint32_t)id & m_mask]; }
+
+	static uint32_t lockSlot(Slot& s)
+	{
+		uint32_t ver = s.version.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			if ((ver & 1) == 0 && s.version.compare_exchange_weak(ver, ver + 1, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				std::atomic_thread_fence(std::memory_order_release);
+				return ver;
+			}
+			std::this_thread::yield();
+			ver = s.version.load(std::memory_order_relaxed);
+		}
+	}
+
+	static void unlockSlot(Slot& s, uint32_t ver)
+	{
+		s.version.store(ver + 2, std::memory_order_release);
+	}
+
+	static V loadValue(const Slot& s)
+	{
+		uint64_t words[kWords];
+		for (int w = 0; w < kWords; ++w) { words[w] = s.words[w].load(std::memory_order_relaxed); }
+		V v;
+		std::memcpy(&v, words, sizeof(V));
+		return v;
+	}
+
+	static void storeValue(Slot& s, const V& v)
+	{
+		uint64_t words[kWords] = {};
+		std::memcpy(words, &v, sizeof(V));
+		for (int w = 0; w < kWords; ++w) { s.words[w].store(words[w], std::memory_order_relaxed); }
+	}
+
+	void overflowInsert(int id, const V& v)
+	{
+		std::lock_guard<std::mutex> lock(m_overflowMutex);
+		if (m_overflow.size() >= capacity())
+		{
+			for (auto it = m_overflow.begin(); it != m_overflow.end();)
+			{
+				if (it->second.terminal) { it = m_overflow.erase(it); }
+				else { ++it; }
+			}
+		}
+		OverflowEntry& e = m_overflow[id];
+		e.value = v;
+		e.terminal = false;
+		m_overflowSize.store(m_overflow.size(), std::memory_order_release);
+	}
+
+	bool overflowUpdate(int id, const V& v)
+	{
+		std::lock_guard<std::mutex> lock(m_overflowMutex);
+		auto it = m_overflow.find(id);
+		if (it == m_overflow.end()) { return false; }
+		it->second.value = v;
+		it->second.terminal = false;
+		return true;
+	}
+
+	bool overflowFind(int id, V& v) const
+	{
+		std::lock_guard<std::mutex> lock(m_overflowMutex);
+		auto it = m_overflow.find(id);
+		if (it == m_overflow.end()) { return false; }
+		v = it->second.value;
+		return true;
+	}
+
+protected:
+	std::unique_ptr<Slot[]> m_slots;
+	uint32_t m_mask;
+	std::atomic<int64_t> m_live;
+
+	mutable std::mutex m_overflowMutex;
+	std::unordered_map<int, OverflowEntry> m_overflow; ///< ids whose slot was held by a live id
+	std::atomic<size_t> m_overflowSize;
+
+	std::atomic<uint64_t> m_collisions;
+	std::atomic<uint64_t> m_recycled;
+}; //class RequestIdTable
+
+} //namespace XT
+
+#endif
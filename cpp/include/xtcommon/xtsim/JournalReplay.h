@@ -0,0 +1,473 @@
+#pragma once
+#ifndef XT_JOURNAL_REPLAY_H
+#define XT_JOURNAL_REPLAY_H
+
+/**
+* \file JournalReplay.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a deterministic replay engine over recorded MemDB journals.
+*
+* \description
+*	MarketSim drives simulations from CSV lines. JournalReplay drives the same
+*	SimMd/SimTrader/MarketManager objects from the exact bytes recorded in MemDB journals
+*	during live runs, in gen_time order, either as fast as possible or paced against
+*	the wall clock, while a virtual clock keeps TimeUtil and the market XTTimer in step
+*	with the replayed data.
+*	Out of the box it decodes the frames JournalRecorder writes (MktQuoteData and
+*	ReplayOrderBookEvent). Frames of other producers, e.g. order or trade updates recorded by a
+*	live process, are replayed by registering a decoder with onProto or onFrame; frames without
+*	a decoder, the MemDB control frames included, only move the clock.
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>
+
+#include "XTConfig.h"
+#include "XTEnum.pb.h"
+#include "XTData.pb.h"
+#include "typedef_XTData.pb.h"
+
+#include "log4z.h"
+#include "fmt/format.h"
+
+#include "TimeUtil.h"
+#include "XTTimer.h"
+
+#include "MemDBData.h"
+#include "MemDBJournal.h"
+#include "MemDBTypeRegistry.h"
+
+#include "MarketManager.h"
+#include "XTOrder.h"
+#include "SimMd.h"
+#include "SimTrader.h"
+
+namespace XT
+{
+
+	/**
+	* actions of a market-by-order event
+	*/
+	class ReplayOrderBookAction
+	{
+	public:
+		enum enumtype
+		{
+			Add = 1,
+			Reduce = 2,
+			Modify = 3,
+			Delete = 4,
+			Execute = 5
+		};
+	};
+
+#ifdef _WIN32
+#pragma  pack(push, 1)
+#endif
+	/**
+	* market-by-order event as recorded in a journal, msg type MemDBExtMsgType::OrderBookEvent.
+	* MktQuoteData is recorded as a serialized protobuf with msg type MemDBExtMsgType::MktQuoteData.
+	*/
+	struct ReplayOrderBookEvent
+	{
+		int64_t id;
+		int64_t price;
+		int64_t quantity;
+		uint32_t symbol;
+		int32_t action; ///< ReplayOrderBookAction
+		int32_t side; ///< OrderSide
+#ifndef _WIN32
+	} __attribute__((packed));
+#else
+};
+#pragma pack(pop)
+#endif
+
+}//namespace XT
+
+XT_MEMDB_REGISTER_TYPE(XT::ReplayOrderBookEvent, XT::MemDBExtMsgType::OrderBookEvent, 1,
+	XT_MEMDB_FIELD(XT::ReplayOrderBookEvent, id), XT_MEMDB_FIELD(XT::ReplayOrderBookEvent, price), XT_MEMDB_FIELD(XT::ReplayOrderBookEvent, quantity),
+	XT_MEMDB_FIELD(XT::ReplayOrderBookEvent, symbol), XT_MEMDB_FIELD(XT::ReplayOrderBookEvent, action), XT_MEMDB_FIELD(XT::ReplayOrderBookEvent, side))
+
+namespace XT
+{
+
+	/**
+	* Virtual clock of a replay. Time only moves when a frame is replayed,
+	* so two replays of the same journals see identical timestamps.
+	* Journal gen_time is in nanoseconds, TimeUtil/XTTimer timestamps in microseconds.
+	*/
+	class ReplayClock
+	{
+	public:
+		ReplayClock() : m_nowNano(0), m_installed(false) {}
+
+		/**
+		* switch TimeUtil, the market timer and the timing wheel to outside timestamps
+		* @param startNano as the time of the first replayed frame, timers pending on the wheel keep their remaining delay from it
+		*/
+		void install(int64_t startNano)
+		{
+			if (startNano > m_nowNano) { m_nowNano = startNano; }
+			int64_t ts = m_nowNano / 1000;
+			TimeUtil::setNowType(1);
+			TimeUtil::setNowTs(ts);
+			XTTimer* timer = XTTimerMgr::getMktTimer();
+			if (timer != nullptr)
+			{
+				timer->setNowType(1);
+				timer->setNowTs(ts);
+			}
+			XTTimerMgr::getTimerWheel()->setClockType(XTTimerWheel::SimClock, m_nowNano);
+			m_installed = true;
+		}
+
+		/** restore wall clock, the timing wheel thread stopped by install is started again */
+		void uninstall()
+		{
+			if (!m_installed) { return; }
+			TimeUtil::setNowType(0);
+			XTTimer* timer = XTTimerMgr::getMktTimer();
+			if (timer != nullptr)
+			{
+				timer->setNowType(0);
+			}
+			XTTimerWheel* wheel = XTTimerMgr::getTimerWheel();
+			wheel->setClockType(XTTimerWheel::WallClock);
+			wheel->start();
+			m_installed = false;
+		}
+
+		bool isInstalled() const { return m_installed; }
+
+		/** move the clock forward, never backward */
+		void advanceTo(int64_t nano)
+		{
+			if (nano <= m_nowNano) { return; }
+			m_nowNano = nano;
+			if (!m_installed) { return; }
+			int64_t ts = nano / 1000;
+			TimeUtil::setNowTs(ts);
+			XTTimer* timer = XTTimerMgr::getMktTimer();
+			if (timer != nullptr)
+			{
+				timer->setNowTs(ts);
+			}
+			XTTimerWheel* wheel = XTTimerMgr::getTimerWheel();
+			if (wheel->getClockType() == XTTimerWheel::SimClock)
+			{
+				wheel->advanceTo(nano);
+			}
+		}
+
+		int64_t getNowNano() const { return m_nowNano; }
+
+		int64_t getNowTs() const { return m_nowNano / 1000; }
+
+	private:
+		int64_t m_nowNano;
+		bool m_installed;
+	};
+
+	/**
+	* Replays recorded MemDB journals into the simulators.
+	* MemDBReader merges the joined journals by gen_time; frames are dispatched on the calling thread.
+	*/
+	class JournalReplay
+	{
+	public:
+		typedef std::function<void(const MsgEvent&)> FrameHandler;
+
+		JournalReplay() :
+			m_reader(std::make_shared<MemDBReader>(true)), m_speed(0.0), m_beginNano(0), m_endNano(0),
+			m_stopped(false), m_nFrames(0), m_nMktData(0), m_nOrderEvents(0), m_nBadFrames(0), m_nOutOfOrder(0)
+		{
+			m_dispatcher.on<ReplayOrderBookEvent>([this](const MsgEvent&, const ReplayOrderBookEvent& e) { onOrderBookEvent(e); });
+			m_dispatcher.onRaw(MemDBExtMsgType::MktQuoteData, [this](const MsgEvent& e) { onMktQuoteFrame(e); });
+		}
+
+		/** join a recorded journal, must be called before run() */
+		void addJournal(const MemDBLocationPtr& location, uint32_t dest_id)
+		{
+			m_reader->join(location, dest_id, m_beginNano);
+		}
+
+		/** replay only frames with begin <= gen_time <= end, 0 means unbounded; set before addJournal */
+		void setTimeRange(int64_t beginNano, int64_t endNano)
+		{
+			m_beginNano = beginNano;
+			m_endNano = endNano;
+		}
+
+		/**
+		* @param speed 0 replays as fast as possible, otherwise replayed time runs speed times faster than the wall clock
+		*/
+		void setSpeed(double speed) { m_speed = speed; }
+
+		double getSpeed() const { return m_speed; }
+
+		void setSimMd(const SimMdPtr& md) { m_md = md; }
+
+		void setSimTrader(const SimTraderPtr& trd) { m_trd = trd; }
+
+		/** book for ReplayOrderBookEvent, defaults to the MarketManager of the SimTrader */
+		void setMarketManager(const MarketManagerPtr& mktMgr) { m_mktMgr = mktMgr; }
+
+		/** extra handler for a msg type, e.g. recorded OrderInfo/TradeInfo for reconciliation */
+		void onFrame(int32_t msg_type, FrameHandler handler) { m_dispatcher.onRaw(msg_type, std::move(handler)); }
+
+		/**
+		* decode the frames of msg_type as a serialized protobuf T, e.g. OrderInfo recorded with
+		* JournalRecorder::recordProto. T is reused between frames, frames that fail to parse are bad frames.
+		*/
+		template<typename T>
+		void onProto(int32_t msg_type, std::function<void(const MsgEvent&, const T&)> handler)
+		{
+			std::shared_ptr<T> msg = std::make_shared<T>();
+			int64_t* pBad = &m_nBadFrames;
+			m_dispatcher.onRaw(msg_type, [msg, handler, pBad](const MsgEvent& e)
+			{
+				if (!msg->ParseFromArray(e.data_as_bytes(), (int)e.data_length()))
+				{
+					++(*pBad);
+					return;
+				}
+				handler(e, *msg);
+			});
+		}
+
+		ReplayClock& clock() { return m_clock; }
+
+		/** stop a running replay from another thread */
+		void stop() { m_stopped.store(true); }
+
+		/**
+		* replay until the journals are exhausted, the end of the time range, or stop()
+		* @return number of frames replayed
+		*/
+		int64_t run()
+		{
+			m_stopped.store(false);
+			int64_t firstNano = 0;
+			std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+			while (!m_stopped.load(std::memory_order_relaxed) && m_reader->data_available())
+			{
+				MemDBFramePtr frame = m_reader->current_frame();
+				int64_t genTime = frame->gen_time();
+				if (m_endNano > 0 && genTime > m_endNano)
+				{
+					break;
+				}
+				if (!m_clock.isInstalled())
+				{
+					m_clock.install(genTime);
+				}
+				else if (genTime < m_clock.getNowNano())
+				{
+					++m_nOutOfOrder;
+				}
+
+				if (m_speed > 0.0)
+				{
+					if (firstNano == 0)
+					{
+						firstNano = genTime;
+						wallStart = std::chrono::steady_clock::now();
+					}
+					std::chrono::nanoseconds offset(static_cast<int64_t>((genTime - firstNano) / m_speed));
+					std::this_thread::sleep_until(wallStart + offset);
+				}
+
+				m_clock.advanceTo(genTime);
+				m_dispatcher.dispatch(*frame);
+				++m_nFrames;
+				m_reader->next();
+			}
+
+			m_clock.uninstall();
+			LOGI(fmt::format("JournalReplay,frames:{},mktdata:{},orderevents:{},bad:{},outoforder:{}", m_nFrames, m_nMktData, m_nOrderEvents, m_nBadFrames + (int64_t)m_dispatcher.getBadLengthCount(), m_nOutOfOrder));
+			return m_nFrames;
+		}
+
+		int64_t getFrameCount() const { return m_nFrames; }
+
+		int64_t getMktDataCount() const { return m_nMktData; }
+
+		int64_t getOrderEventCount() const { return m_nOrderEvents; }
+
+		int64_t getBadFrameCount() const { return m_nBadFrames + (int64_t)m_dispatcher.getBadLengthCount(); }
+
+		/** frames whose gen_time went backwards, 0 for a well formed recording */
+		int64_t getOutOfOrderCount() const { return m_nOutOfOrder; }
+
+	protected:
+		void onMktQuoteFrame(const MsgEvent& e)
+		{
+			MktQuoteDataPtr mktdata(new MktQuoteData());
+			if (!mktdata->ParseFromArray(e.data_as_bytes(), (int)e.data_length()))
+			{
+				++m_nBadFrames;
+				return;
+			}
+			++m_nMktData;
+			if (m_md != nullptr)
+			{
+				m_md->onMktQuoteData(mktdata);
+			}
+			if (m_trd != nullptr)
+			{
+				m_trd->onMktQuoteData(mktdata);
+			}
+		}
+
+		void onOrderBookEvent(const ReplayOrderBookEvent& e)
+		{
+			++m_nOrderEvents;
+			//without an explicit MarketManager the events go to the book SimTrader matches against
+			MarketManagerPtr mktMgr = m_mktMgr;
+			if (mktMgr == nullptr && m_trd != nullptr)
+			{
+				mktMgr = m_trd->getMarketManager();
+			}
+			if (mktMgr == nullptr)
+			{
+				return;
+			}
+			switch (e.action)
+			{
+			case ReplayOrderBookAction::Add:
+				mktMgr->AddOrder(XTOrder::Limit(e.id, e.symbol, (e.side == OrderSide::SELL) ? OrderSide::SELL : OrderSide::BUY, e.price, e.quantity));
+				break;
+			case ReplayOrderBookAction::Reduce:
+				mktMgr->ReduceOrder(e.id, e.quantity);
+				break;
+			case ReplayOrderBookAction::Modify:
+				mktMgr->ModifyOrder(e.id, e.price, e.quantity);
+				break;
+			case ReplayOrderBookAction::Delete:
+				mktMgr->DeleteOrder(e.id);
+				break;
+			case ReplayOrderBookAction::Execute:
+				mktMgr->ExecuteOrder(e.id, e.price, e.quantity);
+				break;
+			default:
+				++m_nBadFrames;
+				break;
+			}
+		}
+
+	protected:
+		MemDBReaderPtr m_reader;
+		MemDBTypedDispatcher m_dispatcher;
+		ReplayClock m_clock;
+
+		SimMdPtr m_md;
+		SimTraderPtr m_trd;
+		MarketManagerPtr m_mktMgr;
+
+		double m_speed;
+		int64_t m_beginNano;
+		int64_t m_endNano;
+		std::atomic<bool> m_stopped;
+
+		int64_t m_nFrames;
+		int64_t m_nMktData;
+		int64_t m_nOrderEvents;
+		int64_t m_nBadFrames;
+		int64_t m_nOutOfOrder;
+	};
+
+	typedef std::shared_ptr<JournalReplay> JournalReplayPtr;
+
+	/**
+	* Records the frames JournalReplay understands, e.g. from a live md gateway
+	* or while converting csv/column store history into journals.
+	* gen_time of the frames is the exchange time of the data, so a converted recording
+	* replays with the original timestamps.
+	* Not thread safe, use one recorder per writer thread.
+	*/
+	class JournalRecorder
+	{
+	public:
+		explicit JournalRecorder(const MemDBWriterPtr& writer) : m_writer(writer), m_nMktData(0), m_nOrderEvents(0), m_nBadData(0)
+		{
+			//replay checks the layouts of the recorded PODs against its own
+			memdb_write_schema(*m_writer, 0);
+		}
+
+		/**
+		* @param genNano gen_time of the frame in nanoseconds, 0 takes exchts (microseconds) of the quote
+		*/
+		void recordMktQuoteData(MktQuoteDataPtr& mktdata, int64_t genNano = 0)
+		{
+			int size = mktdata->ByteSize();
+			m_buf.resize(size > 0 ? size : 1);
+			if (!mktdata->SerializeToArray(&m_buf[0], size))
+			{
+				++m_nBadData;
+				return;
+			}
+			if (genNano == 0)
+			{
+				genNano = mktdata->exchts() * 1000;
+			}
+			m_writer->write_raw_with_time(genNano, MemDBExtMsgType::MktQuoteData, reinterpret_cast<uintptr_t>(&m_buf[0]), (uint32_t)size);
+			++m_nMktData;
+		}
+
+		/**
+		* record any protobuf message, replayed with JournalReplay::onProto
+		* @param msg_type as a msg type no other producer of the journal uses
+		* @param genNano gen_time of the frame in nanoseconds
+		*/
+		void recordProto(int32_t msg_type, const google::protobuf::Message& msg, int64_t genNano)
+		{
+			int size = msg.ByteSize();
+			m_buf.resize(size > 0 ? size : 1);
+			if (!msg.SerializeToArray(&m_buf[0], size))
+			{
+				++m_nBadData;
+				return;
+			}
+			m_writer->write_raw_with_time(genNano, msg_type, reinterpret_cast<uintptr_t>(&m_buf[0]), (uint32_t)size);
+		}
+
+		/**
+		* @param genNano gen_time of the frame in nanoseconds
+		*/
+		void recordOrderBookEvent(const ReplayOrderBookEvent& e, int64_t genNano)
+		{
+			m_writer->write_with_time(genNano, MemDBExtMsgType::OrderBookEvent, e);
+			++m_nOrderEvents;
+		}
+
+		int64_t getMktDataCount() const { return m_nMktData; }
+
+		int64_t getOrderEventCount() const { return m_nOrderEvents; }
+
+		/** quotes and messages that failed to serialize */
+		int64_t getBadDataCount() const { return m_nBadData; }
+
+	private:
+		MemDBWriterPtr m_writer;
+		std::vector<char> m_buf;
+		int64_t m_nMktData;
+		int64_t m_nOrderEvents;
+		int64_t m_nBadData;
+	};
+
+	typedef std::shared_ptr<JournalRecorder> JournalRecorderPtr;
+
+}//namespace XT
+
+#endif
@@ -18,6 +18,7 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 
 #include <boost/smart_ptr.hpp>
 #include "safe_ptr.h"
@@ -43,6 +44,9 @@
 
 #include "LineFiles.h"
 #include "LineFilesGroup.h"
+#include "JournalReplay.h"
+#include "MktColumnStore.h"
+#include "CsvUtil.h"
 
 #include "InstrUtil.h"
 
@@ -102,9 +106,15 @@ protected:
 	int m_csvSkipCols;
 	int m_csvType;
 
+	CsvFields m_csvFields; ///< fields of the line being processed
+	std::vector<const google::protobuf::FieldDescriptor*> m_csvFieldDescs; ///< MktQuoteData field of each csv item
+	std::vector<std::string> m_csvFieldDescItems; ///< csv items m_csvFieldDescs was looked up for
+
 
 	MktQuoteDataPtr m_mktQuoteData;
 
+	JournalRecorderPtr m_journalRecorder; ///< records the simulated ticks for JournalReplay when set
+
 	LineFilesGroupPtr m_mktFilesGroup;
 	LineFilesPtr m_instrFiles;
 
@@ -119,6 +129,108 @@ public:
 
 	void processMktDataCsvStr(const std::string& csvstr);
 
+	/**
+	* @brief process a MktQuoteData csv line without copying its fields
+	*
+	*	Counterpart of processMktQuoteDataCsvStr for the lines of e.g.
+	*	PipelinedLineFilesGroup::getLineView: the fields are parsed in place, no string is made
+	*	per field. A new MktQuoteData is still made per line, SimMd and SimTrader keep the tick.
+	*	The columns after the skipped ones are named by the csv items, items which are not
+	*	MktQuoteData fields are ignored.
+	*
+	* @param s as line
+	* @param n as line length
+	*
+	* @return false if the line has no columns
+	*/
+	bool processMktQuoteDataCsvView(const char* s, size_t n)
+	{
+		if (m_csvFieldDescItems != m_csvItems)
+		{
+			const google::protobuf::Descriptor* desc = MktQuoteData::descriptor();
+			m_csvFieldDescs.clear();
+			for (const std::string& item : m_csvItems) { m_csvFieldDescs.push_back(desc->FindFieldByName(item)); }
+			m_csvFieldDescItems = m_csvItems;
+		}
+		size_t nbfields = CsvUtil::split(s, n, m_csvDelimiter.empty() ? std::string(",") : m_csvDelimiter, m_csvFields);
+		size_t skip = (size_t)std::max(0, m_csvSkipCols);
+		if (nbfields <= skip) { return false; }
+
+		MktQuoteData* d = new MktQuoteData();
+		for (size_t i = 0; i + skip < nbfields && i < m_csvFieldDescs.size(); ++i)
+		{
+			const CsvField& f = m_csvFields[i + skip];
+			if (m_csvFieldDescs[i] == nullptr || f.empty()) { continue; }
+			CsvUtil::setPBField(d, m_csvFieldDescs[i], f);
+		}
+		MktQuoteDataPtr mktdata(d);
+		if (m_journalRecorder != nullptr)
+		{
+			m_journalRecorder->recordMktQuoteData(mktdata);
+		}
+		if (m_md != nullptr)
+		{
+			m_md->onMktQuoteData(mktdata);
+		}
+		if (m_trd != nullptr)
+		{
+			m_trd->onMktQuoteData(mktdata);
+		}
+		return true;
+	}
+
+	/**
+	* @brief create a journal replay feeding this simulation's SimMd and SimTrader
+	*
+	* @return replay engine, join recorded journals with addJournal then call run
+	*/
+	JournalReplayPtr createJournalReplay()
+	{
+		JournalReplayPtr replay = std::make_shared<JournalReplay>();
+		replay->setSimMd(m_md);
+		replay->setSimTrader(m_trd);
+		return replay;
+	}
+
+	/**
+	* @brief record the ticks fed by processMktQuoteDataCsvView and replayColumnStore,
+	*	e.g. to convert csv or column store history into journals for JournalReplay
+	*
+	* @param recorder as recorder, nullptr stops recording
+	*/
+	void setJournalRecorder(const JournalRecorderPtr& recorder) { m_journalRecorder = recorder; }
+
+	/**
+	* @brief replay the ticks of a column store into this simulation's SimMd and SimTrader
+	*
+	* @param root as column store root directory
+	* @param exch as exchange id
+	* @param startday as first trading day
+	* @param endday as last trading day
+	* @param instrids as instruments to replay, empty for all
+	*
+	* @return number of ticks replayed
+	*/
+	uint64_t replayColumnStore(const std::string& root, const std::string& exch, int startday, int endday,
+		const std::vector<std::string>& instrids = std::vector<std::string>())
+	{
+		return MktColumnStoreLoader::replayTicks(root, exch, startday, endday, [this](MktQuoteDataPtr& mktdata) {
+			if (m_journalRecorder != nullptr)
+			{
+				m_journalRecorder->recordMktQuoteData(mktdata);
+			}
+			if (m_md != nullptr)
+			{
+				m_md->onMktQuoteData(mktdata);
+			}
+			if (m_trd != nullptr)
+			{
+				m_trd->onMktQuoteData(mktdata);
+			}
+			return true;
+		}, instrids);
+	}
+
 protected:
 	void processCTPMktDataCsvStr(const std::string& csvstr);
 
@@ -21,6 +21,7 @@
 //#include <boost/lockfree/queue.hpp>
 //#include <boost/lockfree/spsc_queue.hpp>
 #include "Containers.h"
+#include "XTMPMCWaitRing.h"
 
 #include "XTConfig.h"
 #include "XTEnum.pb.h"
@@ -71,13 +72,23 @@ namespace XT
 
 		int getTaskQueueSz(int flag);
 
+		/**
+		* @brief number of task pushes that found the ring full and spilled
+		*/
+		uint64_t getTaskQueueOverflows() { return m_task_queue.overflows(); }
+
+		/**
+		* @brief peak task queue size
+		*/
+		size_t getTaskQueuePeak() { return m_task_queue.peak(); }
+
 	protected:
 
 		XT::GatewayCfgDataPtr m_cfgData;
 		XT::GatewayDataPtr m_data;
 
 		std::thread* m_task_thread;
-		ConcurrentQueue<SimMdTask> m_task_queue;
+		MPMCWaitRing<SimMdTask> m_task_queue; ///< task queue, push never blocks and spills past the ring capacity
 
 
 		std::set<std::string> m_instrPrefixSet;///< instrument prefixes set
@@ -63,6 +63,11 @@ public:
 	*/
 	virtual void onDataStr(const std::string& line, const std::string& datatype);
 
+	/**
+	* @brief order book orders are matched against, e.g. fed by JournalReplay
+	*/
+	MarketManagerPtr& getMarketManager() { return m_mktMgr; }
+
 protected:
 	virtual void onAddSymbol(const Symbol& symbol);
 
@@ -14,6 +14,8 @@
 
 #include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 
@@ -45,6 +47,7 @@
 //#include "InstrIndicator.h"
 
 #include "StringMap.h"
+#include "ParamBinding.h"
 #include "InstrMgr.h"
 #include "SettingsMgr.h"
 #include "InstrSettingsMgr.h"
@@ -57,6 +60,7 @@
 #include "XTTimer.h" 
 
 #include "XTApiMgr.h"
+#include "XTMsgWire.h"
 #include "InstrEventHandler.h"
 
 #include "ThreadUtil.h"
@@ -118,6 +122,9 @@ protected:
 	//
 	std::unordered_map<int, int> m_iidToTrdStatusMap; ///< instrument integer id to TrdStatus map;
 
+	ParamBindingSet m_paramBindings; ///< typed parameter blocks parsed from m_strParams and m_iidParameters
+	std::shared_ptr<std::mutex> m_strParamsMutex = std::make_shared<std::mutex>(); ///< guards m_strParams and serializes binding refreshes, held by pointer so Strat stays copyable
+
 public:
 	/**
 	* @brief cfg data
@@ -206,6 +213,50 @@ public:
 	* @param status
 	*/
 	void setTrdStatusForIid(int iid, int status);
+
+	/**
+	* @brief register a typed parameter block, filled from strategy and iid parameters by refreshBoundParams()
+	*
+	*	Callbacks read it through a ParamBinding<P>::Reader held for the callback, which pins one
+	*	block without locking.
+	*
+	* @param binding as a member of the derived strategy
+	*/
+	void bindStrParams(ParamBindingBase* binding)
+	{
+		m_paramBindings.bind(binding);
+	}
+
+	/**
+	* @brief parse strategy and iid parameters into the bound parameter blocks, call at the end of init()
+	*/
+	void refreshBoundParams()
+	{
+		std::map<int, StringMapPtr> iidSmps(m_iidParameters.begin(), m_iidParameters.end());
+		std::lock_guard<std::mutex> lock(*m_strParamsMutex);
+		m_paramBindings.updateAll(m_strParams, iidSmps);
+	}
+
+	/**
+	* @brief hot reload strategy parameters, the bound parameter blocks are swapped atomically
+	*
+	* @param smp as strategy parameter
+	*/
+	void applyStrParams(const StringMapPtr& smp)
+	{
+		std::lock_guard<std::mutex> lock(*m_strParamsMutex);
+		m_strParams = smp;
+		m_paramBindings.update(smp);
+	}
+
+	/**
+	* @brief strategy parameters, safe against a concurrent applyStrParams
+	*/
+	StringMapPtr loadStrParams() const
+	{
+		std::lock_guard<std::mutex> lock(*m_strParamsMutex);
+		return m_strParams;
+	}
 	
 	///@}
 
@@ -219,6 +270,21 @@ public:
 	*/
 	virtual int handleXTMsg(XTMsgPtr& msg);
 
+	/**
+	* @brief handle wire encoded XTMsg
+	*
+	*	Overrides should read the fields through the view (findTag/findKey/getInt...) without decoding;
+	*	the default decodes into an XTMsg only so handlers written for handleXTMsg keep working.
+	*
+	* @param v as view over the received buffer, valid during the call only
+	*/
+	virtual int handleXTMsgWire(const XTMsgWireView& v)
+	{
+		if (!v.valid()) { return -1; }
+		XTMsgPtr msg = v.toXTMsg();
+		return handleXTMsg(msg);
+	}
+
 	/**
 	* @brief process InstrEvent
 	message InstrEventType
@@ -32,6 +32,7 @@
 
 #include <boost/unordered_set.hpp>
 #include <boost/thread/thread.hpp>
+#include <boost/thread/shared_mutex.hpp>
 
 #define BOOST_SYSTEM_NO_LIB
 #define BOOST_FILESYSTEM_NO_LIB
@@ -55,6 +56,13 @@
 //#include "PgsqlUtil.h"
 #include "OrderQuoteMgr.h"
 #include "Strat.h"
+#include "InstrEventMgr.h"
+#include "SubscriptionIndex.h"
+#include "XTTaskPool.h"
+#include "ThreadPlacementMgr.h"
+#ifndef XT_DISABLE_ZMQ
+#include "ZMQMgr.h"
+#endif
  
 
 #include "StringMap.h"
@@ -70,6 +78,19 @@ namespace XT
 
 
 
+/**
+* Subscriber entry of the strategy index: a strategy and where its callbacks run. Resolved by
+* enableParallelDispatch/disableParallelDispatch, so the event thread neither locks nor looks up.
+*/
+struct StratRoute
+{
+	StratPtr strat;
+	TaskPool* pool = nullptr; ///< nullptr to run on the calling thread
+	int strand = -1; ///< strand of strat in pool
+};
+
+typedef SubscriptionIndex<StratRoute> StratSubscriptionIndex;
+
 class XT_COMMON_API StratMgr  
 {
 public:
@@ -228,6 +249,360 @@ public:
 	*/
 	virtual StringMapPtr getDefaultStratSetting(const std::string& stratname, const std::string& pluginname);
 
+	/**
+	* @brief build the iid to strategy index from each strategy's prefixes, exchanges and products (Strat::hasInstr)
+	*/
+	void buildSubscriptionIndex()
+	{
+		std::vector<StratRoute> routes;
+		std::vector<StratSubscriptionIndex::Matcher> matchers;
+		{
+			boost::shared_lock<boost::shared_mutex> poolLock(m_dispatchMutex);
+			for (auto it = m_stratMap.begin(); it != m_stratMap.end(); ++it)
+			{
+				StratPtr strat = it->second;
+				StratRoute route;
+				route.strat = strat;
+				auto sit = m_stratStrands.find(strat.get());
+				if (m_dispatchPool && sit != m_stratStrands.end() && sit->second >= 0)
+				{
+					route.pool = m_dispatchPool.get();
+					route.strand = sit->second;
+				}
+				routes.push_back(route);
+				matchers.push_back([strat](const InstrPtr& instr) { return strat->hasInstr(instr); });
+			}
+		}
+		std::vector<InstrPtr> instrs;
+		{
+			auto locked = sf::slock_safe_ptr(InstrMgr::getInstance()->iidToInstrMap());
+			instrs.reserve(locked->size());
+			for (auto it = locked->begin(); it != locked->end(); ++it)
+			{
+				instrs.push_back(it->second);
+			}
+		}
+		m_subIndex.build(routes, matchers, instrs);
+	}
+
+	/**
+	* @brief index instruments added after buildSubscriptionIndex, unknown iids are also indexed on their first event
+	*
+	* @param instrs
+	*/
+	void addInstrsToSubscriptionIndex(const std::vector<InstrPtr>& instrs) { m_subIndex.addInstrs(instrs); }
+
+	/**
+	* @brief subscription index
+	*
+	* @return index
+	*/
+	StratSubscriptionIndex& subscriptionIndex() { return m_subIndex; }
+
+	/**
+	* @brief route instr events through the subscription index instead of connecting every strategy to InstrEventMgr
+	*/
+	void enableSubscriptionRouting()
+	{
+		buildSubscriptionIndex();
+		for (auto it = m_stratMap.begin(); it != m_stratMap.end(); ++it)
+		{
+			it->second->unsubscribeInstrEvent();
+		}
+		m_connectionRouter.disconnect();
+		m_connectionRouter = InstrEventMgr::getInstance()->signal()->connect(
+			[this](int iid, int oid, int qid, int flag) { routeInstrEvent(iid, oid, qid, flag); });
+	}
+
+	/**
+	* @brief connect every strategy to InstrEventMgr again
+	*/
+	void disableSubscriptionRouting()
+	{
+		if (!m_connectionRouter.connected()) { return; }
+		m_connectionRouter.disconnect();
+		for (auto it = m_stratMap.begin(); it != m_stratMap.end(); ++it)
+		{
+			it->second->subscribeInstrEvent();
+		}
+	}
+
+	/**
+	* @brief deliver an instr event to the strategies subscribed to its iid
+	*
+	*	The index snapshot stays pinned until the strategies are called or queued, which only
+	*	delays freeing replaced snapshots. Each entry carries its strand, so the event thread
+	*	takes no StratMgr lock.
+	*
+	* @param iid
+	* @param oid
+	* @param qid
+	* @param flag
+	*/
+	void routeInstrEvent(int iid, int oid, int qid, int flag)
+	{
+		StratSubscriptionIndex::Reader snap(m_subIndex);
+		if (iid >= 0 && !snap->hasIid(iid))
+		{
+			InstrPtr& instr = InstrMgr::getInstance()->getInstrByIid(iid);
+			if (instr != nullptr)
+			{
+				m_subIndex.addInstr(instr);
+				snap.reload();
+			}
+		}
+		if (iid < 0 || !snap->hasIid(iid))
+		{
+			snap->forEach([&](const StratRoute& route) { deliverInstrEvent(route, iid, oid, qid, flag); });
+			return;
+		}
+		snap->forEachSubscriber(iid, [&](const StratRoute& route) { deliverInstrEvent(route, iid, oid, qid, flag); });
+	}
+
+	/**
+	* @brief run strategy callbacks on a work stealing pool, one ordered strand per strategy
+	*
+	* Enables subscription routing as well, and moves the one second timer to the strands: each
+	* tick posts a Timer instr event to every strategy (dispatchTimerEvent) instead of running
+	* onOneSecondTimer. Call after all strategies are added, before events flow. A strategy left
+	* without a strand (more than the pool's maximal strands) is logged and runs inline.
+	*
+	* @param threads as number of worker threads, 0 for hardware concurrency
+	*/
+	void enableParallelDispatch(size_t threads = 0)
+	{
+		disableParallelDispatch();
+		if (threads == 0) { threads = std::thread::hardware_concurrency(); }
+		std::shared_ptr<TaskPool> pool = std::make_shared<TaskPool>(threads);
+		pool->SetThreadInit([](size_t index) {
+			ThreadPlacementMgr::getInstance()->applyToCurrentThread("strat", "strat" + std::to_string(index));
+		});
+		std::unordered_map<const Strat*, int> strands;
+		for (auto it = m_stratMap.begin(); it != m_stratMap.end(); ++it)
+		{
+			int strand = pool->AddStrand(it->first);
+			if (strand < 0)
+			{
+				LOGE("StratMgr::enableParallelDispatch,no strand left,strat:" + it->first + ",its callbacks run on the event thread");
+			}
+			strands[it->second.get()] = strand;
+		}
+		pool->Start();
+		size_t nstrats = strands.size();
+		{
+			boost::unique_lock<boost::shared_mutex> poolLock(m_dispatchMutex);
+			m_stratStrands.swap(strands);
+			m_dispatchPool = std::move(pool);
+		}
+		if (m_connectionRouter.connected())
+		{
+			buildSubscriptionIndex();
+		}
+		else
+		{
+			enableSubscriptionRouting();
+		}
+		m_serialTimer = m_connectionOneSecondTimer.connected();
+		m_connectionOneSecondTimer.disconnect();
+		m_connectionOneSecondTimer = XTTimerMgr::getOneSecondTimer()->connectSignalTimer([this](int) { dispatchTimerEvent(); });
+		LOGI("StratMgr::enableParallelDispatch,threads:" + std::to_string(threads) + ",strats:" + std::to_string(nstrats));
+	}
+
+	/**
+	* @brief run queued strategy callbacks, then call strategies on the event thread again
+	*
+	* Safe while events flow: the index is republished without strands, and the pool is stopped
+	* only once no event thread can still hold an entry pointing to it (Epoch::Synchronize).
+	* Callbacks still queued may overlap the first inline ones. Not from a strategy callback.
+	*/
+	void disableParallelDispatch()
+	{
+		std::shared_ptr<TaskPool> pool = getDispatchPool();
+		if (!pool) { return; }
+		//drain while still attached, keeps per strategy order for events already routed
+		pool->WaitIdle();
+		{
+			boost::unique_lock<boost::shared_mutex> poolLock(m_dispatchMutex);
+			m_dispatchPool.reset();
+			m_stratStrands.clear();
+		}
+		m_connectionOneSecondTimer.disconnect();
+		if (m_serialTimer)
+		{
+			m_connectionOneSecondTimer = XTTimerMgr::getOneSecondTimer()->connectSignalTimer([this](int i) { onOneSecondTimer(i); });
+		}
+		buildSubscriptionIndex();
+		Epoch::Synchronize();
+		//tasks posted between the drain and the republish, nothing can post to the pool now
+		pool->WaitIdle();
+		pool->Stop();
+	}
+
+	/**
+	* @brief run a task for a strategy, after the tasks already queued for it
+	*
+	* Runs inline when parallel dispatch is disabled or the strategy has no strand.
+	*
+	* @param strat
+	* @param task
+	*/
+	void dispatchToStrat(const StratPtr& strat, TaskPool::Task task)
+	{
+		StratSubscriptionIndex::Reader snap(m_subIndex);
+		const StratRoute* found = nullptr;
+		snap->forEach([&](const StratRoute& route) { if (route.strat == strat) { found = &route; } });
+		if (found != nullptr && found->pool != nullptr)
+		{
+			found->pool->Post(found->strand, std::move(task));
+			return;
+		}
+		task();
+	}
+
+	/**
+	* @brief run fn for every strategy, in parallel across strategies
+	*
+	*	Goes through the routes of the subscription index, strategies are called inline while no
+	*	index has been built.
+	*
+	* @param fn
+	* @param wait as waiting until every queued strategy callback is done
+	*/
+	void dispatchToAllStrats(const std::function<void(const StratPtr&)>& fn, bool wait = false)
+	{
+		StratSubscriptionIndex::Reader snap(m_subIndex);
+		if (snap->subscriberCount() == 0)
+		{
+			for (auto it = m_stratMap.begin(); it != m_stratMap.end(); ++it)
+			{
+				fn(it->second);
+			}
+			return;
+		}
+		TaskPool* pool = nullptr;
+		snap->forEach([&](const StratRoute& route) {
+			if (route.pool == nullptr)
+			{
+				fn(route.strat);
+				return;
+			}
+			StratPtr strat = route.strat;
+			route.pool->Post(route.strand, [fn, strat]() { fn(strat); });
+			pool = route.pool;
+		});
+		if (wait && pool != nullptr)
+		{
+			pool->WaitIdle(); //pinned, so disableParallelDispatch cannot stop the pool meanwhile
+		}
+	}
+
+	/**
+	* @brief deliver a Timer instr event to every strategy, a slow strategy does not delay the others
+	*
+	* @param wait as waiting until every strategy handled it
+	*/
+	void dispatchTimerEvent(bool wait = false)
+	{
+		dispatchToAllStrats([](const StratPtr& strat) { strat->onInstrEvent(-1, 0, 0, InstrEventType_enumtype_Timer); }, wait);
+	}
+
+	/**
+	* @brief deliver a wire encoded XTMsg to every strategy on the calling thread,
+	*	the view points into the receive buffer so it is not queued to the strategy strands
+	*
+	* @param v as view over the received buffer
+	*
+	* @return number of strategies which handled it (handleXTMsgWire >= 0)
+	*/
+	int dispatchXTMsgWire(const XTMsgWireView& v)
+	{
+		if (!v.valid()) { return 0; }
+		int n = 0;
+		for (auto it = m_stratMap.begin(); it != m_stratMap.end(); ++it)
+		{
+			if (it->second->handleXTMsgWire(v) >= 0) { ++n; }
+		}
+		return n;
+	}
+
+#ifndef XT_DISABLE_ZMQ
+	/**
+	* @brief receive pending messages of the ZMQMgr subscribe socket, wire messages go to dispatchXTMsgWire
+	*
+	* @param onOther as handler of json/pb string messages, may be empty
+	* @param maxmsgs as maximum number of messages received per call
+	*
+	* @return number of messages received
+	*/
+	int pollXTMsgWire(const std::function<void(const char*, size_t)>& onOther = nullptr, int maxmsgs = 64)
+	{
+		ZMQMgr* zmq = ZMQMgr::getInstance();
+		return zmq->pollXTMsgWire(zmq->getSubscribeSocket(), [this](const XTMsgWireView& v) { dispatchXTMsgWire(v); }, onOther, maxmsgs);
+	}
+#endif
+
+	/**
+	* @brief work stealing pool, nullptr when parallel dispatch is disabled
+	*
+	* The returned pointer keeps a detached pool alive, posting to it after disableParallelDispatch is lost.
+	*/
+	std::shared_ptr<TaskPool> getDispatchPool() const
+	{
+		boost::shared_lock<boost::shared_mutex> poolLock(m_dispatchMutex);
+		return m_dispatchPool;
+	}
+
+
+	/**
+	* @brief queue depth and run time of each strategy
+	*
+	* @return stats, empty when parallel dispatch is disabled
+	*/
+	std::vector<TaskPool::StrandStats> getStratDispatchStats()
+	{
+		std::vector<TaskPool::StrandStats> v;
+		boost::shared_lock<boost::shared_mutex> poolLock(m_dispatchMutex);
+		if (!m_dispatchPool) { return v; }
+		for (size_t i = 0; i < m_dispatchPool->strands(); ++i)
+		{
+			v.push_back(m_dispatchPool->GetStrandStats((int)i));
+		}
+		return v;
+	}
+
+	/**
+	* @brief log queue depth of each worker and run time of each strategy
+	*/
+	void logStratDispatchStats()
+	{
+		{
+			boost::shared_lock<boost::shared_mutex> poolLock(m_dispatchMutex);
+			if (!m_dispatchPool) { return; }
+			for (size_t i = 0; i < m_dispatchPool->threads(); ++i)
+			{
+				LOGI("StratMgr::dispatch,worker:" + std::to_string(i) + ",depth:" + std::to_string(m_dispatchPool->QueueDepth(i)) + ",steals:" + std::to_string(m_dispatchPool->Steals(i)));
+			}
+		}
+		for (const TaskPool::StrandStats& st : getStratDispatchStats())
+		{
+			LOGI("StratMgr::dispatch,strat:" + st.name + ",pending:" + std::to_string(st.pending) + ",runs:" + std::to_string(st.runs)
+				+ ",avgus:" + std::to_string(st.runs > 0 ? st.totalNs / st.runs / 1000 : 0) + ",maxus:" + std::to_string(st.maxNs / 1000)
+				+ ",failures:" + std::to_string(st.failures));
+		}
+	}
+
+protected:
+	void deliverInstrEvent(const StratRoute& route, int iid, int oid, int qid, int flag)
+	{
+		if (route.pool != nullptr)
+		{
+			StratPtr s = route.strat;
+			route.pool->Post(route.strand, [s, iid, oid, qid, flag]() { s->onInstrEvent(iid, oid, qid, flag); });
+			return;
+		}
+		route.strat->onInstrEvent(iid, oid, qid, flag);
+	}
+
 
 
 protected:
@@ -240,6 +615,12 @@ protected:
 
 protected:
 	boost::signals2::connection m_connectionOneSecondTimer; ///< one second timer connection
+	boost::signals2::connection m_connectionRouter; ///< InstrEventMgr connection used by subscription routing
+	StratSubscriptionIndex m_subIndex; ///< iid to subscribed strategies
+	std::shared_ptr<TaskPool> m_dispatchPool; ///< strategy callbacks pool, enabled by enableParallelDispatch
+	mutable boost::shared_mutex m_dispatchMutex; ///< guards m_dispatchPool and m_stratStrands, never taken on the event path
+	std::unordered_map<const Strat*, int> m_stratStrands; ///< strategy to its strand in m_dispatchPool, -1 if none was left
+	bool m_serialTimer = false; ///< onOneSecondTimer was connected before enableParallelDispatch
 protected:
 	/**
 	* @brief on timer
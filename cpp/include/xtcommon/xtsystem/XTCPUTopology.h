@@ -0,0 +1,264 @@
+#pragma once
+#ifndef XT_CPU_TOPOLOGY_H
+#define XT_CPU_TOPOLOGY_H
+
+/**
+* \file XTCPUTopology.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide cpu topology (cores, SMT siblings, NUMA nodes).
+*
+* \description
+*	Designed for thread placement. On Linux the topology is read from /sys/devices/system,
+*	elsewhere every logical cpu is reported as its own core on node 0.
+*/
+
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <set>
+#include <map>
+#include <thread>
+#include <algorithm>
+
+#include "XTConfig.h"
+
+namespace XT
+{
+
+	//! Logical cpu as seen by the scheduler
+	struct CPUInfo
+	{
+		int cpu;                    ///< logical cpu id
+		int core;                   ///< core id within the package
+		int package;                ///< physical package (socket) id
+		int node;                   ///< NUMA node
+		bool isolated;              ///< listed in isolcpus
+		std::vector<int> siblings;  ///< SMT siblings including itself
+	};
+
+	//! CPU topology snapshot
+	/*!
+		Not thread-safe, load once at startup.
+	*/
+	class CPUTopology
+	{
+	public:
+		CPUTopology() {}
+
+		//! Read the topology of the running machine
+		/*!
+			\param sysroot - Root of the cpu and node directories (for tests)
+			\return Topology
+		*/
+		static CPUTopology Load(const std::string& sysroot = "/sys/devices/system")
+		{
+			CPUTopology t;
+#if defined(__linux__)
+			std::vector<int> online = ParseCpuList(ReadFile(sysroot + "/cpu/online"));
+			std::vector<int> isolated = ParseCpuList(ReadFile(sysroot + "/cpu/isolated"));
+			std::set<int> isolatedSet(isolated.begin(), isolated.end());
+			std::map<int, int> cpuToNode;
+			for (int node : ParseCpuList(ReadFile(sysroot + "/node/online")))
+			{
+				t._nodes.push_back(node);
+				for (int cpu : ParseCpuList(ReadFile(sysroot + "/node/node" + std::to_string(node) + "/cpulist"))) { cpuToNode[cpu] = node; }
+			}
+			for (int cpu : online)
+			{
+				std::string dir = sysroot + "/cpu/cpu" + std::to_string(cpu) + "/topology/";
+				CPUInfo info;
+				info.cpu = cpu;
+				info.core = ReadInt(dir + "core_id", cpu);
+				info.package = ReadInt(dir + "physical_package_id", 0);
+				info.node = cpuToNode.count(cpu) ? cpuToNode[cpu] : 0;
+				info.isolated = isolatedSet.count(cpu) > 0;
+				info.siblings = ParseCpuList(ReadFile(dir + "thread_siblings_list"));
+				if (info.siblings.empty()) { info.siblings.push_back(cpu); }
+				t._cpus.push_back(info);
+			}
+#endif
+			if (t._cpus.empty())
+			{
+				int n = (int)std::max(1u, std::thread::hardware_concurrency());
+				for (int cpu = 0; cpu < n; ++cpu)
+				{
+					CPUInfo info;
+					info.cpu = cpu;
+					info.core = cpu;
+					info.package = 0;
+					info.node = 0;
+					info.isolated = false;
+					info.siblings.push_back(cpu);
+					t._cpus.push_back(info);
+				}
+			}
+			if (t._nodes.empty()) { t._nodes.push_back(0); }
+			return t;
+		}
+
+		//! Parse a kernel cpu list such as "0-3,8,10-11"
+		static std::vector<int> ParseCpuList(const std::string& s)
+		{
+			std::vector<int> v;
+			std::stringstream ss(s);
+			std::string item;
+			while (std::getline(ss, item, ','))
+			{
+				item.erase(std::remove_if(item.begin(), item.end(), [](char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }), item.end());
+				if (item.empty()) { continue; }
+				size_t dash = item.find('-');
+				try
+				{
+					if (dash == std::string::npos)
+					{
+						v.push_back(std::stoi(item));
+					}
+					else
+					{
+						int lo = std::stoi(item.substr(0, dash));
+						int hi = std::stoi(item.substr(dash + 1));
+						for (int c = lo; c <= hi; ++c) { v.push_back(c); }
+					}
+				}
+				catch (...)
+				{
+				}
+			}
+			std::sort(v.begin(), v.end());
+			v.erase(std::unique(v.begin(), v.end()), v.end());
+			return v;
+		}
+
+		//! Format a cpu list in kernel notation
+		static std::string FormatCpuList(const std::vector<int>& cpus)
+		{
+			std::vector<int> v(cpus);
+			std::sort(v.begin(), v.end());
+			std::string s;
+			for (size_t i = 0; i < v.size();)
+			{
+				size_t j = i;
+				while (j + 1 < v.size() && v[j + 1] == v[j] + 1) { ++j; }
+				if (!s.empty()) { s += ","; }
+				s += std::to_string(v[i]);
+				if (j > i) { s += "-" + std::to_string(v[j]); }
+				i = j + 1;
+			}
+			return s;
+		}
+
+		//! Online logical cpus
+		const std::vector<CPUInfo>& cpus() const noexcept { return _cpus; }
+		//! NUMA nodes
+		const std::vector<int>& nodes() const noexcept { return _nodes; }
+
+		//! Logical cpus count
+		int LogicalCores() const noexcept { return (int)_cpus.size(); }
+		//! Physical cores count
+		int PhysicalCores() const
+		{
+			std::set<std::pair<int, int> > cores;
+			for (const CPUInfo& c : _cpus) { cores.insert(std::make_pair(c.package, c.core)); }
+			return (int)cores.size();
+		}
+
+		//! Get cpu info, nullptr if the cpu is not online
+		const CPUInfo* Find(int cpu) const
+		{
+			for (const CPUInfo& c : _cpus)
+			{
+				if (c.cpu == cpu) { return &c; }
+			}
+			return nullptr;
+		}
+
+		//! SMT siblings of a cpu including itself
+		std::vector<int> SiblingsOf(int cpu) const
+		{
+			const CPUInfo* c = Find(cpu);
+			return c ? c->siblings : std::vector<int>();
+		}
+
+		//! NUMA node of a cpu, -1 if the cpu is not online
+		int NodeOf(int cpu) const
+		{
+			const CPUInfo* c = Find(cpu);
+			return c ? c->node : -1;
+		}
+
+		//! Logical cpus of a NUMA node
+		std::vector<int> CpusOfNode(int node) const
+		{
+			std::vector<int> v;
+			for (const CPUInfo& c : _cpus)
+			{
+				if (c.node == node) { v.push_back(c.cpu); }
+			}
+			return v;
+		}
+
+		//! Isolated cpus
+		std::vector<int> IsolatedCpus() const
+		{
+			std::vector<int> v;
+			for (const CPUInfo& c : _cpus)
+			{
+				if (c.isolated) { v.push_back(c.cpu); }
+			}
+			return v;
+		}
+
+		//! Do two cpus share a physical core?
+		bool SameCore(int cpu0, int cpu1) const
+		{
+			std::vector<int> s = SiblingsOf(cpu0);
+			return std::find(s.begin(), s.end(), cpu1) != s.end();
+		}
+
+		//! One line per cpu: cpu, package, core, node, siblings, isolated
+		std::string ToString() const
+		{
+			std::stringstream ss;
+			ss << "cpus:" << LogicalCores() << ",cores:" << PhysicalCores() << ",nodes:" << _nodes.size() << "\n";
+			for (const CPUInfo& c : _cpus)
+			{
+				ss << "cpu:" << c.cpu << ",package:" << c.package << ",core:" << c.core << ",node:" << c.node
+					<< ",siblings:" << FormatCpuList(c.siblings) << (c.isolated ? ",isolated" : "") << "\n";
+			}
+			return ss.str();
+		}
+
+	private:
+		static std::string ReadFile(const std::string& path)
+		{
+			std::ifstream in(path.c_str());
+			if (!in) { return std::string(); }
+			std::stringstream ss;
+			ss << in.rdbuf();
+			return ss.str();
+		}
+
+		static int ReadInt(const std::string& path, int defaultValue)
+		{
+			std::string s = ReadFile(path);
+			try
+			{
+				return s.empty() ? defaultValue : std::stoi(s);
+			}
+			catch (...)
+			{
+				return defaultValue;
+			}
+		}
+
+		std::vector<CPUInfo> _cpus;
+		std::vector<int> _nodes;
+	};
+
+}//namespace XT
+
+#endif
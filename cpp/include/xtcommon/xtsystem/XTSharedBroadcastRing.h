@@ -0,0 +1,241 @@
+#pragma once
+#ifndef XT_SHARED_BROADCAST_RING_H
+#define XT_SHARED_BROADCAST_RING_H
+
+/**
+* \file XTSharedBroadcastRing.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a single writer / many readers broadcast ring in shared memory.
+*
+* \description
+*	Designed for fanning out fixed size POD records (market quotes) to several processes
+*	on the same box without sockets. Each reader keeps its own cursor and detects when the
+*	writer has lapped it.
+*/
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <type_traits>
+
+#include "XTSharedMemory.h"
+
+namespace XT
+{
+
+	//! Header of a shared broadcast ring, lives at the beginning of the shared memory block
+	struct SharedBroadcastRingHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t capacity;
+		uint64_t record_size;
+		uint64_t slot_size;
+		char _pad0[128 - 32];
+		std::atomic<uint64_t> write_index; ///< number of records published so far
+		char _pad1[128 - sizeof(std::atomic<uint64_t>)];
+	};
+
+	//! Single writer / multiple readers broadcast ring in shared memory
+	/*!
+		Every slot carries a sequence number: odd while the writer copies the record in,
+		2 * (index + 1) once record 'index' is complete. A reader copies the record and checks
+		the sequence again (seqlock), so it never returns a torn record. The writer never waits
+		for readers; a reader that falls more than capacity records behind loses the oldest
+		records and is told how many.
+
+		Writer: one thread of one process. Readers: any number of processes, one cursor each.
+
+		T must be trivially copyable and must not contain pointers.
+	*/
+	template<typename T>
+	class SharedBroadcastRing
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "shared ring records must be trivially copyable");
+
+	public:
+		static const uint32_t kMagic = 0x58545342; // "XTSB"
+		static const uint32_t kVersion = 1;
+
+		struct Slot
+		{
+			std::atomic<uint64_t> seq;
+			T record;
+		};
+
+		//! Create or open the ring
+		/*!
+			\param name - Shared memory block name
+			\param capacity - Ring capacity in records (must be a power of two), must match between processes
+		*/
+		SharedBroadcastRing(const std::string& name, size_t capacity) :
+			_shm(name, sizeof(SharedBroadcastRingHeader) + capacity * sizeof(Slot)), _capacity(capacity), _mask(capacity - 1), _header(nullptr), _slots(nullptr)
+		{
+			assert((capacity > 1) && "Ring capacity must be greater than one!");
+			assert(((capacity & (capacity - 1)) == 0) && "Ring capacity must be a power of two!");
+			if (!_shm)
+				return;
+
+			_header = static_cast<SharedBroadcastRingHeader*>(_shm.ptr());
+			_slots = reinterpret_cast<Slot*>(static_cast<char*>(_shm.ptr()) + sizeof(SharedBroadcastRingHeader));
+
+			if (_shm.owner() || _header->magic != kMagic)
+			{
+				for (size_t i = 0; i < capacity; ++i)
+				{
+					_slots[i].seq.store(0, std::memory_order_relaxed);
+				}
+				_header->capacity = capacity;
+				_header->record_size = sizeof(T);
+				_header->slot_size = sizeof(Slot);
+				_header->version = kVersion;
+				_header->write_index.store(0, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+				_header->magic = kMagic;
+			}
+		}
+		SharedBroadcastRing(const SharedBroadcastRing&) = delete;
+		SharedBroadcastRing& operator=(const SharedBroadcastRing&) = delete;
+
+		//! Is the ring mapped and compatible with T?
+		bool valid() const
+		{
+			return (_header != nullptr) && (_header->magic == kMagic) && (_header->version == kVersion) &&
+				(_header->capacity == _capacity) && (_header->record_size == sizeof(T)) && (_header->slot_size == sizeof(Slot));
+		}
+
+		size_t capacity() const noexcept { return _capacity; }
+
+		//! Number of records published so far
+		uint64_t write_index() const noexcept { return _header->write_index.load(std::memory_order_acquire); }
+
+		//! Publish a record (single writer). Will not block.
+		void Publish(const T& record)
+		{
+			const uint64_t index = _header->write_index.load(std::memory_order_relaxed);
+			Slot& slot = _slots[index & _mask];
+			slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			memcpy(&slot.record, &record, sizeof(T));
+			slot.seq.store(2 * index + 2, std::memory_order_release);
+			_header->write_index.store(index + 1, std::memory_order_release);
+		}
+
+		//! Result of a read attempt
+		enum ReadResult
+		{
+			Empty = 0,   ///< nothing new
+			Ok = 1,      ///< record copied, cursor advanced
+			Overrun = 2  ///< reader was lapped, cursor moved to the oldest available record, 'lost' records are gone
+		};
+
+		//! Try to read the record at cursor
+		/*!
+			\param cursor - Reader cursor (index of the next record to read), updated on Ok and Overrun
+			\param record - Destination of the record
+			\param lost - Incremented by the number of records skipped on Overrun
+		*/
+		ReadResult TryRead(uint64_t& cursor, T& record, uint64_t& lost) const
+		{
+			const uint64_t head = _header->write_index.load(std::memory_order_acquire);
+			if (cursor >= head)
+				return Empty;
+
+			if (head - cursor > _capacity)
+			{
+				uint64_t oldest = head - _capacity;
+				lost += oldest - cursor;
+				cursor = oldest;
+				return Overrun;
+			}
+
+			const Slot& slot = _slots[cursor & _mask];
+			const uint64_t expected = 2 * cursor + 2;
+			uint64_t seq0 = slot.seq.load(std::memory_order_acquire);
+			if (seq0 != expected)
+			{
+				if (seq0 > expected)
+				{
+					// overwritten between the head check and now
+					uint64_t oldest = _header->write_index.load(std::memory_order_acquire) - _capacity;
+					lost += (oldest > cursor) ? (oldest - cursor) : 1;
+					cursor = (oldest > cursor) ? oldest : cursor + 1;
+					return Overrun;
+				}
+				return Empty;
+			}
+			memcpy(&record, &slot.record, sizeof(T));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uint64_t seq1 = slot.seq.load(std::memory_order_relaxed);
+			if (seq1 != seq0)
+			{
+				lost += 1;
+				cursor += 1;
+				return Overrun;
+			}
+			++cursor;
+			return Ok;
+		}
+
+	private:
+		SharedMemory _shm;
+		const size_t _capacity;
+		const size_t _mask;
+		SharedBroadcastRingHeader* _header;
+		Slot* _slots;
+	};
+
+	//! Reader over a SharedBroadcastRing with its own cursor and overrun statistics
+	template<typename T>
+	class SharedBroadcastRingReader
+	{
+	public:
+		//! Attach a reader
+		/*!
+			\param ring - Ring to read
+			\param fromLatest - Start at the current write index (true) or at the oldest available record (false)
+		*/
+		explicit SharedBroadcastRingReader(const std::shared_ptr<SharedBroadcastRing<T> >& ring, bool fromLatest = true) :
+			_ring(ring), _cursor(0), _lost(0), _overruns(0)
+		{
+			uint64_t head = _ring->write_index();
+			_cursor = fromLatest ? head : ((head > _ring->capacity()) ? head - _ring->capacity() : 0);
+		}
+
+		//! Read the next record, returns false if there is nothing new
+		bool Read(T& record)
+		{
+			for (;;)
+			{
+				typename SharedBroadcastRing<T>::ReadResult r = _ring->TryRead(_cursor, record, _lost);
+				if (r == SharedBroadcastRing<T>::Ok)
+					return true;
+				if (r == SharedBroadcastRing<T>::Empty)
+					return false;
+				++_overruns;
+			}
+		}
+
+		//! Records not yet read
+		uint64_t lag() const { uint64_t head = _ring->write_index(); return (head > _cursor) ? head - _cursor : 0; }
+		//! Total records lost to overruns
+		uint64_t lost() const noexcept { return _lost; }
+		//! Number of overrun events
+		uint64_t overruns() const noexcept { return _overruns; }
+		uint64_t cursor() const noexcept { return _cursor; }
+
+	private:
+		std::shared_ptr<SharedBroadcastRing<T> > _ring;
+		uint64_t _cursor;
+		uint64_t _lost;
+		uint64_t _overruns;
+	};
+
+}//namespace XT
+
+#endif
@@ -0,0 +1,231 @@
+#pragma once
+#ifndef XT_EPOCH_H
+#define XT_EPOCH_H
+
+/**
+* \file XTEpoch.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide an epoch based reclamation class .
+*
+* \description
+*	Designed for read-mostly tables published through an atomic raw pointer: readers pin
+*	instead of taking a lock or a reference count, writers retire the replaced object.
+*/
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace XT
+{
+
+	//! Epoch based memory reclamation
+	/*!
+		A reader pins the calling thread around its accesses to objects published through an
+		atomic pointer. Pinning copies the global epoch into a slot owned by the thread and issues
+		a full fence: no read-modify-write, no lock, nothing shared is written. Pins nest.
+
+		A writer swaps the pointer first, then retires the replaced object. Retire() stamps the
+		object with the global epoch and advances it; the object is deleted by a later Retire() or
+		Reclaim() once no thread is pinned at an epoch up to that stamp, i.e. once every reader
+		that could have loaded the old pointer has unpinned. A reader stuck inside a pin delays
+		reclamation, it never blocks a writer.
+
+		One domain serves the whole process. Slots are taken on the first Pin() of a thread and
+		handed back when the thread exits.
+
+		Thread-safe.
+	*/
+	class Epoch
+	{
+	public:
+		//! Pin the calling thread for the lifetime of the guard
+		class Guard
+		{
+		public:
+			Guard() noexcept { Epoch::Pin(); }
+			Guard(const Guard&) = delete;
+			Guard& operator=(const Guard&) = delete;
+			~Guard() { Epoch::Unpin(); }
+		};
+
+		//! Pin the calling thread, objects loaded from now on stay valid until the matching Unpin()
+		static void Pin() noexcept
+		{
+			ThreadSlot& ts = threadSlot();
+			if (ts.depth++ > 0) { return; }
+			Domain& d = domain();
+			ts.slot->epoch.store(d.epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+
+		//! Unpin the calling thread
+		static void Unpin() noexcept
+		{
+			ThreadSlot& ts = threadSlot();
+			if (--ts.depth > 0) { return; }
+			ts.slot->epoch.store(0, std::memory_order_release);
+		}
+
+		//! Delete ptr once no reader can hold it any more, ptr must already be unreachable for new readers
+		template <typename T>
+		static void Retire(const T* ptr)
+		{
+			if (ptr == nullptr) { return; }
+			Domain& d = domain();
+			std::lock_guard<std::mutex> lock(d.mutex);
+			d.retired.push_back(Retired{ d.epoch.fetch_add(1, std::memory_order_seq_cst), ptr, &deleteAs<T> });
+			reclaimLocked(d);
+		}
+
+		//! Wait until every thread pinned at the time of the call has unpinned
+		/*!
+			For objects that are not deleted but torn down (e.g. a pool a reader may still post to):
+			unpublish the pointer, Synchronize(), then tear down. Must not be called while pinned.
+		*/
+		static void Synchronize()
+		{
+			Domain& d = domain();
+			const uint64_t e = d.epoch.fetch_add(1, std::memory_order_seq_cst);
+			for (;;)
+			{
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				bool pinned = false;
+				{
+					std::lock_guard<std::mutex> lock(d.mutex);
+					for (const Slot& s : d.slots)
+					{
+						uint64_t se = s.epoch.load(std::memory_order_acquire);
+						if (se != 0 && se <= e) { pinned = true; break; }
+					}
+				}
+				if (!pinned) { return; }
+				std::this_thread::yield();
+			}
+		}
+
+		//! Delete what can be deleted now
+		/*!
+			\return Number of objects still waiting for readers
+		*/
+		static size_t Reclaim()
+		{
+			Domain& d = domain();
+			std::lock_guard<std::mutex> lock(d.mutex);
+			reclaimLocked(d);
+			return d.retired.size();
+		}
+
+		//! Get number of retired objects not deleted yet
+		static size_t pending()
+		{
+			Domain& d = domain();
+			std::lock_guard<std::mutex> lock(d.mutex);
+			return d.retired.size();
+		}
+
+	private:
+		struct Slot
+		{
+			std::atomic<uint64_t> epoch; ///< 0 while the owner is not pinned
+			std::atomic<bool> used;
+			char pad[64 - sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<bool>)]; ///< one slot per cache line
+		};
+
+		struct Retired
+		{
+			uint64_t epoch;
+			const void* ptr;
+			void (*deleter)(const void*);
+		};
+
+		struct Domain
+		{
+			std::atomic<uint64_t> epoch{ 1 };
+			std::mutex mutex; ///< guards slots and retired
+			std::deque<Slot> slots; ///< never shrinks, so a Slot* stays valid
+			std::vector<Retired> retired;
+
+			~Domain()
+			{
+				// process exit: no reader is left
+				for (const Retired& r : retired) { r.deleter(r.ptr); }
+			}
+		};
+
+		struct ThreadSlot
+		{
+			Slot* slot;
+			uint32_t depth;
+
+			ThreadSlot() : slot(nullptr), depth(0)
+			{
+				Domain& d = domain();
+				std::lock_guard<std::mutex> lock(d.mutex);
+				for (Slot& s : d.slots)
+				{
+					if (!s.used.load(std::memory_order_relaxed)) { slot = &s; break; }
+				}
+				if (slot == nullptr)
+				{
+					d.slots.emplace_back();
+					slot = &d.slots.back();
+				}
+				slot->epoch.store(0, std::memory_order_relaxed);
+				slot->used.store(true, std::memory_order_relaxed);
+			}
+
+			~ThreadSlot()
+			{
+				Domain& d = domain();
+				std::lock_guard<std::mutex> lock(d.mutex);
+				slot->epoch.store(0, std::memory_order_release);
+				slot->used.store(false, std::memory_order_relaxed);
+			}
+		};
+
+		template <typename T>
+		static void deleteAs(const void* ptr) { delete static_cast<const T*>(ptr); }
+
+		static Domain& domain()
+		{
+			static Domain instance;
+			return instance;
+		}
+
+		static ThreadSlot& threadSlot()
+		{
+			static thread_local ThreadSlot ts;
+			return ts;
+		}
+
+		static void reclaimLocked(Domain& d)
+		{
+			if (d.retired.empty()) { return; }
+			// pairs with the fence of Pin(): a reader either shows up pinned here or loads the new pointer
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			uint64_t oldest = UINT64_MAX;
+			for (const Slot& s : d.slots)
+			{
+				uint64_t e = s.epoch.load(std::memory_order_acquire);
+				if (e != 0 && e < oldest) { oldest = e; }
+			}
+			size_t kept = 0;
+			for (size_t i = 0; i < d.retired.size(); ++i)
+			{
+				if (d.retired[i].epoch < oldest) { d.retired[i].deleter(d.retired[i].ptr); }
+				else { d.retired[kept++] = d.retired[i]; }
+			}
+			d.retired.resize(kept);
+		}
+	};
+
+} // namespace XT
+
+#endif
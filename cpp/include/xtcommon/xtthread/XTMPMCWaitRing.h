@@ -0,0 +1,536 @@
+#pragma once
+#ifndef XT_MPMC_WAIT_RING_H
+#define XT_MPMC_WAIT_RING_H
+
+/**
+* \file XTMPMCWaitRing.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a bounded multi producers multi consumers wait ring class .
+*
+* \description
+*	Designed for gateway task queues: lock-free ring with blocking wait, batch dequeue and a
+*	non-blocking push that spills past capacity.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <utility>
+
+namespace XT
+{
+
+	//! Bounded multiple producers / multiple consumers wait ring
+	/*!
+		Enqueue and dequeue are lock-free (Dmitry Vyukov's bounded MPMC ring with per slot
+		sequence numbers). Threads only take the mutex to sleep when the ring is empty
+		(consumers) or full (producers), and the other side only takes it to wake a sleeper.
+
+		DequeueBatch() claims every ready item up to the given count with a single
+		compare-and-swap of the tail, so a worker drains a burst in one go.
+
+		Push() never blocks: when the ring is full the item goes to a mutex protected spill
+		list, later pushes follow it there until consumers drained the spill, so FIFO order
+		holds. A thread that consumes the ring can post to itself without deadlocking.
+
+		Overflow accounting: TryEnqueue() failures on a full ring, Enqueue() calls that had
+		to wait and Push() calls that spilled are counted, together with the peak ring size.
+
+		The push/emplace/wait_and_pop/wait_and_pop_move methods mirror ConcurrentQueue (push
+		and emplace never block), so a task queue member can be switched without touching
+		the code using it.
+
+		FIFO order is guaranteed!
+
+		Thread-safe.
+	*/
+	template<typename T>
+	class MPMCWaitRing
+	{
+	public:
+		//! Default class constructor
+		/*!
+			\param capacity - Ring capacity (must be a power of two)
+		*/
+		explicit MPMCWaitRing(size_t capacity = 65536);
+		MPMCWaitRing(const MPMCWaitRing&) = delete;
+		MPMCWaitRing(MPMCWaitRing&&) = delete;
+		~MPMCWaitRing() { Close(); delete[] _buffer; }
+
+		MPMCWaitRing& operator=(const MPMCWaitRing&) = delete;
+		MPMCWaitRing& operator=(MPMCWaitRing&&) = delete;
+
+		//! Check if the wait ring is not empty
+		explicit operator bool() const noexcept { return !closed() && !empty(); }
+
+		//! Is wait ring closed?
+		bool closed() const noexcept { return _closed.load(std::memory_order_acquire); }
+		//! Is wait ring empty?
+		bool empty() const noexcept { return (size() == 0); }
+		//! Get wait ring capacity
+		size_t capacity() const noexcept { return _capacity; }
+		//! Get wait ring size
+		size_t size() const noexcept;
+
+		//! Get number of enqueues that found the ring full
+		uint64_t overflows() const noexcept { return _overflows.load(std::memory_order_relaxed); }
+		//! Get number of items spilled past the ring capacity and not yet dequeued
+		size_t spilled() const noexcept { return _spillSize.load(std::memory_order_acquire); }
+		//! Get peak size since construction
+		size_t peak() const noexcept { return _peak.load(std::memory_order_relaxed); }
+
+		//! Try to enqueue an item into the wait ring
+		/*!
+			Will not block.
+
+			\param item - Item to enqueue
+			\return 'true' if the item was successfully enqueue, 'false' if the wait ring is full or closed
+		*/
+		bool TryEnqueue(const T& item)
+		{
+			T temp = item;
+			return TryEnqueue(std::move(temp));
+		}
+		//! Try to enqueue an item into the wait ring (the item is moved only on success)
+		bool TryEnqueue(T&& item);
+
+		//! Enqueue an item into the wait ring
+		/*!
+			Will block while the wait ring is full.
+
+			\param item - Item to enqueue
+			\return 'true' if the item was successfully enqueue, 'false' if the wait ring is closed
+		*/
+		bool Enqueue(const T& item)
+		{
+			T temp = item;
+			return Enqueue(std::move(temp));
+		}
+		//! Enqueue an item into the wait ring (will block while the wait ring is full)
+		bool Enqueue(T&& item);
+
+		//! Push an item, spilling it past the ring capacity when the ring is full
+		/*!
+			Will not block (except on the spill mutex).
+
+			\param item - Item to push
+			\return 'true' if the item was pushed, 'false' if the wait ring is closed
+		*/
+		bool Push(T&& item);
+
+		//! Try to dequeue an item from the wait ring
+		/*!
+			Will not block.
+
+			\param item - Item to dequeue
+			\return 'true' if the item was successfully dequeue, 'false' if the wait ring is empty
+		*/
+		bool TryDequeue(T& item) { return TryDequeueBatch(&item, 1) == 1; }
+
+		//! Dequeue an item from the wait ring
+		/*!
+			Will block while the wait ring is empty.
+
+			\param item - Item to dequeue
+			\return 'true' if the item was successfully dequeue, 'false' if the wait ring is closed and empty
+		*/
+		bool Dequeue(T& item) { return DequeueBatch(&item, 1) == 1; }
+
+		//! Try to dequeue up to count items with one claim
+		/*!
+			Will not block.
+
+			\param items - Items array
+			\param count - Maximal number of items to dequeue
+			\return Number of dequeued items
+		*/
+		size_t TryDequeueBatch(T* items, size_t count);
+
+		//! Dequeue up to count items with one claim
+		/*!
+			Will block until at least one item is available.
+
+			\param items - Items array
+			\param count - Maximal number of items to dequeue
+			\return Number of dequeued items, 0 if the wait ring is closed and empty
+		*/
+		size_t DequeueBatch(T* items, size_t count);
+
+		//! Dequeue up to count items and append them to a vector
+		/*!
+			Will block until at least one item is available.
+
+			\param items - Items vector
+			\param count - Maximal number of items to dequeue
+			\return Number of dequeued items, 0 if the wait ring is closed and empty
+		*/
+		size_t DequeueBatch(std::vector<T>& items, size_t count)
+		{
+			size_t offset = items.size();
+			items.resize(offset + count);
+			size_t n = DequeueBatch(items.data() + offset, count);
+			items.resize(offset + n);
+			return n;
+		}
+
+		//! Set number of polls of a consumer before it sleeps on an empty ring (0 to sleep at once, the default on one core)
+		void SetSpin(int spin) noexcept { _spin = spin; }
+
+		//! Close the wait ring and wake up every waiting thread
+		void Close();
+
+		//! ConcurrentQueue compatible push (will not block)
+		void push(T const& data)
+		{
+			T temp = data;
+			Push(std::move(temp));
+		}
+		//! ConcurrentQueue compatible emplace (will not block)
+		void emplace(T&& data) { Push(std::move(data)); }
+		//! ConcurrentQueue compatible pop (will block), default item if the wait ring is closed
+		T wait_and_pop()
+		{
+			T item = T();
+			Dequeue(item);
+			return item;
+		}
+		//! ConcurrentQueue compatible pop by move (will block), default item if the wait ring is closed
+		T wait_and_pop_move() { return wait_and_pop(); }
+
+	private:
+		struct Node
+		{
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		typedef char cache_line_pad[128];
+
+		bool TryEnqueueImpl(T& item);
+		size_t TryDequeueRing(T* items, size_t count);
+		size_t TryDequeueSpill(T* items, size_t count);
+		bool full() const noexcept;
+		bool ready() const noexcept;
+		void NotifyConsumers();
+		void NotifyProducers();
+		void UpdatePeak(size_t head);
+
+		cache_line_pad _pad0;
+		const size_t _capacity;
+		const size_t _mask;
+		Node* const _buffer;
+
+		cache_line_pad _pad1;
+		std::atomic<size_t> _head;
+		cache_line_pad _pad2;
+		std::atomic<size_t> _tail;
+		cache_line_pad _pad3;
+
+		std::atomic<bool> _closed;
+		std::atomic<int> _consumerWaiters;
+		std::atomic<int> _producerWaiters;
+		std::atomic<uint64_t> _overflows;
+		std::atomic<size_t> _peak;
+		int _spin;
+		std::atomic<size_t> _spillSize;
+		std::mutex _spillMutex;
+		std::deque<T> _spill;
+		std::mutex _mutex;
+		std::condition_variable _notEmpty;
+		std::condition_variable _notFull;
+	};
+
+//////
+	template<typename T>
+	inline MPMCWaitRing<T>::MPMCWaitRing(size_t capacity) : _capacity(capacity), _mask(capacity - 1), _buffer(new Node[capacity]), _head(0), _tail(0),
+		_closed(false), _consumerWaiters(0), _producerWaiters(0), _overflows(0), _peak(0), _spin(std::thread::hardware_concurrency() > 1 ? 2048 : 0), _spillSize(0)
+	{
+		assert((capacity > 1) && "Ring capacity must be greater than one!");
+		assert(((capacity & (capacity - 1)) == 0) && "Ring capacity must be a power of two!");
+
+		memset(_pad0, 0, sizeof(cache_line_pad));
+		memset(_pad1, 0, sizeof(cache_line_pad));
+		memset(_pad2, 0, sizeof(cache_line_pad));
+		memset(_pad3, 0, sizeof(cache_line_pad));
+
+		for (size_t i = 0; i < capacity; ++i)
+			_buffer[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	template<typename T>
+	inline size_t MPMCWaitRing<T>::size() const noexcept
+	{
+		const size_t tail = _tail.load(std::memory_order_acquire);
+		const size_t head = _head.load(std::memory_order_acquire);
+
+		return ((head > tail) ? (head - tail) : 0) + _spillSize.load(std::memory_order_acquire);
+	}
+
+	template<typename T>
+	inline bool MPMCWaitRing<T>::TryEnqueue(T&& item)
+	{
+		if (TryEnqueueImpl(item))
+			return true;
+
+		if (!_closed.load(std::memory_order_acquire))
+			_overflows.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	template<typename T>
+	inline bool MPMCWaitRing<T>::Enqueue(T&& item)
+	{
+		// Never pass items already spilled by Push()
+		if (_spillSize.load(std::memory_order_acquire) > 0)
+			return Push(std::move(item));
+		if (TryEnqueueImpl(item))
+			return true;
+		if (_closed.load(std::memory_order_acquire))
+			return false;
+
+		// Counted once however long the producer waits
+		_overflows.fetch_add(1, std::memory_order_relaxed);
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_producerWaiters.fetch_add(1, std::memory_order_seq_cst);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				// Check again after announcing the waiter, a consumer may have made room meanwhile
+				if (full() && !_closed.load(std::memory_order_acquire))
+					_notFull.wait(lock);
+				_producerWaiters.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			if (TryEnqueueImpl(item))
+				return true;
+			if (_closed.load(std::memory_order_acquire))
+				return false;
+		}
+	}
+
+	template<typename T>
+	inline bool MPMCWaitRing<T>::Push(T&& item)
+	{
+		// Stay behind spilled items, the ring is only used again once consumers took them
+		if (_spillSize.load(std::memory_order_acquire) == 0 && TryEnqueueImpl(item))
+			return true;
+		if (_closed.load(std::memory_order_acquire))
+			return false;
+
+		{
+			std::lock_guard<std::mutex> lock(_spillMutex);
+			_spill.push_back(std::move(item));
+			_spillSize.store(_spill.size(), std::memory_order_release);
+		}
+		_overflows.fetch_add(1, std::memory_order_relaxed);
+		NotifyConsumers();
+		return true;
+	}
+
+	template<typename T>
+	inline bool MPMCWaitRing<T>::TryEnqueueImpl(T& item)
+	{
+		if (_closed.load(std::memory_order_acquire))
+			return false;
+
+		size_t head_sequence = _head.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			Node* node = &_buffer[head_sequence & _mask];
+			size_t node_sequence = node->sequence.load(std::memory_order_acquire);
+
+			int64_t diff = (int64_t)node_sequence - (int64_t)head_sequence;
+			if (diff == 0)
+			{
+				if (_head.compare_exchange_weak(head_sequence, head_sequence + 1, std::memory_order_relaxed))
+				{
+					node->value = std::move(item);
+					node->sequence.store(head_sequence + 1, std::memory_order_release);
+					UpdatePeak(head_sequence + 1);
+					NotifyConsumers();
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				// The slot still holds an item of the previous lap, the ring is full
+				return false;
+			}
+			else
+			{
+				head_sequence = _head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	template<typename T>
+	inline bool MPMCWaitRing<T>::full() const noexcept
+	{
+		const size_t head = _head.load(std::memory_order_relaxed);
+		return ((int64_t)_buffer[head & _mask].sequence.load(std::memory_order_acquire) - (int64_t)head) < 0;
+	}
+
+	template<typename T>
+	inline size_t MPMCWaitRing<T>::TryDequeueBatch(T* items, size_t count)
+	{
+		if (count == 0)
+			return 0;
+
+		// Ring items are older than spilled ones
+		size_t n = TryDequeueRing(items, count);
+		if (n > 0 || _spillSize.load(std::memory_order_acquire) == 0)
+			return n;
+		return TryDequeueSpill(items, count);
+	}
+
+	template<typename T>
+	inline size_t MPMCWaitRing<T>::TryDequeueSpill(T* items, size_t count)
+	{
+		std::lock_guard<std::mutex> lock(_spillMutex);
+		size_t n = 0;
+		while (n < count && !_spill.empty())
+		{
+			items[n++] = std::move(_spill.front());
+			_spill.pop_front();
+		}
+		_spillSize.store(_spill.size(), std::memory_order_release);
+		return n;
+	}
+
+	template<typename T>
+	inline size_t MPMCWaitRing<T>::TryDequeueRing(T* items, size_t count)
+	{
+		size_t tail_sequence = _tail.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			// Count the ready items from the tail on
+			size_t ready = 0;
+			while (ready < count)
+			{
+				const size_t sequence = tail_sequence + ready;
+				if (_buffer[sequence & _mask].sequence.load(std::memory_order_acquire) != sequence + 1)
+					break;
+				++ready;
+			}
+
+			if (ready == 0)
+			{
+				Node* node = &_buffer[tail_sequence & _mask];
+				int64_t diff = (int64_t)node->sequence.load(std::memory_order_acquire) - (int64_t)(tail_sequence + 1);
+				if (diff < 0)
+					return 0;
+				tail_sequence = _tail.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			// Claim all ready items at once
+			if (_tail.compare_exchange_weak(tail_sequence, tail_sequence + ready, std::memory_order_relaxed))
+			{
+				for (size_t i = 0; i < ready; ++i)
+				{
+					const size_t sequence = tail_sequence + i;
+					Node* node = &_buffer[sequence & _mask];
+					items[i] = std::move(node->value);
+					node->sequence.store(sequence + _mask + 1, std::memory_order_release);
+				}
+				NotifyProducers();
+				return ready;
+			}
+		}
+	}
+
+	template<typename T>
+	inline size_t MPMCWaitRing<T>::DequeueBatch(T* items, size_t count)
+	{
+		for (;;)
+		{
+			size_t n = TryDequeueBatch(items, count);
+			if (n > 0 || count == 0)
+				return n;
+			if (_closed.load(std::memory_order_acquire))
+				return TryDequeueBatch(items, count);
+
+			// Spin a little before sleeping, a futex wake costs microseconds
+			bool spun = false;
+			for (int i = 0; i < _spin && !spun; ++i)
+			{
+				spun = ready();
+				if (!spun && i >= _spin / 2)
+					std::this_thread::yield();
+			}
+			if (spun)
+				continue;
+
+			std::unique_lock<std::mutex> lock(_mutex);
+			_consumerWaiters.fetch_add(1, std::memory_order_seq_cst);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			// Check again after announcing the waiter, a producer may have published meanwhile
+			if (!ready() && !_closed.load(std::memory_order_acquire))
+				_notEmpty.wait(lock);
+			_consumerWaiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	template<typename T>
+	inline bool MPMCWaitRing<T>::ready() const noexcept
+	{
+		const size_t tail = _tail.load(std::memory_order_relaxed);
+		return _buffer[tail & _mask].sequence.load(std::memory_order_acquire) == tail + 1 || _spillSize.load(std::memory_order_acquire) > 0;
+	}
+
+	template<typename T>
+	inline void MPMCWaitRing<T>::Close()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_closed.store(true, std::memory_order_release);
+		_notEmpty.notify_all();
+		_notFull.notify_all();
+	}
+
+	template<typename T>
+	inline void MPMCWaitRing<T>::NotifyConsumers()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (_consumerWaiters.load(std::memory_order_relaxed) > 0)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_notEmpty.notify_one();
+		}
+	}
+
+	template<typename T>
+	inline void MPMCWaitRing<T>::NotifyProducers()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (_producerWaiters.load(std::memory_order_relaxed) > 0)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_notFull.notify_all();
+		}
+	}
+
+	template<typename T>
+	inline void MPMCWaitRing<T>::UpdatePeak(size_t head)
+	{
+		const size_t tail = _tail.load(std::memory_order_relaxed);
+		const size_t sz = (head > tail) ? (head - tail) : 0;
+		size_t peak = _peak.load(std::memory_order_relaxed);
+		while (sz > peak && !_peak.compare_exchange_weak(peak, sz, std::memory_order_relaxed))
+		{
+		}
+	}
+
+}//namespace XT
+
+#endif
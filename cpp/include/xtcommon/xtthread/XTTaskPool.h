@@ -0,0 +1,431 @@
+#pragma once
+#ifndef XT_TASK_POOL_H
+#define XT_TASK_POOL_H
+
+/**
+* \file XTTaskPool.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide a work stealing task pool class .
+*
+* \description
+*	Designed for a work stealing task pool with ordered strands.
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+namespace XT
+{
+
+	//! Work stealing task pool
+	/*!
+		Every worker thread owns a deque. A worker pops its own deque in FIFO order and,
+		when it is empty, steals from the tail of the other workers' deques.
+
+		Tasks posted to a strand run one at a time in posting order, on the strand's
+		affinity worker unless another worker steals the strand. Different strands run
+		in parallel. Strands are meant for "all callbacks of one strategy".
+
+		Post/Submit are thread-safe. WaitIdle() must not be called from a worker.
+	*/
+	class TaskPool
+	{
+	public:
+		typedef std::function<void()> Task;
+
+		//! Run-time statistics of a strand
+		struct StrandStats
+		{
+			std::string name;
+			int affinity;         ///< preferred worker
+			size_t pending;       ///< tasks waiting in the strand
+			uint64_t runs;        ///< tasks executed
+			uint64_t failures;    ///< tasks that threw
+			uint64_t totalNs;     ///< total run time
+			uint64_t maxNs;       ///< longest run time
+			uint64_t lastNs;      ///< last run time
+		};
+
+		//! Default class constructor
+		/*!
+			\param threads - Number of worker threads (default is std::thread::hardware_concurrency)
+			\param maxStrands - Maximal number of strands
+			\param batch - Maximal number of strand tasks run before the strand is re-queued
+		*/
+		explicit TaskPool(size_t threads = std::thread::hardware_concurrency(), size_t maxStrands = 1024, size_t batch = 64)
+			: _workers(std::max<size_t>(threads, 1)), _strands(maxStrands), _strandCount(0), _batch(std::max<size_t>(batch, 1)),
+			_running(false), _stopping(false), _queued(0), _outstanding(0), _failures(0), _sleepers(0), _next(0)
+		{
+			for (auto& w : _workers) { w.reset(new Worker()); }
+		}
+		TaskPool(const TaskPool&) = delete;
+		TaskPool(TaskPool&&) = delete;
+		~TaskPool() { Stop(); }
+
+		TaskPool& operator=(const TaskPool&) = delete;
+		TaskPool& operator=(TaskPool&&) = delete;
+
+		//! Get number of worker threads
+		size_t threads() const noexcept { return _workers.size(); }
+		//! Get number of strands
+		size_t strands() const noexcept { return _strandCount.load(std::memory_order_acquire); }
+		//! Is the task pool running?
+		bool running() const noexcept { return _running.load(std::memory_order_acquire); }
+
+		//! Set a function called first in each worker thread with its index, e.g. to pin it to a cpu
+		/*!
+			Must be set before Start().
+		*/
+		void SetThreadInit(const std::function<void(size_t)>& init) { _threadInit = init; }
+
+		//! Start worker threads
+		void Start()
+		{
+			std::lock_guard<std::mutex> lock(_controlMutex);
+			if (_running.load()) { return; }
+			_stopping.store(false);
+			for (size_t i = 0; i < _workers.size(); ++i)
+			{
+				_workers[i]->thread = std::thread([this, i]() { Run(i); });
+			}
+			_running.store(true, std::memory_order_release);
+		}
+
+		//! Stop worker threads, queued tasks are executed first
+		void Stop()
+		{
+			std::lock_guard<std::mutex> lock(_controlMutex);
+			if (!_running.load()) { return; }
+			{
+				std::lock_guard<std::mutex> sleepLock(_sleepMutex);
+				_stopping.store(true);
+			}
+			_sleepCv.notify_all();
+			for (auto& w : _workers)
+			{
+				if (w->thread.joinable()) { w->thread.join(); }
+			}
+			_running.store(false, std::memory_order_release);
+		}
+
+		//! Add a strand
+		/*!
+			\param name - Strand name for statistics
+			\param affinity - Preferred worker index (-1 for round robin)
+			\return Strand key for Post(), or -1 if the maximal number of strands is reached
+		*/
+		int AddStrand(const std::string& name, int affinity = -1)
+		{
+			std::lock_guard<std::mutex> lock(_controlMutex);
+			size_t n = _strandCount.load(std::memory_order_relaxed);
+			if (n >= _strands.size()) { return -1; }
+			Strand* s = new Strand();
+			s->name = name;
+			s->affinity = (affinity < 0) ? (int)(n % _workers.size()) : (int)((size_t)affinity % _workers.size());
+			_strands[n].reset(s);
+			_strandCount.store(n + 1, std::memory_order_release);
+			return (int)n;
+		}
+
+		//! Post a task to a strand, tasks of one strand run in posting order
+		/*!
+			\param strand - Strand key
+			\param task - Task to run
+			\return 'true' if the task was queued, 'false' if the strand is unknown
+		*/
+		bool Post(int strand, Task task)
+		{
+			if (strand < 0 || (size_t)strand >= strands()) { return false; }
+			Strand* s = _strands[strand].get();
+			_outstanding.fetch_add(1, std::memory_order_relaxed);
+			bool schedule = false;
+			{
+				std::lock_guard<std::mutex> lock(s->mutex);
+				s->queue.push_back(std::move(task));
+				if (!s->scheduled)
+				{
+					s->scheduled = true;
+					schedule = true;
+				}
+			}
+			if (schedule)
+			{
+				Push((size_t)s->affinity, Item(s));
+			}
+			return true;
+		}
+
+		//! Submit an unordered task
+		/*!
+			From a worker the task goes to the worker's own deque, otherwise round robin.
+
+			\param task - Task to run
+		*/
+		void Submit(Task task)
+		{
+			_outstanding.fetch_add(1, std::memory_order_relaxed);
+			size_t index = (CurrentPool() == this) ? CurrentWorker() : (_next.fetch_add(1, std::memory_order_relaxed) % _workers.size());
+			Push(index, Item(std::move(task)));
+		}
+
+		//! Wait until every posted and submitted task is done
+		void WaitIdle()
+		{
+			std::unique_lock<std::mutex> lock(_idleMutex);
+			_idleCv.wait(lock, [this]() { return _outstanding.load(std::memory_order_acquire) == 0; });
+		}
+
+		//! Get queue depth of a worker deque (strands count once)
+		size_t QueueDepth(size_t worker) const
+		{
+			if (worker >= _workers.size()) { return 0; }
+			return _workers[worker]->depth.load(std::memory_order_relaxed);
+		}
+		//! Get number of posted and submitted tasks not yet done
+		size_t PendingTasks() const noexcept { return (size_t)_outstanding.load(std::memory_order_relaxed); }
+		//! Get number of tasks that threw
+		uint64_t Failures() const noexcept { return _failures.load(std::memory_order_relaxed); }
+		//! Get number of tasks stolen by a worker
+		uint64_t Steals(size_t worker) const
+		{
+			if (worker >= _workers.size()) { return 0; }
+			return _workers[worker]->steals.load(std::memory_order_relaxed);
+		}
+
+		//! Get run-time statistics of a strand
+		StrandStats GetStrandStats(int strand) const
+		{
+			StrandStats st = StrandStats();
+			st.affinity = -1;
+			if (strand < 0 || (size_t)strand >= strands()) { return st; }
+			Strand* s = _strands[strand].get();
+			st.name = s->name;
+			st.affinity = s->affinity;
+			{
+				std::lock_guard<std::mutex> lock(s->mutex);
+				st.pending = s->queue.size();
+			}
+			st.runs = s->runs.load(std::memory_order_relaxed);
+			st.failures = s->failures.load(std::memory_order_relaxed);
+			st.totalNs = s->totalNs.load(std::memory_order_relaxed);
+			st.maxNs = s->maxNs.load(std::memory_order_relaxed);
+			st.lastNs = s->lastNs.load(std::memory_order_relaxed);
+			return st;
+		}
+
+	private:
+		struct Strand
+		{
+			std::string name;
+			int affinity = 0;
+			std::mutex mutex;
+			std::deque<Task> queue;
+			bool scheduled = false;
+			std::atomic<uint64_t> runs{ 0 };
+			std::atomic<uint64_t> failures{ 0 };
+			std::atomic<uint64_t> totalNs{ 0 };
+			std::atomic<uint64_t> maxNs{ 0 };
+			std::atomic<uint64_t> lastNs{ 0 };
+		};
+
+		struct Item
+		{
+			Item() : strand(nullptr) {}
+			explicit Item(Strand* s) : strand(s) {}
+			explicit Item(Task&& t) : strand(nullptr), task(std::move(t)) {}
+
+			Strand* strand;
+			Task task;
+		};
+
+		struct Worker
+		{
+			std::mutex mutex;
+			std::deque<Item> items;
+			std::atomic<size_t> depth{ 0 };
+			std::atomic<uint64_t> steals{ 0 };
+			std::thread thread;
+		};
+
+		static TaskPool*& CurrentPool() { static thread_local TaskPool* pool = nullptr; return pool; }
+		static size_t& CurrentWorker() { static thread_local size_t worker = 0; return worker; }
+
+		void Push(size_t index, Item&& item)
+		{
+			Worker& w = *_workers[index];
+			{
+				std::lock_guard<std::mutex> lock(w.mutex);
+				w.items.push_back(std::move(item));
+				w.depth.store(w.items.size(), std::memory_order_relaxed);
+			}
+			_queued.fetch_add(1, std::memory_order_seq_cst);
+			if (_sleepers.load(std::memory_order_seq_cst) > 0)
+			{
+				std::lock_guard<std::mutex> lock(_sleepMutex);
+				_sleepCv.notify_one();
+			}
+		}
+
+		bool PopOwn(size_t index, Item& item)
+		{
+			Worker& w = *_workers[index];
+			std::lock_guard<std::mutex> lock(w.mutex);
+			if (w.items.empty()) { return false; }
+			item = std::move(w.items.front());
+			w.items.pop_front();
+			w.depth.store(w.items.size(), std::memory_order_relaxed);
+			return true;
+		}
+
+		bool Steal(size_t index, Item& item)
+		{
+			for (size_t k = 1; k < _workers.size(); ++k)
+			{
+				Worker& victim = *_workers[(index + k) % _workers.size()];
+				if (victim.depth.load(std::memory_order_relaxed) == 0) { continue; }
+				std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+				if (!lock.owns_lock() || victim.items.empty()) { continue; }
+				item = std::move(victim.items.back());
+				victim.items.pop_back();
+				victim.depth.store(victim.items.size(), std::memory_order_relaxed);
+				_workers[index]->steals.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+			return false;
+		}
+
+		void Done(uint64_t n)
+		{
+			if (_outstanding.fetch_sub(n, std::memory_order_acq_rel) == n)
+			{
+				std::lock_guard<std::mutex> lock(_idleMutex);
+				_idleCv.notify_all();
+			}
+		}
+
+		void RunTask(Task& task, Strand* s)
+		{
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+			try
+			{
+				task();
+			}
+			catch (...)
+			{
+				_failures.fetch_add(1, std::memory_order_relaxed);
+				if (s != nullptr) { s->failures.fetch_add(1, std::memory_order_relaxed); }
+			}
+			if (s != nullptr)
+			{
+				uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+				s->runs.fetch_add(1, std::memory_order_relaxed);
+				s->totalNs.fetch_add(ns, std::memory_order_relaxed);
+				s->lastNs.store(ns, std::memory_order_relaxed);
+				if (ns > s->maxNs.load(std::memory_order_relaxed)) { s->maxNs.store(ns, std::memory_order_relaxed); }
+			}
+		}
+
+		void RunStrand(Strand* s)
+		{
+			for (size_t n = 0; n < _batch; ++n)
+			{
+				Task task;
+				{
+					std::lock_guard<std::mutex> lock(s->mutex);
+					if (s->queue.empty())
+					{
+						s->scheduled = false;
+						return;
+					}
+					task = std::move(s->queue.front());
+					s->queue.pop_front();
+				}
+				RunTask(task, s);
+				Done(1);
+			}
+			// batch used up, let other work run before the rest of this strand
+			{
+				std::lock_guard<std::mutex> lock(s->mutex);
+				if (s->queue.empty())
+				{
+					s->scheduled = false;
+					return;
+				}
+			}
+			Push((size_t)s->affinity, Item(s));
+		}
+
+		void Run(size_t index)
+		{
+			CurrentPool() = this;
+			CurrentWorker() = index;
+			if (_threadInit) { _threadInit(index); }
+			for (;;)
+			{
+				Item item;
+				if (PopOwn(index, item) || Steal(index, item))
+				{
+					_queued.fetch_sub(1, std::memory_order_relaxed);
+					if (item.strand != nullptr)
+					{
+						RunStrand(item.strand);
+					}
+					else
+					{
+						RunTask(item.task, nullptr);
+						Done(1);
+					}
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(_sleepMutex);
+				if (_stopping.load() && _queued.load() == 0) { break; }
+				_sleepers.fetch_add(1, std::memory_order_seq_cst);
+				if (_queued.load(std::memory_order_seq_cst) == 0 && !_stopping.load())
+				{
+					_sleepCv.wait_for(lock, std::chrono::milliseconds(10));
+				}
+				_sleepers.fetch_sub(1, std::memory_order_seq_cst);
+			}
+			CurrentPool() = nullptr;
+		}
+
+	private:
+		std::vector<std::unique_ptr<Worker> > _workers;
+		std::vector<std::unique_ptr<Strand> > _strands; ///< fixed size, filled by AddStrand
+		std::atomic<size_t> _strandCount;
+		size_t _batch;
+		std::function<void(size_t)> _threadInit;
+
+		std::mutex _controlMutex;
+		std::atomic<bool> _running;
+		std::atomic<bool> _stopping;
+
+		std::atomic<int64_t> _queued; ///< items in worker deques
+		std::atomic<uint64_t> _outstanding; ///< tasks posted or submitted and not yet done
+		std::atomic<uint64_t> _failures;
+
+		std::mutex _sleepMutex;
+		std::condition_variable _sleepCv;
+		std::atomic<int> _sleepers;
+		std::atomic<size_t> _next;
+
+		std::mutex _idleMutex;
+		std::condition_variable _idleCv;
+	};
+
+}//namespace
+
+#endif
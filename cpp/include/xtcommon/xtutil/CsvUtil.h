@@ -0,0 +1,364 @@
+#pragma once
+#ifndef XT_CSV_UTIL_H
+#define XT_CSV_UTIL_H
+
+/**
+* \file CsvUtil.h
+*
+* \author Bin Deng (bdeng@xtal-tech.com)
+*
+* \brief  Provide csv scanning and number parsing utility functions.
+*
+* \description
+*	Designed for market data ingestion. Lines are split into CsvField views of the line
+*	without allocating, the delimiters are found 16 bytes at a time with SSE2 where
+*	available. Numbers are parsed from the views without allocating or throwing. Quoted
+*	fields are not supported, market data csv files do not use them.
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
+
+#include <google/protobuf/message.h>
+#include <google/protobuf/descriptor.h>
+
+#include "XTConfig.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XT_CSV_UTIL_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace XT {
+
+/** view of a csv field, valid as long as the line */
+typedef boost::string_view CsvField;
+typedef std::vector<CsvField> CsvFields;
+
+class CsvUtil {
+public:
+	CsvUtil() = delete;
+
+	/**
+	* @brief call f(pos) for each position of ch in [p, p + n), in order
+	*/
+	template<typename F>
+	static void forEachChar(const char* p, size_t n, char ch, F f)
+	{
+		size_t i = 0;
+#ifdef XT_CSV_UTIL_SSE2
+		const __m128i c = _mm_set1_epi8(ch);
+		for (; i + 16 <= n; i += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, c));
+			while (mask)
+			{
+				f(i + ctz(mask));
+				mask &= mask - 1;
+			}
+		}
+#endif
+		for (; i < n; ++i)
+		{
+			if (p[i] == ch) { f(i); }
+		}
+	}
+
+	/**
+	* @brief split a line into fields, a trailing end of line is dropped
+	*
+	* @param p as line
+	* @param n as line length
+	* @param delimiter as field delimiter
+	* @param fields as output, cleared first
+	*
+	* @return number of fields
+	*/
+	static size_t split(const char* p, size_t n, char delimiter, CsvFields& fields)
+	{
+		fields.clear();
+		n = trimEol(p, n);
+		size_t start = 0;
+		forEachChar(p, n, delimiter, [&](size_t pos) {
+			fields.emplace_back(p + start, pos - start);
+			start = pos + 1;
+		});
+		fields.emplace_back(p + start, n - start);
+		return fields.size();
+	}
+
+	/**
+	* @brief split a line into fields, with a delimiter of any length
+	*/
+	static size_t split(const char* p, size_t n, const std::string& delimiter, CsvFields& fields)
+	{
+		if (delimiter.size() == 1) { return split(p, n, delimiter[0], fields); }
+		fields.clear();
+		n = trimEol(p, n);
+		if (delimiter.empty())
+		{
+			fields.emplace_back(p, n);
+			return 1;
+		}
+		CsvField line(p, n);
+		size_t start = 0;
+		for (size_t pos; (pos = line.find(delimiter.data(), start, delimiter.size())) != CsvField::npos; start = pos + delimiter.size())
+		{
+			fields.emplace_back(p + start, pos - start);
+		}
+		fields.emplace_back(p + start, n - start);
+		return fields.size();
+	}
+
+	static size_t split(const std::string& s, const std::string& delimiter, CsvFields& fields)
+	{
+		return split(s.data(), s.size(), delimiter, fields);
+	}
+
+	/**
+	* @brief call f(line, len) for each line of a buffer, without the end of line
+	*/
+	template<typename F>
+	static void forEachLine(const char* p, size_t n, F f)
+	{
+		size_t start = 0;
+		forEachChar(p, n, '\n', [&](size_t pos) {
+			f(p + start, trimEol(p + start, pos - start));
+			start = pos + 1;
+		});
+		if (start < n) { f(p + start, trimEol(p + start, n - start)); }
+	}
+
+	/**
+	* @brief parse an integer, surrounding blanks allowed
+	*
+	* @return false if empty, not a number or out of range
+	*/
+	static bool parseInt64(const char* p, size_t n, int64_t& v)
+	{
+		trimBlanks(p, n);
+		if (n == 0) { return false; }
+		bool neg = false;
+		size_t i = 0;
+		if (p[0] == '-' || p[0] == '+') { neg = (p[0] == '-'); ++i; }
+		if (i == n) { return false; }
+		uint64_t u = 0;
+		const uint64_t limit = neg ? (uint64_t)std::numeric_limits<int64_t>::max() + 1 : (uint64_t)std::numeric_limits<int64_t>::max();
+		for (; i < n; ++i)
+		{
+			unsigned d = (unsigned)(p[i] - '0');
+			if (d > 9) { return false; }
+			if (u > (limit - d) / 10) { return false; }
+			u = u * 10 + d;
+		}
+		v = neg ? (int64_t)(0 - u) : (int64_t)u;
+		return true;
+	}
+
+	static bool parseInt(const char* p, size_t n, int& v)
+	{
+		int64_t x;
+		if (!parseInt64(p, n, x) || x < std::numeric_limits<int>::min() || x > std::numeric_limits<int>::max()) { return false; }
+		v = (int)x;
+		return true;
+	}
+
+	/**
+	* @brief parse a double, surrounding blanks allowed
+	*
+	*	Decimals of up to 19 significant digits with a power of ten within 1e22 are converted
+	*	exactly with one multiplication or division, the rest (long mantissas, large exponents,
+	*	nan, inf) with strtod.
+	*
+	* @return false if empty or not a number
+	*/
+	static bool parseDouble(const char* p, size_t n, double& v)
+	{
+		trimBlanks(p, n);
+		if (n == 0) { return false; }
+		size_t i = 0;
+		bool neg = false;
+		if (p[0] == '-' || p[0] == '+') { neg = (p[0] == '-'); ++i; }
+		uint64_t m = 0;
+		int digits = 0;
+		int exp10 = 0;
+		bool any = false;
+		for (; i < n && (unsigned)(p[i] - '0') <= 9; ++i, any = true)
+		{
+			if (m == 0 && p[i] == '0') { continue; }
+			if (digits < 19) { m = m * 10 + (unsigned)(p[i] - '0'); ++digits; }
+			else { return parseDoubleSlow(p, n, v); }
+		}
+		if (i < n && p[i] == '.')
+		{
+			for (++i; i < n && (unsigned)(p[i] - '0') <= 9; ++i, any = true)
+			{
+				if (m == 0 && p[i] == '0') { --exp10; continue; }
+				if (digits < 19) { m = m * 10 + (unsigned)(p[i] - '0'); ++digits; --exp10; }
+				else { return parseDoubleSlow(p, n, v); }
+			}
+		}
+		if (!any) { return parseDoubleSlow(p, n, v); }
+		if (i < n && (p[i] == 'e' || p[i] == 'E'))
+		{
+			int64_t e;
+			if (!parseInt64(p + i + 1, n - i - 1, e) || e < -10000 || e > 10000) { return parseDoubleSlow(p, n, v); }
+			exp10 += (int)e;
+			i = n;
+		}
+		if (i != n) { return parseDoubleSlow(p, n, v); }
+		if (m == 0) { v = neg ? -0.0 : 0.0; return true; }
+		if (m > (uint64_t(1) << 53) || exp10 < -22 || exp10 > 22) { return parseDoubleSlow(p, n, v); }
+		double d = (double)m;
+		d = exp10 < 0 ? d / pow10(-exp10) : d * pow10(exp10);
+		v = neg ? -d : d;
+		return true;
+	}
+
+	static bool parseInt64(const CsvField& f, int64_t& v) { return parseInt64(f.data(), f.size(), v); }
+	static bool parseInt(const CsvField& f, int& v) { return parseInt(f.data(), f.size(), v); }
+	static bool parseDouble(const CsvField& f, double& v) { return parseDouble(f.data(), f.size(), v); }
+
+	/** field as a number, 0 if it is not one */
+	static int64_t toInt64(const CsvField& f) { int64_t v = 0; return parseInt64(f, v) ? v : 0; }
+	static int toInt(const CsvField& f) { int v = 0; return parseInt(f, v) ? v : 0; }
+	static double toDouble(const CsvField& f) { double v = 0.0; return parseDouble(f, v) ? v : 0.0; }
+
+	/**
+	* @brief set a singular field of a protobuf message from a csv field
+	*
+	* @return false if the field is repeated or a message, or the value is not valid for it
+	*/
+	static bool setPBField(google::protobuf::Message* msg, const google::protobuf::FieldDescriptor* fd, const CsvField& f)
+	{
+		const google::protobuf::Reflection* refl = msg->GetReflection();
+		if (fd->is_repeated()) { return false; }
+		switch (fd->cpp_type())
+		{
+		case google::protobuf::FieldDescriptor::CPPTYPE_STRING:
+			refl->SetString(msg, fd, std::string(f.data(), f.size()));
+			return true;
+		case google::protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+		case google::protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+		{
+			double v;
+			if (!parseDouble(f, v)) { return false; }
+			if (fd->cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_DOUBLE) { refl->SetDouble(msg, fd, v); }
+			else { refl->SetFloat(msg, fd, (float)v); }
+			return true;
+		}
+		case google::protobuf::FieldDescriptor::CPPTYPE_ENUM:
+		{
+			int64_t v;
+			const google::protobuf::EnumValueDescriptor* ev = parseInt64(f, v)
+				? fd->enum_type()->FindValueByNumber((int)v)
+				: fd->enum_type()->FindValueByName(std::string(f.data(), f.size()));
+			if (!ev) { return false; }
+			refl->SetEnum(msg, fd, ev);
+			return true;
+		}
+		default:
+			break;
+		}
+		int64_t v;
+		if (!parseInt64(f, v)) { return false; }
+		switch (fd->cpp_type())
+		{
+		case google::protobuf::FieldDescriptor::CPPTYPE_INT32: refl->SetInt32(msg, fd, (google::protobuf::int32)v); return true;
+		case google::protobuf::FieldDescriptor::CPPTYPE_INT64: refl->SetInt64(msg, fd, (google::protobuf::int64)v); return true;
+		case google::protobuf::FieldDescriptor::CPPTYPE_UINT32: refl->SetUInt32(msg, fd, (google::protobuf::uint32)v); return true;
+		case google::protobuf::FieldDescriptor::CPPTYPE_UINT64: refl->SetUInt64(msg, fd, (google::protobuf::uint64)v); return true;
+		case google::protobuf::FieldDescriptor::CPPTYPE_BOOL: refl->SetBool(msg, fd, v != 0); return true;
+		default: return false;
+		}
+	}
+
+	/** add a csv field to a repeated scalar field of a protobuf message */
+	static bool addPBField(google::protobuf::Message* msg, const google::protobuf::FieldDescriptor* fd, const CsvField& f)
+	{
+		const google::protobuf::Reflection* refl = msg->GetReflection();
+		switch (fd->cpp_type())
+		{
+		case google::protobuf::FieldDescriptor::CPPTYPE_STRING: refl->AddString(msg, fd, std::string(f.data(), f.size())); return true;
+		case google::protobuf::FieldDescriptor::CPPTYPE_DOUBLE: { double v; if (!parseDouble(f, v)) { return false; } refl->AddDouble(msg, fd, v); return true; }
+		case google::protobuf::FieldDescriptor::CPPTYPE_FLOAT: { double v; if (!parseDouble(f, v)) { return false; } refl->AddFloat(msg, fd, (float)v); return true; }
+		case google::protobuf::FieldDescriptor::CPPTYPE_INT32: { int64_t v; if (!parseInt64(f, v)) { return false; } refl->AddInt32(msg, fd, (google::protobuf::int32)v); return true; }
+		case google::protobuf::FieldDescriptor::CPPTYPE_INT64: { int64_t v; if (!parseInt64(f, v)) { return false; } refl->AddInt64(msg, fd, (google::protobuf::int64)v); return true; }
+		case google::protobuf::FieldDescriptor::CPPTYPE_UINT32: { int64_t v; if (!parseInt64(f, v)) { return false; } refl->AddUInt32(msg, fd, (google::protobuf::uint32)v); return true; }
+		case google::protobuf::FieldDescriptor::CPPTYPE_UINT64: { int64_t v; if (!parseInt64(f, v)) { return false; } refl->AddUInt64(msg, fd, (google::protobuf::uint64)v); return true; }
+		case google::protobuf::FieldDescriptor::CPPTYPE_BOOL: { int64_t v; if (!parseInt64(f, v)) { return false; } refl->AddBool(msg, fd, v != 0); return true; }
+		default: return false;
+		}
+	}
+
+	static size_t trimEol(const char* p, size_t n)
+	{
+		while (n > 0 && (p[n - 1] == '\n' || p[n - 1] == '\r')) { --n; }
+		return n;
+	}
+
+protected:
+	static void trimBlanks(const char*& p, size_t& n)
+	{
+		while (n > 0 && (p[0] == ' ' || p[0] == '\t')) { ++p; --n; }
+		while (n > 0 && (p[n - 1] == ' ' || p[n - 1] == '\t' || p[n - 1] == '\r')) { --n; }
+	}
+
+	static double pow10(int e)
+	{
+		static const double table[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		return table[e];
+	}
+
+	static bool parseDoubleSlow(const char* p, size_t n, double& v)
+	{
+		char buf[128];
+		std::string big;
+		const char* s;
+		if (n < sizeof(buf))
+		{
+			std::memcpy(buf, p, n);
+			buf[n] = '\0';
+			s = buf;
+		}
+		else
+		{
+			big.assign(p, n);
+			s = big.c_str();
+		}
+		char* end = nullptr;
+		double d = std::strtod(s, &end);
+		if (end == s) { return false; }
+		v = d;
+		return true;
+	}
+
+#ifdef XT_CSV_UTIL_SSE2
+	static unsigned ctz(unsigned x)
+	{
+#if defined(_MSC_VER)
+		unsigned long i;
+		_BitScanForward(&i, x);
+		return (unsigned)i;
+#else
+		return (unsigned)__builtin_ctz(x);
+#endif
+	}
+#endif
+};//class CsvUtil
+
+}//namespace XT
+
+#endif
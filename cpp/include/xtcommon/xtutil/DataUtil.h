@@ -26,6 +26,7 @@
 #include <iomanip>
 
 #include <vector>
+#include <algorithm>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>		 
@@ -65,6 +66,7 @@
 #include "json/json.h"
 
 #include "StringUtil.h"
+#include "CsvUtil.h"
 #include "PBUtil.h"
 
 #include "LogUtil.h"
@@ -89,12 +91,12 @@ public:
 	/**
 	* @brief copy constructor
 	*/
-	DataUtil(const DataUtil& from) {} // = delete;
+	DataUtil(const DataUtil&) {} // = delete;
 
 	/**
 	* @brief copy assignment
 	*/
-	DataUtil& operator=(const DataUtil& from) { return *this; } // = delete;
+	DataUtil& operator=(const DataUtil&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
@@ -2868,6 +2870,55 @@ public:
 
 	//////end_PyAT_OrderData
 
+	//////begin_PlainCsvView
+	/**
+	* @brief fill a message from a plain csv line without copying the fields
+	*
+	*	Same layout as the parse*FromPlainCsvStr functions: after skipcols, the singular fields
+	*	in declaration order, a repeated scalar field takes the remaining columns. Empty columns
+	*	leave their field unset. Messages with map or message fields are not supported.
+	*
+	* @param s as line
+	* @param n as line length
+	* @param msg as message to fill, not cleared
+	* @param sep as delimiter
+	* @param skipcols as leading columns to skip
+	* @param fields as reusable buffer of the split fields
+	*
+	* @return false if a column is not valid for its field or the message is not supported
+	*/
+	static bool parsePBMsgFromPlainCsvView(const char* s, size_t n, google::protobuf::Message* msg, const std::string& sep, int skipcols, CsvFields& fields)
+	{
+		CsvUtil::split(s, n, sep, fields);
+		const google::protobuf::Descriptor* desc = msg->GetDescriptor();
+		size_t col = (size_t)std::max(0, skipcols);
+		for (int i = 0; i < desc->field_count() && col < fields.size(); ++i)
+		{
+			const google::protobuf::FieldDescriptor* fd = desc->field(i);
+			if (fd->cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) { return false; }
+			if (fd->is_repeated())
+			{
+				for (; col < fields.size(); ++col)
+				{
+					if (!CsvUtil::addPBField(msg, fd, fields[col])) { return false; }
+				}
+				break;
+			}
+			const CsvField& f = fields[col++];
+			if (f.empty()) { continue; }
+			if (!CsvUtil::setPBField(msg, fd, f)) { return false; }
+		}
+		return true;
+	}
+
+	static bool parsePBMsgFromPlainCsvView(const char* s, size_t n, google::protobuf::Message* msg, const std::string& sep = "|", int skipcols = 0)
+	{
+		CsvFields fields;
+		return parsePBMsgFromPlainCsvView(s, n, msg, sep, skipcols, fields);
+	}
+
+	//////end_PlainCsvView
+
 
 
 
@@ -44,12 +44,12 @@ public:
 	/**
 	* @brief copy constructor
 	*/
-	EnumUtil(const EnumUtil& from) {} // = delete;
+	EnumUtil(const EnumUtil&) {} // = delete;
 
 	/**
 	* @brief copy assignment
 	*/
-	EnumUtil& operator=(const EnumUtil& from) { return *this; } // = delete;
+	EnumUtil& operator=(const EnumUtil&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
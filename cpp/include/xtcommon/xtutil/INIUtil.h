@@ -61,12 +61,12 @@ public:
 	/**
 	* @brief copy constructor
 	*/
-	INIUtil(const INIUtil& from) {} // = delete;
+	INIUtil(const INIUtil&) {} // = delete;
 
 	/**
 	* @brief copy assignment
 	*/
-	INIUtil& operator=(const INIUtil& from) { return *this; } // = delete;
+	INIUtil& operator=(const INIUtil&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
@@ -225,12 +225,12 @@ public:
 	/**
 	* @brief copy constructor
 	*/
-	PBUtil(const PBUtil& from) {} // = delete;
+	PBUtil(const PBUtil&) {} // = delete;
 
 	/**
 	* @brief copy assignment
 	*/
-	PBUtil& operator=(const PBUtil& from) { return *this; } // = delete;
+	PBUtil& operator=(const PBUtil&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
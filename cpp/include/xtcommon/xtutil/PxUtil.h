@@ -50,12 +50,12 @@ public:
 	/**
 	* @brief copy constructor
 	*/
-	PxUtil(const PxUtil& from) {} // = delete;
+	PxUtil(const PxUtil&) {} // = delete;
 
 	/**
 	* @brief copy assignment
 	*/
-	PxUtil& operator=(const PxUtil& from) { return *this; } // = delete;
+	PxUtil& operator=(const PxUtil&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
@@ -40,12 +40,12 @@ public:
 	/**
 	* @brief copy constructor
 	*/
-	QLUtil(const QLUtil& from) {} // = delete;
+	QLUtil(const QLUtil&) {} // = delete;
 
 	/**
 	* @brief copy assignment
 	*/
-	QLUtil& operator=(const QLUtil& from) { return *this; } // = delete;
+	QLUtil& operator=(const QLUtil&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor
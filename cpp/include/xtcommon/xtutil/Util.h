@@ -105,12 +105,12 @@ public:
 	/**
 	* @brief copy constructor
 	*/
-	Util(const Util& from) {} // = delete;
+	Util(const Util&) {} // = delete;
 
 	/**
 	* @brief copy assignment
 	*/
-	Util& operator=(const Util& from) { return *this; } // = delete;
+	Util& operator=(const Util&) { return *this; } // = delete;
 
 	/**
 	* @brief destructor